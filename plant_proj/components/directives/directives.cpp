@@ -0,0 +1,277 @@
+#include <esp_log.h>
+#include <esp_attr.h>
+#include <string.h>
+#include "leaf_config.hpp"
+#include "moisture_sensor.hpp"
+#include "event_log.hpp"
+#include "directives.hpp"
+
+#if DIRECTIVES_ENABLED
+
+const uint32_t DIRECTIVE_MIN_SLEEP_S = 8; //MIN_SLEEP_DURATION of adaptive sampling
+const uint32_t DIRECTIVE_MAX_SLEEP_S = 86400; //a day
+
+static const char* _logger = "Directives *** ";
+static const size_t TOKEN_LEN = 16; //longest key or literal that can be a directive, longer ones are skipped
+
+//the whole parser lives in this arena, nothing is allocated per response
+typedef struct {
+    directive_parse_state_t state;
+    char key[TOKEN_LEN];
+    size_t key_len; //TOKEN_LEN once the key overflowed
+    char literal[TOKEN_LEN];
+    size_t literal_len;
+    uint8_t depth; //nesting of a skipped object or array value
+    bool in_string; //inside a string of a skipped nested value
+    bool escaped; //previous character was a backslash
+
+    //directives of the current response
+    bool has_sleep_interval;
+    uint32_t sleep_interval_s;
+    bool has_sample_size;
+    uint16_t sample_size;
+    bool flush_backlog;
+} directive_parser_t;
+
+static directive_parser_t _parser;
+
+//set by a flush directive and kept across deep sleep until the flash queue is empty
+RTC_DATA_ATTR static bool _flush_pending = false;
+
+void directives_begin_response() {
+    memset(&_parser, 0, sizeof(_parser));
+    _parser.state = DIRECTIVE_PARSE_SEEK_OBJECT;
+}
+
+void directives_feed(const char* data, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        if (_parser.state == DIRECTIVE_PARSE_DONE || _parser.state == DIRECTIVE_PARSE_ERROR) {
+            return;
+        }
+        _parse_char(data[i]);
+    }
+}
+
+void directives_end_response(bool accepted) {
+    //a truncated body or a rejected request might not mean what it says
+    if (!accepted || _parser.state != DIRECTIVE_PARSE_DONE) {
+        return;
+    }
+
+    bool changed = false;
+    if (_parser.has_sleep_interval && _parser.sleep_interval_s != leaf_settings.sleep_interval_s) {
+        EVENT_LOG_I(EVT_DIRECTIVE_SLEEP, _parser.sleep_interval_s);
+        leaf_settings.sleep_interval_s = _parser.sleep_interval_s;
+        changed = true;
+    }
+    if (_parser.has_sample_size && _parser.sample_size != leaf_settings.sample_size) {
+        EVENT_LOG_I(EVT_DIRECTIVE_SAMPLES, _parser.sample_size);
+        leaf_settings.sample_size = _parser.sample_size;
+        changed = true;
+    }
+    if (_parser.flush_backlog && !_flush_pending) {
+        EVENT_LOG_I(EVT_DIRECTIVE_FLUSH);
+        _flush_pending = true;
+    }
+
+    //the backend usually repeats its directives on every response, nvs is only written when they change
+    if (changed && leaf_config_save() != ESP_OK) {
+        ESP_LOGE(_logger, "ERROR! Unable to save the server's directives, they're only applied until the next cold boot");
+    }
+}
+
+bool directives_flush_pending() {
+    return _flush_pending;
+}
+
+void directives_flush_done() {
+    _flush_pending = false;
+}
+
+void _parse_char(char c) {
+    bool space = (c == ' ' || c == '\t' || c == '\r' || c == '\n');
+
+    switch (_parser.state) {
+        case DIRECTIVE_PARSE_SEEK_OBJECT:
+            if (c == '{') {
+                _parser.state = DIRECTIVE_PARSE_SEEK_KEY;
+            } else if (!space) {
+                _parser.state = DIRECTIVE_PARSE_ERROR;
+            }
+            break;
+        case DIRECTIVE_PARSE_SEEK_KEY:
+            if (c == '"') {
+                _parser.key_len = 0;
+                _parser.state = DIRECTIVE_PARSE_KEY;
+            } else if (c == '}') {
+                _parser.state = DIRECTIVE_PARSE_DONE;
+            } else if (!space) {
+                _parser.state = DIRECTIVE_PARSE_ERROR;
+            }
+            break;
+        case DIRECTIVE_PARSE_KEY:
+            if (_parser.escaped) {
+                _parser.escaped = false;
+                _parser.key_len = TOKEN_LEN; //no directive has an escape in its name
+            } else if (c == '\\') {
+                _parser.escaped = true;
+            } else if (c == '"') {
+                _parser.state = DIRECTIVE_PARSE_SEEK_COLON;
+            } else if (_parser.key_len < TOKEN_LEN - 1) {
+                _parser.key[_parser.key_len++] = c;
+            } else {
+                _parser.key_len = TOKEN_LEN;
+            }
+            break;
+        case DIRECTIVE_PARSE_SEEK_COLON:
+            if (c == ':') {
+                _parser.state = DIRECTIVE_PARSE_SEEK_VALUE;
+            } else if (!space) {
+                _parser.state = DIRECTIVE_PARSE_ERROR;
+            }
+            break;
+        case DIRECTIVE_PARSE_SEEK_VALUE:
+            if (c == '"') {
+                _parser.state = DIRECTIVE_PARSE_STRING_VALUE;
+            } else if (c == '{' || c == '[') {
+                _parser.depth = 1;
+                _parser.state = DIRECTIVE_PARSE_NESTED_VALUE;
+            } else if (c == ',' || c == '}' || c == ':' || c == ']') {
+                _parser.state = DIRECTIVE_PARSE_ERROR;
+            } else if (!space) {
+                _parser.literal[0] = c;
+                _parser.literal_len = 1;
+                _parser.state = DIRECTIVE_PARSE_LITERAL;
+            }
+            break;
+        case DIRECTIVE_PARSE_STRING_VALUE:
+            if (_parser.escaped) {
+                _parser.escaped = false;
+            } else if (c == '\\') {
+                _parser.escaped = true;
+            } else if (c == '"') {
+                _parser.state = DIRECTIVE_PARSE_SEEK_COMMA;
+            }
+            break;
+        case DIRECTIVE_PARSE_NESTED_VALUE:
+            if (_parser.in_string) {
+                if (_parser.escaped) {
+                    _parser.escaped = false;
+                } else if (c == '\\') {
+                    _parser.escaped = true;
+                } else if (c == '"') {
+                    _parser.in_string = false;
+                }
+            } else if (c == '"') {
+                _parser.in_string = true;
+            } else if (c == '{' || c == '[') {
+                _parser.depth += 1;
+                if (_parser.depth == 0) {
+                    _parser.state = DIRECTIVE_PARSE_ERROR; //nested deeper than the counter goes
+                }
+            } else if (c == '}' || c == ']') {
+                _parser.depth -= 1;
+                if (_parser.depth == 0) {
+                    _parser.state = DIRECTIVE_PARSE_SEEK_COMMA;
+                }
+            }
+            break;
+        case DIRECTIVE_PARSE_LITERAL:
+            if (c == ',' || c == '}' || space) {
+                _complete_value();
+                if (c == ',') {
+                    _parser.state = DIRECTIVE_PARSE_SEEK_KEY;
+                } else if (c == '}') {
+                    _parser.state = DIRECTIVE_PARSE_DONE;
+                } else {
+                    _parser.state = DIRECTIVE_PARSE_SEEK_COMMA;
+                }
+            } else if (_parser.literal_len < TOKEN_LEN - 1) {
+                _parser.literal[_parser.literal_len++] = c;
+            } else {
+                _parser.literal_len = TOKEN_LEN; //too long for any valid value
+            }
+            break;
+        case DIRECTIVE_PARSE_SEEK_COMMA:
+            if (c == ',') {
+                _parser.state = DIRECTIVE_PARSE_SEEK_KEY;
+            } else if (c == '}') {
+                _parser.state = DIRECTIVE_PARSE_DONE;
+            } else if (!space) {
+                _parser.state = DIRECTIVE_PARSE_ERROR;
+            }
+            break;
+        case DIRECTIVE_PARSE_DONE:
+        case DIRECTIVE_PARSE_ERROR:
+            break;
+    }
+}
+
+void _complete_value() {
+    if (_parser.key_len >= TOKEN_LEN) {
+        return;
+    }
+    _parser.key[_parser.key_len] = '\0';
+
+    bool valid = true;
+    if (strcmp(_parser.key, "sleep_s") == 0) {
+        uint32_t value = 0;
+        valid = _parse_uint(&value) && value >= DIRECTIVE_MIN_SLEEP_S && value <= DIRECTIVE_MAX_SLEEP_S;
+        if (valid) {
+            _parser.has_sleep_interval = true;
+            _parser.sleep_interval_s = value;
+        }
+    } else if (strcmp(_parser.key, "samples") == 0) {
+        uint32_t value = 0;
+        //and no more than a continuous capture of every plant converts within its frame budget
+        valid = _parse_uint(&value) && value > 0 && value <= MAX_SAMPLE_SIZE
+            && value <= static_cast<uint32_t>(moisture_sensor_max_samples(leaf_info.plant_count));
+        if (valid) {
+            _parser.has_sample_size = true;
+            _parser.sample_size = static_cast<uint16_t>(value);
+        }
+    } else if (strcmp(_parser.key, "flush") == 0) {
+        valid = _parse_bool(&_parser.flush_backlog);
+    }
+
+    //the other directives of the response still apply
+    if (!valid) {
+        EVENT_LOG_W(EVT_DIRECTIVE_INVALID);
+    }
+}
+
+bool _parse_uint(uint32_t* out) {
+    if (_parser.literal_len == 0 || _parser.literal_len >= TOKEN_LEN) {
+        return false;
+    }
+
+    uint32_t value = 0;
+    for (size_t i = 0; i < _parser.literal_len; ++i) {
+        char c = _parser.literal[i];
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        uint32_t digit = static_cast<uint32_t>(c - '0');
+        if (value > (UINT32_MAX - digit) / 10) {
+            return false;
+        }
+        value = value * 10 + digit;
+    }
+
+    *out = value;
+    return true;
+}
+
+bool _parse_bool(bool* out) {
+    if (_parser.literal_len == 4 && memcmp(_parser.literal, "true", 4) == 0) {
+        *out = true;
+        return true;
+    }
+    if (_parser.literal_len == 5 && memcmp(_parser.literal, "false", 5) == 0) {
+        *out = false;
+        return true;
+    }
+    return false;
+}
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef DIRECTIVES_HPP
+#define DIRECTIVES_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Downlink directives the backend can put in the body of its response to a POST, as a flat json object:
+ *
+ *     {"sleep_s": 60, "samples": 32, "flush": true}
+ *
+ * sleep_s sets leaf_settings.sleep_interval_s, the shortest interval adaptive sampling sleeps for. samples sets
+ * leaf_settings.sample_size, up to what moisture_sensor_max_samples allows for the node's plants. both are saved with leaf_config_save so they survive a cold boot. flush asks the
+ * node to send its whole flash queue instead of FLASH_DRAIN_MAX_BATCHES requests worth, it's kept in rtc memory
+ * until the queue is empty
+ *
+ * the body is parsed as it arrives, chunk by chunk, with a fixed size token buffer so nothing is allocated or
+ * copied. unknown keys, string values and nested values are skipped, and a body that isn't a json object
+ * (ie "ok") is ignored. directives only take effect once the whole response was read and the backend
+ * accepted the request
+ *
+ * the transports call the parser through the DIRECTIVES_* macros so building with DIRECTIVES_ENABLED=0 leaves
+ * the config alone whatever the backend answers (ie tools/fleet_sim, where every thread is a node)
+ */
+
+#ifndef DIRECTIVES_ENABLED
+#define DIRECTIVES_ENABLED 1
+#endif
+
+#if DIRECTIVES_ENABLED
+
+#define DIRECTIVES_BEGIN_RESPONSE() directives_begin_response()
+#define DIRECTIVES_FEED(data, len) directives_feed(data, len)
+#define DIRECTIVES_END_RESPONSE(accepted) directives_end_response(accepted)
+
+extern const uint32_t DIRECTIVE_MIN_SLEEP_S; //range accepted for sleep_s
+extern const uint32_t DIRECTIVE_MAX_SLEEP_S;
+
+/**
+ * Resets the parser. called before every request
+ */
+void directives_begin_response();
+
+/**
+ * Parses the next chunk of the response body
+ * @param data chunk, not null terminated
+ * @param len size of the chunk
+ */
+void directives_feed(const char* data, size_t len);
+
+/**
+ * Ends the response and applies its directives. the config is only saved if a value actually changed
+ * @param accepted true if the backend accepted the request. directives of a failed request are dropped
+ */
+void directives_end_response(bool accepted);
+
+/**
+ * @return returns true while a flush directive is waiting for the flash queue to be emptied
+ */
+bool directives_flush_pending();
+
+/**
+ * Clears the flush directive. called once the flash queue is empty
+ */
+void directives_flush_done();
+
+//parser states, one per position in the json object
+typedef enum {
+    DIRECTIVE_PARSE_SEEK_OBJECT, //before the opening brace
+    DIRECTIVE_PARSE_SEEK_KEY,
+    DIRECTIVE_PARSE_KEY,
+    DIRECTIVE_PARSE_SEEK_COLON,
+    DIRECTIVE_PARSE_SEEK_VALUE,
+    DIRECTIVE_PARSE_STRING_VALUE, //skipped, no directive takes a string
+    DIRECTIVE_PARSE_NESTED_VALUE, //objects and arrays are skipped
+    DIRECTIVE_PARSE_LITERAL, //number, true, false or null
+    DIRECTIVE_PARSE_SEEK_COMMA,
+    DIRECTIVE_PARSE_DONE,
+    DIRECTIVE_PARSE_ERROR, //not a json object, the rest of the body is ignored
+} directive_parse_state_t;
+
+/**
+ * Handles one character of the body
+ * @param c next character
+ */
+void _parse_char(char c);
+
+/**
+ * Called when a key's value is complete. stores it if the key is a directive and the value is valid
+ */
+void _complete_value();
+
+/**
+ * Parses the literal in the token buffer as an unsigned integer
+ * @param out set to the value
+ * @return returns false if it isn't a number or doesn't fit in 32 bits
+ */
+bool _parse_uint(uint32_t* out);
+
+/**
+ * Parses the literal in the token buffer as true or false
+ * @param out set to the value
+ * @return returns false if it isn't a boolean
+ */
+bool _parse_bool(bool* out);
+
+#else
+
+#define DIRECTIVES_BEGIN_RESPONSE() ((void)0)
+#define DIRECTIVES_FEED(data, len) ((void)0)
+#define DIRECTIVES_END_RESPONSE(accepted) ((void)0)
+
+#endif
+
+#endif
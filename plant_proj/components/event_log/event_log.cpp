@@ -0,0 +1,104 @@
+#include <freertos/FreeRTOS.h>
+#include <esp_attr.h>
+#include <stdio.h>
+#include <string.h>
+#include "sleep_hal.hpp"
+#include "event_log.hpp"
+
+#ifndef RTC_NOINIT_ATTR
+#define RTC_NOINIT_ATTR
+#endif
+
+static const uint32_t EVENT_LOG_MAGIC = 0x454C4F47; //"ELOG"
+
+typedef struct {
+    uint32_t magic; //EVENT_LOG_MAGIC once the ring was initialized
+    uint32_t head; //entries ever written, the next one goes to head % EVENT_LOG_CAPACITY
+    uint32_t dumped; //value of head at the last dump
+    uint16_t wake;
+    bool dump_requested;
+    event_log_entry_t entries[EVENT_LOG_CAPACITY];
+} event_log_t;
+
+//not initialized on boot so the ring is still there after a panic or watchdog reset
+RTC_NOINIT_ATTR static event_log_t _log;
+
+//the sampling task and the wifi/http event handlers record at the same time as the tracker task
+static portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+
+void event_log_begin_wake() {
+    bool valid = _log.magic == EVENT_LOG_MAGIC && _log.dumped <= _log.head;
+    if (!valid) {
+        memset(&_log, 0, sizeof(_log));
+        _log.magic = EVENT_LOG_MAGIC;
+    }
+
+    if (valid && sleep_hal_crashed()) {
+        //recorded in the new wake so the dump shows where the crashed wake's entries end
+        _log.wake += 1;
+        event_log_write(EVENT_LOG_LEVEL_ERROR, EVT_CRASH_RECOVERED);
+        return;
+    }
+
+    _log.wake += 1;
+}
+
+void event_log_write(uint8_t level, event_id_t id, int32_t arg0, int32_t arg1) {
+    uint32_t now = static_cast<uint32_t>(sleep_hal_time_us());
+
+    portENTER_CRITICAL(&_lock);
+    event_log_entry_t& entry = _log.entries[_log.head % EVENT_LOG_CAPACITY];
+    entry.time_us = now;
+    entry.wake = _log.wake;
+    entry.id = id;
+    entry.level = level;
+    entry.args[0] = arg0;
+    entry.args[1] = arg1;
+    _log.head += 1;
+
+    if (level == EVENT_LOG_LEVEL_ERROR) {
+        _log.dump_requested = true;
+    }
+    portEXIT_CRITICAL(&_lock);
+}
+
+void event_log_request_dump() {
+    _log.dump_requested = true;
+}
+
+void event_log_flush() {
+    if (_log.dump_requested || EVENT_LOG_DUMP_ALWAYS) {
+        event_log_dump();
+    }
+}
+
+void event_log_dump() {
+    //entries older than a full ring were overwritten
+    uint32_t start = _log.dumped;
+    uint32_t lost = 0;
+    if (_log.head - start > EVENT_LOG_CAPACITY) {
+        lost = _log.head - start - EVENT_LOG_CAPACITY;
+        start = _log.head - EVENT_LOG_CAPACITY;
+    }
+
+    //written with printf so the dump goes out whatever the log level is
+    printf("ELOG-BEGIN %u %u\n", static_cast<unsigned>(_log.head - start), static_cast<unsigned>(lost));
+    for (uint32_t i = start; i != _log.head; ++i) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&_log.entries[i % EVENT_LOG_CAPACITY]);
+
+        char line[5 + 2 * sizeof(event_log_entry_t) + 1] = "ELOG:";
+        for (size_t b = 0; b < sizeof(event_log_entry_t); ++b) {
+            snprintf(line + 5 + 2 * b, 3, "%02x", bytes[b]);
+        }
+        printf("%s\n", line);
+    }
+    printf("ELOG-END\n");
+
+    _log.dumped = _log.head;
+    _log.dump_requested = false;
+}
+
+size_t event_log_pending() {
+    uint32_t pending = _log.head - _log.dumped;
+    return (pending > EVENT_LOG_CAPACITY) ? EVENT_LOG_CAPACITY : pending;
+}
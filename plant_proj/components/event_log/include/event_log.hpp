@@ -0,0 +1,114 @@
+#ifndef EVENT_LOG_HPP
+#define EVENT_LOG_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include "event_log_events.hpp"
+
+/**
+ * Deferred binary log. instead of formatting a string and pushing it out over the uart, a log site stores its
+ * event id and up to 2 integer args in a ring buffer in rtc memory (16 bytes, a few hundred ns). the ring is
+ * only written out when a dump was asked for or an error was recorded, and tools/event_log_decode.py turns the
+ * dump back into text using the formats in event_log_events.hpp
+ *
+ * the ring is kept in RTC_NOINIT memory so it survives deep sleep and also panics and watchdog resets, the wake
+ * after a crash dumps what led up to it
+ *
+ * sites go through the EVENT_LOG_* macros. the ones above EVENT_LOG_LEVEL compile to nothing (their args aren't
+ * evaluated either)
+ */
+
+#define EVENT_LOG_LEVEL_NONE 0
+#define EVENT_LOG_LEVEL_ERROR 1
+#define EVENT_LOG_LEVEL_WARN 2
+#define EVENT_LOG_LEVEL_INFO 3
+#define EVENT_LOG_LEVEL_DEBUG 4
+
+#ifndef EVENT_LOG_LEVEL
+#define EVENT_LOG_LEVEL EVENT_LOG_LEVEL_INFO
+#endif
+
+//set to 1 to dump at the end of every wake, ie on the host build piped into the decoder
+#ifndef EVENT_LOG_DUMP_ALWAYS
+#define EVENT_LOG_DUMP_ALWAYS 0
+#endif
+
+#define EVENT_LOG_CAPACITY 64 //entries in the ring, 1kb of rtc memory
+
+#define EVENT_LOG_ENUM(name, format) name,
+typedef enum : uint8_t {
+    EVENT_LOG_EVENTS(EVENT_LOG_ENUM)
+    EVT_COUNT
+} event_id_t;
+#undef EVENT_LOG_ENUM
+
+typedef struct {
+    uint32_t time_us; //since the start of the wake
+    uint16_t wake; //wake it was recorded in, wraps around
+    uint8_t id; //event_id_t
+    uint8_t level; //EVENT_LOG_LEVEL_*
+    int32_t args[2]; //unused args are 0
+} event_log_entry_t;
+
+#if EVENT_LOG_LEVEL >= EVENT_LOG_LEVEL_ERROR
+#define EVENT_LOG_E(...) event_log_write(EVENT_LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define EVENT_LOG_E(...) ((void)0)
+#endif
+
+#if EVENT_LOG_LEVEL >= EVENT_LOG_LEVEL_WARN
+#define EVENT_LOG_W(...) event_log_write(EVENT_LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define EVENT_LOG_W(...) ((void)0)
+#endif
+
+#if EVENT_LOG_LEVEL >= EVENT_LOG_LEVEL_INFO
+#define EVENT_LOG_I(...) event_log_write(EVENT_LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define EVENT_LOG_I(...) ((void)0)
+#endif
+
+#if EVENT_LOG_LEVEL >= EVENT_LOG_LEVEL_DEBUG
+#define EVENT_LOG_D(...) event_log_write(EVENT_LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define EVENT_LOG_D(...) ((void)0)
+#endif
+
+/**
+ * Starts a new wake in the log. validates the ring (it's garbage after a power on) and asks for a dump if the
+ * last reset was a crash. called first thing in the wake cycle
+ */
+void event_log_begin_wake();
+
+/**
+ * Records an event. meant to be called through the EVENT_LOG_* macros
+ * @param level EVENT_LOG_LEVEL_*. errors also ask for a dump at the end of the wake
+ * @param id event
+ * @param arg0 first arg of the event's format
+ * @param arg1 second arg of the event's format
+ */
+void event_log_write(uint8_t level, event_id_t id, int32_t arg0 = 0, int32_t arg1 = 0);
+
+/**
+ * Asks for the log to be dumped at the end of the wake
+ */
+void event_log_request_dump();
+
+/**
+ * Dumps the log if it was asked for, an error was recorded or EVENT_LOG_DUMP_ALWAYS is set. called before
+ * going to sleep
+ */
+void event_log_flush();
+
+/**
+ * Writes every entry recorded since the last dump to the console, one "ELOG:<hex>" line each, for
+ * tools/event_log_decode.py
+ */
+void event_log_dump();
+
+/**
+ * @return returns the number of entries recorded since the last dump that are still in the ring
+ */
+size_t event_log_pending();
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef EVENT_LOG_EVENTS_HPP
+#define EVENT_LOG_EVENTS_HPP
+
+/**
+ * Every event the event log can record. an event's id is its position in the list and the format string is
+ * only read by tools/event_log_decode.py, it isn't compiled into the firmware. new events go at the end so
+ * old dumps still decode. the decoder parses this file so keep one X(NAME, "format") per line
+ *
+ * formats take up to 2 integer args (%d, %u, %x)
+ */
+
+#define EVENT_LOG_EVENTS(X) \
+    X(EVT_WAKE, "wake %u") \
+    X(EVT_SLEEP, "entering deep sleep for %u ms") \
+    X(EVT_CRASH_RECOVERED, "last reset was a crash, dumping the log of the crashed wake") \
+    X(EVT_UPLOAD_SKIPPED, "upload not due yet, skipping wifi") \
+    X(EVT_UPLOAD_OVERLAP, "upload expected, sampling while wifi connects") \
+    X(EVT_UPLOAD_FAILED, "upload failed with %u readings in the rtc buffer") \
+    X(EVT_SENSOR_INIT, "sensor initialized, %u channels x %d samples") \
+    X(EVT_SAMPLED, "sampling took %d us") \
+    X(EVT_CHANNEL_VALUE, "channel %u: %d percent (scaled)") \
+    X(EVT_HEARTBEAT, "no upload for %u wakes, forcing a heartbeat") \
+    X(EVT_DEADBAND, "readings within the deadband, not reporting them") \
+    X(EVT_NEXT_SLEEP, "fastest trend %d units/min, sleeping for %u s") \
+    X(EVT_BUFFERED, "buffered reading from wake %u, %u stored") \
+    X(EVT_FLUSH_FILL, "buffer reached its fill level of %u readings") \
+    X(EVT_FLUSH_AGE, "oldest buffered reading is %u wakes old") \
+    X(EVT_PHASE, "phase %u took %u us") \
+    X(EVT_WIFI_CONNECTING, "connecting to wifi") \
+    X(EVT_WIFI_CONNECTED, "associated on channel %u") \
+    X(EVT_WIFI_DISCONNECTED, "disconnected, reason %u") \
+    X(EVT_WIFI_FAILED, "wifi connection failed, %u in a row") \
+    X(EVT_GOT_IP, "got ip %08x") \
+    X(EVT_HTTP_CONNECTED, "http connected") \
+    X(EVT_HTTP_HEADER_SENT, "http headers sent") \
+    X(EVT_HTTP_HEADER, "http response header") \
+    X(EVT_HTTP_DATA, "http response data, %d bytes") \
+    X(EVT_HTTP_FINISH, "http request finished") \
+    X(EVT_HTTP_DISCONNECTED, "http disconnected") \
+    X(EVT_HTTP_ERROR, "http error") \
+    X(EVT_POST, "posting %u readings, mode %u") \
+    X(EVT_DIRECTIVE_SLEEP, "server set the sleep interval to %u s") \
+    X(EVT_DIRECTIVE_SAMPLES, "server set the sample size to %u") \
+    X(EVT_DIRECTIVE_FLUSH, "server asked for the flash queue to be flushed") \
+    X(EVT_DIRECTIVE_INVALID, "ignored a server directive with an invalid value") \
+    X(EVT_TIME_SYNCED, "clock synced, moved by %d ms, drift %d ppm") \
+    X(EVT_TIME_SYNC_FAILED, "clock sync failed") \
+    X(EVT_MQTT_CONNECTED, "mqtt connected, session present %u") \
+    X(EVT_MQTT_DISCONNECTED, "mqtt disconnected") \
+    X(EVT_MQTT_ERROR, "mqtt error") \
+    X(EVT_RING_OVERFLOW, "reading ring full, dropped %u readings") \
+    X(EVT_RAW_CAPTURE, "captured raw samples, mode %u, %u bytes") \
+    X(EVT_CHANNEL_EMPTY, "channel %u got no samples, no reading") \
+    X(EVT_BOOT_TO_SLEEP_FULL, "full boot to sleep took %d ms") \
+    X(EVT_BOOT_TO_SLEEP_TIMER, "timer wake to sleep took %d ms, mean %d ms since power on")
+
+#endif
@@ -0,0 +1,391 @@
+#include <esp_log.h>
+#include <esp_attr.h>
+#include <esp_partition.h>
+#include <string.h>
+#include <stddef.h>
+#include "flash_queue.hpp"
+
+const char* FLASH_QUEUE_PARTITION = "readings";
+const flash_queue_policy_t FLASH_QUEUE_POLICY = FLASH_QUEUE_DROP_OLDEST; //recent readings matter more than old ones
+
+static const char* _logger = "Flash Queue *** ";
+static const uint32_t SECTOR_SIZE = 4096; //erase unit of the flash
+static const uint32_t SECTOR_MAGIC = 0x464C5132; //"FLQ2", sectors of an older entry layout are treated as unused
+static const uint32_t STATE_MAGIC = 0x464C5153; //"FLQS"
+
+//states of an entry. each one only clears bits of the previous so they're programmed without an erase
+static const uint8_t ENTRY_WRITTEN = 0xFE;
+static const uint8_t ENTRY_SENT = 0xFC;
+
+typedef struct {
+    uint32_t magic; //SECTOR_MAGIC once the sector was started
+    uint32_t seq; //increases every time a sector is started, the lowest valid one is the oldest sector
+    uint8_t reserved[8];
+} sector_header_t;
+
+typedef struct {
+    uint8_t state; //0xFF while erased, then ENTRY_WRITTEN, then ENTRY_SENT
+    uint8_t reserved0;
+    uint16_t crc; //crc16 of every byte after it
+    uint32_t wake_id;
+    int32_t moisture;
+    uint32_t timestamp;
+    uint16_t time_error_s;
+    uint8_t plant_id;
+    uint8_t reserved1;
+} flash_entry_t;
+
+static const uint32_t SLOTS_PER_SECTOR = (SECTOR_SIZE - sizeof(sector_header_t)) / sizeof(flash_entry_t);
+
+//positions survive deep sleep so the partition is only scanned on a cold boot
+typedef struct {
+    uint32_t magic; //STATE_MAGIC once the partition was scanned
+    uint32_t head; //oldest slot that may hold a reading waiting to be sent
+    uint32_t tail; //slot the next reading is written to. head == tail when the queue is empty, or full (depth > 0)
+    uint32_t next_seq; //sequence number of the next sector that's started
+    flash_queue_stats_t stats;
+} queue_state_t;
+
+RTC_DATA_ATTR static queue_state_t _state;
+static const esp_partition_t* _partition = NULL;
+static uint32_t _sector_count = 0;
+static uint32_t _slot_count = 0;
+
+esp_err_t flash_queue_init() {
+    if (_partition != NULL) {
+        return ESP_OK;
+    }
+
+    const esp_partition_t* partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, FLASH_QUEUE_PARTITION);
+    if (partition == NULL) {
+        ESP_LOGE(_logger, "Error! No \"%s\" partition in the partition table", FLASH_QUEUE_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    //one sector is always being written so at least two are needed to keep a backlog
+    if (partition->size / SECTOR_SIZE < 2) {
+        ESP_LOGE(_logger, "Error! \"%s\" partition needs at least 2 sectors", FLASH_QUEUE_PARTITION);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    _partition = partition;
+    _sector_count = partition->size / SECTOR_SIZE;
+    _slot_count = _sector_count * SLOTS_PER_SECTOR;
+
+    if (_state.magic == STATE_MAGIC) {
+        return ESP_OK;
+    }
+
+    esp_err_t res = _scan_partition();
+    if (res != ESP_OK) {
+        ESP_LOGE(_logger, "Error! Unable to scan the queue partition");
+        _partition = NULL;
+    }
+
+    return res;
+}
+
+esp_err_t flash_queue_append(const reading_record_t* records, size_t count, size_t* stored) {
+    return _append(records, count, stored, FLASH_QUEUE_POLICY);
+}
+
+esp_err_t _append(const reading_record_t* records, size_t count, size_t* stored, flash_queue_policy_t policy) {
+    if (stored != NULL) {
+        *stored = 0;
+    }
+
+    esp_err_t res = flash_queue_init();
+    if (res != ESP_OK) {
+        return res;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        //a new sector has to be started. if it still holds the head the queue is full. the head can only be at
+        //the tail there once the tail went all the way around, so an empty queue is told apart by its depth
+        if (_state.tail % SLOTS_PER_SECTOR == 0) {
+            uint32_t sector = _state.tail / SLOTS_PER_SECTOR;
+
+            if (_state.stats.depth == 0) {
+                _state.head = _state.tail; //nothing the head still points at is waiting to be sent
+            } else if (_state.head / SLOTS_PER_SECTOR == sector) {
+                if (policy == FLASH_QUEUE_DROP_NEWEST) {
+                    _state.stats.dropped += count - i;
+                    ESP_LOGW(_logger, "WARNING! Queue is full, dropping %u new readings", static_cast<unsigned>(count - i));
+                    return ESP_ERR_NO_MEM;
+                }
+
+                uint32_t next_sector_start = ((sector + 1) % _sector_count) * SLOTS_PER_SECTOR;
+                uint32_t lost = _count_unsent(_state.head, next_sector_start);
+                _state.stats.dropped += lost;
+                _state.stats.depth -= lost;
+                _state.head = next_sector_start;
+                ESP_LOGW(_logger, "WARNING! Queue is full, dropped its %u oldest readings", static_cast<unsigned>(lost));
+            }
+
+            res = _start_sector(sector);
+            if (res != ESP_OK) {
+                return res;
+            }
+        }
+
+        flash_entry_t entry;
+        memset(&entry, 0xFF, sizeof(entry));
+        entry.state = ENTRY_WRITTEN;
+        entry.wake_id = records[i].wake_id;
+        entry.moisture = records[i].moisture;
+        entry.timestamp = records[i].timestamp;
+        entry.time_error_s = records[i].time_error_s;
+        entry.plant_id = records[i].plant_id;
+        entry.crc = _crc16(reinterpret_cast<const uint8_t*>(&entry) + offsetof(flash_entry_t, wake_id), sizeof(entry) - offsetof(flash_entry_t, wake_id));
+
+        //the slot is used up even if the write fails, a half written entry fails its crc and is skipped
+        uint32_t slot = _state.tail;
+        _state.tail = (_state.tail + 1) % _slot_count;
+
+        res = esp_partition_write(_partition, _slot_offset(slot), &entry, sizeof(entry));
+        if (res != ESP_OK) {
+            ESP_LOGE(_logger, "Error! Unable to write reading to flash (%s)", esp_err_to_name(res));
+            return res;
+        }
+
+        _state.stats.depth += 1;
+        _state.stats.appended += 1;
+        if (stored != NULL) {
+            *stored = i + 1;
+        }
+    }
+
+    return ESP_OK;
+}
+
+size_t flash_queue_peek(reading_record_t* out, size_t max_count) {
+    if (flash_queue_init() != ESP_OK) {
+        return 0;
+    }
+
+    size_t n = 0;
+    uint32_t span = _queued_slots();
+    for (uint32_t i = 0; i < span && n < max_count; ++i) {
+        if (_read_entry((_state.head + i) % _slot_count, &out[n], NULL)) {
+            n += 1;
+        }
+    }
+
+    return n;
+}
+
+esp_err_t flash_queue_commit(size_t n) {
+    esp_err_t res = flash_queue_init();
+    if (res != ESP_OK) {
+        return res;
+    }
+
+    uint32_t slot = _state.head;
+    uint32_t span = _queued_slots();
+    size_t marked = 0;
+    reading_record_t record;
+
+    for (; span > 0 && marked < n; --span) {
+        if (_read_entry(slot, &record, NULL)) {
+            res = esp_partition_write(_partition, _slot_offset(slot) + offsetof(flash_entry_t, state), &ENTRY_SENT, sizeof(ENTRY_SENT));
+            if (res != ESP_OK) {
+                ESP_LOGE(_logger, "Error! Unable to mark reading as sent (%s)", esp_err_to_name(res));
+                _state.head = slot;
+                return res;
+            }
+
+            marked += 1;
+            _state.stats.depth -= 1;
+            _state.stats.drained += 1;
+        }
+        slot = (slot + 1) % _slot_count;
+    }
+
+    //moves past entries that aren't waiting to be sent so the next peek starts at a reading
+    for (; span > 0 && !_read_entry(slot, &record, NULL); --span) {
+        slot = (slot + 1) % _slot_count;
+    }
+    _state.head = slot;
+
+    return ESP_OK;
+}
+
+size_t flash_queue_depth() {
+    if (flash_queue_init() != ESP_OK) {
+        return 0;
+    }
+    return _state.stats.depth;
+}
+
+flash_queue_stats_t flash_queue_stats() {
+    flash_queue_init();
+    return _state.stats;
+}
+
+esp_err_t _scan_partition() {
+    memset(&_state, 0, sizeof(_state));
+    _state.stats.capacity = (_sector_count - 1) * SLOTS_PER_SECTOR; //the sector being written can be dropped when full
+
+    //the valid sectors form an arc of the ring from the oldest to the newest
+    bool found = false;
+    uint32_t oldest = 0;
+    uint32_t newest = 0;
+    uint32_t oldest_seq = 0;
+    uint32_t newest_seq = 0;
+    for (uint32_t sector = 0; sector < _sector_count; ++sector) {
+        sector_header_t header;
+        if (esp_partition_read(_partition, sector * SECTOR_SIZE, &header, sizeof(header)) != ESP_OK) {
+            return ESP_FAIL;
+        }
+        if (header.magic != SECTOR_MAGIC) {
+            continue;
+        }
+
+        if (!found || header.seq < oldest_seq) {
+            oldest = sector;
+            oldest_seq = header.seq;
+        }
+        if (!found || header.seq > newest_seq) {
+            newest = sector;
+            newest_seq = header.seq;
+        }
+        found = true;
+    }
+
+    if (!found) {
+        _state.next_seq = 1;
+        _state.magic = STATE_MAGIC;
+        ESP_LOGI(_logger, "Queue partition is empty");
+        return ESP_OK;
+    }
+
+    //the tail is right after the last written entry of the newest sector, or at the start of the next sector
+    //if it's full
+    bool head_found = false;
+    _state.tail = ((newest + 1) % _sector_count) * SLOTS_PER_SECTOR;
+    for (uint32_t sector = oldest; ; sector = (sector + 1) % _sector_count) {
+        sector_header_t header;
+        esp_partition_read(_partition, sector * SECTOR_SIZE, &header, sizeof(header));
+
+        for (uint32_t i = 0; header.magic == SECTOR_MAGIC && i < SLOTS_PER_SECTOR; ++i) {
+            uint32_t slot = sector * SLOTS_PER_SECTOR + i;
+            reading_record_t record;
+            bool erased = false;
+
+            if (_read_entry(slot, &record, &erased)) {
+                _state.stats.depth += 1;
+                if (!head_found) {
+                    _state.head = slot;
+                    head_found = true;
+                }
+            } else if (erased && sector == newest) {
+                _state.tail = slot;
+                break;
+            }
+        }
+
+        if (sector == newest) {
+            break;
+        }
+    }
+
+    if (!head_found) {
+        _state.head = _state.tail;
+    }
+    _state.next_seq = newest_seq + 1;
+    _state.magic = STATE_MAGIC;
+
+    ESP_LOGI(_logger, "Recovered %u queued readings from flash", static_cast<unsigned>(_state.stats.depth));
+    return ESP_OK;
+}
+
+esp_err_t _start_sector(uint32_t sector) {
+    esp_err_t res = esp_partition_erase_range(_partition, sector * SECTOR_SIZE, SECTOR_SIZE);
+    if (res != ESP_OK) {
+        ESP_LOGE(_logger, "Error! Unable to erase sector %u (%s)", static_cast<unsigned>(sector), esp_err_to_name(res));
+        return res;
+    }
+    _state.stats.sector_erases += 1;
+
+    sector_header_t header;
+    memset(&header, 0xFF, sizeof(header));
+    header.magic = SECTOR_MAGIC;
+    header.seq = _state.next_seq++;
+
+    res = esp_partition_write(_partition, sector * SECTOR_SIZE, &header, sizeof(header));
+    if (res != ESP_OK) {
+        ESP_LOGE(_logger, "Error! Unable to write header of sector %u (%s)", static_cast<unsigned>(sector), esp_err_to_name(res));
+    }
+    return res;
+}
+
+bool _read_entry(uint32_t slot, reading_record_t* out, bool* erased) {
+    flash_entry_t entry;
+    if (esp_partition_read(_partition, _slot_offset(slot), &entry, sizeof(entry)) != ESP_OK) {
+        return false;
+    }
+
+    if (erased != NULL) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&entry);
+        *erased = true;
+        for (size_t i = 0; i < sizeof(entry); ++i) {
+            if (bytes[i] != 0xFF) {
+                *erased = false;
+                break;
+            }
+        }
+    }
+
+    if (entry.state != ENTRY_WRITTEN) {
+        return false;
+    }
+
+    uint16_t crc = _crc16(reinterpret_cast<const uint8_t*>(&entry) + offsetof(flash_entry_t, wake_id), sizeof(entry) - offsetof(flash_entry_t, wake_id));
+    if (crc != entry.crc) {
+        return false;
+    }
+
+    out->wake_id = entry.wake_id;
+    out->moisture = entry.moisture;
+    out->timestamp = entry.timestamp;
+    out->time_error_s = entry.time_error_s;
+    out->plant_id = entry.plant_id;
+    return true;
+}
+
+uint32_t _count_unsent(uint32_t from, uint32_t to) {
+    uint32_t count = 0;
+    reading_record_t record;
+
+    for (uint32_t slot = from; slot != to; slot = (slot + 1) % _slot_count) {
+        if (_read_entry(slot, &record, NULL)) {
+            count += 1;
+        }
+    }
+
+    return count;
+}
+
+uint32_t _queued_slots() {
+    if (_state.head == _state.tail) {
+        return (_state.stats.depth > 0) ? _slot_count : 0;
+    }
+    return (_state.tail + _slot_count - _state.head) % _slot_count;
+}
+
+uint32_t _slot_offset(uint32_t slot) {
+    return (slot / SLOTS_PER_SECTOR) * SECTOR_SIZE + sizeof(sector_header_t) + (slot % SLOTS_PER_SECTOR) * sizeof(flash_entry_t);
+}
+
+uint16_t _crc16(const uint8_t* data, size_t len) {
+    uint16_t crc = 0xFFFF;
+
+    for (size_t i = 0; i < len; ++i) {
+        crc ^= static_cast<uint16_t>(data[i]) << 8;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+        }
+    }
+
+    return crc;
+}
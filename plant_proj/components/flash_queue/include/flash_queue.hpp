@@ -0,0 +1,135 @@
+#ifndef FLASH_QUEUE_HPP
+#define FLASH_QUEUE_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_err.h>
+#include "reading_buffer.hpp"
+
+/**
+ * Store and forward queue of readings kept in the FLASH_QUEUE_PARTITION flash partition (see partitions.csv).
+ * readings that couldn't be uploaded are moved here from the rtc buffer so they survive power loss and don't
+ * get pushed out of the rtc buffer, and they're drained oldest first once the backend is reachable again
+ *
+ * the partition is an append only log of 4kb sectors used as a ring so erases are spread evenly across it.
+ * each sector starts with a header whose sequence number orders the sectors after a cold boot, followed by
+ * fixed size entries. an entry is written in one go with a crc so a torn write is ignored, and once the backend
+ * accepted it its state byte is programmed from WRITTEN to SENT in place (flash bits can go from 1 to 0 without
+ * an erase). a reset between the backend accepting a batch and its markers being written resends that batch,
+ * so delivery is at least once: readings are never lost but can reach the backend twice. it's up to the backend
+ * to drop the duplicates by plant, wake and ts (the wake counter restarts on a cold boot, the wake alone won't do)
+ *
+ * the head/tail positions are kept in rtc memory so the partition is only scanned on a cold boot
+ */
+
+extern const char* FLASH_QUEUE_PARTITION; //label of the partition
+
+//what happens to a reading that doesn't fit
+typedef enum {
+    FLASH_QUEUE_DROP_OLDEST, //the oldest sector is erased to make room
+    FLASH_QUEUE_DROP_NEWEST, //the new reading is rejected
+} flash_queue_policy_t;
+extern const flash_queue_policy_t FLASH_QUEUE_POLICY;
+
+typedef struct {
+    uint32_t depth; //readings waiting to be sent
+    uint32_t capacity; //readings the partition can hold
+    uint32_t appended; //counters since the last cold boot
+    uint32_t drained;
+    uint32_t dropped; //lost to the capacity policy
+    uint32_t sector_erases;
+} flash_queue_stats_t;
+
+/**
+ * Finds the partition and, on a cold boot, scans it to recover the queue. called by every other function
+ * so it doesn't have to be called on wakes that don't need the queue
+ * @return returns ESP_OK, or ESP_ERR_NOT_FOUND if the partition table has no queue partition
+ */
+esp_err_t flash_queue_init();
+
+/**
+ * Appends readings to the end of the queue. stops at the first reading that can't be stored so the stored
+ * readings are always a prefix of records
+ * @param records readings, oldest first
+ * @param count number of readings
+ * @param stored (optional) set to the number of readings that were stored, the caller only lets go of those
+ * @return returns ESP_OK if every reading was stored. with FLASH_QUEUE_DROP_NEWEST a full queue returns
+ * ESP_ERR_NO_MEM and the readings that didn't fit are counted as dropped
+ */
+esp_err_t flash_queue_append(const reading_record_t* records, size_t count, size_t* stored);
+
+/**
+ * Copies the oldest unsent readings without removing them
+ * @param out array the readings are copied into
+ * @param max_count max number of readings that fit in out
+ * @return returns the number of readings that were copied
+ */
+size_t flash_queue_peek(reading_record_t* out, size_t max_count);
+
+/**
+ * Marks the n oldest unsent readings as sent. meant to be called once the backend accepted them
+ * @param n number of readings, at most what flash_queue_peek returned
+ * @return returns ESP_OK or the flash error
+ */
+esp_err_t flash_queue_commit(size_t n);
+
+/**
+ * @return returns the number of readings waiting to be sent
+ */
+size_t flash_queue_depth();
+
+/**
+ * @return returns the queue's metrics
+ */
+flash_queue_stats_t flash_queue_stats();
+
+/**
+ * Appends readings like flash_queue_append, with the given capacity policy instead of FLASH_QUEUE_POLICY
+ */
+esp_err_t _append(const reading_record_t* records, size_t count, size_t* stored, flash_queue_policy_t policy);
+
+/**
+ * Recovers the head and tail positions and the depth from the partition. called on a cold boot
+ * @return returns ESP_OK or the flash error
+ */
+esp_err_t _scan_partition();
+
+/**
+ * Erases a sector and writes its header so entries can be appended to it
+ * @param sector index of the sector in the partition
+ * @return returns ESP_OK or the flash error
+ */
+esp_err_t _start_sector(uint32_t sector);
+
+/**
+ * Reads the entry in a slot
+ * @param slot index of the slot in the partition
+ * @param out set to the reading if the entry is waiting to be sent
+ * @param erased (optional) set to true if the slot was never written
+ * @return returns true if the slot holds a reading waiting to be sent
+ */
+bool _read_entry(uint32_t slot, reading_record_t* out, bool* erased);
+
+/**
+ * Counts the readings waiting to be sent in [from, to)
+ */
+uint32_t _count_unsent(uint32_t from, uint32_t to);
+
+/**
+ * @return returns the number of slots from the head to the tail, every slot when the queue is full
+ */
+uint32_t _queued_slots();
+
+/**
+ * @return returns the offset of a slot in the partition
+ */
+uint32_t _slot_offset(uint32_t slot);
+
+/**
+ * @param data bytes
+ * @param len number of bytes
+ * @return returns the crc16/ccitt of data
+ */
+uint16_t _crc16(const uint8_t* data, size_t len);
+
+#endif
@@ -0,0 +1,212 @@
+#include <esp_log.h>
+#include <esp_adc/adc_oneshot.h>
+#include <esp_adc/adc_continuous.h>
+#include <esp_adc/adc_cali.h>
+#include <esp_adc/adc_cali_scheme.h>
+#include <vector>
+#include "adc_hal.hpp"
+#include "static_alloc.hpp"
+
+/**
+ * Espressif Docs on using one shot mode and calibrating analog readings
+ * https://docs.espressif.com/projects/esp-idf/en/stable/esp32/api-reference/peripherals/adc_oneshot.html
+ * https://docs.espressif.com/projects/esp-idf/en/stable/esp32/api-reference/peripherals/adc_calibration.html
+ *
+ * continuous (DMA) mode
+ * https://docs.espressif.com/projects/esp-idf/en/stable/esp32/api-reference/peripherals/adc_continuous.html
+ */
+
+//the output format of the digital controller depends on the chip
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2
+#define ADC_OUTPUT_TYPE ADC_DIGI_OUTPUT_FORMAT_TYPE1
+#define ADC_GET_CHANNEL(p_data) ((p_data)->type1.channel)
+#define ADC_GET_DATA(p_data) ((p_data)->type1.data)
+#else
+#define ADC_OUTPUT_TYPE ADC_DIGI_OUTPUT_FORMAT_TYPE2
+#define ADC_GET_CHANNEL(p_data) ((p_data)->type2.channel)
+#define ADC_GET_DATA(p_data) ((p_data)->type2.data)
+#endif
+
+#define ADC_HAL_MAX_CHANNELS 8
+
+adc_oneshot_unit_init_cfg_t ADC_CONFIG; // adc object used to select ADC unit
+adc_oneshot_chan_cfg_t CHAN_CONFIG; //used to set attenuation and bitwidth
+adc_cali_line_fitting_config_t CALI_CONFIG; // used for calibration
+
+//NULL until set up and again after adc_hal_deinit
+static adc_oneshot_unit_handle_t adc1_handle = NULL;
+static adc_continuous_handle_t adc1_cont_handle = NULL;
+static adc_cali_handle_t cali_handle = NULL;
+#if STATIC_ALLOCATION
+//room for the largest frame plus the rounding up to whole conversions
+static static_vector<uint8_t, ADC_HAL_STATIC_FRAME_SAMPLES * SOC_ADC_DIGI_RESULT_BYTES + SOC_ADC_DIGI_DATA_BYTES_PER_CONV> _frame_buffer;
+#else
+static std::vector<uint8_t> _frame_buffer; //raw DMA frame in continuous mode
+#endif
+static const char* _logger = "ADC HAL *** ";
+
+esp_err_t adc_hal_oneshot_init(const uint8_t* channels, size_t count) {
+    ESP_LOGI(_logger, "Initializing ADC configuration");
+    // using ADC1 GPIO(32-39)
+    ADC_CONFIG = {
+        .unit_id = ADC_UNIT_1,
+        .ulp_mode = ADC_ULP_MODE_DISABLE,
+    };
+
+    esp_err_t res = adc_oneshot_new_unit(&ADC_CONFIG, &adc1_handle);
+    if (res != ESP_OK) {
+        ESP_LOGE(_logger, "Error! Failed to create ADC unit");
+        return res;
+    }
+
+    ESP_LOGI(_logger, "Initializing ADC channels");
+    //channel configuration
+    CHAN_CONFIG = {
+        .atten = ADC_ATTEN_DB_12, // recommended val for esp32 0V-2.45V
+        .bitwidth = ADC_BITWIDTH_DEFAULT, //resolution 12 bits. higher resolution means a more precise measurement
+    };
+
+    //every channel a probe is wired to (ie ADC_channel_0 is pin36)
+    for (size_t i = 0; i < count; ++i) {
+        res = adc_oneshot_config_channel(adc1_handle, static_cast<adc_channel_t>(channels[i]), &CHAN_CONFIG);
+        if (res != ESP_OK) {
+            ESP_LOGE(_logger, "Error! Failed to configure ADC channel %u", channels[i]);
+            return res;
+        }
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t adc_hal_oneshot_read(uint8_t channel, int* raw) {
+    return adc_oneshot_read(adc1_handle, static_cast<adc_channel_t>(channel), raw);
+}
+
+esp_err_t adc_hal_continuous_init(const uint8_t* channels, size_t count, uint32_t sample_freq_hz, size_t frame_samples) {
+    ESP_LOGI(_logger, "Initializing ADC continuous mode at %u Hz", static_cast<unsigned>(sample_freq_hz));
+
+    if (count > ADC_HAL_MAX_CHANNELS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    //the frame size has to be a multiple of the bytes per conversion
+    uint32_t frame_size = frame_samples * SOC_ADC_DIGI_RESULT_BYTES;
+    frame_size = ((frame_size + SOC_ADC_DIGI_DATA_BYTES_PER_CONV - 1) / SOC_ADC_DIGI_DATA_BYTES_PER_CONV) * SOC_ADC_DIGI_DATA_BYTES_PER_CONV;
+#if STATIC_ALLOCATION
+    if (!_frame_buffer.resize(frame_size)) {
+        ESP_LOGE(_logger, "Error! A frame of %u conversions is over the static buffer", static_cast<unsigned>(frame_samples));
+        return ESP_ERR_NO_MEM;
+    }
+#else
+    _frame_buffer.resize(frame_size);
+#endif
+
+    adc_continuous_handle_cfg_t handle_config = {
+        .max_store_buf_size = frame_size * 2, //room for the frame being read and the one being filled
+        .conv_frame_size = frame_size,
+    };
+    esp_err_t res = adc_continuous_new_handle(&handle_config, &adc1_cont_handle);
+    if (res != ESP_OK) {
+        ESP_LOGE(_logger, "Error! Failed to create ADC continuous handle");
+        return res;
+    }
+
+    //the digital controller steps through the pattern one conversion at a time so the channels' samples are interleaved
+    adc_digi_pattern_config_t patterns[ADC_HAL_MAX_CHANNELS];
+    for (size_t i = 0; i < count; ++i) {
+        patterns[i] = {
+            .atten = ADC_ATTEN_DB_12, // recommended val for esp32 0V-2.45V
+            .channel = channels[i],
+            .unit = ADC_UNIT_1,
+            .bit_width = SOC_ADC_DIGI_MAX_BITWIDTH,
+        };
+    }
+
+    adc_continuous_config_t digi_config = {
+        .pattern_num = static_cast<uint32_t>(count),
+        .adc_pattern = patterns,
+        .sample_freq_hz = sample_freq_hz,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_OUTPUT_TYPE,
+    };
+    return adc_continuous_config(adc1_cont_handle, &digi_config);
+}
+
+esp_err_t adc_hal_continuous_capture(adc_hal_sample_t* out, size_t max_samples, size_t* captured, uint32_t timeout_ms) {
+    uint32_t filled = 0;
+    esp_err_t ret = ESP_OK;
+
+    //the DMA fills the frame while the cpu blocks in adc_continuous_read
+    esp_err_t res = adc_continuous_start(adc1_cont_handle);
+    if (res != ESP_OK) {
+        return res;
+    }
+
+    while (filled < _frame_buffer.size()) {
+        uint32_t ret_num = 0;
+        res = adc_continuous_read(
+            adc1_cont_handle, _frame_buffer.data() + filled, _frame_buffer.size() - filled, &ret_num, timeout_ms
+        );
+
+        if (res != ESP_OK) {
+            ret = res;
+            break;
+        }
+        filled += ret_num;
+    }
+    adc_continuous_stop(adc1_cont_handle);
+
+    //decodes the chip specific output format
+    size_t n = 0;
+    for (uint32_t b = 0; b + SOC_ADC_DIGI_RESULT_BYTES <= filled && n < max_samples; b += SOC_ADC_DIGI_RESULT_BYTES) {
+        adc_digi_output_data_t* p = reinterpret_cast<adc_digi_output_data_t*>(&_frame_buffer[b]);
+        out[n].channel = ADC_GET_CHANNEL(p);
+        out[n].raw = ADC_GET_DATA(p);
+        n += 1;
+    }
+    *captured = n;
+
+    return ret;
+}
+
+esp_err_t adc_hal_calibration_init() {
+    ESP_LOGI(_logger, "Initializing ADC Calibration");
+    //the esp32 compares the input analog reading to a reference voltage. this reference voltage might be off so
+    //we need to calibrate it to get a more accurate result
+    CALI_CONFIG = {
+        .unit_id = ADC_UNIT_1,
+        .atten = ADC_ATTEN_DB_12,
+        .bitwidth = ADC_BITWIDTH_DEFAULT,
+    };
+
+    return adc_cali_create_scheme_line_fitting(&CALI_CONFIG, &cali_handle);
+}
+
+esp_err_t adc_hal_raw_to_mv(int raw, int* mv) {
+    return adc_cali_raw_to_voltage(cali_handle, raw, mv);
+}
+
+esp_err_t adc_hal_deinit() {
+    //ADC1 can only have one oneshot unit and one continuous handle, a second new_unit or new_handle fails
+    esp_err_t ret = ESP_OK;
+    if (adc1_handle != NULL) {
+        esp_err_t res = adc_oneshot_del_unit(adc1_handle);
+        ret = (ret == ESP_OK) ? res : ret;
+        adc1_handle = NULL;
+    }
+    if (adc1_cont_handle != NULL) {
+        esp_err_t res = adc_continuous_deinit(adc1_cont_handle);
+        ret = (ret == ESP_OK) ? res : ret;
+        adc1_cont_handle = NULL;
+    }
+    if (cali_handle != NULL) {
+        esp_err_t res = adc_cali_delete_scheme_line_fitting(cali_handle);
+        ret = (ret == ESP_OK) ? res : ret;
+        cali_handle = NULL;
+    }
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(_logger, "Error! Failed to release the ADC drivers");
+    }
+    return ret;
+}
@@ -0,0 +1,15 @@
+#include <esp_heap_caps.h>
+#include "mem_hal.hpp"
+
+esp_err_t mem_hal_heap(mem_hal_heap_t* heap) {
+    heap->free_bytes = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+    heap->min_free_bytes = heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT);
+    heap->largest_block = heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT);
+    return ESP_OK;
+}
+
+esp_err_t mem_hal_stack_min_free(TaskHandle_t task, uint32_t* min_free_bytes) {
+    //the high water mark is in bytes on esp-idf, not in words like upstream freertos
+    *min_free_bytes = uxTaskGetStackHighWaterMark(task);
+    return ESP_OK;
+}
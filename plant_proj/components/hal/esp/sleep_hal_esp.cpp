@@ -0,0 +1,30 @@
+#include <esp_sleep.h>
+#include <esp_timer.h>
+#include <esp_system.h>
+#include "sleep_hal.hpp"
+
+int64_t sleep_hal_time_us() {
+    return esp_timer_get_time();
+}
+
+bool sleep_hal_woke_from_timer() {
+    return esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER;
+}
+
+bool sleep_hal_crashed() {
+    switch (esp_reset_reason()) {
+        case ESP_RST_PANIC:
+        case ESP_RST_INT_WDT:
+        case ESP_RST_TASK_WDT:
+        case ESP_RST_WDT:
+        case ESP_RST_BROWNOUT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void sleep_hal_deep_sleep(uint64_t sleep_us) {
+    esp_sleep_enable_timer_wakeup(sleep_us);
+    esp_deep_sleep_start();
+}
@@ -0,0 +1,80 @@
+#ifndef ADC_HAL_HPP
+#define ADC_HAL_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_err.h>
+
+/**
+ * Thin interface over ADC1. the esp implementation wraps the oneshot, continuous and calibration drivers,
+ * the linux implementation generates synthetic probe readings so the sampling and filtering code can run
+ * on a host machine
+ */
+
+#define ADC_HAL_STATIC_FRAME_SAMPLES 2048 //largest continuous frame, in conversions, when built with STATIC_ALLOCATION
+
+//one decoded conversion from a continuous capture
+typedef struct {
+    uint8_t channel; //ADC1 channel the conversion was made on
+    uint16_t raw; //raw ADC value
+} adc_hal_sample_t;
+
+/**
+ * Sets up ADC1 for one shot reads on the given channels
+ * @param channels ADC1 channels
+ * @param count number of channels
+ * @return returns ESP_OK on success
+ */
+esp_err_t adc_hal_oneshot_init(const uint8_t* channels, size_t count);
+
+/**
+ * Performs a single read
+ * @param channel ADC1 channel to read
+ * @param raw set to the raw ADC value
+ * @return returns ESP_OK on success
+ */
+esp_err_t adc_hal_oneshot_read(uint8_t channel, int* raw);
+
+/**
+ * Sets up ADC1 for continuous (DMA) reads. the channels are converted in turn so their samples are interleaved
+ * @param channels ADC1 channels
+ * @param count number of channels
+ * @param sample_freq_hz conversion rate
+ * @param frame_samples number of conversions captured by each call to adc_hal_continuous_capture
+ * @return returns ESP_OK on success, ESP_ERR_NO_MEM if the frame is over ADC_HAL_STATIC_FRAME_SAMPLES in the
+ * STATIC_ALLOCATION build
+ */
+esp_err_t adc_hal_continuous_init(const uint8_t* channels, size_t count, uint32_t sample_freq_hz, size_t frame_samples);
+
+/**
+ * Captures one frame of conversions
+ * @param out array the decoded conversions are written to
+ * @param max_samples size of out
+ * @param captured set to the number of conversions written to out
+ * @param timeout_ms max time to wait for the frame
+ * @return returns ESP_OK on success, ESP_ERR_TIMEOUT if the frame was cut short
+ */
+esp_err_t adc_hal_continuous_capture(adc_hal_sample_t* out, size_t max_samples, size_t* captured, uint32_t timeout_ms);
+
+/**
+ * Sets up the calibration used by adc_hal_raw_to_mv
+ * @return returns ESP_OK on success
+ */
+esp_err_t adc_hal_calibration_init();
+
+/**
+ * Converts a raw ADC value to a calibrated voltage
+ * @param raw raw ADC value
+ * @param mv set to the voltage in mV
+ * @return returns ESP_OK on success
+ */
+esp_err_t adc_hal_raw_to_mv(int raw, int* mv);
+
+/**
+ * Releases the drivers and calibration the init functions created so they can be set up again, ie with other
+ * channels or another frame size. does nothing for what wasn't set up
+ * @return returns ESP_OK on success
+ */
+esp_err_t adc_hal_deinit();
+
+#endif
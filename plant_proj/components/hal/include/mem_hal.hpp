@@ -0,0 +1,33 @@
+#ifndef MEM_HAL_HPP
+#define MEM_HAL_HPP
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+/**
+ * Thin interface over the heap and stack probes. the esp implementation reads the heap_caps counters and the
+ * freertos stack high water marks, the host has neither so the linux implementation reports them as unsupported
+ */
+
+typedef struct {
+    uint32_t free_bytes; //free heap right now
+    uint32_t min_free_bytes; //lowest the free heap got since boot
+    uint32_t largest_block; //largest block an allocation can get, far below free_bytes once the heap is fragmented
+} mem_hal_heap_t;
+
+/**
+ * @param heap set to the default capability heap's counters
+ * @return returns ESP_OK, or ESP_ERR_NOT_SUPPORTED if the target can't tell
+ */
+esp_err_t mem_hal_heap(mem_hal_heap_t* heap);
+
+/**
+ * @param task task to look at, NULL for the calling task
+ * @param min_free_bytes set to the least stack the task had left since it started
+ * @return returns ESP_OK, or ESP_ERR_NOT_SUPPORTED if the target can't tell
+ */
+esp_err_t mem_hal_stack_min_free(TaskHandle_t task, uint32_t* min_free_bytes);
+
+#endif
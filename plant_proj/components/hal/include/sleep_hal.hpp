@@ -0,0 +1,34 @@
+#ifndef SLEEP_HAL_HPP
+#define SLEEP_HAL_HPP
+
+#include <stdint.h>
+
+/**
+ * Thin interface over the clock and deep sleep. on the esp32 deep sleep ends in a reboot and never returns.
+ * on linux it simulates the reboot by restarting the clock, marking the next wake as a timer wake and
+ * returning, so the caller can run the next wake cycle in the same process (static variables stand in
+ * for rtc memory)
+ */
+
+/**
+ * @return returns the microseconds since this wake started
+ */
+int64_t sleep_hal_time_us();
+
+/**
+ * @return returns true if this wake was caused by the deep sleep timer, false after power on or reset
+ */
+bool sleep_hal_woke_from_timer();
+
+/**
+ * @return returns true if the last reset was a panic, a watchdog or a brownout
+ */
+bool sleep_hal_crashed();
+
+/**
+ * Enters deep sleep with a timer wakeup
+ * @param sleep_us how long to sleep
+ */
+void sleep_hal_deep_sleep(uint64_t sleep_us);
+
+#endif
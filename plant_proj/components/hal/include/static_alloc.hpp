@@ -0,0 +1,95 @@
+#ifndef STATIC_ALLOC_HPP
+#define STATIC_ALLOC_HPP
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Build mode where the firmware never allocates at run time. building with STATIC_ALLOCATION=1 (see the
+ * project's CMakeLists.txt) puts every task's stack and control block and every buffer sized at run time in
+ * .bss instead of the heap, so running out of memory shows up in the link map instead of as a failed
+ * allocation weeks into a deployment. the esp-idf drivers (wifi, esp_http_client, esp-mqtt, adc continuous)
+ * still allocate internally, mem_stats.hpp reports how low the heap gets
+ */
+
+#ifndef STATIC_ALLOCATION
+#define STATIC_ALLOCATION 0
+#endif
+
+/**
+ * Fixed capacity stand-in for the std::vector buffers that are sized at run time. resize never allocates, it
+ * refuses sizes over the capacity
+ */
+template <typename T, size_t N>
+class static_vector {
+public:
+    /**
+     * @param n new size
+     * @return returns false and leaves the size as it was if n is more than N
+     */
+    bool resize(size_t n) {
+        if (n > N) {
+            return false;
+        }
+        _size = n;
+        return true;
+    }
+
+    T* data() { return _items; }
+    const T* data() const { return _items; }
+    size_t size() const { return _size; }
+    static constexpr size_t capacity() { return N; }
+    T& operator[](size_t i) { return _items[i]; }
+    const T& operator[](size_t i) const { return _items[i]; }
+
+private:
+    T _items[N];
+    size_t _size = 0;
+};
+
+/**
+ * Stack and control block of a task created with static_task_create. empty unless STATIC_ALLOCATION is set,
+ * the heap holds them then
+ * @tparam STACK stack size in bytes
+ */
+#if STATIC_ALLOCATION
+template <uint32_t STACK>
+struct static_task_t {
+    StackType_t stack[STACK]; //StackType_t is a byte on the esp32
+    StaticTask_t tcb;
+};
+#else
+template <uint32_t STACK>
+struct static_task_t {};
+#endif
+
+/**
+ * Creates a task pinned to a core, in the buffers when STATIC_ALLOCATION is set and on the heap otherwise.
+ * the buffers can't be reused for another task after a static task deletes itself (the idle task still holds
+ * its control block), so the tasks of this firmware are started once per boot and never return
+ * @param buffers stack and control block, static for the life of the program
+ * @param task function the task runs
+ * @param name task name
+ * @param priority task priority
+ * @param handle set to the task's handle, can be NULL
+ * @param core core the task is pinned to, or tskNO_AFFINITY
+ * @return returns true if the task was created
+ */
+template <uint32_t STACK>
+bool static_task_create(static_task_t<STACK>& buffers, TaskFunction_t task, const char* name,
+    UBaseType_t priority, TaskHandle_t* handle, BaseType_t core) {
+#if STATIC_ALLOCATION
+    TaskHandle_t created = xTaskCreateStaticPinnedToCore(task, name, STACK, NULL, priority, buffers.stack, &buffers.tcb, core);
+    if (handle != NULL) {
+        *handle = created;
+    }
+    return created != NULL;
+#else
+    (void)buffers;
+    return xTaskCreatePinnedToCore(task, name, STACK, NULL, priority, handle, core) == pdPASS;
+#endif
+}
+
+#endif
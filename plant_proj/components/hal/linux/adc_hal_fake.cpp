@@ -0,0 +1,102 @@
+#include <esp_log.h>
+#include "adc_hal.hpp"
+
+/**
+ * Synthetic probe. every channel sits at its own level, drifts slowly from wake to wake, and has
+ * uniform noise plus the occasional full scale spike the capacitive probes produce
+ */
+
+static const int FAKE_BASE_RAW = 1800; //level of channel 0, each following channel sits 150 steps higher
+static const int FAKE_NOISE_RAW = 12; //peak noise
+static const uint32_t FAKE_SPIKE_PERIOD = 97; //one in this many samples is a spike
+static const int ADC_RAW_MAX = 4095;
+
+static const char* _logger = "ADC HAL (fake) *** ";
+static uint8_t _channels[8];
+static size_t _channel_count = 0;
+static size_t _frame_samples = 0;
+static uint32_t _sample_freq_hz = 0;
+static uint32_t _rng = 0x12345678; //xorshift state
+static uint32_t _sample_index = 0; //samples produced since power on, drives the drift and spikes
+
+static uint32_t _next_random() {
+    _rng ^= _rng << 13;
+    _rng ^= _rng >> 17;
+    _rng ^= _rng << 5;
+    return _rng;
+}
+
+static int _fake_sample(uint8_t channel) {
+    _sample_index += 1;
+    if (_sample_index % FAKE_SPIKE_PERIOD == 0) {
+        return ADC_RAW_MAX;
+    }
+
+    int drift = static_cast<int>((_sample_index / 1000) % 200) - 100; //slow triangle-ish wander
+    int noise = static_cast<int>(_next_random() % (2 * FAKE_NOISE_RAW + 1)) - FAKE_NOISE_RAW;
+    int raw = FAKE_BASE_RAW + channel * 150 + drift + noise;
+
+    return (raw < 0) ? 0 : (raw > ADC_RAW_MAX ? ADC_RAW_MAX : raw);
+}
+
+static void _set_channels(const uint8_t* channels, size_t count) {
+    _channel_count = (count > sizeof(_channels)) ? sizeof(_channels) : count;
+    for (size_t i = 0; i < _channel_count; ++i) {
+        _channels[i] = channels[i];
+    }
+}
+
+esp_err_t adc_hal_oneshot_init(const uint8_t* channels, size_t count) {
+    ESP_LOGI(_logger, "Initializing fake ADC with %u channels", static_cast<unsigned>(count));
+    _set_channels(channels, count);
+    return ESP_OK;
+}
+
+esp_err_t adc_hal_oneshot_read(uint8_t channel, int* raw) {
+    *raw = _fake_sample(channel);
+    return ESP_OK;
+}
+
+esp_err_t adc_hal_continuous_init(const uint8_t* channels, size_t count, uint32_t sample_freq_hz, size_t frame_samples) {
+    ESP_LOGI(_logger, "Initializing fake continuous ADC with %u channels", static_cast<unsigned>(count));
+    _set_channels(channels, count);
+    _frame_samples = frame_samples;
+    _sample_freq_hz = sample_freq_hz;
+    return ESP_OK;
+}
+
+esp_err_t adc_hal_continuous_capture(adc_hal_sample_t* out, size_t max_samples, size_t* captured, uint32_t timeout_ms) {
+    size_t n = (_frame_samples < max_samples) ? _frame_samples : max_samples;
+
+    //the driver only hands over whole frames, one that takes longer than the timeout to convert comes back empty
+    if (_sample_freq_hz > 0 && static_cast<uint64_t>(_frame_samples) * 1000 > static_cast<uint64_t>(timeout_ms) * _sample_freq_hz) {
+        *captured = 0;
+        return ESP_ERR_TIMEOUT;
+    }
+
+    //the channels take turns like the digital controller's pattern
+    for (size_t i = 0; i < n && _channel_count > 0; ++i) {
+        uint8_t channel = _channels[i % _channel_count];
+        out[i].channel = channel;
+        out[i].raw = static_cast<uint16_t>(_fake_sample(channel));
+    }
+    *captured = (_channel_count > 0) ? n : 0;
+
+    return ESP_OK;
+}
+
+esp_err_t adc_hal_calibration_init() {
+    return ESP_OK;
+}
+
+esp_err_t adc_hal_raw_to_mv(int raw, int* mv) {
+    //roughly the esp32's line fitting curve at 12 dB attenuation
+    *mv = 142 + raw * (3130 - 142) / ADC_RAW_MAX;
+    return ESP_OK;
+}
+
+esp_err_t adc_hal_deinit() {
+    _channel_count = 0;
+    _frame_samples = 0;
+    return ESP_OK;
+}
@@ -0,0 +1,15 @@
+#include "mem_hal.hpp"
+
+//the host's heap and thread stacks have nothing in common with the esp32's, so there is nothing worth reporting
+
+esp_err_t mem_hal_heap(mem_hal_heap_t* heap) {
+    heap->free_bytes = 0;
+    heap->min_free_bytes = 0;
+    heap->largest_block = 0;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t mem_hal_stack_min_free(TaskHandle_t task, uint32_t* min_free_bytes) {
+    *min_free_bytes = 0;
+    return ESP_ERR_NOT_SUPPORTED;
+}
@@ -0,0 +1,42 @@
+#include <esp_log.h>
+#include <time.h>
+#include <unistd.h>
+#include "sleep_hal.hpp"
+
+//host sleeps are shortened by this factor so simulated hours pass in seconds
+static const uint64_t SLEEP_SPEEDUP = 1000;
+
+static const char* _logger = "Sleep HAL (fake) *** ";
+static int64_t _boot_us = -1; //host clock when the simulated wake started
+static bool _woke_from_timer = false;
+
+static int64_t _host_time_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+int64_t sleep_hal_time_us() {
+    if (_boot_us < 0) {
+        _boot_us = _host_time_us();
+    }
+    return _host_time_us() - _boot_us;
+}
+
+bool sleep_hal_woke_from_timer() {
+    return _woke_from_timer;
+}
+
+bool sleep_hal_crashed() {
+    //a crashed host process doesn't come back
+    return false;
+}
+
+void sleep_hal_deep_sleep(uint64_t sleep_us) {
+    ESP_LOGI(_logger, "Simulating deep sleep of %llu ms", static_cast<unsigned long long>(sleep_us / 1000));
+    usleep(sleep_us / SLEEP_SPEEDUP);
+
+    //the next wake starts with a fresh clock, like the esp32 after a deep sleep reboot
+    _boot_us = _host_time_us();
+    _woke_from_timer = true;
+}
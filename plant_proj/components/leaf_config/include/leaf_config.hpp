@@ -1,6 +1,25 @@
 #ifndef LEAF_CONFIG_HPP
 #define LEAF_CONFIG_HPP
 
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_err.h>
+
+/**
+ * Runtime configuration of the node. it's stored in the LEAF_CONFIG_NAMESPACE nvs namespace so plant names,
+ * credentials and settings can be changed without reflashing the firmware. the compile time values in
+ * leaf_info.hpp and wifi_credentials.hpp are only defaults, written to nvs on the first boot
+ *
+ * the validated config is cached in rtc memory. timer wakes use the cache and never touch nvs, it's only
+ * read again on a cold boot or after the config generation changed (leaf_config_save, leaf_config_invalidate)
+ */
+
+#define MAX_PLANTS 8 //ADC1 has 8 channels
+#define LEAF_CONFIG_SCHEMA 1 //bump when the layout of the namespace changes, older layouts are replaced by the defaults
+
+extern const char* LEAF_CONFIG_NAMESPACE;
+extern const uint16_t MAX_SAMPLE_SIZE; //largest sample_size accepted
+
 typedef struct {
     unsigned char wifi_ssid[32];
     unsigned char wifi_password[64];
@@ -9,12 +28,72 @@ extern wifi_credentials_t wifi_credentials;
 
 typedef struct {
     unsigned char plant_name[16];
+    uint8_t adc_channel; //ADC1 channel the plant's probe is wired to
+} plant_info_t;
+
+typedef struct {
+    uint32_t node_id; //unique per node. together with a plant's index it identifies the plant
+    plant_info_t plants[MAX_PLANTS]; //plants are identified by their index in this table
+    uint8_t plant_count;
 } leaf_info_t;
 extern leaf_info_t leaf_info;
 
-void initialize_leaf_config(void); //uses the 2 private functions below
+typedef struct {
+    char server_url[64]; //scheme://host[:port], requests go to server_url + SUBMIT_READING_ROUTE
+    uint16_t sample_size; //samples taken per plant every wake
+    uint32_t sleep_interval_s; //sleep between wakes until there's a trend to adapt it to, and the shortest adapted sleep
+} leaf_settings_t;
+extern leaf_settings_t leaf_settings;
+
+/**
+ * Loads the config into wifi_credentials, leaf_info and leaf_settings. uses the rtc cache on timer wakes
+ * and nvs otherwise
+ */
+void initialize_leaf_config(void);
+
+/**
+ * Initializes nvs the first time it's called. timer wakes skip it unless something needs nvs (ie the
+ * wifi driver's calibration data), so it's safe to call from anywhere
+ * @return returns ESP_OK or the nvs error
+ */
+esp_err_t leaf_config_nvs_init(void);
+
+/**
+ * Writes the current wifi_credentials, leaf_info and leaf_settings to nvs under a new generation and
+ * refreshes the rtc cache
+ * @return returns ESP_OK, or the nvs error (the config in ram is kept either way)
+ */
+esp_err_t leaf_config_save(void);
+
+/**
+ * Drops the rtc cache so the next wake reloads the config from nvs. used when nvs was changed by
+ * something other than leaf_config_save
+ */
+void leaf_config_invalidate(void);
+
+/**
+ * @return returns the generation of the loaded config. it changes every time the config is saved
+ */
+uint32_t leaf_config_generation(void);
+
+void _load_defaults(void);
+
+/**
+ * Reads the config from nvs. the globals are only replaced once every key was read
+ * @return returns ESP_OK, ESP_ERR_NVS_NOT_FOUND if nothing of the current schema was saved, or the nvs error
+ */
+esp_err_t _load_from_nvs(void);
+esp_err_t _save_to_nvs(uint32_t generation);
+bool _validate_config(void);
+bool _load_cached_config(void);
+void _cache_config(uint32_t generation);
 
-void _load_wifi_credentials(void); 
-void _load_leaf_info(void);
+/**
+ * Copies a string and always null terminates it, long strings are truncated
+ * @param dst destination buffer
+ * @param dst_size size of dst
+ * @param src null terminated string
+ */
+void _copy_string(void* dst, size_t dst_size, const char* src);
 
-#endif
\ No newline at end of file
+#endif
@@ -1,6 +1,24 @@
 #ifndef LEAF_INFO_HPP
 #define LEAF_INFO_HPP
 
-const char* PLANT_NAME = "Rizq";
+#include <stdint.h>
 
-#endif
\ No newline at end of file
+//defaults written to nvs on the first boot, see leaf_config.hpp
+
+//identifies this node to the backend in binary payloads, which send the plant's index instead of its name
+const uint32_t NODE_ID = 1;
+
+//every plant served by this node and the ADC1 channel its probe is wired to
+//ADC1 channel 0 is GPIO36, channels 0-7 map to GPIO36, 37, 38, 39, 32, 33, 34, 35
+const struct {
+    const char* name;
+    uint8_t adc_channel;
+} PLANT_CHANNELS[] = {
+    {"Rizq", 0},
+};
+
+const char* SERVER_URL = "http://";
+const uint16_t SAMPLE_SIZE = 10;
+const uint32_t SLEEP_INTERVAL_S = 8;
+
+#endif
@@ -1,70 +1,343 @@
 #include <esp_log.h>
+#include <esp_attr.h>
+#include <nvs.h>
+#include <nvs_flash.h>
+#include <cstring>
+#include <cstdio>
+#include <cstddef>
 #include "leaf_config.hpp"
 #include "leaf_info.hpp"
 #include "wifi_credentials.hpp"
-#include "esp_mac.h"
-#include <cstring>
+#include "sleep_hal.hpp"
 
 static const char* _LEAF_CONFIG_LOGGER = "Leaf Congif *** ";
 
+const char* LEAF_CONFIG_NAMESPACE = "leaf_cfg";
+static const uint32_t CONFIG_CACHE_MAGIC = 0x4C434647; //"LCFG"
+const uint16_t MAX_SAMPLE_SIZE = 1000;
+
 wifi_credentials_t wifi_credentials; //from .hpp file
 leaf_info_t leaf_info; //from .hpp file
+leaf_settings_t leaf_settings; //from .hpp file
+
+//validated copy of the config kept in rtc memory so timer wakes don't need nvs. rtc memory is
+//reinitialized on a cold boot so the cache only survives deep sleep
+typedef struct {
+    uint32_t magic; //CONFIG_CACHE_MAGIC when the cache holds a config
+    uint32_t generation;
+    wifi_credentials_t wifi_credentials;
+    leaf_info_t leaf_info;
+    leaf_settings_t leaf_settings;
+    uint32_t checksum; //over every byte before it
+} config_cache_t;
 
+RTC_DATA_ATTR static config_cache_t _cache;
+static uint32_t _generation = 0;
+static bool _nvs_initialized = false;
+
+//fnv-1a. only guards the cache against a brownout corrupting rtc memory
+static uint32_t _cache_checksum(const config_cache_t& cache) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&cache);
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(config_cache_t, checksum); ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
 
 void initialize_leaf_config() {
     ESP_LOGI(_LEAF_CONFIG_LOGGER, "Initiliazing Leaf Configuration");
 
-    _load_leaf_info();
-    _load_wifi_credentials();
+    //timer wakes reuse the config decoded on the previous boot, nvs isn't touched at all
+    if (sleep_hal_woke_from_timer() && _load_cached_config()) {
+        ESP_LOGI(_LEAF_CONFIG_LOGGER, "Initiliazed Leaf Configuration from the rtc cache, generation %u", static_cast<unsigned>(_generation));
+        return;
+    }
+
+    //the defaults are loaded first so the node can still run if nvs can't be read
+    _load_defaults();
+
+    if (leaf_config_nvs_init() != ESP_OK) {
+        ESP_LOGE(_LEAF_CONFIG_LOGGER, "Error! Unable to initialize NVS, using the default configuration");
+        return;
+    }
 
-    ESP_LOGI(_LEAF_CONFIG_LOGGER, "Initiliazed Leaf Configuration");
+    esp_err_t res = _load_from_nvs();
+    if (res == ESP_ERR_NVS_NOT_FOUND) {
+        //first boot, or the namespace holds an older schema
+        ESP_LOGI(_LEAF_CONFIG_LOGGER, "No configuration in NVS, writing the defaults");
+        _load_defaults();
+        res = _save_to_nvs(1);
+        if (res == ESP_OK) {
+            _generation = 1;
+        }
+    } else if (res == ESP_OK && !_validate_config()) {
+        //nvs is left as is so whatever wrote it can fix it
+        ESP_LOGE(_LEAF_CONFIG_LOGGER, "Error! Invalid configuration in NVS, using the default configuration");
+        _load_defaults();
+    }
+
+    //a config that couldn't be read isn't cached so the next wake tries nvs again
+    if (res != ESP_OK) {
+        ESP_LOGE(_LEAF_CONFIG_LOGGER, "Error! Unable to read the configuration from NVS (%s), using the default configuration", esp_err_to_name(res));
+        return;
+    }
+
+    _cache_config(_generation);
+
+    for (size_t i = 0; i < leaf_info.plant_count; ++i) {
+        ESP_LOGI(_LEAF_CONFIG_LOGGER, "Plant %u: %s on ADC channel %u", static_cast<unsigned>(i), leaf_info.plants[i].plant_name, leaf_info.plants[i].adc_channel);
+    }
+    ESP_LOGI(_LEAF_CONFIG_LOGGER, "Initiliazed Leaf Configuration from NVS, generation %u", static_cast<unsigned>(_generation));
 }
 
-void _load_leaf_info() {
-    ESP_LOGI(_LEAF_CONFIG_LOGGER, "Initiliazing Leaf Info");
+esp_err_t leaf_config_nvs_init() {
+    if (_nvs_initialized) {
+        return ESP_OK;
+    }
 
-    //copies PLANT_NAME value to our object
-    strncpy(
-        reinterpret_cast<char *>(leaf_info.plant_name),
-        PLANT_NAME, sizeof(leaf_info.plant_name) / sizeof(char)
-    );
+    esp_err_t res = nvs_flash_init();
+    if (res == ESP_ERR_NVS_NO_FREE_PAGES || res == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        //the partition is full or was written by a newer nvs version, it has to be erased
+        ESP_LOGW(_LEAF_CONFIG_LOGGER, "WARNING! Erasing NVS partition");
+        if (nvs_flash_erase() != ESP_OK) {
+            return ESP_FAIL;
+        }
+        res = nvs_flash_init();
+    }
 
-    size_t name_len = strlen(PLANT_NAME);
+    _nvs_initialized = (res == ESP_OK);
+    return res;
+}
 
-    //null termination
-    leaf_info.plant_name[name_len] = '\0';
+esp_err_t leaf_config_save() {
+    if (!_validate_config()) {
+        ESP_LOGE(_LEAF_CONFIG_LOGGER, "Error! Refusing to save an invalid configuration");
+        return ESP_ERR_INVALID_ARG;
+    }
 
-    ESP_LOGI(_LEAF_CONFIG_LOGGER, "Initiliazed Leaf Info");
+    uint32_t generation = _generation + 1;
+    esp_err_t res = _save_to_nvs(generation);
+    if (res != ESP_OK) {
+        ESP_LOGE(_LEAF_CONFIG_LOGGER, "Error! Unable to save the configuration (%s)", esp_err_to_name(res));
+        return res;
+    }
+
+    _generation = generation;
+    _cache_config(generation);
+
+    ESP_LOGI(_LEAF_CONFIG_LOGGER, "Saved configuration generation %u", static_cast<unsigned>(generation));
+    return ESP_OK;
 }
 
-void _load_wifi_credentials() {
-    ESP_LOGI(_LEAF_CONFIG_LOGGER, "Initiliazing Wifi Credentials");
+void leaf_config_invalidate() {
+    _cache.magic = 0;
+}
+
+uint32_t leaf_config_generation() {
+    return _generation;
+}
+
+void _load_defaults() {
+    memset(&wifi_credentials, 0, sizeof(wifi_credentials));
+    memset(&leaf_info, 0, sizeof(leaf_info));
+    memset(&leaf_settings, 0, sizeof(leaf_settings));
+
+    _copy_string(wifi_credentials.wifi_ssid, sizeof(wifi_credentials.wifi_ssid), WIFI_SSID);
+    _copy_string(wifi_credentials.wifi_password, sizeof(wifi_credentials.wifi_password), WIFI_PASSWORD);
+
+    leaf_info.node_id = NODE_ID;
+
+    size_t plant_count = sizeof(PLANT_CHANNELS) / sizeof(PLANT_CHANNELS[0]);
+    if (plant_count > MAX_PLANTS) {
+        ESP_LOGW(_LEAF_CONFIG_LOGGER, "WARNING! %u plants configured, only the first %d are used", static_cast<unsigned>(plant_count), MAX_PLANTS);
+        plant_count = MAX_PLANTS;
+    }
+
+    for (size_t i = 0; i < plant_count; ++i) {
+        _copy_string(leaf_info.plants[i].plant_name, sizeof(leaf_info.plants[i].plant_name), PLANT_CHANNELS[i].name);
+        leaf_info.plants[i].adc_channel = PLANT_CHANNELS[i].adc_channel;
+    }
+    leaf_info.plant_count = plant_count;
+
+    _copy_string(leaf_settings.server_url, sizeof(leaf_settings.server_url), SERVER_URL);
+    leaf_settings.sample_size = SAMPLE_SIZE;
+    leaf_settings.sleep_interval_s = SLEEP_INTERVAL_S;
+
+    _generation = 0;
+}
+
+//reads a string key into a fixed size buffer. strings that don't fit are an error instead of being truncated
+static esp_err_t _get_string(nvs_handle_t handle, const char* key, void* dst, size_t dst_size) {
+    size_t len = dst_size;
+    return nvs_get_str(handle, key, static_cast<char*>(dst), &len);
+}
+
+esp_err_t _load_from_nvs() {
+    nvs_handle_t handle;
+    esp_err_t res = nvs_open(LEAF_CONFIG_NAMESPACE, NVS_READONLY, &handle);
+    if (res != ESP_OK) {
+        return res; //ESP_ERR_NVS_NOT_FOUND if the namespace was never written
+    }
+
+    uint8_t schema = 0;
+    res = nvs_get_u8(handle, "schema", &schema);
+    if (res == ESP_OK && schema != LEAF_CONFIG_SCHEMA) {
+        ESP_LOGW(_LEAF_CONFIG_LOGGER, "WARNING! NVS holds configuration schema %u, expected %d", schema, LEAF_CONFIG_SCHEMA);
+        res = ESP_ERR_NVS_NOT_FOUND;
+    }
 
-    //uses strncpy to copy the values stored in WIFI_SSID and WIFI_PASSWORD
-    //to the corresponding members of our wifi_credential object
+    //decoded into locals so an error part way through leaves the defaults untouched instead of a mix
+    uint32_t generation = 0;
+    wifi_credentials_t credentials = {};
+    leaf_info_t info = {};
+    leaf_settings_t settings = {};
 
-    strncpy(
-        reinterpret_cast<char *>(wifi_credentials.wifi_ssid),
-        WIFI_SSID, sizeof(wifi_credentials.wifi_ssid) / sizeof(char)
-    );
+    if (res == ESP_OK) res = nvs_get_u32(handle, "generation", &generation);
+    if (res == ESP_OK) res = _get_string(handle, "ssid", credentials.wifi_ssid, sizeof(credentials.wifi_ssid));
+    if (res == ESP_OK) res = _get_string(handle, "password", credentials.wifi_password, sizeof(credentials.wifi_password));
+    if (res == ESP_OK) res = nvs_get_u32(handle, "node_id", &info.node_id);
+    if (res == ESP_OK) res = nvs_get_u8(handle, "plant_count", &info.plant_count);
+    if (res == ESP_OK) res = _get_string(handle, "server_url", settings.server_url, sizeof(settings.server_url));
+    if (res == ESP_OK) res = nvs_get_u16(handle, "sample_size", &settings.sample_size);
+    if (res == ESP_OK) res = nvs_get_u32(handle, "sleep_s", &settings.sleep_interval_s);
 
-    strncpy(
-        reinterpret_cast<char *>(wifi_credentials.wifi_password),
-        WIFI_PASSWORD, sizeof(wifi_credentials.wifi_password) / sizeof(char)
-    );
+    if (res == ESP_OK && info.plant_count > MAX_PLANTS) {
+        res = ESP_ERR_INVALID_SIZE;
+    }
 
+    for (size_t i = 0; res == ESP_OK && i < info.plant_count; ++i) {
+        char key[16];
+        plant_info_t& plant = info.plants[i];
 
-    //ensuring that strings are properly null terminated
-    size_t ssid_len = strlen(
-        (WIFI_SSID)
-    );
+        snprintf(key, sizeof(key), "plant_name_%u", static_cast<unsigned>(i));
+        res = _get_string(handle, key, plant.plant_name, sizeof(plant.plant_name));
 
-    size_t pass_len = strlen(
-        (WIFI_PASSWORD)
-    );
+        snprintf(key, sizeof(key), "channel_%u", static_cast<unsigned>(i));
+        if (res == ESP_OK) res = nvs_get_u8(handle, key, &plant.adc_channel);
+    }
 
-    wifi_credentials.wifi_ssid[ssid_len] = '\0';
-    wifi_credentials.wifi_password[pass_len] = '\0';
+    nvs_close(handle);
 
-    ESP_LOGI(_LEAF_CONFIG_LOGGER, "Initiliazed Wifi Credentials");
-}
\ No newline at end of file
+    if (res == ESP_OK) {
+        _generation = generation;
+        wifi_credentials = credentials;
+        leaf_info = info;
+        leaf_settings = settings;
+    }
+    return res;
+}
+
+esp_err_t _save_to_nvs(uint32_t generation) {
+    esp_err_t res = leaf_config_nvs_init();
+    if (res != ESP_OK) {
+        return res;
+    }
+
+    nvs_handle_t handle;
+    res = nvs_open(LEAF_CONFIG_NAMESPACE, NVS_READWRITE, &handle);
+    if (res != ESP_OK) {
+        return res;
+    }
+
+    //the schema is invalidated first and written last so a reset halfway through doesn't leave a mix of
+    //old and new values that looks complete
+    res = nvs_set_u8(handle, "schema", 0);
+    if (res == ESP_OK) res = nvs_commit(handle);
+
+    if (res == ESP_OK) res = nvs_set_u32(handle, "generation", generation);
+    if (res == ESP_OK) res = nvs_set_str(handle, "ssid", reinterpret_cast<const char*>(wifi_credentials.wifi_ssid));
+    if (res == ESP_OK) res = nvs_set_str(handle, "password", reinterpret_cast<const char*>(wifi_credentials.wifi_password));
+    if (res == ESP_OK) res = nvs_set_u32(handle, "node_id", leaf_info.node_id);
+    if (res == ESP_OK) res = nvs_set_u8(handle, "plant_count", leaf_info.plant_count);
+    if (res == ESP_OK) res = nvs_set_str(handle, "server_url", leaf_settings.server_url);
+    if (res == ESP_OK) res = nvs_set_u16(handle, "sample_size", leaf_settings.sample_size);
+    if (res == ESP_OK) res = nvs_set_u32(handle, "sleep_s", leaf_settings.sleep_interval_s);
+
+    for (size_t i = 0; res == ESP_OK && i < leaf_info.plant_count; ++i) {
+        char key[16];
+        const plant_info_t& plant = leaf_info.plants[i];
+
+        snprintf(key, sizeof(key), "plant_name_%u", static_cast<unsigned>(i));
+        res = nvs_set_str(handle, key, reinterpret_cast<const char*>(plant.plant_name));
+
+        snprintf(key, sizeof(key), "channel_%u", static_cast<unsigned>(i));
+        if (res == ESP_OK) res = nvs_set_u8(handle, key, plant.adc_channel);
+    }
+
+    if (res == ESP_OK) res = nvs_set_u8(handle, "schema", LEAF_CONFIG_SCHEMA);
+    if (res == ESP_OK) res = nvs_commit(handle);
+
+    nvs_close(handle);
+    return res;
+}
+
+bool _validate_config() {
+    bool valid = true;
+
+    if (wifi_credentials.wifi_ssid[0] == '\0') {
+        ESP_LOGE(_LEAF_CONFIG_LOGGER, "Error! Empty Wifi SSID");
+        valid = false;
+    }
+
+    if (leaf_info.plant_count == 0 || leaf_info.plant_count > MAX_PLANTS) {
+        ESP_LOGE(_LEAF_CONFIG_LOGGER, "Error! Invalid plant count %u", leaf_info.plant_count);
+        valid = false;
+    }
+
+    for (size_t i = 0; i < leaf_info.plant_count && i < MAX_PLANTS; ++i) {
+        if (leaf_info.plants[i].adc_channel >= MAX_PLANTS) {
+            ESP_LOGE(_LEAF_CONFIG_LOGGER, "Error! Plant %u is on invalid ADC channel %u", static_cast<unsigned>(i), leaf_info.plants[i].adc_channel);
+            valid = false;
+        }
+    }
+
+    if (strncmp(leaf_settings.server_url, "http", 4) != 0) {
+        ESP_LOGE(_LEAF_CONFIG_LOGGER, "Error! Invalid server url %s", leaf_settings.server_url);
+        valid = false;
+    }
+
+    if (leaf_settings.sample_size == 0 || leaf_settings.sample_size > MAX_SAMPLE_SIZE) {
+        ESP_LOGE(_LEAF_CONFIG_LOGGER, "Error! Invalid sample size %u", leaf_settings.sample_size);
+        valid = false;
+    }
+
+    if (leaf_settings.sleep_interval_s == 0) {
+        ESP_LOGE(_LEAF_CONFIG_LOGGER, "Error! Invalid sleep interval");
+        valid = false;
+    }
+
+    return valid;
+}
+
+bool _load_cached_config() {
+    if (_cache.magic != CONFIG_CACHE_MAGIC || _cache.checksum != _cache_checksum(_cache)) {
+        return false;
+    }
+
+    wifi_credentials = _cache.wifi_credentials;
+    leaf_info = _cache.leaf_info;
+    leaf_settings = _cache.leaf_settings;
+    _generation = _cache.generation;
+    return true;
+}
+
+void _cache_config(uint32_t generation) {
+    _cache.magic = CONFIG_CACHE_MAGIC;
+    _cache.generation = generation;
+    _cache.wifi_credentials = wifi_credentials;
+    _cache.leaf_info = leaf_info;
+    _cache.leaf_settings = leaf_settings;
+    _cache.checksum = _cache_checksum(_cache);
+}
+
+void _copy_string(void* dst, size_t dst_size, const char* src) {
+    char* out = static_cast<char*>(dst);
+    if (dst_size == 0) {
+        return;
+    }
+
+    //the last byte is reserved for the null terminator so long strings are truncated instead of overflowing
+    strncpy(out, src, dst_size - 1);
+    out[dst_size - 1] = '\0';
+}
@@ -0,0 +1,63 @@
+#ifndef MEM_STATS_HPP
+#define MEM_STATS_HPP
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Memory headroom of the node. each task records the least stack it had left (its high water mark) and the
+ * lowest the free heap got is tracked next to it. the figures live in rtc memory so they're the worst seen
+ * since power on, not just this wake's, and they're attached to uploads (see the payload encoders) so stacks
+ * can be sized from what deployed nodes actually use. the tasks' stack sizes matter most in the
+ * STATIC_ALLOCATION build where they're reserved up front (see static_alloc.hpp)
+ *
+ * on the linux target there's nothing to measure, mem_stats_get returns everything as 0
+ */
+
+//tasks whose stacks are watched. the values are sent in the binary payload so new tasks go at the end
+typedef enum {
+    MEM_TASK_MAIN, //app_main, runs the wake cycle on timer wakes
+    MEM_TASK_TRACKER, //runs the wake cycle after a cold boot
+    MEM_TASK_SAMPLING, //samples while wifi connects
+    MEM_TASK_SAMPLER, //continuous mode
+    MEM_TASK_UPLINK, //continuous mode
+    MEM_TASK_COUNT
+} mem_task_t;
+
+extern const char* const MEM_TASK_NAMES[MEM_TASK_COUNT]; //short names used in logs and as keys in the json payload
+
+typedef struct {
+    uint32_t stack_size; //bytes, 0 if the task never recorded its usage
+    uint32_t stack_min_free; //least stack the task had left, in bytes
+} mem_task_stats_t;
+
+typedef struct {
+    uint32_t heap_free; //free heap when mem_stats_get was called
+    uint32_t heap_min_free; //lowest the free heap got since power on
+    uint32_t heap_largest_block; //largest allocation that could succeed when mem_stats_get was called
+    mem_task_stats_t tasks[MEM_TASK_COUNT];
+} mem_stats_t;
+
+/**
+ * Records how much stack a task has left. called by the task itself at the end of its work, or by another
+ * task with its handle
+ * @param id the task
+ * @param task its handle, NULL for the calling task
+ * @param stack_size stack the task was created with, in bytes
+ */
+void mem_stats_record_task(mem_task_t id, TaskHandle_t task, uint32_t stack_size);
+
+/**
+ * Reads the heap counters and folds them into the minimum
+ * @return returns the stats, or NULL if the target can't measure them
+ */
+const mem_stats_t* mem_stats_get();
+
+/**
+ * Logs every figure
+ */
+void mem_stats_log();
+
+#endif
@@ -0,0 +1,57 @@
+#include <esp_attr.h>
+#include <esp_log.h>
+#include "mem_hal.hpp"
+#include "mem_stats.hpp"
+
+const char* const MEM_TASK_NAMES[MEM_TASK_COUNT] = {
+    "main", "tracker", "sampling", "sampler", "uplink"
+};
+
+static const char* _logger = "Mem Stats *** ";
+
+//worst seen since power on. heap_caps only keeps the minimum since boot and every wake is a boot
+RTC_DATA_ATTR static mem_stats_t _stats;
+
+void mem_stats_record_task(mem_task_t id, TaskHandle_t task, uint32_t stack_size) {
+    uint32_t min_free = 0;
+    if (mem_hal_stack_min_free(task, &min_free) != ESP_OK) {
+        return;
+    }
+
+    mem_task_stats_t& stats = _stats.tasks[id];
+    if (stats.stack_size != stack_size || min_free < stats.stack_min_free) {
+        stats.stack_min_free = min_free;
+    }
+    stats.stack_size = stack_size;
+}
+
+const mem_stats_t* mem_stats_get() {
+    mem_hal_heap_t heap;
+    if (mem_hal_heap(&heap) != ESP_OK) {
+        return NULL;
+    }
+
+    _stats.heap_free = heap.free_bytes;
+    _stats.heap_largest_block = heap.largest_block;
+    if (_stats.heap_min_free == 0 || heap.min_free_bytes < _stats.heap_min_free) {
+        _stats.heap_min_free = heap.min_free_bytes;
+    }
+    return &_stats;
+}
+
+void mem_stats_log() {
+    const mem_stats_t* stats = mem_stats_get();
+    if (stats == NULL) {
+        return;
+    }
+
+    ESP_LOGI(_logger, "Heap: %u free, %u at the lowest, largest block %u", static_cast<unsigned>(stats->heap_free),
+        static_cast<unsigned>(stats->heap_min_free), static_cast<unsigned>(stats->heap_largest_block));
+    for (size_t i = 0; i < MEM_TASK_COUNT; ++i) {
+        const mem_task_stats_t& task = stats->tasks[i];
+        if (task.stack_size > 0) {
+            ESP_LOGI(_logger, "  %s stack: %u of %u bytes used at the most", MEM_TASK_NAMES[i],
+                static_cast<unsigned>(task.stack_size - task.stack_min_free), static_cast<unsigned>(task.stack_size));
+        }
+    }
+}
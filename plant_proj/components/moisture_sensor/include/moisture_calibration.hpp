@@ -0,0 +1,117 @@
+#ifndef MOISTURE_CALIBRATION_HPP
+#define MOISTURE_CALIBRATION_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Converts probe voltages to moisture in percent. every probe type is described by calibration points measured
+ * in dry and saturated soil (two points) or along the whole range (multi point), and the curve through them is
+ * sampled into an integer lookup table at compile time by calibration_build_lut. at runtime a conversion is
+ * one table lookup and a linear interpolation between two entries, no floating point
+ *
+ * capacitive probes output less as the soil gets wetter, so the points are usually sorted by falling percent
+ */
+
+#define CALIBRATION_CHANNELS 8 //one table per ADC1 channel
+#define CALIBRATION_MAX_POINTS 8
+#define CALIBRATION_STEP_SHIFT 4 //table entries are 2^4 = 16 mV apart, keeps the error at the points' corners below 0.3 percent
+#define CALIBRATION_LUT_SIZE 209 //covers 0 to 3328 mV, above the esp32's input range
+#define CALIBRATION_PERCENT_SCALE 100 //percentages in the points and the table are hundredths of a percent
+#define CALIBRATION_REFERENCE_TEMP_C 20 //temperature the points were measured at
+
+typedef struct {
+    int32_t mv; //probe output
+    int32_t percent; //moisture at that output, scaled by CALIBRATION_PERCENT_SCALE
+} calibration_point_t;
+
+typedef struct {
+    calibration_point_t points[CALIBRATION_MAX_POINTS]; //sorted by rising mv
+    size_t point_count; //at least 2
+    int32_t mv_per_c; //how much the probe output rises per degree above CALIBRATION_REFERENCE_TEMP_C, 0 to ignore temperature
+} probe_calibration_t;
+
+typedef struct {
+    int16_t percent[CALIBRATION_LUT_SIZE]; //moisture at i << CALIBRATION_STEP_SHIFT mV, scaled by CALIBRATION_PERCENT_SCALE
+    int32_t mv_per_c;
+} calibration_lut_t;
+
+/**
+ * Evaluates the curve through a probe's points. outside of the points the nearest point's percentage is used,
+ * and the result is kept within 0 to 100 percent
+ * @param probe calibration of the probe
+ * @param mv probe output
+ * @return returns the moisture scaled by CALIBRATION_PERCENT_SCALE
+ */
+constexpr int32_t calibration_curve(const probe_calibration_t& probe, int32_t mv) {
+    const calibration_point_t* points = probe.points;
+    size_t last = probe.point_count - 1;
+
+    int32_t percent = points[last].percent;
+    if (mv <= points[0].mv) {
+        percent = points[0].percent;
+    } else {
+        for (size_t i = 1; i <= last; ++i) {
+            if (mv <= points[i].mv) {
+                //rounds to the nearest hundredth
+                int64_t span = points[i].mv - points[i - 1].mv;
+                int64_t offset = static_cast<int64_t>(points[i].percent - points[i - 1].percent) * (mv - points[i - 1].mv);
+                percent = points[i - 1].percent + static_cast<int32_t>((offset + (offset >= 0 ? span / 2 : -span / 2)) / span);
+                break;
+            }
+        }
+    }
+
+    if (percent < 0) {
+        return 0;
+    }
+    if (percent > 100 * CALIBRATION_PERCENT_SCALE) {
+        return 100 * CALIBRATION_PERCENT_SCALE;
+    }
+    return percent;
+}
+
+/**
+ * @param probe calibration of the probe
+ * @return returns true if the probe has 2 to CALIBRATION_MAX_POINTS points sorted by rising mv. used in static_asserts
+ */
+constexpr bool calibration_valid(const probe_calibration_t& probe) {
+    if (probe.point_count < 2 || probe.point_count > CALIBRATION_MAX_POINTS) {
+        return false;
+    }
+    for (size_t i = 1; i < probe.point_count; ++i) {
+        if (probe.points[i].mv <= probe.points[i - 1].mv) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Samples a probe's curve into a lookup table. meant to run at compile time, ie
+ * constexpr calibration_lut_t LUT = calibration_build_lut(PROBE);
+ * @param probe calibration of the probe, see calibration_valid
+ * @return returns the table
+ */
+constexpr calibration_lut_t calibration_build_lut(const probe_calibration_t& probe) {
+    calibration_lut_t lut = {};
+    for (size_t i = 0; i < CALIBRATION_LUT_SIZE; ++i) {
+        lut.percent[i] = static_cast<int16_t>(calibration_curve(probe, static_cast<int32_t>(i << CALIBRATION_STEP_SHIFT)));
+    }
+    lut.mv_per_c = probe.mv_per_c;
+    return lut;
+}
+
+extern const calibration_lut_t* const CHANNEL_CALIBRATIONS[CALIBRATION_CHANNELS]; //table of the probe wired to each ADC1 channel
+
+/**
+ * Converts a probe output to moisture with a table built by calibration_build_lut
+ * @param lut table of the probe
+ * @param mv probe output in mV multiplied by scale
+ * @param scale power of 10 mv and the result are multiplied by
+ * @param temp_c soil temperature, CALIBRATION_REFERENCE_TEMP_C if it isn't measured
+ * @return returns the moisture in percent multiplied by scale
+ */
+int32_t calibration_mv_to_percent(const calibration_lut_t& lut, int32_t mv, int32_t scale, int32_t temp_c);
+
+#endif
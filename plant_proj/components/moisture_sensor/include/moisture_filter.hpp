@@ -0,0 +1,59 @@
+#ifndef MOISTURE_FILTER_HPP
+#define MOISTURE_FILTER_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Integer only filters that reduce a buffer of raw ADC samples into one value. results are fixed point
+ * numbers scaled by FILTER_SCALE so the fraction of an ADC step isn't lost before calibration.
+ * the robust filters (median, trimmed mean, MAD) stop a single noise spike from the probe skewing the reading
+ */
+
+#define FILTER_IIR_SLOTS 8 //number of independent iir filters, one per ADC channel
+
+//filter results are raw ADC values multiplied by FILTER_SCALE (Q4). 4095 * 16 still fits easily in an int32
+#define FILTER_SCALE 16
+
+typedef enum {
+    FILTER_MEAN, //plain average
+    FILTER_MEDIAN, //middle value, ignores up to half the samples being outliers
+    FILTER_TRIMMED_MEAN, //average after dropping FILTER_TRIM_PERCENT of the samples from each end
+    FILTER_MAD_MEAN, //average of the samples within FILTER_MAD_THRESHOLD median absolute deviations of the median
+} moisture_filter_t;
+
+extern const int FILTER_TRIM_PERCENT; //percent of samples dropped from each end by the trimmed mean
+extern const int32_t FILTER_MAD_THRESHOLD; //outlier threshold in MADs, scaled by 1000
+extern const int IIR_SHIFT; //smoothing factor of the iir filter is 1 / 2^IIR_SHIFT
+
+/**
+ * reduces the samples with the selected filter
+ * @param filter filter to use
+ * @param samples raw ADC samples
+ * @param n number of samples
+ * @param scratch working space of at least n ints. the robust filters sort the samples in here
+ * @return returns the filtered value scaled by FILTER_SCALE, 0 if n is 0
+ */
+int32_t filter_samples(moisture_filter_t filter, const int* samples, size_t n, int* scratch);
+
+/**
+ * smooths a filtered value with a first order iir filter. its state is kept in rtc memory so the
+ * smoothing carries across deep sleep
+ * @param slot which filter to use, one per channel
+ * @param value filtered value scaled by FILTER_SCALE
+ * @return returns the smoothed value scaled by FILTER_SCALE
+ */
+int32_t filter_iir_smooth(size_t slot, int32_t value);
+
+/**
+ * resets an iir filter so its next value is taken as is
+ * @param slot which filter to reset
+ */
+void filter_iir_reset(size_t slot);
+
+int32_t _filter_mean(const int* samples, size_t n);
+int32_t _filter_median(int* sorted, size_t n);
+int32_t _filter_trimmed_mean(int* sorted, size_t n);
+int32_t _filter_mad_mean(const int* samples, int* scratch, size_t n);
+
+#endif
@@ -2,47 +2,151 @@
 #define MOISTURE_SENSOR_HPP
 
 #include <freertos/FreeRTOS.h>
-#include <esp_adc/adc_oneshot.h>
-#include <esp_adc/adc_cali.h>
-#include <esp_adc/adc_cali_scheme.h>
+#include <stdint.h>
+#include <stddef.h>
 #include <vector>
+#include "moisture_filter.hpp"
+#include "adc_hal.hpp"
 
 /**
- * Espressif Docs on using one shot mode and calibrating analog readings
- * https://docs.espressif.com/projects/esp-idf/en/stable/esp32/api-reference/peripherals/adc_oneshot.html
- * https://docs.espressif.com/projects/esp-idf/en/stable/esp32/api-reference/peripherals/adc_calibration.html
+ * Samples the moisture probes and reduces the samples to moisture readings in percent. the ADC itself is reached
+ * through adc_hal.hpp so this code also runs on the linux target
  * 
  * data sheet
  * https://documentation.espressif.com/esp32_technical_reference_manual_en.pdf
  */
 
-extern adc_oneshot_unit_init_cfg_t ADC_CONFIG; // adc object used to select ADC unit
-extern adc_oneshot_chan_cfg_t CHAN_CONFIG; //used to set attenuation and bitwidth
-extern adc_cali_line_fitting_config_t CALI_CONFIG; // used for calibration
+#define MOISTURE_SENSOR_MAX_CHANNELS 8 //ADC1 has 8 channels
+#define MOISTURE_SENSOR_STATIC_SAMPLES 256 //samples of every channel together the buffers hold when built with STATIC_ALLOCATION
 
+//how the ADC is driven when taking a reading
+typedef enum {
+    ADC_SAMPLE_ONESHOT, //the cpu triggers and reads every sample one by one
+    ADC_SAMPLE_CONTINUOUS, //the ADC fills a DMA frame on its own at ADC_SAMPLE_FREQ_HZ
+} adc_sample_mode_t;
+
+extern const adc_sample_mode_t ADC_SAMPLE_MODE; //selects the backend used by get_moisture_values
+extern const uint32_t ADC_SAMPLE_FREQ_HZ; //sample rate in continuous mode
+extern const int ADC_OVERSAMPLE_FACTOR; //raw samples averaged into each buffer entry in continuous mode
+extern const uint32_t ADC_READ_TIMEOUT_MARGIN; //ms waited for the DMA frame past the time it takes at ADC_SAMPLE_FREQ_HZ
+extern const uint32_t ADC_MAX_FRAME_MS; //longest DMA frame a sample size can ask for in continuous mode
+extern const moisture_filter_t MOISTURE_FILTER; //filter that reduces the readings buffer into one value
+extern const bool IIR_SMOOTHING_ENABLED; //smooths readings across wakes with an iir filter
+extern const int ADC_RAW_MAX; //largest raw ADC value
+extern const int32_t MOISTURE_NO_READING; //value of a channel the last read got no samples of
+
+
+/**
+ * Sets up the ADC on the ESP32 as well as a buffer of n readings per channel to store moisture readings. can be
+ * called again, the drivers of the previous call are released first
+ * @param n number of samples taken from each channel per reading. capped by moisture_sensor_max_samples
+ * @param channels ADC1 channels the probes are wired to
+ * @param channel_count number of channels, at most MOISTURE_SENSOR_MAX_CHANNELS
+ */
+void moisture_sensor_init(int n, const uint8_t* channels, size_t channel_count);
 
 /**
- * Sets up the ADC on the ESP32 as well as a buffer of size n to store moisture readings
- * @param n size of the buffer used to capture buff_size reading
+ * @param channel_count number of channels sampled together
+ * @return returns the most samples per channel a read can take. in continuous mode that's what converts within
+ * ADC_MAX_FRAME_MS (and fits the static buffers in the STATIC_ALLOCATION build), oneshot reads aren't limited
  */
-void moisture_sensor_init(int n);
+int moisture_sensor_max_samples(size_t channel_count);
 
 /**
- * performs n reads from the moisture sensor and stores them in a buffer.
- * multisampling is done to mitigate noise
- * @return returns the average of the buffer values
+ * samples every channel in one interleaved burst and reduces each channel's samples to a value.
+ * stays in integer arithmetic the whole way
+ * @param scale power of 10 the results are multiplied by (ie 100 returns hundredths of a percent)
+ * @param out set to each channel's filtered value converted to moisture in percent (see moisture_calibration.hpp)
+ * multiplied by scale, in the order
+ * the channels were passed to moisture_sensor_init. MOISTURE_NO_READING for a channel that got no samples (ie the
+ * DMA frame timed out), which isn't a reading and mustn't be reported
  */
-double get_moisture_val();
+void get_moisture_values(int32_t scale, int32_t* out);
 
 /**
- * reads from the configured gpio pin and populates the buffer
+ * @return returns how long the last call to get_moisture_values kept the cpu busy sampling, in microseconds
+ */
+int64_t get_last_sample_time_us();
+
+/**
+ * reads from the configured gpio pins and populates the buffer with raw ADC values
  */
 void _populate_buffer();
 
 /**
- * gets the mean of the buffer
+ * populates the buffer with one shot reads
+ */
+void _populate_buffer_oneshot();
+
+/**
+ * captures a whole DMA frame of ADC_OVERSAMPLE_FACTOR * n samples per channel and reduces it into the buffer
+ */
+void _populate_buffer_continuous();
+
+/**
+ * initializes the ADC for one shot reads
+ */
+void _oneshot_init();
+
+/**
+ * initializes the ADC for continuous reads
+ * @param n number of samples per channel
+ */
+void _continuous_init(int n);
+
+/**
+ * @param frame_samples conversions in the frame, every channel's
+ * @return returns how long the ADC takes to fill the frame at ADC_SAMPLE_FREQ_HZ plus ADC_READ_TIMEOUT_MARGIN, in ms
+ */
+uint32_t _frame_timeout_ms(size_t frame_samples);
+
+/**
+ * converts a filtered raw value to a voltage, interpolating between ADC steps
+ * @param raw raw ADC value scaled by FILTER_SCALE
+ * @param scale power of 10 the result is multiplied by
+ * @return returns the voltage in mV multiplied by scale
+ */
+int32_t _calibrate_fixed(int32_t raw, int32_t scale);
+
+/**
+ * @return returns the number of channels being sampled
+ */
+size_t moisture_sensor_channel_count();
+
+/**
+ * @param slot slot of the channel, in the order the channels were passed to moisture_sensor_init
+ * @return returns the ADC1 channel in the slot
+ */
+uint8_t moisture_sensor_channel(size_t slot);
+
+/**
+ * The samples the last read reduced to the channel's value, before any filtering. in continuous mode every
+ * sample is the average of ADC_OVERSAMPLE_FACTOR conversions
+ * @param slot slot of the channel
+ * @param count set to the number of samples
+ * @return returns the channel's samples, valid until the next read or moisture_sensor_init
+ */
+const int* moisture_sensor_samples(size_t slot, size_t* count);
+
+/**
+ * The conversions of the last continuous capture before they were averaged, every channel's interleaved
+ * @param count set to the number of conversions
+ * @return returns the conversions, valid until the next read or moisture_sensor_init. NULL in oneshot mode
+ */
+const adc_hal_sample_t* moisture_sensor_frame(size_t* count);
+
+/**
+ * @param i slot of the channel
+ * @return returns the number of samples the last read captured for the channel
+ */
+size_t _samples_in_channel(size_t i);
+
+/**
+ * Only in the STATIC_ALLOCATION build, where the buffers can't grow
+ * @param channels number of channels sampled together, at least 1
+ * @return returns the most samples per channel the static buffers hold for that many channels
  */
-double _get_mean();
+int _static_max_samples(size_t channels);
 
 
-#endif
\ No newline at end of file
+#endif
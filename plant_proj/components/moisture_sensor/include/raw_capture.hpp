@@ -0,0 +1,109 @@
+#ifndef RAW_CAPTURE_HPP
+#define RAW_CAPTURE_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Diagnostic capture of the samples behind the readings. a misbehaving probe only shows up as an odd mean,
+ * with RAW_CAPTURE_ENABLED=1 every wake also keeps the samples of its last read, compressed, in rtc memory and
+ * the next upload carries them next to the timing summary (see the payload encoders). RAW_CAPTURE_MODE picks
+ * the samples the filters saw or, in continuous ADC mode, the full rate conversions before they were averaged,
+ * ADC_OVERSAMPLE_FACTOR times as many over the same stretch of time
+ *
+ * the samples are sent as delta + zig-zag varints. neighbouring samples of a probe are close so most deltas fit
+ * in one byte, against two for the raw 12 bit value. every channel gets an equal share of RAW_CAPTURE_LEN, the
+ * samples that don't fit in it are left out. tools/wire_format.py decodes it, tools/raw_capture_bench.py
+ * compares it with other encodings over recorded captures
+ *
+ * data layout, per channel:
+ *   u8  plant_id      slot of the channel, the plant's index in leaf_info.plants
+ *   u16 count         number of samples that follow, little endian
+ *   varint deltas     zig-zag encoded difference to the previous sample (the first to 0), 7 bits per byte
+ *                     least significant first, the high bit is set on every byte but the last
+ *
+ * continuous mode (continuous_mode.hpp) doesn't capture, its sampler and uplink tasks would share the buffer
+ */
+
+#ifndef RAW_CAPTURE_ENABLED
+#define RAW_CAPTURE_ENABLED 0
+#endif
+
+#define RAW_CAPTURE_LEN 1024 //bytes of compressed samples kept in rtc memory
+
+typedef enum {
+    RAW_CAPTURE_NONE,
+    RAW_CAPTURE_SAMPLES, //the samples the filters reduce to a reading
+    RAW_CAPTURE_FULL_RATE, //the conversions the samples were averaged from, continuous ADC mode only
+} raw_capture_mode_t;
+
+typedef struct {
+    uint8_t mode; //raw_capture_mode_t of the samples, RAW_CAPTURE_NONE if there are none
+    uint16_t len; //bytes used in data
+    uint8_t data[RAW_CAPTURE_LEN];
+} raw_capture_t;
+
+#if RAW_CAPTURE_ENABLED
+
+extern const raw_capture_mode_t RAW_CAPTURE_MODE;
+
+#define RAW_CAPTURE_TAKE() raw_capture_take()
+#define RAW_CAPTURE_GET() raw_capture_get()
+#define RAW_CAPTURE_CLEAR() raw_capture_clear()
+
+/**
+ * Compresses the samples of the moisture sensor's last read into the capture, replacing the previous one.
+ * called right after sampling
+ */
+void raw_capture_take();
+
+/**
+ * @return returns the capture waiting to be sent, or NULL if there is none
+ */
+const raw_capture_t* raw_capture_get();
+
+/**
+ * Drops the capture. called once it was uploaded
+ */
+void raw_capture_clear();
+
+/**
+ * Takes the capture in a given mode, raw_capture_take passes RAW_CAPTURE_MODE
+ * @param mode samples to keep. RAW_CAPTURE_FULL_RATE falls back to the samples without a continuous frame
+ */
+void _raw_capture_take(raw_capture_mode_t mode);
+
+/**
+ * Appends one channel's samples to the capture. samples that would go past end are left out
+ * @param plant_id slot of the channel
+ * @param samples the channel's samples
+ * @param count number of values in samples
+ * @param end offset in the capture's data the channel has to end before
+ */
+void _raw_capture_channel(uint8_t plant_id, const int* samples, size_t count, size_t end);
+
+/**
+ * Appends the channel's conversions from an interleaved continuous frame
+ * @param plant_id slot of the channel
+ * @param channel ADC1 channel of the slot
+ * @param end offset in the capture's data the channel has to end before
+ */
+void _raw_capture_frame_channel(uint8_t plant_id, uint8_t channel, size_t end);
+
+/**
+ * Appends one delta to the capture
+ * @param delta difference to the previous sample
+ * @param end offset in the capture's data the varint has to end before
+ * @return returns false if it didn't fit, the capture is left as it was
+ */
+bool _raw_capture_put(int32_t delta, size_t end);
+
+#else
+
+#define RAW_CAPTURE_TAKE() ((void)0)
+#define RAW_CAPTURE_GET() (static_cast<const raw_capture_t*>(NULL))
+#define RAW_CAPTURE_CLEAR() ((void)0)
+
+#endif
+
+#endif
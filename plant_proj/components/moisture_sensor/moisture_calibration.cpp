@@ -0,0 +1,47 @@
+#include "moisture_calibration.hpp"
+
+//capacitive soil moisture sensor v1.2 on 3.3 V, measured in potting soil. the response flattens out towards
+//both ends so it takes more than two points
+static constexpr probe_calibration_t CAPACITIVE_V1_2 = {
+    .points = {
+        {1300, 10000}, //saturated
+        {1500, 8500},
+        {1800, 6000},
+        {2200, 3000},
+        {2550, 1000},
+        {2800, 0}, //dry
+    },
+    .point_count = 6,
+    .mv_per_c = 0,
+};
+static_assert(calibration_valid(CAPACITIVE_V1_2), "calibration points must be sorted by rising mv");
+
+static constexpr calibration_lut_t CAPACITIVE_V1_2_LUT = calibration_build_lut(CAPACITIVE_V1_2);
+
+const calibration_lut_t* const CHANNEL_CALIBRATIONS[CALIBRATION_CHANNELS] = {
+    &CAPACITIVE_V1_2_LUT, &CAPACITIVE_V1_2_LUT, &CAPACITIVE_V1_2_LUT, &CAPACITIVE_V1_2_LUT,
+    &CAPACITIVE_V1_2_LUT, &CAPACITIVE_V1_2_LUT, &CAPACITIVE_V1_2_LUT, &CAPACITIVE_V1_2_LUT,
+};
+
+int32_t calibration_mv_to_percent(const calibration_lut_t& lut, int32_t mv, int32_t scale, int32_t temp_c) {
+    //moves the output back to what the probe would read at the reference temperature
+    int64_t scaled_mv = static_cast<int64_t>(mv) - static_cast<int64_t>(lut.mv_per_c) * (temp_c - CALIBRATION_REFERENCE_TEMP_C) * scale;
+
+    int64_t step = static_cast<int64_t>(scale) << CALIBRATION_STEP_SHIFT;
+    if (scaled_mv <= 0) {
+        return static_cast<int32_t>(static_cast<int64_t>(lut.percent[0]) * scale / CALIBRATION_PERCENT_SCALE);
+    }
+
+    size_t i = static_cast<size_t>(scaled_mv / step);
+    if (i >= CALIBRATION_LUT_SIZE - 1) {
+        return static_cast<int32_t>(static_cast<int64_t>(lut.percent[CALIBRATION_LUT_SIZE - 1]) * scale / CALIBRATION_PERCENT_SCALE);
+    }
+
+    //interpolates between the two entries around mv, in percent multiplied by scale * CALIBRATION_PERCENT_SCALE
+    int64_t frac = scaled_mv - static_cast<int64_t>(i) * step;
+    int64_t p0 = lut.percent[i];
+    int64_t p1 = lut.percent[i + 1];
+    int64_t percent = p0 * scale + (p1 - p0) * scale * frac / step;
+
+    return static_cast<int32_t>(percent / CALIBRATION_PERCENT_SCALE);
+}
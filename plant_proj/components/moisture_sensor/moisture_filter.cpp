@@ -0,0 +1,122 @@
+#include <esp_attr.h>
+#include <algorithm>
+#include "moisture_filter.hpp"
+
+const int FILTER_TRIM_PERCENT = 20;
+const int32_t FILTER_MAD_THRESHOLD = 4448; //3 standard deviations. 1 MAD is ~1/1.4826 of a std deviation for gaussian noise
+const int IIR_SHIFT = 2; //new values are weighted 1/4
+
+//iir state in rtc memory, survives deep sleep
+RTC_DATA_ATTR static int32_t _iir_state[FILTER_IIR_SLOTS];
+RTC_DATA_ATTR static bool _iir_valid[FILTER_IIR_SLOTS];
+
+int32_t filter_samples(moisture_filter_t filter, const int* samples, size_t n, int* scratch) {
+    if (n == 0) {
+        return 0;
+    }
+
+    switch (filter) {
+        case FILTER_MEDIAN:
+            std::copy(samples, samples + n, scratch);
+            std::sort(scratch, scratch + n);
+            return _filter_median(scratch, n);
+        case FILTER_TRIMMED_MEAN:
+            std::copy(samples, samples + n, scratch);
+            std::sort(scratch, scratch + n);
+            return _filter_trimmed_mean(scratch, n);
+        case FILTER_MAD_MEAN:
+            return _filter_mad_mean(samples, scratch, n);
+        case FILTER_MEAN:
+        default:
+            return _filter_mean(samples, n);
+    }
+}
+
+int32_t filter_iir_smooth(size_t slot, int32_t value) {
+    if (slot >= FILTER_IIR_SLOTS) {
+        return value;
+    }
+
+    if (!_iir_valid[slot]) {
+        _iir_state[slot] = value;
+        _iir_valid[slot] = true;
+        return value;
+    }
+
+    //y += (x - y) / 2^shift. the division is done on the magnitude so negative steps round the same way as positive ones
+    int32_t step = value - _iir_state[slot];
+    _iir_state[slot] += (step >= 0) ? (step >> IIR_SHIFT) : -((-step) >> IIR_SHIFT);
+    return _iir_state[slot];
+}
+
+void filter_iir_reset(size_t slot) {
+    if (slot < FILTER_IIR_SLOTS) {
+        _iir_valid[slot] = false;
+    }
+}
+
+int32_t _filter_mean(const int* samples, size_t n) {
+    int64_t sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+        sum += samples[i];
+    }
+
+    //rounds to the nearest fixed point value
+    return static_cast<int32_t>((sum * FILTER_SCALE + static_cast<int64_t>(n / 2)) / static_cast<int64_t>(n));
+}
+
+int32_t _filter_median(int* sorted, size_t n) {
+    //even sized buffers use the average of the two middle values
+    if (n % 2 == 0) {
+        return (sorted[n / 2 - 1] + sorted[n / 2]) * FILTER_SCALE / 2;
+    }
+    return sorted[n / 2] * FILTER_SCALE;
+}
+
+int32_t _filter_trimmed_mean(int* sorted, size_t n) {
+    size_t trim = n * FILTER_TRIM_PERCENT / 100;
+
+    //always keeps at least one sample
+    if (2 * trim >= n) {
+        trim = (n - 1) / 2;
+    }
+
+    return _filter_mean(sorted + trim, n - 2 * trim);
+}
+
+int32_t _filter_mad_mean(const int* samples, int* scratch, size_t n) {
+    std::copy(samples, samples + n, scratch);
+    std::sort(scratch, scratch + n);
+    int32_t median = _filter_median(scratch, n);
+
+    //absolute deviations from the median, all in FILTER_SCALE units
+    for (size_t i = 0; i < n; ++i) {
+        int32_t dev = samples[i] * FILTER_SCALE - median;
+        scratch[i] = (dev < 0) ? -dev : dev;
+    }
+    std::sort(scratch, scratch + n);
+    int32_t mad = (n % 2 == 0) ? (scratch[n / 2 - 1] + scratch[n / 2]) / 2 : scratch[n / 2];
+
+    //a MAD of 0 means more than half the samples are identical. one ADC step is allowed so the
+    //samples next to the median aren't all thrown away
+    if (mad < FILTER_SCALE) {
+        mad = FILTER_SCALE;
+    }
+
+    int64_t sum = 0;
+    int64_t kept = 0;
+    for (size_t i = 0; i < n; ++i) {
+        int32_t dev = samples[i] * FILTER_SCALE - median;
+        if (dev < 0) {
+            dev = -dev;
+        }
+
+        if (static_cast<int64_t>(dev) * 1000 <= static_cast<int64_t>(mad) * FILTER_MAD_THRESHOLD) {
+            sum += samples[i];
+            kept += 1;
+        }
+    }
+
+    //the median itself is always within the threshold so kept is never 0
+    return static_cast<int32_t>((sum * FILTER_SCALE + kept / 2) / kept);
+}
@@ -1,99 +1,278 @@
 #include "moisture_sensor.hpp"
+#include "moisture_calibration.hpp"
 #include <esp_log.h>
+#include "adc_hal.hpp"
+#include "sleep_hal.hpp"
+#include "event_log.hpp"
+#include "static_alloc.hpp"
 
-adc_oneshot_unit_init_cfg_t ADC_CONFIG; 
-adc_oneshot_chan_cfg_t CHAN_CONFIG;
-adc_cali_line_fitting_config_t CALI_CONFIG;
+const adc_sample_mode_t ADC_SAMPLE_MODE = ADC_SAMPLE_CONTINUOUS;
+const uint32_t ADC_SAMPLE_FREQ_HZ = 20000; //lowest rate the esp32's digital controller supports
+const int ADC_OVERSAMPLE_FACTOR = 8;
+const uint32_t ADC_READ_TIMEOUT_MARGIN = 50; //ms, the frame's duration grows with the sample size
+const uint32_t ADC_MAX_FRAME_MS = 250; //the cpu waits on the frame, and the wake with it
+const moisture_filter_t MOISTURE_FILTER = FILTER_MAD_MEAN;
+const bool IIR_SMOOTHING_ENABLED = false;
+const int ADC_RAW_MAX = 4095; //12 bit ADC
+const int32_t MOISTURE_NO_READING = INT32_MIN;
 
-adc_oneshot_unit_handle_t adc1_handle;
-adc_cali_handle_t cali_handle;
+//samples of every channel. channel i's samples are at [i * n, (i + 1) * n)
+#if STATIC_ALLOCATION
+static_vector<int, MOISTURE_SENSOR_STATIC_SAMPLES> _readings_buffer;
+static_vector<adc_hal_sample_t, ADC_HAL_STATIC_FRAME_SAMPLES> _frame_buffer;
+static_vector<int, MOISTURE_SENSOR_STATIC_SAMPLES> _filter_scratch;
+#else
 std::vector<int> _readings_buffer;
+std::vector<adc_hal_sample_t> _frame_buffer; //decoded conversions of a continuous capture
+std::vector<int> _filter_scratch; //working space for the filters, same size as one channel's samples
+#endif
+static uint8_t _channels[MOISTURE_SENSOR_MAX_CHANNELS]; //channels being sampled
+static size_t _channel_count = 0;
+static int _buffer_size = 0; //samples per channel
+static int _samples_filled[MOISTURE_SENSOR_MAX_CHANNELS]; //samples actually captured per channel by the last read
+static size_t _frame_filled = 0; //conversions the last continuous capture got
+static uint32_t _read_timeout_ms = 0; //how long a continuous capture waits for its frame
+static int64_t _last_sample_time_us = 0;
 static const char* _logger = "Moisture Sensor *** ";
 
 
 
 
-void moisture_sensor_init(int n) {
-    ESP_LOGI(_logger, "Starting Moisture sensor initialization");
+void moisture_sensor_init(int n, const uint8_t* channels, size_t channel_count) {
+    if (channel_count > MOISTURE_SENSOR_MAX_CHANNELS) {
+        ESP_LOGW(_logger, "WARNING! %u channels requested, only the first %d are sampled", static_cast<unsigned>(channel_count), MOISTURE_SENSOR_MAX_CHANNELS);
+        channel_count = MOISTURE_SENSOR_MAX_CHANNELS;
+    }
 
-    ESP_LOGI(_logger, "Initializing ADC configuration");
-    // using ADC1 GPIO(32-39)
-    ADC_CONFIG = {
-        .unit_id = ADC_UNIT_1,
-        .ulp_mode = ADC_ULP_MODE_DISABLE,
-    };
+    for (size_t i = 0; i < channel_count; ++i) {
+        _channels[i] = channels[i];
+    }
+    _channel_count = channel_count;
 
-    ESP_ERROR_CHECK(adc_oneshot_new_unit(&ADC_CONFIG, &adc1_handle));
+    //a config saved before the limit (or with a different plant count) can ask for more
+    int max_n = moisture_sensor_max_samples(channel_count);
+    if (n > max_n) {
+        ESP_LOGW(_logger, "WARNING! %d samples per channel requested, a read can take %d", n, max_n);
+        n = max_n;
+    }
+    _buffer_size = n;
 
-    ESP_LOGI(_logger, "Initializing ADC channel");
-    //channel configuration
-    CHAN_CONFIG = {
-        .atten = ADC_ATTEN_DB_12, // recommended val for esp32 0V-2.45V
-        .bitwidth = ADC_BITWIDTH_DEFAULT, //resolution 12 bits. higher resolution means a more precise measurement
-    };
+    //init runs again when a directive changes the sample size (continuous mode, or every wake on the linux
+    //target) and the drivers can't be created twice
+    ESP_ERROR_CHECK(adc_hal_deinit());
 
-    //selects pin36 (ADC_channel_0) to use for analog readings from the moisture sensor
-    ESP_ERROR_CHECK(adc_oneshot_config_channel(adc1_handle, ADC_CHANNEL_0, &CHAN_CONFIG));
+    //the oneshot and continuous drivers can't share ADC1 so only the selected one is set up
+    if (ADC_SAMPLE_MODE == ADC_SAMPLE_CONTINUOUS) {
+        _continuous_init(n);
+    } else {
+        _oneshot_init();
+    }
 
-    ESP_LOGI(_logger, "Initializing ADC Calibration");
     //the esp32 compares the input analog reading to a reference voltage. this reference voltage might be off so
     //we need to calibrate it to get a more accurate result
-    adc_cali_line_fitting_config_t CALI_CONFIG = {
-        .unit_id = ADC_UNIT_1,
-        .atten = ADC_ATTEN_DB_12,
-        .bitwidth = ADC_BITWIDTH_DEFAULT,
-    };
+    ESP_ERROR_CHECK(adc_hal_calibration_init());
+
+    EVENT_LOG_I(EVT_SENSOR_INIT, static_cast<int32_t>(_channel_count), n);
 
-    ESP_ERROR_CHECK(adc_cali_create_scheme_line_fitting(&CALI_CONFIG, &cali_handle));
+    _readings_buffer.resize(n * _channel_count);
+    _filter_scratch.resize(n);
+}
 
-    ESP_LOGI(_logger, "Succesfully initialized Moisture sensor");
+int moisture_sensor_max_samples(size_t channel_count) {
+    size_t channels = (channel_count > 0) ? channel_count : 1;
+    int max_n = INT32_MAX; //oneshot reads don't wait on a frame
+    if (ADC_SAMPLE_MODE == ADC_SAMPLE_CONTINUOUS) {
+        max_n = static_cast<int>(static_cast<uint64_t>(ADC_MAX_FRAME_MS) * ADC_SAMPLE_FREQ_HZ / 1000 / (ADC_OVERSAMPLE_FACTOR * channels));
+    }
+#if STATIC_ALLOCATION
+    int static_n = _static_max_samples(channels);
+    max_n = (static_n < max_n) ? static_n : max_n;
+#endif
+    return max_n;
+}
 
-    _readings_buffer.resize(n);
+void _oneshot_init() {
+    ESP_ERROR_CHECK(adc_hal_oneshot_init(_channels, _channel_count));
 }
 
-double get_moisture_val() {
-    ESP_LOGI(_logger, "Getting Moisture value");
+void _continuous_init(int n) {
+    //one frame holds every raw sample of every channel
+    size_t frame_samples = n * ADC_OVERSAMPLE_FACTOR * _channel_count;
+    _frame_buffer.resize(frame_samples);
+    _frame_filled = 0;
+    _read_timeout_ms = _frame_timeout_ms(frame_samples);
+
+    ESP_ERROR_CHECK(adc_hal_continuous_init(_channels, _channel_count, ADC_SAMPLE_FREQ_HZ, frame_samples));
+}
 
-    double res;
+void get_moisture_values(int32_t scale, int32_t* out) {
+    int64_t start = sleep_hal_time_us();
     _populate_buffer();
-    res = _get_mean();
+    _last_sample_time_us = sleep_hal_time_us() - start;
+
+    EVENT_LOG_I(EVT_SAMPLED, static_cast<int32_t>(_last_sample_time_us));
+
+    for (size_t i = 0; i < _channel_count; ++i) {
+        const int* samples = _readings_buffer.data() + i * _buffer_size;
+        size_t sample_count = _samples_in_channel(i);
+
+        //filtering nothing gives 0, which the calibration would turn into a soaked probe
+        if (sample_count == 0) {
+            out[i] = MOISTURE_NO_READING;
+            EVENT_LOG_W(EVT_CHANNEL_EMPTY, _channels[i]);
+            continue;
+        }
+
+        int32_t raw = filter_samples(MOISTURE_FILTER, samples, sample_count, _filter_scratch.data());
+        if (IIR_SMOOTHING_ENABLED) {
+            raw = filter_iir_smooth(i, raw);
+        }
+
+        //the line fitting calibration is linear so calibrating the filtered value once gives the same result
+        //as calibrating every sample. the probe's curve isn't, it's applied to the filtered voltage
+        int32_t mv = _calibrate_fixed(raw, scale);
+        out[i] = calibration_mv_to_percent(*CHANNEL_CALIBRATIONS[_channels[i]], mv, scale, CALIBRATION_REFERENCE_TEMP_C);
+        EVENT_LOG_D(EVT_CHANNEL_VALUE, _channels[i], out[i]);
+    }
+}
+
+uint32_t _frame_timeout_ms(size_t frame_samples) {
+    uint64_t duration_ms = (static_cast<uint64_t>(frame_samples) * 1000 + ADC_SAMPLE_FREQ_HZ - 1) / ADC_SAMPLE_FREQ_HZ;
+    return static_cast<uint32_t>(duration_ms) + ADC_READ_TIMEOUT_MARGIN;
+}
+
+int32_t _calibrate_fixed(int32_t raw, int32_t scale) {
+    //adc_cali_raw_to_voltage only takes whole ADC steps, the fraction is interpolated between the two steps around raw
+    int base = raw / FILTER_SCALE;
+    int32_t frac = raw % FILTER_SCALE;
+    int next = (base < ADC_RAW_MAX) ? base + 1 : base;
+
+    int v0;
+    int v1;
+    ESP_ERROR_CHECK(adc_hal_raw_to_mv(base, &v0));
+    ESP_ERROR_CHECK(adc_hal_raw_to_mv(next, &v1));
+
+    return v0 * scale + (v1 - v0) * scale * frac / FILTER_SCALE;
+}
 
-    ESP_LOGI(_logger, "Succesfully Obtained Moisture value of %d", res);
-    return res;
+int64_t get_last_sample_time_us() {
+    return _last_sample_time_us;
 }
 
 void _populate_buffer() {
-    std::vector<int>::iterator itr;
-    int raw_val;
-    int cali_val;
+    for (size_t i = 0; i < _channel_count; ++i) {
+        _samples_filled[i] = 0;
+    }
 
-    ESP_LOGI(_logger, "Performing %d samples. Populating moisture buffer", _readings_buffer.size());
+    if (ADC_SAMPLE_MODE == ADC_SAMPLE_CONTINUOUS) {
+        _populate_buffer_continuous();
+    } else {
+        _populate_buffer_oneshot();
+    }
+}
 
-    for (itr = _readings_buffer.begin(); itr != _readings_buffer.end(); ++itr){
+void _populate_buffer_oneshot() {
+    int raw_val;
 
-        ESP_ERROR_CHECK(adc_oneshot_read(adc1_handle, ADC_CHANNEL_0, &raw_val));
-        ESP_ERROR_CHECK(adc_cali_raw_to_voltage(cali_handle, raw_val, &cali_val));
+    //the channels are read in turn so every plant is sampled over the same stretch of time
+    for (int s = 0; s < _buffer_size; ++s) {
+        for (size_t i = 0; i < _channel_count; ++i) {
+            ESP_ERROR_CHECK(adc_hal_oneshot_read(_channels[i], &raw_val));
 
-        *itr = cali_val;
+            _readings_buffer[i * _buffer_size + s] = raw_val;
+            _samples_filled[i] += 1;
+        }
     }
 }
 
-double _get_mean() {
-    double sum = 0;
-    int len = 0;
-    std::vector<int>::iterator itr;
+void _populate_buffer_continuous() {
+    size_t filled = 0;
 
-    ESP_LOGI(_logger, "Getting Average of Sampled Readings");
+    esp_err_t res = adc_hal_continuous_capture(_frame_buffer.data(), _frame_buffer.size(), &filled, _read_timeout_ms);
+    _frame_filled = filled;
+    if (res == ESP_ERR_TIMEOUT) {
+        ESP_LOGW(_logger, "WARNING! Timed out waiting for ADC frame, got %u of %u samples",
+            static_cast<unsigned>(filled), static_cast<unsigned>(_frame_buffer.size()));
+    } else {
+        ESP_ERROR_CHECK(res);
+    }
 
-    for (itr = _readings_buffer.begin(); itr != _readings_buffer.end(); ++itr){
-        sum += *itr;
-        len += 1;
+    //maps an ADC channel number back to its slot in _channels
+    int slot_of_channel[MOISTURE_SENSOR_MAX_CHANNELS];
+    for (int c = 0; c < MOISTURE_SENSOR_MAX_CHANNELS; ++c) {
+        slot_of_channel[c] = -1;
     }
+    for (size_t i = 0; i < _channel_count; ++i) {
+        slot_of_channel[_channels[i]] = i;
+    }
+
+    //averages every ADC_OVERSAMPLE_FACTOR samples of a channel into one buffer entry
+    int sums[MOISTURE_SENSOR_MAX_CHANNELS] = {0};
+    int group_lens[MOISTURE_SENSOR_MAX_CHANNELS] = {0};
+    for (size_t b = 0; b < filled; ++b) {
+        uint32_t channel = _frame_buffer[b].channel;
+        if (channel >= MOISTURE_SENSOR_MAX_CHANNELS || slot_of_channel[channel] < 0) {
+            continue;
+        }
+
+        int i = slot_of_channel[channel];
+        if (_samples_filled[i] >= _buffer_size) {
+            continue;
+        }
 
-    if (len == 0)
-        ESP_LOGW(_logger, "WARNING! called _get_mean on an empty buffer!");
+        sums[i] += _frame_buffer[b].raw;
+        group_lens[i] += 1;
+        if (group_lens[i] == ADC_OVERSAMPLE_FACTOR) {
+            _readings_buffer[i * _buffer_size + _samples_filled[i]] = sums[i] / group_lens[i];
+            _samples_filled[i] += 1;
+            sums[i] = 0;
+            group_lens[i] = 0;
+        }
+    }
 
-    return sum / len;
+    for (size_t i = 0; i < _channel_count; ++i) {
+        if (_samples_filled[i] < _buffer_size) {
+            //short frame, only the entries that were filled are used
+            ESP_LOGW(_logger, "WARNING! ADC frame only filled %d of %d samples on channel %d",
+                _samples_filled[i], _buffer_size, static_cast<int>(_channels[i]));
+        }
+    }
 }
 
+size_t _samples_in_channel(size_t i) {
+    return _samples_filled[i];
+}
 
+size_t moisture_sensor_channel_count() {
+    return _channel_count;
+}
+
+uint8_t moisture_sensor_channel(size_t slot) {
+    return _channels[slot];
+}
+
+const int* moisture_sensor_samples(size_t slot, size_t* count) {
+    *count = _samples_in_channel(slot);
+    return _readings_buffer.data() + slot * _buffer_size;
+}
+
+const adc_hal_sample_t* moisture_sensor_frame(size_t* count) {
+    if (ADC_SAMPLE_MODE != ADC_SAMPLE_CONTINUOUS) {
+        *count = 0;
+        return NULL;
+    }
+    *count = _frame_filled;
+    return _frame_buffer.data();
+}
+
+#if STATIC_ALLOCATION
+int _static_max_samples(size_t channels) {
+    //fewer channels leave room for more samples of each
+    size_t max_n = MOISTURE_SENSOR_STATIC_SAMPLES / channels;
+    if (ADC_SAMPLE_MODE == ADC_SAMPLE_CONTINUOUS) {
+        size_t frame_n = ADC_HAL_STATIC_FRAME_SAMPLES / (ADC_OVERSAMPLE_FACTOR * channels);
+        max_n = (frame_n < max_n) ? frame_n : max_n;
+    }
+    return static_cast<int>(max_n);
+}
+#endif
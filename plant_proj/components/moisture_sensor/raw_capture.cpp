@@ -0,0 +1,137 @@
+#include <esp_attr.h>
+#include "moisture_sensor.hpp"
+#include "event_log.hpp"
+#include "raw_capture.hpp"
+
+#if RAW_CAPTURE_ENABLED
+
+const raw_capture_mode_t RAW_CAPTURE_MODE = RAW_CAPTURE_SAMPLES;
+
+static const size_t CHANNEL_HEADER_LEN = 3; //plant_id and count
+
+//survives deep sleep so the capture of a wake that didn't upload goes out with the next upload
+RTC_DATA_ATTR static raw_capture_t _capture;
+
+//previous sample and count of the channel being written
+static int32_t _prev = 0;
+static uint16_t _count = 0;
+
+void raw_capture_take() {
+    _raw_capture_take(RAW_CAPTURE_MODE);
+}
+
+void _raw_capture_take(raw_capture_mode_t mode) {
+    _capture.mode = RAW_CAPTURE_NONE;
+    _capture.len = 0;
+
+    size_t channels = moisture_sensor_channel_count();
+    if (channels == 0) {
+        return;
+    }
+
+    //oneshot mode has no frame, the samples are the conversions
+    size_t frame_len = 0;
+    bool full_rate = (mode == RAW_CAPTURE_FULL_RATE && moisture_sensor_frame(&frame_len) != NULL);
+
+    size_t share = RAW_CAPTURE_LEN / channels;
+    for (size_t slot = 0; slot < channels; ++slot) {
+        size_t end = (slot + 1 == channels) ? RAW_CAPTURE_LEN : (slot + 1) * share;
+        if (full_rate) {
+            _raw_capture_frame_channel(static_cast<uint8_t>(slot), moisture_sensor_channel(slot), end);
+        } else {
+            size_t count = 0;
+            const int* samples = moisture_sensor_samples(slot, &count);
+            _raw_capture_channel(static_cast<uint8_t>(slot), samples, count, end);
+        }
+    }
+
+    _capture.mode = full_rate ? RAW_CAPTURE_FULL_RATE : RAW_CAPTURE_SAMPLES;
+    EVENT_LOG_D(EVT_RAW_CAPTURE, _capture.mode, _capture.len);
+}
+
+const raw_capture_t* raw_capture_get() {
+    return (_capture.mode != RAW_CAPTURE_NONE) ? &_capture : NULL;
+}
+
+void raw_capture_clear() {
+    _capture.mode = RAW_CAPTURE_NONE;
+    _capture.len = 0;
+}
+
+//writes the channel's header, the count is patched in by _end_channel. returns the offset of the header
+static size_t _begin_channel(uint8_t plant_id, size_t end) {
+    size_t start = _capture.len;
+    if (start + CHANNEL_HEADER_LEN > end) {
+        return SIZE_MAX;
+    }
+
+    _capture.data[start] = plant_id;
+    _capture.len += CHANNEL_HEADER_LEN;
+    _prev = 0;
+    _count = 0;
+    return start;
+}
+
+static void _end_channel(size_t start) {
+    _capture.data[start + 1] = static_cast<uint8_t>(_count);
+    _capture.data[start + 2] = static_cast<uint8_t>(_count >> 8);
+}
+
+static bool _put_sample(int32_t sample, size_t end) {
+    if (_count == UINT16_MAX || !_raw_capture_put(sample - _prev, end)) {
+        return false;
+    }
+    _prev = sample;
+    _count += 1;
+    return true;
+}
+
+void _raw_capture_channel(uint8_t plant_id, const int* samples, size_t count, size_t end) {
+    size_t start = _begin_channel(plant_id, end);
+    if (start == SIZE_MAX) {
+        return;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if (!_put_sample(samples[i], end)) {
+            break;
+        }
+    }
+    _end_channel(start);
+}
+
+void _raw_capture_frame_channel(uint8_t plant_id, uint8_t channel, size_t end) {
+    size_t start = _begin_channel(plant_id, end);
+    if (start == SIZE_MAX) {
+        return;
+    }
+
+    size_t frame_len = 0;
+    const adc_hal_sample_t* frame = moisture_sensor_frame(&frame_len);
+    for (size_t i = 0; i < frame_len; ++i) {
+        if (frame[i].channel == channel && !_put_sample(frame[i].raw, end)) {
+            break;
+        }
+    }
+    _end_channel(start);
+}
+
+bool _raw_capture_put(int32_t delta, size_t end) {
+    //zig-zag keeps small negative deltas small: 0, -1, 1, -2, 2 become 0, 1, 2, 3, 4
+    uint32_t value = (static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31);
+
+    size_t len = _capture.len;
+    do {
+        if (len >= end) {
+            return false;
+        }
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        _capture.data[len++] = (value != 0) ? (byte | 0x80) : byte;
+    } while (value != 0);
+
+    _capture.len = static_cast<uint16_t>(len);
+    return true;
+}
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef NODE_TIME_HPP
+#define NODE_TIME_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_err.h>
+
+/**
+ * Wall clock time of the node, so readings are stamped when they're sampled instead of when the backend
+ * receives them. the system clock keeps running through deep sleep on the rtc slow clock, which drifts, so
+ * it's synced over sntp now and then and the drift measured between two syncs is corrected for in between.
+ * every timestamp comes with a bound on its error, which grows with the time since the last sync
+ *
+ * syncs only happen on wakes that bring the radio up for an upload anyway (see node_time_sync_due), so
+ * keeping time doesn't cost extra radio time. the sync state is kept in rtc memory
+ */
+
+extern const char* TIME_SNTP_SERVER;
+extern const uint32_t TIME_SYNC_EVERY_WAKES; //wakes between syncs even if the error bound is still small
+extern const uint32_t TIME_MAX_ERROR_MS; //a sync is due once the error bound grows past this
+extern const uint32_t TIME_SYNC_TIMEOUT_MS; //max time spent waiting for the sntp server
+extern const uint32_t TIME_STATE_MAGIC;
+
+typedef struct {
+    uint32_t epoch_s; //unix time, 0 if the node never synced since power on
+    uint16_t error_s; //bound on the error of epoch_s, saturates at UINT16_MAX
+} node_timestamp_t;
+
+typedef struct {
+    uint32_t magic; //TIME_STATE_MAGIC once the clock was synced since power on
+    int64_t last_sync_us; //system clock right after the last sync
+    int64_t drift_ppb; //how fast the system clock runs ahead of true time, in parts per billion
+    bool drift_known; //false until two syncs far enough apart measured the drift
+    uint32_t wakes_since_sync;
+} time_state_t;
+
+/**
+ * Counts the wake towards TIME_SYNC_EVERY_WAKES. called once at the start of every wake
+ */
+void node_time_begin_wake();
+
+/**
+ * @return returns the current time corrected for the measured drift, with its error bound
+ */
+node_timestamp_t node_time_now();
+
+/**
+ * @return returns true if the node never synced, the error bound is above TIME_MAX_ERROR_MS or
+ * TIME_SYNC_EVERY_WAKES wakes passed since the last sync
+ */
+bool node_time_sync_due();
+
+/**
+ * Syncs the system clock over sntp and updates the drift estimate. the network has to be up
+ * @return returns ESP_OK, or ESP_ERR_TIMEOUT if the server didn't answer within TIME_SYNC_TIMEOUT_MS
+ */
+esp_err_t node_time_sync();
+
+/**
+ * Runs one sntp exchange and sets the system clock. implemented per target (sntp_client.cpp on the esp32,
+ * linux/sntp_client_host.cpp on the host)
+ * @param step_us set to how far the system clock was moved, true time minus the clock's time before the sync
+ * @return returns ESP_OK or ESP_ERR_TIMEOUT
+ */
+esp_err_t _sntp_exchange(int64_t* step_us);
+
+/**
+ * @return returns the system clock in microseconds since the unix epoch
+ */
+int64_t _system_time_us();
+
+/**
+ * The clock math behind node_time_now, node_time_sync_due and node_time_sync. it takes the state and the system
+ * clock as arguments so it can be run against a simulated clock
+ * @param state sync state
+ * @param now_us system clock
+ */
+node_timestamp_t _timestamp_at(const time_state_t& state, int64_t now_us);
+bool _sync_due(const time_state_t& state, int64_t now_us);
+
+/**
+ * Updates the drift estimate and restarts the error bound after a sync
+ * @param state sync state
+ * @param now_us system clock right after the sync
+ * @param step_us how far the sync moved the clock, see _sntp_exchange
+ */
+void _record_sync(time_state_t& state, int64_t now_us, int64_t step_us);
+
+/**
+ * @param state sync state
+ * @param now_us system clock
+ * @return returns the system clock corrected for the measured drift, in microseconds
+ */
+int64_t _corrected_time_us(const time_state_t& state, int64_t now_us);
+
+/**
+ * @param state sync state
+ * @param now_us system clock
+ * @return returns the bound on the error of the corrected time, in microseconds
+ */
+int64_t _error_bound_us(const time_state_t& state, int64_t now_us);
+
+#endif
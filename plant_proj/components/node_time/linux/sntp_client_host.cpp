@@ -0,0 +1,11 @@
+#include "node_time.hpp"
+
+/**
+ * The host's clock is already kept in sync by its operating system, so the exchange is a no op and the
+ * clock never has to be moved
+ */
+
+esp_err_t _sntp_exchange(int64_t* step_us) {
+    *step_us = 0;
+    return ESP_OK;
+}
@@ -0,0 +1,117 @@
+#include <esp_log.h>
+#include <esp_attr.h>
+#include <sys/time.h>
+#include "node_time.hpp"
+#include "event_log.hpp"
+
+const char* TIME_SNTP_SERVER = "pool.ntp.org";
+const uint32_t TIME_SYNC_EVERY_WAKES = 192; //2 days at the longest adaptive sleep (15 min)
+const uint32_t TIME_MAX_ERROR_MS = 2000;
+const uint32_t TIME_SYNC_TIMEOUT_MS = 3000;
+const uint32_t TIME_STATE_MAGIC = 0x4E54494D; //"NTIM"
+
+static const char* _logger = "Node Time *** ";
+static const int64_t SYNC_ERROR_US = 100000; //error of an sntp sync over wifi, a generous bound on half the round trip
+static const int64_t DRIFT_UNKNOWN_PPM = 2000; //drift assumed for the rtc slow clock until it was measured
+static const int64_t DRIFT_RESIDUAL_PPM = 100; //drift left over after the correction, temperature moves it around
+static const int64_t DRIFT_MIN_INTERVAL_US = 600000000; //shorter intervals are dominated by the sync error, 10 min
+static const int DRIFT_SHIFT = 2; //smoothing factor of the drift estimate is 1 / 2^DRIFT_SHIFT
+
+//kept in rtc memory, the system clock itself also keeps running through deep sleep
+RTC_DATA_ATTR static time_state_t _state;
+
+void node_time_begin_wake() {
+    if (_state.magic == TIME_STATE_MAGIC) {
+        _state.wakes_since_sync += 1;
+    }
+}
+
+node_timestamp_t node_time_now() {
+    return _timestamp_at(_state, _system_time_us());
+}
+
+bool node_time_sync_due() {
+    return _sync_due(_state, _system_time_us());
+}
+
+esp_err_t node_time_sync() {
+    int64_t step_us = 0;
+    esp_err_t res = _sntp_exchange(&step_us);
+    if (res != ESP_OK) {
+        EVENT_LOG_W(EVT_TIME_SYNC_FAILED);
+        ESP_LOGW(_logger, "WARNING! Unable to sync the clock with %s, keeping the drift corrected time", TIME_SNTP_SERVER);
+        return res;
+    }
+
+    _record_sync(_state, _system_time_us(), step_us);
+
+    EVENT_LOG_I(EVT_TIME_SYNCED, static_cast<int32_t>(step_us / 1000), static_cast<int32_t>(_state.drift_ppb / 1000));
+    return ESP_OK;
+}
+
+int64_t _system_time_us() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return static_cast<int64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
+}
+
+node_timestamp_t _timestamp_at(const time_state_t& state, int64_t now_us) {
+    node_timestamp_t stamp = {
+        .epoch_s = 0,
+        .error_s = UINT16_MAX,
+    };
+    if (state.magic != TIME_STATE_MAGIC) {
+        return stamp;
+    }
+
+    //rounding to the nearest second adds half a second to the error
+    int64_t error_s = (_error_bound_us(state, now_us) + 500000 + 999999) / 1000000;
+
+    stamp.epoch_s = static_cast<uint32_t>((_corrected_time_us(state, now_us) + 500000) / 1000000);
+    stamp.error_s = static_cast<uint16_t>(error_s < UINT16_MAX ? error_s : UINT16_MAX);
+    return stamp;
+}
+
+bool _sync_due(const time_state_t& state, int64_t now_us) {
+    if (state.magic != TIME_STATE_MAGIC || state.wakes_since_sync >= TIME_SYNC_EVERY_WAKES) {
+        return true;
+    }
+    return _error_bound_us(state, now_us) > static_cast<int64_t>(TIME_MAX_ERROR_MS) * 1000;
+}
+
+void _record_sync(time_state_t& state, int64_t now_us, int64_t step_us) {
+    if (state.magic == TIME_STATE_MAGIC) {
+        //the clock ran ahead by -step over the time since the last sync. the sync error is only small next
+        //to the step over long intervals
+        int64_t interval_us = now_us - step_us - state.last_sync_us;
+        if (interval_us >= DRIFT_MIN_INTERVAL_US) {
+            int64_t drift_ppb = -step_us * 1000 / (interval_us / 1000000);
+            if (state.drift_known) {
+                state.drift_ppb += (drift_ppb - state.drift_ppb) / (1 << DRIFT_SHIFT);
+            } else {
+                state.drift_ppb = drift_ppb;
+                state.drift_known = true;
+            }
+        }
+    }
+
+    state.magic = TIME_STATE_MAGIC;
+    state.last_sync_us = now_us;
+    state.wakes_since_sync = 0;
+}
+
+int64_t _corrected_time_us(const time_state_t& state, int64_t now_us) {
+    //the clock gained drift_ppb for every unit of time since the sync
+    int64_t elapsed_us = now_us - state.last_sync_us;
+    return now_us - elapsed_us / 1000 * state.drift_ppb / 1000000;
+}
+
+int64_t _error_bound_us(const time_state_t& state, int64_t now_us) {
+    int64_t elapsed_us = now_us - state.last_sync_us;
+    if (elapsed_us < 0) {
+        elapsed_us = -elapsed_us;
+    }
+
+    int64_t drift_ppm = state.drift_known ? DRIFT_RESIDUAL_PPM : DRIFT_UNKNOWN_PPM;
+    return SYNC_ERROR_US + elapsed_us / 1000000 * drift_ppm;
+}
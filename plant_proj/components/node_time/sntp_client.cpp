@@ -0,0 +1,48 @@
+#include <esp_log.h>
+#include <esp_netif_sntp.h>
+#include <sys/time.h>
+#include "sleep_hal.hpp"
+#include "node_time.hpp"
+
+static const char* _logger = "SNTP Client *** ";
+
+//where the clock was before the exchange, so the callback can tell how far it moved it
+static int64_t _before_system_us = 0;
+static int64_t _before_uptime_us = 0;
+static int64_t _step_us = 0;
+
+//called by the sntp client right after it set the system clock
+static void _on_time_sync(struct timeval* tv) {
+    int64_t synced_us = static_cast<int64_t>(tv->tv_sec) * 1000000 + tv->tv_usec;
+
+    //the high resolution timer runs off the crystal while awake so it measures the exchange itself exactly
+    int64_t local_us = _before_system_us + (sleep_hal_time_us() - _before_uptime_us);
+    _step_us = synced_us - local_us;
+}
+
+esp_err_t _sntp_exchange(int64_t* step_us) {
+    esp_sntp_config_t config = ESP_NETIF_SNTP_DEFAULT_CONFIG(TIME_SNTP_SERVER);
+    config.sync_cb = _on_time_sync;
+
+    _before_system_us = _system_time_us();
+    _before_uptime_us = sleep_hal_time_us();
+    _step_us = 0;
+
+    esp_err_t res = esp_netif_sntp_init(&config);
+    if (res != ESP_OK) {
+        ESP_LOGE(_logger, "ERROR! Unable to start the sntp client. Error Code=%s", esp_err_to_name(res));
+        return res;
+    }
+
+    res = esp_netif_sntp_sync_wait(pdMS_TO_TICKS(TIME_SYNC_TIMEOUT_MS));
+
+    //only one exchange per sync, the client isn't left polling in the background
+    esp_netif_sntp_deinit();
+
+    if (res != ESP_OK) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    *step_us = _step_us;
+    return ESP_OK;
+}
@@ -0,0 +1,165 @@
+#include <string.h>
+#include "binary_encoder.hpp"
+
+const char* const BINARY_CONTENT_TYPE = "application/x-leaf-readings";
+
+static const size_t BINARY_COUNT_OFFSET = 14; //count is the last byte of the header, patched once the records are written
+
+size_t encode_readings_binary(
+    uint8_t* buf, size_t cap,
+    uint32_t node_id, size_t plant_count,
+    const reading_record_t* records, size_t count,
+    const wake_phase_stats_t* timing,
+    const mem_stats_t* mem,
+    const raw_capture_t* raw
+) {
+    binary_writer_t w = {
+        .buf = buf,
+        .cap = cap,
+        .len = 0,
+        .overflow = (buf == NULL || cap == 0),
+    };
+
+    uint8_t flags = 0;
+#if WAKE_TIMING_ENABLED
+    if (timing != NULL) {
+        flags |= BINARY_FLAG_TIMING;
+    }
+#endif
+    if (mem != NULL) {
+        flags |= BINARY_FLAG_MEMORY;
+    }
+    if (raw != NULL) {
+        flags |= BINARY_FLAG_RAW;
+    }
+
+    uint32_t base_wake = (count > 0) ? records[0].wake_id : 0;
+    uint32_t base_time = 0;
+    for (size_t i = 0; i < count && base_time == 0; ++i) {
+        base_time = records[i].timestamp;
+    }
+
+    _binary_write_u8(w, BINARY_FORMAT_VERSION);
+    _binary_write_u8(w, flags);
+    _binary_write_u32(w, node_id);
+    _binary_write_u32(w, base_wake);
+    _binary_write_u32(w, base_time);
+    _binary_write_u8(w, 0);
+
+    size_t written = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (records[i].plant_id >= plant_count) {
+            continue;
+        }
+
+        //records are oldest first so the delta can't be negative. a batch spanning too many wakes is
+        //rejected and the caller splits it
+        uint32_t delta = records[i].wake_id - base_wake;
+        if (delta > UINT16_MAX || written == BINARY_MAX_RECORDS) {
+            return 0;
+        }
+
+        //the clock can be moved back by a sync so a timestamp before base_time is rejected like a long span
+        uint32_t time_delta = BINARY_NO_TIME;
+        if (records[i].timestamp != 0) {
+            if (records[i].timestamp < base_time || records[i].timestamp - base_time >= BINARY_NO_TIME) {
+                return 0;
+            }
+            time_delta = records[i].timestamp - base_time;
+        }
+
+        _binary_write_u8(w, records[i].plant_id);
+        _binary_write_u16(w, static_cast<uint16_t>(delta));
+        _binary_write_u32(w, static_cast<uint32_t>(records[i].moisture));
+        _binary_write_u16(w, static_cast<uint16_t>(time_delta));
+        _binary_write_u8(w, static_cast<uint8_t>(records[i].time_error_s < UINT8_MAX ? records[i].time_error_s : UINT8_MAX));
+        written += 1;
+    }
+
+#if WAKE_TIMING_ENABLED
+    if (timing != NULL) {
+        uint8_t mask = 0;
+        for (size_t i = 0; i < WAKE_PHASE_COUNT; ++i) {
+            if (timing[i].count != 0) {
+                mask |= static_cast<uint8_t>(1 << i);
+            }
+        }
+        _binary_write_u8(w, mask);
+
+        for (size_t i = 0; i < WAKE_PHASE_COUNT; ++i) {
+            const wake_phase_stats_t& stats = timing[i];
+            if (stats.count == 0) {
+                continue;
+            }
+
+            _binary_write_u32(w, stats.count);
+            _binary_write_u32(w, stats.min_us);
+            _binary_write_u32(w, static_cast<uint32_t>(stats.total_us / stats.count));
+            _binary_write_u32(w, stats.max_us);
+            for (size_t b = 0; b < WAKE_TIMING_BUCKETS; ++b) {
+                _binary_write_u16(w, stats.histogram[b]);
+            }
+        }
+    }
+#endif
+    if (mem != NULL) {
+        _binary_write_mem(w, mem);
+    }
+    if (raw != NULL) {
+        _binary_write_u8(w, raw->mode);
+        _binary_write_u16(w, raw->len);
+        for (size_t i = 0; i < raw->len; ++i) {
+            _binary_write_u8(w, raw->data[i]);
+        }
+    }
+
+    if (w.overflow) {
+        return 0;
+    }
+
+    buf[BINARY_COUNT_OFFSET] = static_cast<uint8_t>(written);
+    return w.len;
+}
+
+void _binary_write_u8(binary_writer_t& w, uint8_t value) {
+    if (w.overflow || w.len + 1 > w.cap) {
+        w.overflow = true;
+        return;
+    }
+
+    w.buf[w.len++] = value;
+}
+
+void _binary_write_u16(binary_writer_t& w, uint16_t value) {
+    _binary_write_u8(w, static_cast<uint8_t>(value));
+    _binary_write_u8(w, static_cast<uint8_t>(value >> 8));
+}
+
+void _binary_write_u32(binary_writer_t& w, uint32_t value) {
+    _binary_write_u16(w, static_cast<uint16_t>(value));
+    _binary_write_u16(w, static_cast<uint16_t>(value >> 16));
+}
+
+void _binary_write_mem(binary_writer_t& w, const mem_stats_t* mem) {
+    _binary_write_u32(w, mem->heap_free);
+    _binary_write_u32(w, mem->heap_min_free);
+    _binary_write_u32(w, mem->heap_largest_block);
+
+    uint8_t mask = 0;
+    for (size_t i = 0; i < MEM_TASK_COUNT; ++i) {
+        if (mem->tasks[i].stack_size != 0) {
+            mask |= static_cast<uint8_t>(1 << i);
+        }
+    }
+    _binary_write_u8(w, mask);
+
+    for (size_t i = 0; i < MEM_TASK_COUNT; ++i) {
+        const mem_task_stats_t& task = mem->tasks[i];
+        if (task.stack_size == 0) {
+            continue;
+        }
+
+        _binary_write_u16(w, static_cast<uint16_t>(task.stack_size < UINT16_MAX ? task.stack_size : UINT16_MAX));
+        _binary_write_u16(w, static_cast<uint16_t>(task.stack_min_free < UINT16_MAX ? task.stack_min_free : UINT16_MAX));
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef BINARY_ENCODER_HPP
+#define BINARY_ENCODER_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include "reading_buffer.hpp"
+#include "wake_timing.hpp"
+#include "mem_stats.hpp"
+#include "raw_capture.hpp"
+
+/**
+ * Packed binary alternative to the json payload. plants are sent as the node's id plus their index in
+ * leaf_info.plants instead of their name, and moisture stays in its fixed point form. every field is
+ * little endian. tools/wire_format.py is the reference decoder
+ *
+ * header (15 bytes)
+ *   u8  version       BINARY_FORMAT_VERSION
+ *   u8  flags         BINARY_FLAG_TIMING, BINARY_FLAG_MEMORY and BINARY_FLAG_RAW for the trailers that follow the records
+ *   u32 node_id
+ *   u32 base_wake     wake id of the first record
+ *   u32 base_time     timestamp of the first record that has one, 0 if none has
+ *   u8  count         number of records
+ * record (10 bytes each)
+ *   u8  plant_id
+ *   u16 wake_delta    wake id - base_wake
+ *   i32 moisture      scaled by MOISTURE_SCALE
+ *   u16 time_delta    timestamp - base_time in seconds, BINARY_NO_TIME if the reading has no timestamp
+ *   u8  time_error    error bound of the timestamp in seconds, saturates at 255
+ * timing trailer (optional)
+ *   u8  phase_mask    bit i set if wake_phase_t i follows
+ *   per phase in the mask: u32 count, u32 min_us, u32 mean_us, u32 max_us, u16 histogram[WAKE_TIMING_BUCKETS]
+ * memory trailer (optional, after the timing trailer)
+ *   u32 heap_free, u32 heap_min_free, u32 heap_largest_block
+ *   u8  task_mask     bit i set if mem_task_t i follows
+ *   per task in the mask: u16 stack_size, u16 stack_min_free   bytes, saturate at UINT16_MAX
+ * raw capture trailer (optional, last)
+ *   u8  mode          raw_capture_mode_t
+ *   u16 len
+ *   u8  data[len]     compressed samples, see raw_capture.hpp
+ *
+ * sizes for one plant (4 character name): 1 reading is 25 bytes vs 89 bytes of batch json, 8 readings are 95 bytes vs 614
+ */
+
+#define BINARY_FORMAT_VERSION 2 //version 1 had no timestamps
+#define BINARY_NO_TIME 0xFFFF
+#define BINARY_FLAG_TIMING 0x01
+#define BINARY_FLAG_MEMORY 0x02
+#define BINARY_FLAG_RAW 0x04
+#define BINARY_MAX_RECORDS 255 //count is a single byte
+
+extern const char* const BINARY_CONTENT_TYPE; //the backend picks the decoder from the request's content type
+
+typedef struct {
+    uint8_t* buf; //buffer owned by the caller
+    size_t cap; //size of buf
+    size_t len; //number of bytes written so far
+    bool overflow; //set once a write didn't fit. everything written after that is dropped
+} binary_writer_t;
+
+/**
+ * Encodes a batch of readings
+ * @param buf buffer the payload is written into
+ * @param cap size of buf
+ * @param node_id id of this node
+ * @param plant_count number of plants on the node. readings with an unknown plant_id are skipped
+ * @param records array of readings, oldest first
+ * @param count number of readings in records
+ * @param timing per phase wake timing summary indexed by wake_phase_t, or NULL to leave it out
+ * @param mem heap and stack headroom, or NULL to leave it out
+ * @param raw compressed samples of a diagnostic capture, or NULL to leave them out
+ * @return returns the length of the payload, or 0 if it didn't fit in the buffer, there are more than
+ * BINARY_MAX_RECORDS readings or the readings span more than UINT16_MAX wakes or BINARY_NO_TIME - 1 seconds
+ */
+size_t encode_readings_binary(
+    uint8_t* buf, size_t cap,
+    uint32_t node_id, size_t plant_count,
+    const reading_record_t* records, size_t count,
+    const wake_phase_stats_t* timing,
+    const mem_stats_t* mem,
+    const raw_capture_t* raw
+);
+
+/**
+ * Appends little endian integers to the payload
+ * @param w writer
+ * @param value the integer
+ */
+void _binary_write_u8(binary_writer_t& w, uint8_t value);
+void _binary_write_u16(binary_writer_t& w, uint16_t value);
+void _binary_write_u32(binary_writer_t& w, uint32_t value);
+
+/**
+ * Appends the memory trailer
+ * @param w writer
+ * @param mem heap and stack headroom
+ */
+void _binary_write_mem(binary_writer_t& w, const mem_stats_t* mem);
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef JSON_ENCODER_HPP
+#define JSON_ENCODER_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "reading_buffer.hpp"
+#include "wake_timing.hpp"
+#include "mem_stats.hpp"
+#include "raw_capture.hpp"
+
+/**
+ * Heap free json encoder. payloads are written straight into a buffer owned by the caller, field names and
+ * the layout of the payload are string literals whose lengths are known at compile time, and numbers are
+ * formatted by hand instead of going through printf/std::to_string
+ *
+ * batch:           {"readings":[{"plant name":"<name>","wake":<id>,"moisture":<val>,"ts":<unix time>,"ts_err":<s>},...]}
+ *                  ts and ts_err are left out of readings sampled before the node had the time
+ * batch + timing:  {"readings":[...],"timing":{"<phase>":[count,min,mean,max,<histogram buckets>],...}}
+ *                  durations are in microseconds, see wake_timing.hpp for the phases and buckets
+ * batch + memory:  {"readings":[...],"mem":{"heap":[free,min free,largest block],"<task>":[stack size,min free],...}}
+ *                  in bytes, after the timing if both are sent. see mem_stats.hpp for the tasks
+ * batch + raw:     {"readings":[...],"raw":{"mode":<raw_capture_mode_t>,"data":"<base64>"}}
+ *                  last of the summaries, data is laid out as in raw_capture.hpp
+ */
+
+typedef struct {
+    char* buf; //buffer owned by the caller
+    size_t cap; //size of buf
+    size_t len; //number of bytes written so far
+    bool overflow; //set once a write didn't fit. everything written after that is dropped
+} json_writer_t;
+
+/**
+ * Creates a writer over a caller provided buffer
+ * @param buf buffer the payload is written into
+ * @param cap size of buf
+ */
+json_writer_t json_writer_init(char* buf, size_t cap);
+
+/**
+ * Appends raw bytes to the payload
+ * @param w writer
+ * @param data bytes to append
+ * @param n number of bytes
+ */
+void json_write_raw(json_writer_t& w, const char* data, size_t n);
+
+/**
+ * Appends a string literal. the length comes from the literal's type so no strlen is done at runtime
+ * @param w writer
+ * @param literal string literal (ie "{\"wake\":")
+ */
+template <size_t N>
+inline void json_write_literal(json_writer_t& w, const char (&literal)[N]) {
+    json_write_raw(w, literal, N - 1); //N counts the null terminator
+}
+
+/**
+ * Appends a string with json escaping. the surrounding quotes are not written
+ * @param w writer
+ * @param str null terminated string
+ * @param max_len max number of characters read from str
+ */
+void json_write_escaped(json_writer_t& w, const char* str, size_t max_len);
+
+/**
+ * Appends an unsigned integer
+ * @param w writer
+ * @param value the integer
+ */
+void json_write_uint(json_writer_t& w, uint32_t value);
+
+/**
+ * Appends a fixed point number as a decimal (ie 123456 with a scale of 100 is written as 1234.56)
+ * @param w writer
+ * @param value fixed point value
+ * @param scale power of 10 the value was multiplied by
+ */
+void json_write_fixed_point(json_writer_t& w, int32_t value, int32_t scale);
+
+/**
+ * Appends bytes as standard base64, with padding
+ * @param w writer
+ * @param data bytes to encode
+ * @param n number of bytes
+ */
+void json_write_base64(json_writer_t& w, const uint8_t* data, size_t n);
+
+/**
+ * Null terminates the payload
+ * @param w writer
+ * @return returns the length of the payload, or 0 if it didn't fit in the buffer
+ */
+size_t json_writer_finish(json_writer_t& w);
+
+/**
+ * Encodes a batch of readings. readings can belong to different plants, each one is tagged with
+ * the name of its plant
+ * @param buf buffer the payload is written into
+ * @param cap size of buf
+ * @param plant_names name of each plant, indexed by the readings' plant_id
+ * @param plant_count number of names in plant_names. readings with an unknown plant_id are skipped
+ * @param name_len max length of a plant name
+ * @param records array of readings
+ * @param count number of readings in records
+ * @param timing per phase wake timing summary indexed by wake_phase_t, or NULL to leave it out
+ * @param mem heap and stack headroom, or NULL to leave it out
+ * @param raw compressed samples of a diagnostic capture, or NULL to leave them out
+ * @return returns the length of the payload, or 0 if it didn't fit in the buffer
+ */
+size_t encode_readings_json(
+    char* buf, size_t cap,
+    const char* const* plant_names, size_t plant_count, size_t name_len,
+    const reading_record_t* records, size_t count,
+    const wake_phase_stats_t* timing,
+    const mem_stats_t* mem,
+    const raw_capture_t* raw
+);
+
+#if WAKE_TIMING_ENABLED
+/**
+ * Appends the timing summary object. phases no wake reached are left out
+ * @param w writer
+ * @param timing totals indexed by wake_phase_t
+ */
+void _json_write_timing(json_writer_t& w, const wake_phase_stats_t* timing);
+#endif
+
+/**
+ * Appends the memory object. tasks that never recorded their stack are left out
+ * @param w writer
+ * @param mem heap and stack headroom
+ */
+void _json_write_mem(json_writer_t& w, const mem_stats_t* mem);
+
+/**
+ * Appends the raw capture object
+ * @param w writer
+ * @param raw compressed samples
+ */
+void _json_write_raw(json_writer_t& w, const raw_capture_t* raw);
+
+#endif
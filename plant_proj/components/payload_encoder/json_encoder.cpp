@@ -0,0 +1,264 @@
+#include "json_encoder.hpp"
+
+//every piece of the payload's layout. the compiler knows their lengths so they're copied with a single memcpy
+static const char JSON_READINGS_OPEN[] = "{\"readings\":[";
+static const char JSON_RECORD_OPEN[] = "{\"plant name\":\"";
+static const char JSON_RECORD_WAKE_KEY[] = "\",\"wake\":";
+static const char JSON_RECORD_MOISTURE_KEY[] = ",\"moisture\":";
+static const char JSON_RECORD_TIME_KEY[] = ",\"ts\":";
+static const char JSON_RECORD_TIME_ERROR_KEY[] = ",\"ts_err\":";
+static const char JSON_RECORD_CLOSE[] = "}";
+static const char JSON_RECORD_SEPARATOR[] = ",";
+static const char JSON_READINGS_END[] = "]";
+static const char JSON_TIMING_OPEN[] = ",\"timing\":{";
+static const char JSON_PHASE_OPEN[] = "\"";
+static const char JSON_PHASE_VALUES[] = "\":[";
+static const char JSON_PHASE_CLOSE[] = "]";
+static const char JSON_MEM_OPEN[] = ",\"mem\":{\"heap\":[";
+static const char JSON_RAW_OPEN[] = ",\"raw\":{\"mode\":";
+static const char JSON_RAW_DATA_KEY[] = ",\"data\":\"";
+static const char JSON_RAW_CLOSE[] = "\"}";
+static const char JSON_OBJECT_CLOSE[] = "}";
+
+json_writer_t json_writer_init(char* buf, size_t cap) {
+    json_writer_t w = {
+        .buf = buf,
+        .cap = cap,
+        .len = 0,
+        .overflow = (buf == NULL || cap == 0),
+    };
+    return w;
+}
+
+void json_write_raw(json_writer_t& w, const char* data, size_t n) {
+    //one byte is always kept free for the null terminator
+    if (w.overflow || w.len + n >= w.cap) {
+        w.overflow = true;
+        return;
+    }
+
+    memcpy(w.buf + w.len, data, n);
+    w.len += n;
+}
+
+void json_write_escaped(json_writer_t& w, const char* str, size_t max_len) {
+    static const char hex[] = "0123456789abcdef";
+
+    for (size_t i = 0; i < max_len && str[i] != '\0'; ++i) {
+        const unsigned char c = static_cast<unsigned char>(str[i]);
+
+        if (c == '"' || c == '\\') {
+            const char escaped[2] = {'\\', static_cast<char>(c)};
+            json_write_raw(w, escaped, sizeof(escaped));
+        } else if (c < 0x20) {
+            //control characters have to be written as \u00XX
+            const char escaped[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf]};
+            json_write_raw(w, escaped, sizeof(escaped));
+        } else {
+            json_write_raw(w, reinterpret_cast<const char*>(&c), 1);
+        }
+    }
+}
+
+void json_write_uint(json_writer_t& w, uint32_t value) {
+    //digits are produced least significant first so they're filled in from the end of the array
+    char digits[10]; //uint32 max is 10 digits
+    size_t start = sizeof(digits);
+
+    do {
+        digits[--start] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    json_write_raw(w, digits + start, sizeof(digits) - start);
+}
+
+void json_write_fixed_point(json_writer_t& w, int32_t value, int32_t scale) {
+    //works on the magnitude in 64 bits so INT32_MIN doesn't overflow
+    int64_t magnitude = value;
+    if (magnitude < 0) {
+        json_write_literal(w, "-");
+        magnitude = -magnitude;
+    }
+
+    json_write_uint(w, static_cast<uint32_t>(magnitude / scale));
+
+    if (scale <= 1) {
+        return;
+    }
+
+    //fractional part with its leading zeros (ie 5 with a scale of 100 is written as .05)
+    char frac[10];
+    size_t n = 0;
+    int64_t remainder = magnitude % scale;
+    for (int32_t s = scale / 10; s > 0 && n < sizeof(frac); s /= 10) {
+        frac[n++] = static_cast<char>('0' + (remainder / s) % 10);
+    }
+
+    json_write_literal(w, ".");
+    json_write_raw(w, frac, n);
+}
+
+void json_write_base64(json_writer_t& w, const uint8_t* data, size_t n) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    //every 3 bytes become 4 characters, a short last group is padded with '='
+    for (size_t i = 0; i < n; i += 3) {
+        uint32_t group = static_cast<uint32_t>(data[i]) << 16;
+        if (i + 1 < n) {
+            group |= static_cast<uint32_t>(data[i + 1]) << 8;
+        }
+        if (i + 2 < n) {
+            group |= data[i + 2];
+        }
+
+        const char chars[4] = {
+            alphabet[(group >> 18) & 0x3F],
+            alphabet[(group >> 12) & 0x3F],
+            (i + 1 < n) ? alphabet[(group >> 6) & 0x3F] : '=',
+            (i + 2 < n) ? alphabet[group & 0x3F] : '=',
+        };
+        json_write_raw(w, chars, sizeof(chars));
+    }
+}
+
+size_t json_writer_finish(json_writer_t& w) {
+    if (w.overflow) {
+        if (w.buf != NULL && w.cap > 0) {
+            w.buf[0] = '\0';
+        }
+        return 0;
+    }
+
+    w.buf[w.len] = '\0';
+    return w.len;
+}
+
+size_t encode_readings_json(
+    char* buf, size_t cap,
+    const char* const* plant_names, size_t plant_count, size_t name_len,
+    const reading_record_t* records, size_t count,
+    const wake_phase_stats_t* timing,
+    const mem_stats_t* mem,
+    const raw_capture_t* raw
+) {
+    json_writer_t w = json_writer_init(buf, cap);
+    bool first = true;
+
+    json_write_literal(w, JSON_READINGS_OPEN);
+
+    for (size_t i = 0; i < count; ++i) {
+        if (records[i].plant_id >= plant_count) {
+            continue;
+        }
+
+        if (!first) {
+            json_write_literal(w, JSON_RECORD_SEPARATOR);
+        }
+        first = false;
+
+        json_write_literal(w, JSON_RECORD_OPEN);
+        json_write_escaped(w, plant_names[records[i].plant_id], name_len);
+        json_write_literal(w, JSON_RECORD_WAKE_KEY);
+        json_write_uint(w, records[i].wake_id);
+        json_write_literal(w, JSON_RECORD_MOISTURE_KEY);
+        json_write_fixed_point(w, records[i].moisture, MOISTURE_SCALE);
+        if (records[i].timestamp != 0) {
+            json_write_literal(w, JSON_RECORD_TIME_KEY);
+            json_write_uint(w, records[i].timestamp);
+            json_write_literal(w, JSON_RECORD_TIME_ERROR_KEY);
+            json_write_uint(w, records[i].time_error_s);
+        }
+        json_write_literal(w, JSON_RECORD_CLOSE);
+    }
+
+    json_write_literal(w, JSON_READINGS_END);
+#if WAKE_TIMING_ENABLED
+    if (timing != NULL) {
+        _json_write_timing(w, timing);
+    }
+#endif
+    if (mem != NULL) {
+        _json_write_mem(w, mem);
+    }
+    if (raw != NULL) {
+        _json_write_raw(w, raw);
+    }
+    json_write_literal(w, JSON_OBJECT_CLOSE);
+
+    return json_writer_finish(w);
+}
+
+#if WAKE_TIMING_ENABLED
+void _json_write_timing(json_writer_t& w, const wake_phase_stats_t* timing) {
+    bool first = true;
+
+    json_write_literal(w, JSON_TIMING_OPEN);
+
+    for (size_t i = 0; i < WAKE_PHASE_COUNT; ++i) {
+        const wake_phase_stats_t& stats = timing[i];
+        if (stats.count == 0) {
+            continue;
+        }
+
+        if (!first) {
+            json_write_literal(w, JSON_RECORD_SEPARATOR);
+        }
+        first = false;
+
+        json_write_literal(w, JSON_PHASE_OPEN);
+        json_write_raw(w, WAKE_PHASE_NAMES[i], strlen(WAKE_PHASE_NAMES[i]));
+        json_write_literal(w, JSON_PHASE_VALUES);
+        json_write_uint(w, stats.count);
+        json_write_literal(w, JSON_RECORD_SEPARATOR);
+        json_write_uint(w, stats.min_us);
+        json_write_literal(w, JSON_RECORD_SEPARATOR);
+        json_write_uint(w, static_cast<uint32_t>(stats.total_us / stats.count));
+        json_write_literal(w, JSON_RECORD_SEPARATOR);
+        json_write_uint(w, stats.max_us);
+        for (size_t b = 0; b < WAKE_TIMING_BUCKETS; ++b) {
+            json_write_literal(w, JSON_RECORD_SEPARATOR);
+            json_write_uint(w, stats.histogram[b]);
+        }
+        json_write_literal(w, JSON_PHASE_CLOSE);
+    }
+
+    json_write_literal(w, JSON_OBJECT_CLOSE);
+}
+#endif
+
+void _json_write_mem(json_writer_t& w, const mem_stats_t* mem) {
+    json_write_literal(w, JSON_MEM_OPEN);
+    json_write_uint(w, mem->heap_free);
+    json_write_literal(w, JSON_RECORD_SEPARATOR);
+    json_write_uint(w, mem->heap_min_free);
+    json_write_literal(w, JSON_RECORD_SEPARATOR);
+    json_write_uint(w, mem->heap_largest_block);
+    json_write_literal(w, JSON_PHASE_CLOSE);
+
+    for (size_t i = 0; i < MEM_TASK_COUNT; ++i) {
+        const mem_task_stats_t& task = mem->tasks[i];
+        if (task.stack_size == 0) {
+            continue;
+        }
+
+        json_write_literal(w, JSON_RECORD_SEPARATOR);
+        json_write_literal(w, JSON_PHASE_OPEN);
+        json_write_raw(w, MEM_TASK_NAMES[i], strlen(MEM_TASK_NAMES[i]));
+        json_write_literal(w, JSON_PHASE_VALUES);
+        json_write_uint(w, task.stack_size);
+        json_write_literal(w, JSON_RECORD_SEPARATOR);
+        json_write_uint(w, task.stack_min_free);
+        json_write_literal(w, JSON_PHASE_CLOSE);
+    }
+
+    json_write_literal(w, JSON_OBJECT_CLOSE);
+}
+
+void _json_write_raw(json_writer_t& w, const raw_capture_t* raw) {
+    json_write_literal(w, JSON_RAW_OPEN);
+    json_write_uint(w, raw->mode);
+    json_write_literal(w, JSON_RAW_DATA_KEY);
+    json_write_base64(w, raw->data, raw->len);
+    json_write_literal(w, JSON_RAW_CLOSE);
+}
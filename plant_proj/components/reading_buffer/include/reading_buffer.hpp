@@ -0,0 +1,75 @@
+#ifndef READING_BUFFER_HPP
+#define READING_BUFFER_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Ring buffer of moisture readings kept in RTC slow memory. RTC memory survives deep sleep so each wake
+ * can append a reading and go straight back to sleep, the radio is only brought up when the buffer
+ * needs to be flushed to the backend
+ *
+ * https://docs.espressif.com/projects/esp-idf/en/stable/esp32/api-guides/memory-types.html#rtc-slow-memory
+ */
+
+//capacity of the ring buffer. each record is 16 bytes so this uses 2kb of the 8kb of rtc slow memory
+#define READING_BUFFER_CAPACITY 128
+
+//moisture values are stored as fixed point numbers with 2 decimal places (ie 42.56 percent is stored as 4256)
+extern const int32_t MOISTURE_SCALE;
+
+typedef struct {
+    uint32_t wake_id; //the wake cycle the reading was sampled in
+    int32_t moisture; //moisture reading scaled by MOISTURE_SCALE
+    uint32_t timestamp; //unix time the reading was sampled at, 0 if the node had no time yet (see node_time.hpp)
+    uint16_t time_error_s; //bound on the error of timestamp
+    uint8_t plant_id; //index of the plant in leaf_info.plants
+} reading_record_t;
+
+/**
+ * Appends a reading to the buffer. if the buffer is full the oldest reading is dropped
+ * @param record the reading to append
+ */
+void reading_buffer_push(const reading_record_t& record);
+
+/**
+ * @return returns the number of readings currently stored
+ */
+size_t reading_buffer_count();
+
+/**
+ * Copies readings (oldest first) out of the buffer without removing them
+ * @param out array the readings are copied into
+ * @param max_count max number of readings that fit in out
+ * @return returns the number of readings that were copied
+ */
+size_t reading_buffer_peek(reading_record_t* out, size_t max_count);
+
+/**
+ * Removes the n oldest readings. meant to be called once the readings have been uploaded
+ * @param n number of readings to remove
+ */
+void reading_buffer_discard(size_t n);
+
+/**
+ * Checks if the buffer has reached its fill level or if its oldest reading is too old
+ * @param curr_wake_id id of the current wake cycle
+ * @param fill_level number of readings that triggers a flush
+ * @param max_age_wakes number of wake cycles the oldest reading is allowed to wait before triggering a flush
+ * @return returns true if the buffer should be uploaded
+ */
+bool reading_buffer_should_flush(uint32_t curr_wake_id, size_t fill_level, uint32_t max_age_wakes);
+
+/**
+ * Same check as reading_buffer_should_flush without logging the flush, for guessing ahead whether a flush will come
+ * @return returns true if the buffer would be uploaded
+ */
+bool reading_buffer_flush_due(uint32_t curr_wake_id, size_t fill_level, uint32_t max_age_wakes);
+
+/**
+ * @param curr_wake_id id of the current wake cycle
+ * @return returns how many wakes ago the oldest reading was sampled. the buffer must not be empty
+ */
+uint32_t _oldest_age(uint32_t curr_wake_id);
+
+#endif
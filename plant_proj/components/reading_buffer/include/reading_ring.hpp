@@ -0,0 +1,64 @@
+#ifndef READING_RING_HPP
+#define READING_RING_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include "reading_buffer.hpp"
+
+/**
+ * Lock free single producer, single consumer ring of readings connecting the sampler and uplink tasks of the
+ * continuous mode (see continuous_mode.hpp). only the sampler pushes and only the uplink peeks and discards, so
+ * each index is written by one task and read by the other and no lock or critical section is needed. the
+ * consumer removes readings only after the backend accepted them, the same peek and discard as reading_buffer
+ *
+ * unlike the rtc buffer a full ring drops the new reading, the producer can't move the consumer's index.
+ * the drops are counted in reading_ring_stats
+ */
+
+//must be a power of 2 so the free running indexes wrap correctly. each entry is 24 bytes
+#define READING_RING_CAPACITY 256
+
+typedef struct {
+    reading_record_t record;
+    int64_t sampled_us; //monotonic time it was sampled at, for the end to end latency
+} ring_reading_t;
+
+typedef struct {
+    uint32_t pushed; //readings accepted into the ring
+    uint32_t overflows; //readings dropped because the ring was full
+    size_t depth; //readings waiting
+    size_t max_depth; //most readings ever waiting at once
+} reading_ring_stats_t;
+
+/**
+ * Appends a reading. producer side
+ * @param reading reading to append
+ * @return returns false if the ring was full and the reading was dropped
+ */
+bool reading_ring_push(const ring_reading_t& reading);
+
+/**
+ * @return returns the number of readings waiting. exact on the consumer side, a lower bound on the producer side
+ */
+size_t reading_ring_count();
+
+/**
+ * Copies readings (oldest first) out of the ring without removing them. consumer side
+ * @param out array the readings are copied into
+ * @param max_count max number of readings that fit in out
+ * @return returns the number of readings that were copied
+ */
+size_t reading_ring_peek(ring_reading_t* out, size_t max_count);
+
+/**
+ * Removes the n oldest readings. consumer side
+ * @param n number of readings to remove, at most reading_ring_count
+ */
+void reading_ring_discard(size_t n);
+
+/**
+ * @return returns the ring's counters. safe to call from either side
+ */
+reading_ring_stats_t reading_ring_stats();
+
+#endif
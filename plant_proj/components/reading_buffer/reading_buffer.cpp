@@ -0,0 +1,78 @@
+#include <esp_log.h>
+#include <esp_attr.h> // RTC_DATA_ATTR
+#include "reading_buffer.hpp"
+#include "event_log.hpp"
+
+const int32_t MOISTURE_SCALE = 100;
+
+static const char* _logger = "Reading Buffer *** ";
+
+//RTC_DATA_ATTR places the variables in rtc slow memory. they are zero initialized on power on
+//and keep their values across deep sleep cycles
+RTC_DATA_ATTR static reading_record_t _records[READING_BUFFER_CAPACITY];
+RTC_DATA_ATTR static size_t _head = 0; //index of the oldest reading
+RTC_DATA_ATTR static size_t _count = 0; //number of readings stored
+
+void reading_buffer_push(const reading_record_t& record) {
+    if (_count == READING_BUFFER_CAPACITY) {
+        ESP_LOGW(_logger, "WARNING! Reading buffer is full, dropping reading from wake %u", static_cast<unsigned>(_records[_head].wake_id));
+        _head = (_head + 1) % READING_BUFFER_CAPACITY;
+        _count -= 1;
+    }
+
+    size_t tail = (_head + _count) % READING_BUFFER_CAPACITY; //index right after the newest reading
+    _records[tail] = record;
+    _count += 1;
+
+    EVENT_LOG_D(EVT_BUFFERED, record.wake_id, _count);
+}
+
+size_t reading_buffer_count() {
+    return _count;
+}
+
+size_t reading_buffer_peek(reading_record_t* out, size_t max_count) {
+    size_t n = (_count < max_count) ? _count : max_count;
+
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = _records[(_head + i) % READING_BUFFER_CAPACITY];
+    }
+
+    return n;
+}
+
+void reading_buffer_discard(size_t n) {
+    if (n > _count) {
+        ESP_LOGW(_logger, "WARNING! Tried to discard %u readings but only %u are stored", static_cast<unsigned>(n), static_cast<unsigned>(_count));
+        n = _count;
+    }
+
+    _head = (_head + n) % READING_BUFFER_CAPACITY;
+    _count -= n;
+}
+
+bool reading_buffer_should_flush(uint32_t curr_wake_id, size_t fill_level, uint32_t max_age_wakes) {
+    if (!reading_buffer_flush_due(curr_wake_id, fill_level, max_age_wakes)) {
+        return false;
+    }
+
+    if (_count >= fill_level) {
+        EVENT_LOG_I(EVT_FLUSH_FILL, fill_level);
+    } else {
+        EVENT_LOG_I(EVT_FLUSH_AGE, _oldest_age(curr_wake_id));
+    }
+    return true;
+}
+
+bool reading_buffer_flush_due(uint32_t curr_wake_id, size_t fill_level, uint32_t max_age_wakes) {
+    if (_count == 0) {
+        return false;
+    }
+
+    return _count >= fill_level || _oldest_age(curr_wake_id) >= max_age_wakes;
+}
+
+uint32_t _oldest_age(uint32_t curr_wake_id) {
+    //unsigned subtraction so the age is still correct if the wake counter wraps around
+    return curr_wake_id - _records[_head].wake_id;
+}
@@ -0,0 +1,72 @@
+#include <atomic>
+#include "reading_ring.hpp"
+
+static_assert((READING_RING_CAPACITY & (READING_RING_CAPACITY - 1)) == 0, "READING_RING_CAPACITY must be a power of 2");
+
+static ring_reading_t _entries[READING_RING_CAPACITY];
+
+//free running, the slot is the index masked by the capacity. _tail is only written by the producer and _head only
+//by the consumer. the release store of one and the acquire load by the other order the entry's copy with it
+static std::atomic<uint32_t> _tail(0); //index right after the newest reading
+static std::atomic<uint32_t> _head(0); //index of the oldest reading
+
+//only written by the producer
+static std::atomic<uint32_t> _pushed(0);
+static std::atomic<uint32_t> _overflows(0);
+static std::atomic<uint32_t> _max_depth(0);
+
+bool reading_ring_push(const ring_reading_t& reading) {
+    uint32_t tail = _tail.load(std::memory_order_relaxed);
+    uint32_t depth = tail - _head.load(std::memory_order_acquire);
+    if (depth == READING_RING_CAPACITY) {
+        _overflows.store(_overflows.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    _entries[tail & (READING_RING_CAPACITY - 1)] = reading;
+    _tail.store(tail + 1, std::memory_order_release);
+
+    _pushed.store(_pushed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (depth + 1 > _max_depth.load(std::memory_order_relaxed)) {
+        _max_depth.store(depth + 1, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+size_t reading_ring_count() {
+    //loads the head first, a tail loaded after it is never behind it
+    uint32_t head = _head.load(std::memory_order_acquire);
+    return _tail.load(std::memory_order_acquire) - head;
+}
+
+size_t reading_ring_peek(ring_reading_t* out, size_t max_count) {
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    size_t count = _tail.load(std::memory_order_acquire) - head;
+    size_t n = (count < max_count) ? count : max_count;
+
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = _entries[(head + i) & (READING_RING_CAPACITY - 1)];
+    }
+    return n;
+}
+
+void reading_ring_discard(size_t n) {
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    size_t count = _tail.load(std::memory_order_acquire) - head;
+    if (n > count) {
+        n = count;
+    }
+
+    //the slots are handed back to the producer once the copies out of them are done
+    _head.store(head + static_cast<uint32_t>(n), std::memory_order_release);
+}
+
+reading_ring_stats_t reading_ring_stats() {
+    reading_ring_stats_t stats = {
+        .pushed = _pushed.load(std::memory_order_relaxed),
+        .overflows = _overflows.load(std::memory_order_relaxed),
+        .depth = reading_ring_count(),
+        .max_depth = _max_depth.load(std::memory_order_relaxed),
+    };
+    return stats;
+}
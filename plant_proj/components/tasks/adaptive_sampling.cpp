@@ -0,0 +1,141 @@
+#include <esp_attr.h>
+#include <algorithm>
+#include "adaptive_sampling.hpp"
+#include "moisture_tracker.hpp"
+#include "leaf_config.hpp"
+#include "moisture_sensor.hpp"
+#include "event_log.hpp"
+
+const int32_t MOISTURE_DEADBAND = 100; //1 percent
+const uint64_t MIN_SLEEP_DURATION = 8000000; //8 s
+const uint64_t MAX_SLEEP_DURATION = 900000000; //15 min
+const uint32_t HEARTBEAT_WAKES = 30;
+const int TREND_SHIFT = 2;
+
+//kept in rtc memory across deep sleep
+RTC_DATA_ATTR static bool _has_reported = false; //false until the first reading after power on
+RTC_DATA_ATTR static int32_t _last_reported[MAX_PLANTS]; //last value of each plant that was buffered for upload
+RTC_DATA_ATTR static int32_t _last_value[MAX_PLANTS]; //value of each plant on the previous wake
+RTC_DATA_ATTR static int32_t _trend[MAX_PLANTS]; //smoothed rate of change of each plant, MOISTURE_SCALE units per minute
+RTC_DATA_ATTR static uint64_t _last_sleep_us = 0; //how long the node slept before this wake
+RTC_DATA_ATTR static uint32_t _wakes_since_upload = 0;
+
+sample_decision_t adaptive_sampling_update(const int32_t* values, size_t count) {
+    sample_decision_t decision = {
+        .report = false,
+        .heartbeat = false,
+        .next_sleep_us = _configured_sleep_us(),
+    };
+
+    _wakes_since_upload += 1;
+
+    if (!_has_reported) {
+        //nothing to compare against yet, the first readings are always reported
+        for (size_t i = 0; i < count; ++i) {
+            if (values[i] == MOISTURE_NO_READING) {
+                continue;
+            }
+            _last_reported[i] = values[i];
+            _last_value[i] = values[i];
+            _trend[i] = 0;
+        }
+        _has_reported = true;
+        decision.next_sleep_us = _clamp_sleep(decision.next_sleep_us);
+        _last_sleep_us = decision.next_sleep_us;
+
+        decision.report = true;
+        return decision;
+    }
+
+    int32_t fastest = 0;
+    for (size_t i = 0; i < count; ++i) {
+        //a plant without a reading keeps its trend and last values until the next one
+        if (values[i] == MOISTURE_NO_READING) {
+            continue;
+        }
+
+        //rate of change since the previous wake in units per minute
+        int64_t delta = values[i] - _last_value[i];
+        if (delta < 0) {
+            delta = -delta;
+        }
+        int64_t minutes_x1000 = static_cast<int64_t>(_last_sleep_us / 60000); //minutes scaled by 1000
+        int32_t rate = (minutes_x1000 > 0) ? static_cast<int32_t>(delta * 1000 / minutes_x1000) : 0;
+
+        //exponential moving average so one noisy wake doesn't collapse the interval
+        _trend[i] += (rate - _trend[i]) / (1 << TREND_SHIFT);
+        _last_value[i] = values[i];
+
+        if (_trend[i] > fastest) {
+            fastest = _trend[i];
+        }
+
+        int32_t change = values[i] - _last_reported[i];
+        if (change >= MOISTURE_DEADBAND || change <= -MOISTURE_DEADBAND) {
+            decision.report = true;
+        }
+    }
+
+    if (_wakes_since_upload >= HEARTBEAT_WAKES) {
+        EVENT_LOG_I(EVT_HEARTBEAT, _wakes_since_upload);
+        decision.report = true;
+        decision.heartbeat = true;
+    }
+
+    if (decision.report) {
+        for (size_t i = 0; i < count; ++i) {
+            if (values[i] == MOISTURE_NO_READING) {
+                continue;
+            }
+            _last_reported[i] = values[i];
+        }
+    } else {
+        EVENT_LOG_I(EVT_DEADBAND);
+    }
+
+    decision.next_sleep_us = _sleep_for_rate(fastest);
+    _last_sleep_us = decision.next_sleep_us;
+
+    EVENT_LOG_I(EVT_NEXT_SLEEP, fastest, static_cast<int32_t>(decision.next_sleep_us / 1000000));
+
+    return decision;
+}
+
+bool adaptive_sampling_heartbeat_due() {
+    //adaptive_sampling_update counts the wake before checking
+    return _wakes_since_upload + 1 >= HEARTBEAT_WAKES;
+}
+
+void adaptive_sampling_mark_uploaded() {
+    _wakes_since_upload = 0;
+}
+
+uint64_t adaptive_sampling_reclamp(uint64_t sleep_us) {
+    return _clamp_sleep(sleep_us);
+}
+
+void adaptive_sampling_slept(uint64_t sleep_us) {
+    _last_sleep_us = sleep_us;
+}
+
+uint64_t _sleep_for_rate(int32_t rate) {
+    if (rate <= 0) {
+        return _clamp_sleep(MAX_SLEEP_DURATION);
+    }
+
+    //time to drift by one deadband = deadband / rate minutes
+    uint64_t sleep_us = static_cast<uint64_t>(MOISTURE_DEADBAND) * 60000000 / static_cast<uint64_t>(rate);
+    return _clamp_sleep(sleep_us);
+}
+
+uint64_t _clamp_sleep(uint64_t sleep_us) {
+    //the configured interval (which the backend can change, see directives.hpp) raises the floor, and the
+    //ceiling with it if it's above MAX_SLEEP_DURATION
+    uint64_t floor = std::max(MIN_SLEEP_DURATION, _configured_sleep_us());
+    uint64_t ceiling = std::max(MAX_SLEEP_DURATION, floor);
+    return std::min(std::max(sleep_us, floor), ceiling);
+}
+
+uint64_t _configured_sleep_us() {
+    return static_cast<uint64_t>(leaf_settings.sleep_interval_s) * 1000000;
+}
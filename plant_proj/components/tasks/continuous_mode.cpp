@@ -0,0 +1,267 @@
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+#include "wifi_handler.hpp"
+#include "moisture_sensor.hpp"
+#include "flash_queue.hpp"
+#include "leaf_config.hpp"
+#include "sleep_hal.hpp"
+#include "event_log.hpp"
+#include "node_time.hpp"
+#include "moisture_tracker.hpp"
+#include "mem_stats.hpp"
+#include "static_alloc.hpp"
+#include "continuous_mode.hpp"
+
+const bool CONTINUOUS_MODE = false; //set on nodes that don't run on a battery
+const uint32_t CONTINUOUS_SAMPLE_PERIOD_MS = 1000;
+const size_t CONTINUOUS_BATCH_SIZE = 64; //fits in one json request at up to 4 plants
+const uint32_t CONTINUOUS_MAX_BATCH_AGE_MS = 10000;
+const uint32_t CONTINUOUS_RETRY_DELAY_MS = 2000;
+const uint32_t CONTINUOUS_REPORT_PERIOD_MS = 60000;
+const uint32_t SAMPLER_TASK_STACK = 3072;
+const uint32_t UPLINK_TASK_STACK = 4096;
+
+//the sampler runs on the core the wifi driver's task isn't pinned to (like the overlap's sampling task) so
+//sending never delays a sample, the uplink next to the driver
+#if CONFIG_FREERTOS_UNICORE
+#define SAMPLER_TASK_CORE tskNO_AFFINITY
+#define UPLINK_TASK_CORE tskNO_AFFINITY
+#elif CONFIG_ESP_WIFI_TASK_PINNED_TO_CORE_1
+#define SAMPLER_TASK_CORE 0
+#define UPLINK_TASK_CORE 1
+#else
+#define SAMPLER_TASK_CORE 1
+#define UPLINK_TASK_CORE 0
+#endif
+
+static const char* _logger = "Continuous Mode *** ";
+
+static TaskHandle_t _uplink_handle = NULL; //notified by the sampler when a batch is full
+static TaskHandle_t _sampler_handle = NULL; //its stack usage is recorded by the uplink task
+static bool _connected = false; //only used by the uplink task
+static uint32_t _reported_overflows = 0;
+
+//the sampler's counters are only written by the sampler and the rest only by the uplink task. they're read
+//without a lock, a report can be off by the burst or batch that was being counted
+static continuous_stats_t _stats;
+static int64_t _start_us = 0;
+
+//static so they don't live on the uplink task's stack
+static ring_reading_t _peeked[CONTINUOUS_BATCH_SIZE];
+static reading_record_t _records[CONTINUOUS_BATCH_SIZE];
+
+//empty unless built with STATIC_ALLOCATION
+static static_task_t<SAMPLER_TASK_STACK> _sampler_task_buffers;
+static static_task_t<UPLINK_TASK_STACK> _uplink_task_buffers;
+
+esp_err_t continuous_mode_start() {
+    ESP_LOGI(_logger, "Starting continuous mode, sampling every %u ms", static_cast<unsigned>(CONTINUOUS_SAMPLE_PERIOD_MS));
+
+    //nothing sleeps so the whole run is one wake of the event log
+    event_log_begin_wake();
+    _start_us = sleep_hal_time_us();
+    _stats.latency_min_us = INT64_MAX;
+
+    //the uplink goes first so the sampler has a task to notify
+    if (!static_task_create(_uplink_task_buffers, _uplink_task, "uplink", 5, &_uplink_handle, UPLINK_TASK_CORE)) {
+        ESP_LOGE(_logger, "ERROR! Unable to start the uplink task");
+        return ESP_FAIL;
+    }
+    //sampling on time matters more than sending on time
+    if (!static_task_create(_sampler_task_buffers, _sampler_task, "sampler", 6, &_sampler_handle, SAMPLER_TASK_CORE)) {
+        ESP_LOGE(_logger, "ERROR! Unable to start the sampler task");
+        return ESP_FAIL;
+    }
+
+    return ESP_OK;
+}
+
+continuous_stats_t continuous_mode_stats() {
+    continuous_stats_t stats = _stats;
+    stats.elapsed_us = sleep_hal_time_us() - _start_us;
+    stats.ring = reading_ring_stats();
+    return stats;
+}
+
+void _sampler_task(void* pvParameters) {
+    uint8_t channels[MAX_PLANTS];
+    for (size_t i = 0; i < leaf_info.plant_count; ++i) {
+        channels[i] = leaf_info.plants[i].adc_channel;
+    }
+
+    uint16_t sample_size = 0;
+    TickType_t last_wake = xTaskGetTickCount();
+    while (true) {
+        //the backend can change the sample size with a directive, the sensor is set up again when it does
+        if (leaf_settings.sample_size != sample_size) {
+            sample_size = leaf_settings.sample_size;
+            moisture_sensor_init(sample_size, channels, leaf_info.plant_count);
+        }
+
+        int64_t sampled_us = sleep_hal_time_us();
+        int32_t values[MAX_PLANTS];
+        get_moisture_values(MOISTURE_SCALE, values);
+        _stats.sample_bursts += 1;
+
+        //the uplink task stamps the wall clock, see continuous_mode.hpp
+        for (size_t i = 0; i < leaf_info.plant_count; ++i) {
+            if (values[i] == MOISTURE_NO_READING) {
+                continue; //the probe wasn't sampled this burst
+            }
+            ring_reading_t reading = {
+                .record = {
+                    .wake_id = _stats.sample_bursts,
+                    .moisture = values[i],
+                    .timestamp = 0,
+                    .time_error_s = 0,
+                    .plant_id = static_cast<uint8_t>(i),
+                },
+                .sampled_us = sampled_us,
+            };
+            reading_ring_push(reading);
+        }
+
+        if (reading_ring_count() >= CONTINUOUS_BATCH_SIZE) {
+            xTaskNotifyGive(_uplink_handle);
+        }
+
+        //returns right away if the burst took longer than the period
+        if (xTaskDelayUntil(&last_wake, pdMS_TO_TICKS(CONTINUOUS_SAMPLE_PERIOD_MS)) == pdFALSE) {
+            _stats.missed_periods += 1;
+        }
+    }
+}
+
+void _uplink_task(void* pvParameters) {
+    int64_t last_report_us = sleep_hal_time_us();
+
+    while (true) {
+        //size trigger: the sampler's notification. time trigger: the timeout
+        size_t count = reading_ring_peek(_peeked, CONTINUOUS_BATCH_SIZE);
+        uint32_t wait_ms = (count >= CONTINUOUS_BATCH_SIZE) ? 0 : _batch_wait_ms(count, count > 0 ? _peeked[0].sampled_us : 0);
+        if (wait_ms > 0) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait_ms));
+            count = reading_ring_peek(_peeked, CONTINUOUS_BATCH_SIZE);
+        }
+
+        if (count >= CONTINUOUS_BATCH_SIZE || (count > 0 && _batch_wait_ms(count, _peeked[0].sampled_us) == 0)) {
+            if (_upload_batch(count) != ESP_OK) {
+                //readings keep piling up in the ring while this waits, they go out with the next batches
+                uint64_t delay_us = wifi_backoff_sleep_us(static_cast<uint64_t>(CONTINUOUS_RETRY_DELAY_MS) * 1000);
+                vTaskDelay(pdMS_TO_TICKS(delay_us / 1000));
+            }
+            event_log_flush();
+        }
+
+        if (sleep_hal_time_us() - last_report_us >= static_cast<int64_t>(CONTINUOUS_REPORT_PERIOD_MS) * 1000) {
+            last_report_us = sleep_hal_time_us();
+            _report_continuous_stats();
+        }
+    }
+}
+
+uint32_t _batch_wait_ms(size_t count, int64_t oldest_us) {
+    if (count == 0) {
+        return CONTINUOUS_MAX_BATCH_AGE_MS;
+    }
+
+    int64_t remaining_us = oldest_us + static_cast<int64_t>(CONTINUOUS_MAX_BATCH_AGE_MS) * 1000 - sleep_hal_time_us();
+    if (remaining_us <= 0) {
+        return 0;
+    }
+    return static_cast<uint32_t>((remaining_us + 999) / 1000);
+}
+
+esp_err_t _upload_batch(size_t count) {
+    if (!_connected) {
+        //the connection stays up between batches, it's only brought up again after a failure
+        _connected = (start_wifi_connection() == ESP_OK);
+        if (!_connected) {
+            ESP_LOGE(_logger, "Encountered an Error when Starting WIFI. Moving %u readings to flash", static_cast<unsigned>(count));
+        }
+    }
+
+    if (_connected && node_time_sync_due()) {
+        node_time_sync();
+    }
+
+    //stamped now from how long ago they were sampled, node_time_now has the drift corrected time
+    node_timestamp_t now = node_time_now();
+    int64_t now_us = sleep_hal_time_us();
+    for (size_t i = 0; i < count; ++i) {
+        _records[i] = _peeked[i].record;
+        int64_t age_s = (now_us - _peeked[i].sampled_us + 500000) / 1000000;
+        if (now.epoch_s != 0 && age_s < now.epoch_s) {
+            _records[i].timestamp = now.epoch_s - static_cast<uint32_t>(age_s);
+            _records[i].time_error_s = now.error_s;
+        }
+    }
+
+    //the backlog of earlier failures goes out first so the backend gets readings in order
+    esp_err_t res = ESP_FAIL;
+    size_t accepted = 0;
+    bool summary = true; //once per batch, whether or not the backlog goes out with it
+    if (_connected && _drain_flash_queue(&summary) == ESP_OK) {
+        res = post_moisture_readings(_records, count, SUBMIT_BATCH, &accepted, &summary);
+
+        int64_t accepted_us = sleep_hal_time_us();
+        for (size_t i = 0; i < accepted; ++i) {
+            int64_t latency = accepted_us - _peeked[i].sampled_us;
+            _stats.latency_total_us += latency;
+            _stats.latency_min_us = (latency < _stats.latency_min_us) ? latency : _stats.latency_min_us;
+            _stats.latency_max_us = (latency > _stats.latency_max_us) ? latency : _stats.latency_max_us;
+        }
+        _stats.sent += accepted;
+    }
+    reading_ring_discard(accepted);
+    if (res == ESP_OK) {
+        return ESP_OK;
+    }
+
+    //the rest of the batch goes to flash so the ring keeps draining while the backend is out of reach
+    _stats.failed_uploads += 1;
+    size_t stored = 0;
+    if (flash_queue_append(_records + accepted, count - accepted, &stored) != ESP_OK) {
+        ESP_LOGE(_logger, "Encountered an Error when moving readings to flash. Keeping %u in the ring", static_cast<unsigned>(count - accepted - stored));
+    }
+    reading_ring_discard(stored);
+    EVENT_LOG_E(EVT_UPLOAD_FAILED, static_cast<int32_t>(count - accepted));
+
+    //reconnects from scratch on the next batch
+    if (_connected) {
+        stop_wifi_connection();
+        _connected = false;
+    }
+    return res;
+}
+
+void _report_continuous_stats() {
+    continuous_stats_t stats = continuous_mode_stats();
+
+    //both tasks' high water marks go out with the next upload
+    mem_stats_record_task(MEM_TASK_UPLINK, NULL, UPLINK_TASK_STACK);
+    if (_sampler_handle != NULL) {
+        mem_stats_record_task(MEM_TASK_SAMPLER, _sampler_handle, SAMPLER_TASK_STACK);
+    }
+
+    //the readings the sampler dropped since the last report, the ring was full because the uplink fell behind
+    if (stats.ring.overflows != _reported_overflows) {
+        EVENT_LOG_W(EVT_RING_OVERFLOW, static_cast<int32_t>(stats.ring.overflows - _reported_overflows));
+        _reported_overflows = stats.ring.overflows;
+    }
+
+    int64_t elapsed_ms = stats.elapsed_us / 1000;
+    ESP_LOGI(_logger, "Sampled %u times in %lld s (%.2f per s, %u late), ring %u/%u (max %u), %u overflows",
+        static_cast<unsigned>(stats.sample_bursts), static_cast<long long>(elapsed_ms / 1000),
+        elapsed_ms > 0 ? stats.sample_bursts * 1000.0 / elapsed_ms : 0.0, static_cast<unsigned>(stats.missed_periods),
+        static_cast<unsigned>(stats.ring.depth), static_cast<unsigned>(READING_RING_CAPACITY),
+        static_cast<unsigned>(stats.ring.max_depth), static_cast<unsigned>(stats.ring.overflows));
+    if (stats.sent > 0) {
+        ESP_LOGI(_logger, "Sent %u readings, %u failed uploads, latency ms min %lld mean %lld max %lld",
+            static_cast<unsigned>(stats.sent), static_cast<unsigned>(stats.failed_uploads),
+            static_cast<long long>(stats.latency_min_us / 1000), static_cast<long long>(stats.latency_total_us / stats.sent / 1000),
+            static_cast<long long>(stats.latency_max_us / 1000));
+    }
+    mem_stats_log();
+}
@@ -0,0 +1,80 @@
+#ifndef ADAPTIVE_SAMPLING_HPP
+#define ADAPTIVE_SAMPLING_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Send on delta and adaptive sleep. the last reported value and a trend estimate of every plant are kept in
+ * rtc memory. readings that moved less than MOISTURE_DEADBAND since the last reported one are dropped so the
+ * radio isn't used for them, and the sleep interval is stretched while the soil is stable and shrunk while
+ * it's changing, never below the configured sleep interval. a heartbeat forces an upload every HEARTBEAT_WAKES
+ * wakes to show the node is alive
+ */
+
+extern const int32_t MOISTURE_DEADBAND; //change that makes a reading worth reporting, scaled by MOISTURE_SCALE
+extern const uint64_t MIN_SLEEP_DURATION; //in microseconds
+extern const uint64_t MAX_SLEEP_DURATION; //in microseconds
+extern const uint32_t HEARTBEAT_WAKES; //wakes without an upload before one is forced
+extern const int TREND_SHIFT; //smoothing factor of the trend estimate is 1 / 2^TREND_SHIFT
+
+typedef struct {
+    bool report; //true if the readings should be buffered for upload
+    bool heartbeat; //true if an upload is due regardless of the buffer's fill level
+    uint64_t next_sleep_us; //how long to sleep before the next wake
+} sample_decision_t;
+
+/**
+ * Compares this wake's readings against the last reported ones and updates the trend estimates
+ * @param values reading of every plant, scaled by MOISTURE_SCALE. MOISTURE_NO_READING leaves a plant out
+ * @param count number of plants
+ * @return returns whether to report the readings and how long to sleep
+ */
+sample_decision_t adaptive_sampling_update(const int32_t* values, size_t count);
+
+/**
+ * @return returns true if the next call to adaptive_sampling_update will force a heartbeat upload
+ */
+bool adaptive_sampling_heartbeat_due();
+
+/**
+ * Restarts the heartbeat countdown. called after a successful upload
+ */
+void adaptive_sampling_mark_uploaded();
+
+/**
+ * Clamps a sleep interval again after the configured interval changed mid wake (ie by a directive of the backend)
+ * so the change applies to this wake's sleep
+ * @param sleep_us interval returned by adaptive_sampling_update
+ * @return returns the interval to sleep for, in microseconds
+ */
+uint64_t adaptive_sampling_reclamp(uint64_t sleep_us);
+
+/**
+ * Records how long the node actually sleeps, once the wifi backoff stretched the interval. the next wake's rate
+ * of change is measured over it
+ * @param sleep_us interval the node goes to sleep for, in microseconds
+ */
+void adaptive_sampling_slept(uint64_t sleep_us);
+
+/**
+ * Works out the next sleep interval from the fastest changing plant. the node sleeps for about as long as
+ * that plant takes to drift by one deadband
+ * @param rate fastest rate of change, in MOISTURE_SCALE units per minute
+ * @return returns the interval in microseconds, clamped by _clamp_sleep
+ */
+uint64_t _sleep_for_rate(int32_t rate);
+
+/**
+ * @param sleep_us sleep interval in microseconds
+ * @return returns the interval between the larger of MIN_SLEEP_DURATION and the configured interval, and
+ * MAX_SLEEP_DURATION (or the configured interval if it's longer)
+ */
+uint64_t _clamp_sleep(uint64_t sleep_us);
+
+/**
+ * @return returns the sleep interval from leaf_settings in microseconds. used until there's a trend to adapt it to
+ */
+uint64_t _configured_sleep_us();
+
+#endif
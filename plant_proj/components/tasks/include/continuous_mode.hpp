@@ -0,0 +1,87 @@
+#ifndef CONTINUOUS_MODE_HPP
+#define CONTINUOUS_MODE_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_err.h>
+#include "reading_ring.hpp"
+
+/**
+ * Always on mode for mains powered nodes (ie in a greenhouse). instead of the deep sleep loop of
+ * moisture_tracker, which brings wifi up and tears it down on every upload, a sampler task samples every plant
+ * each CONTINUOUS_SAMPLE_PERIOD_MS and an uplink task sends the readings over a connection it keeps open. the
+ * two run on different cores and only share the lock free ring of reading_ring.hpp
+ *
+ * the uplink sends a batch once CONTINUOUS_BATCH_SIZE readings are waiting (the sampler notifies it) or the
+ * oldest one waited CONTINUOUS_MAX_BATCH_AGE_MS. readings are stamped with the wall clock by the uplink task
+ * from the monotonic time they were sampled at, so node_time is only used from one task. a failed upload moves
+ * its batch to the flash queue, drops the connection and waits before reconnecting (see wifi_backoff_sleep_us)
+ *
+ * adaptive sampling and the deadband don't apply, every sample is sent. wake_id holds the sample's sequence number
+ */
+
+extern const bool CONTINUOUS_MODE; //true to run continuous_mode_start instead of the deep sleep loop
+extern const uint32_t CONTINUOUS_SAMPLE_PERIOD_MS;
+extern const size_t CONTINUOUS_BATCH_SIZE; //readings waiting that trigger an upload
+extern const uint32_t CONTINUOUS_MAX_BATCH_AGE_MS; //max time a reading waits before triggering an upload
+extern const uint32_t CONTINUOUS_RETRY_DELAY_MS; //wait before reconnecting after a failure, grows while failures repeat
+extern const uint32_t CONTINUOUS_REPORT_PERIOD_MS; //how often the stats are logged
+extern const uint32_t SAMPLER_TASK_STACK;
+extern const uint32_t UPLINK_TASK_STACK;
+
+typedef struct {
+    int64_t elapsed_us; //since continuous_mode_start
+    uint32_t sample_bursts; //every plant sampled once
+    uint32_t missed_periods; //bursts that ran late, the sampler couldn't keep up with CONTINUOUS_SAMPLE_PERIOD_MS
+    reading_ring_stats_t ring;
+    uint32_t sent; //readings the backend accepted
+    uint32_t failed_uploads;
+    int64_t latency_min_us; //sampled to accepted by the backend, over the accepted readings
+    int64_t latency_max_us;
+    int64_t latency_total_us;
+} continuous_stats_t;
+
+/**
+ * Starts the sampler and uplink tasks. returns once they're running, they never stop
+ * @return returns ESP_OK, or ESP_FAIL if a task couldn't be created
+ */
+esp_err_t continuous_mode_start();
+
+/**
+ * @return returns the counters of both tasks. the sustained sample rate is sample_bursts over elapsed_us
+ */
+continuous_stats_t continuous_mode_stats();
+
+/**
+ * Sampler task. samples every plant each CONTINUOUS_SAMPLE_PERIOD_MS and pushes the readings into the ring
+ * @param pvParameters unused
+ */
+void _sampler_task(void* pvParameters);
+
+/**
+ * Uplink task. waits for the size or time trigger and sends the waiting readings
+ * @param pvParameters unused
+ */
+void _uplink_task(void* pvParameters);
+
+/**
+ * @param count readings waiting in the ring
+ * @param oldest_us sample time of the oldest one
+ * @return returns how long until the time trigger fires, in ms. 0 if it already did
+ */
+uint32_t _batch_wait_ms(size_t count, int64_t oldest_us);
+
+/**
+ * Sends the first count readings of the peeked batch, connecting first if there's no connection. accepted
+ * readings leave the ring, the rest go to the flash queue
+ * @param count readings in the batch
+ * @return returns ESP_OK if every reading was accepted
+ */
+esp_err_t _upload_batch(size_t count);
+
+/**
+ * Logs the stats and the change in the overflow count since the last report
+ */
+void _report_continuous_stats();
+
+#endif
@@ -1,9 +1,116 @@
 #ifndef MOISTURE_TRACKER_HPP
 #define MOISTURE_TRACKER_HPP
 
-extern const uint64_t SLEEP_DURATION; //in microseconds
+#include <stdint.h>
+#include <stddef.h>
+#include "wifi_handler.hpp"
 
+extern const size_t UPLOAD_FILL_LEVEL; //number of wakes worth of buffered readings that triggers an upload
+extern const uint32_t UPLOAD_MAX_AGE_WAKES; //max number of wake cycles a buffered reading waits before triggering an upload
+extern const submit_mode_t UPLOAD_SUBMIT_MODE; //how the buffer is sent to the backend
+extern const size_t FLASH_DRAIN_BATCH; //readings sent from the flash queue per request
+extern const size_t FLASH_DRAIN_MAX_BATCHES; //max requests spent on the flash queue per wake
+extern const bool OVERLAP_SAMPLING; //sample while wifi connects on wakes that are expected to upload
+extern const uint32_t SAMPLING_TASK_STACK; //stack of the task sampling in the overlap mode
+extern const uint32_t TRACKER_TASK_STACK; //stack of the task started after a cold boot
 
+//running totals of the wake to sleep time, used to compare the overlap with sampling before connecting
+typedef struct {
+    uint32_t count;
+    uint64_t total_us;
+} wake_duration_stats_t;
+
+
+/**
+ * Starts the moisture_tracker task. app_main calls it after a cold boot
+ * @return returns ESP_OK, or ESP_FAIL if the task couldn't be created
+ */
+esp_err_t moisture_tracker_start();
+
+/**
+ * Task that runs wake cycles forever, deep sleeping between them
+ * @param pvParameters unused
+ */
 void moisture_tracker(void* pvParameters);
 
-#endif
\ No newline at end of file
+/**
+ * Runs wake cycles on the calling task, deep sleeping between them. app_main calls it directly on timer wakes
+ * so no task has to be created. on the esp32 deep sleep reboots the chip so it never returns
+ */
+void moisture_tracker_run();
+
+/**
+ * Runs one wake cycle: samples every plant, buffers the readings and uploads the buffer if it's due
+ * @return returns how long to deep sleep before the next wake, in microseconds
+ */
+uint64_t moisture_tracker_wake();
+
+/**
+ * connects to wifi and sends the buffered readings, see _send_buffered_readings
+ * @return returns ESP_OK if every buffered reading was accepted
+ */
+esp_err_t _upload_buffered_readings();
+
+/**
+ * drains the flash queue and uploads every reading in the rtc buffer, then disconnects. readings are only removed
+ * once the backend accepted them, the ones that couldn't be sent are moved to the flash queue. the wake timing
+ * summary and the raw capture go out with the first accepted request and are cleared once they did
+ * @param connected result of start_wifi_connection
+ * @return returns ESP_OK if every buffered reading was accepted
+ */
+esp_err_t _send_buffered_readings(esp_err_t connected);
+
+/**
+ * Guesses, before sampling, whether this wake will upload. used to decide if wifi should connect while sampling
+ * @param fill_level number of readings that triggers an upload
+ * @return returns true if a heartbeat is due or the buffer will be due once this wake's readings are added
+ */
+bool _upload_expected(size_t fill_level);
+
+/**
+ * Samples every plant's probe in one burst
+ * @param values set to each plant's reading, scaled by MOISTURE_SCALE
+ */
+void _sample_plants(int32_t* values);
+
+/**
+ * Task running _sample_plants during the overlap. notifies the waiting task when done and waits to be
+ * notified for the next overlap
+ * @param pvParameters unused
+ */
+void _sampling_task(void* pvParameters);
+
+/**
+ * Starts the sampling task (on the other core where there is one), or wakes it up if an earlier wake in the same
+ * boot started it, and connects to wifi on the calling task. then waits for the sampling to finish
+ * @param values set to each plant's reading, scaled by MOISTURE_SCALE
+ * @return returns the result of start_wifi_connection
+ */
+esp_err_t _sample_while_connecting(int32_t* values);
+
+/**
+ * Adds this wake's boot to sleep time to the totals of its boot path (full or timer wake) and logs both. the
+ * wake's time and its path's mean also go to the event log, timer wakes don't log info over the uart
+ */
+void _report_boot_to_sleep();
+
+/**
+ * Adds this wake's wake to sleep time to the totals of its mode and logs the mean of both
+ * @param overlapped true if the sampling overlapped the connection
+ */
+void _report_wake_duration(bool overlapped);
+
+/**
+ * Sends the flash queue oldest first, at most FLASH_DRAIN_MAX_BATCHES requests of FLASH_DRAIN_BATCH readings
+ * unless the backend asked for a flush
+ * @param summary see post_moisture_readings, shared with the requests that follow the drain
+ * @return returns ESP_OK unless a request or marking readings as sent failed
+ */
+esp_err_t _drain_flash_queue(bool* summary);
+
+/**
+ * Moves every reading of the rtc buffer to the flash queue so they survive power loss
+ */
+void _spill_to_flash_queue();
+
+#endif
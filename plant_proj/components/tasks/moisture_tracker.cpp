@@ -1,47 +1,395 @@
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include <esp_log.h>
-#include <esp_sleep.h>
-#include <esp_mac.h>
+#include <esp_attr.h>
 #include "wifi_handler.hpp"
 #include "moisture_sensor.hpp"
+#include "reading_buffer.hpp"
+#include "flash_queue.hpp"
+#include "leaf_config.hpp"
+#include "adaptive_sampling.hpp"
+#include "sleep_hal.hpp"
+#include "wake_timing.hpp"
+#include "event_log.hpp"
+#include "directives.hpp"
+#include "node_time.hpp"
+#include "mem_stats.hpp"
+#include "raw_capture.hpp"
+#include "static_alloc.hpp"
+#include "moisture_tracker.hpp"
 
-const uint64_t SLEEP_DURATION = 8000000; //8 million us or 8 s
-const int SAMPLE_SIZE = 10;
+const size_t UPLOAD_FILL_LEVEL = 8; //number of wakes worth of buffered readings that triggers an upload. set to 1 to upload on every wake
+const uint32_t UPLOAD_MAX_AGE_WAKES = 15; //max number of wakes a reading can wait in the buffer (~2 min at 8s)
+const submit_mode_t UPLOAD_SUBMIT_MODE = SUBMIT_BATCH; //send the whole buffer as one request
+const size_t FLASH_DRAIN_BATCH = 64; //readings sent from the flash queue per request
+const size_t FLASH_DRAIN_MAX_BATCHES = 8; //max requests spent on the flash queue per wake so a long outage doesn't drain the battery in one go
+const bool OVERLAP_SAMPLING = true; //sample in a second task while wifi connects on wakes that are expected to upload
+const uint32_t SAMPLING_TASK_STACK = 3072;
+const uint32_t TRACKER_TASK_STACK = 4096;
+
+//the sampling task runs on the core the wifi driver's task isn't pinned to
+#if CONFIG_FREERTOS_UNICORE
+#define SAMPLING_TASK_CORE tskNO_AFFINITY
+#elif CONFIG_ESP_WIFI_TASK_PINNED_TO_CORE_1
+#define SAMPLING_TASK_CORE 0
+#else
+#define SAMPLING_TASK_CORE 1
+#endif
 
 static const char* _logger = "Moisture Tracker *** "; //scope is restricted to this file via static keyword
 
+//counts wake cycles across deep sleep. used to tag readings and to age the buffer
+RTC_DATA_ATTR static uint32_t _wake_count = 0;
+
+//static so the batch doesn't live on the task's stack
+static reading_record_t _batch[READING_BUFFER_CAPACITY];
+
+//wake to sleep time of the wakes that uploaded, index 0 sampled before connecting, 1 overlapped the two
+RTC_DATA_ATTR static wake_duration_stats_t _upload_wake_stats[2];
+
+//boot to sleep time, index 0 is the full boot path (cold boot or reset), 1 the minimal timer wake path.
+//rtc memory is cleared on a cold boot so the full path only ever holds the last power on
+RTC_DATA_ATTR static wake_duration_stats_t _boot_path_stats[2];
+
+//handed to the sampling task
+static TaskHandle_t _sampling_caller = NULL;
+static int32_t* _sampling_values = NULL;
+static TaskHandle_t _sampling_handle = NULL; //kept between wakes, see _sampling_task
+
+//the task running the wake cycle, app_main's on timer wakes
+static mem_task_t _wake_task = MEM_TASK_MAIN;
+static uint32_t _wake_task_stack = CONFIG_ESP_MAIN_TASK_STACK_SIZE;
+
+//empty unless built with STATIC_ALLOCATION
+static static_task_t<TRACKER_TASK_STACK> _tracker_task_buffers;
+static static_task_t<SAMPLING_TASK_STACK> _sampling_task_buffers;
+
+esp_err_t moisture_tracker_start() {
+    if (!static_task_create(_tracker_task_buffers, moisture_tracker, "moisture_tracker", 5, NULL, tskNO_AFFINITY)) {
+        ESP_LOGE(_logger, "ERROR! Unable to start the moisture tracker task");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
 void moisture_tracker(void* pvParameters) {
+    ESP_LOGI(_logger, "*************Starting moisture Tracker task****************");
+    _wake_task = MEM_TASK_TRACKER;
+    _wake_task_stack = TRACKER_TASK_STACK;
+    moisture_tracker_run();
+}
+
+void moisture_tracker_run() {
+    //on the esp32 deep sleep reboots the chip so this loop only runs once per boot. on the linux target
+    //the fake deep sleep returns and the next wake cycle runs in the same process
+    while (true) {
+        uint64_t sleep_us = moisture_tracker_wake();
+
+        WAKE_TIMING_END();
+        mem_stats_record_task(_wake_task, NULL, _wake_task_stack);
+        mem_stats_log();
+        _report_boot_to_sleep();
+        EVENT_LOG_I(EVT_SLEEP, static_cast<int32_t>(sleep_us / 1000));
+
+        //the log only goes out over the uart if something asked for it
+        event_log_flush();
+        sleep_hal_deep_sleep(sleep_us);
+    }
+}
+
+uint64_t moisture_tracker_wake() {
 
     /*
     Procedure:
-    1. get a moisture reading
-    2. connect to wifi
-    3. send the moisture reading to the backend
-    4. disconnect form wifi
-    5. go into sleep to optimize power
+    1. get a moisture reading for every plant, stamp them with the time and append them to the rtc buffer.
+       if an upload is expected this wake, wifi connects while the sampling runs in a second task
+    2. if the buffer isn't due for an upload (or a heartbeat) go straight to sleep
+    3. connect to wifi (unless it already connected in step 1)
+    4. sync the clock if it's due, then send every buffered reading, for all plants, to the backend in one request
+    5. disconnect form wifi
+    6. go into sleep to optimize power. the interval depends on how fast the soil is changing, and grows
+       while wifi keeps failing
     */
 
-    ESP_LOGI(_logger, "*************Starting moisture Tracker task****************");
-    moisture_sensor_init(SAMPLE_SIZE);
-    double reading = get_moisture_val();
+    WAKE_TIMING_BEGIN();
+    event_log_begin_wake();
+    node_time_begin_wake();
+    _wake_count += 1;
+    EVENT_LOG_I(EVT_WAKE, _wake_count);
+
+    //the fill level counts wakes so a node with more plants doesn't upload more often
+    size_t fill_level = UPLOAD_FILL_LEVEL * leaf_info.plant_count;
+    if (fill_level > READING_BUFFER_CAPACITY) {
+        fill_level = READING_BUFFER_CAPACITY;
+    }
+
+    //when an upload is expected the radio is brought up first and the sampling happens while it associates,
+    //so the sampling time is hidden behind the connection instead of adding to the awake time
+    int32_t values[MAX_PLANTS];
+    bool overlapped = OVERLAP_SAMPLING && _upload_expected(fill_level);
+    esp_err_t connected = ESP_FAIL;
+    if (overlapped) {
+        EVENT_LOG_I(EVT_UPLOAD_OVERLAP);
+        connected = _sample_while_connecting(values);
+    } else {
+        _sample_plants(values);
+    }
+
+    //readings that barely changed since the last reported ones aren't worth the radio
+    sample_decision_t decision = adaptive_sampling_update(values, leaf_info.plant_count);
+    if (decision.report) {
+        //stamped with the time they were sampled at, however long they wait before going out
+        node_timestamp_t sampled_at = node_time_now();
+        for (size_t i = 0; i < leaf_info.plant_count; ++i) {
+            if (values[i] == MOISTURE_NO_READING) {
+                continue; //the probe wasn't sampled this wake
+            }
+            reading_record_t record = {
+                .wake_id = _wake_count,
+                .moisture = values[i],
+                .timestamp = sampled_at.epoch_s,
+                .time_error_s = sampled_at.error_s,
+                .plant_id = static_cast<uint8_t>(i),
+            };
+            reading_buffer_push(record);
+        }
+    }
+
+    bool attempted = true;
+    esp_err_t uploaded = ESP_FAIL;
+    if (overlapped) {
+        //the radio is already up so the buffer goes out even if it turned out not to be due
+        uploaded = _send_buffered_readings(connected);
+    } else if (decision.heartbeat || reading_buffer_should_flush(_wake_count, fill_level, UPLOAD_MAX_AGE_WAKES)) {
+        uploaded = _upload_buffered_readings();
+    } else {
+        EVENT_LOG_I(EVT_UPLOAD_SKIPPED);
+        attempted = false;
+    }
+
+    if (uploaded == ESP_OK) {
+        adaptive_sampling_mark_uploaded();
+    }
+    if (attempted) {
+        _report_wake_duration(overlapped);
+
+        //the backend may have changed the sleep interval in its response, it applies to this sleep already.
+        //a new sample size is picked up by the next wake's sampling
+        decision.next_sleep_us = adaptive_sampling_reclamp(decision.next_sleep_us);
+    }
+
+    //sleeps longer while the access point can't be reached
+    uint64_t sleep_us = wifi_backoff_sleep_us(decision.next_sleep_us);
+    adaptive_sampling_slept(sleep_us);
+    return sleep_us;
+}
+
+bool _upload_expected(size_t fill_level) {
+    if (adaptive_sampling_heartbeat_due()) {
+        return true;
+    }
+
+    //assumes this wake's readings get reported. if they're dropped by the deadband the buffer still goes out a
+    //bit early, which costs less than connecting after sampling
+    size_t expected_fill = (fill_level > leaf_info.plant_count) ? fill_level - leaf_info.plant_count : 1;
+    return reading_buffer_flush_due(_wake_count, expected_fill, UPLOAD_MAX_AGE_WAKES);
+}
+
+void _sample_plants(int32_t* values) {
+    //every plant's probe is sampled in the same burst
+    uint8_t channels[MAX_PLANTS];
+    for (size_t i = 0; i < leaf_info.plant_count; ++i) {
+        channels[i] = leaf_info.plants[i].adc_channel;
+    }
+    moisture_sensor_init(leaf_settings.sample_size, channels, leaf_info.plant_count);
+    WAKE_TIMING_MARK(WAKE_PHASE_SENSOR_INIT);
+
+    get_moisture_values(MOISTURE_SCALE, values);
+    RAW_CAPTURE_TAKE(); //before the sensor's buffers are reused
+    WAKE_TIMING_MARK(WAKE_PHASE_SAMPLED);
+}
+
+void _sampling_task(void* pvParameters) {
+    //waits for the next overlap instead of deleting itself. on the esp32 that's the next boot, on the linux
+    //target the next wake reuses the task, which a task in static buffers can't be recreated in
+    while (true) {
+        _sample_plants(_sampling_values);
+        mem_stats_record_task(MEM_TASK_SAMPLING, NULL, SAMPLING_TASK_STACK);
 
-    ESP_LOGI(_logger, "Starting wifi connection");
-    if (start_wifi_connection() != ESP_OK) {
-        ESP_LOGE(_logger, "Encountered an Error when Starting WIFI");
+        //wakes up _sample_while_connecting, which is waiting on the join
+        xTaskNotifyGive(_sampling_caller);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
     }
+}
+
+esp_err_t _sample_while_connecting(int32_t* values) {
+    /*
+    ADC1 is the only unit that can be used while wifi is running (the driver takes ADC2 for itself) and the hal
+    only ever drives ADC1, so the burst can run during association. noise coupled in from tx bursts shows up as
+    outliers in the burst, which is what the robust filters of moisture_filter.hpp are for.
+    with the overlap the wake timing phases complete out of order, the ones that finished during the other
+    task's phase are recorded as 0 and the total stays correct
+    */
+    _sampling_caller = xTaskGetCurrentTaskHandle();
+    _sampling_values = values;
 
-    ESP_LOGI(_logger, "Attempting to POST moisture reading");
-    if (post_moisture_reading(reading) != ESP_OK) {
-        ESP_LOGE(_logger, "Encountered an Error when POSTING moisture reading");
+    if (_sampling_handle != NULL) {
+        xTaskNotifyGive(_sampling_handle);
+    } else if (!static_task_create(_sampling_task_buffers, _sampling_task, "sampling", uxTaskPriorityGet(NULL), &_sampling_handle, SAMPLING_TASK_CORE)) {
+        _sampling_handle = NULL;
+        ESP_LOGW(_logger, "WARNING! Unable to start the sampling task, sampling before connecting");
+        _sample_plants(values);
+        return start_wifi_connection();
+    }
+
+    esp_err_t res = start_wifi_connection();
+
+    //joins the sampling task, its readings are needed before anything is sent
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    return res;
+}
+
+void _report_boot_to_sleep() {
+    //the esp timer starts after the bootloader so the time spent there isn't included
+    int64_t duration = sleep_hal_time_us();
+    bool timer_wake = sleep_hal_woke_from_timer();
+    wake_duration_stats_t& stats = _boot_path_stats[timer_wake ? 1 : 0];
+    stats.count += 1;
+    stats.total_us += (duration > 0) ? static_cast<uint64_t>(duration) : 0;
+
+    const wake_duration_stats_t& full = _boot_path_stats[0];
+    const wake_duration_stats_t& minimal = _boot_path_stats[1];
+
+    //timer wakes only log warnings over the uart, the event log keeps their half of the comparison
+    int32_t duration_ms = static_cast<int32_t>(duration / 1000);
+    if (timer_wake) {
+        EVENT_LOG_I(EVT_BOOT_TO_SLEEP_TIMER, duration_ms, static_cast<int32_t>(minimal.total_us / minimal.count / 1000));
+    } else {
+        EVENT_LOG_I(EVT_BOOT_TO_SLEEP_FULL, duration_ms);
+    }
+
+    ESP_LOGI(_logger, "Boot to sleep: full boot %llu ms (last power on), timer wake mean %llu ms over %u wakes",
+        static_cast<unsigned long long>(full.count > 0 ? full.total_us / full.count / 1000 : 0),
+        static_cast<unsigned long long>(minimal.count > 0 ? minimal.total_us / minimal.count / 1000 : 0),
+        static_cast<unsigned>(minimal.count));
+}
+
+void _report_wake_duration(bool overlapped) {
+    int64_t duration = sleep_hal_time_us();
+    wake_duration_stats_t& stats = _upload_wake_stats[overlapped ? 1 : 0];
+    stats.count += 1;
+    stats.total_us += (duration > 0) ? static_cast<uint64_t>(duration) : 0;
+
+    ESP_LOGI(_logger, "%s upload wake took %lld ms",
+        overlapped ? "Overlapped" : "Sequential", static_cast<long long>(duration / 1000));
+    for (size_t i = 0; i < 2; ++i) {
+        if (_upload_wake_stats[i].count > 0) {
+            ESP_LOGI(_logger, "  %s: mean %llu ms over %u wakes", i == 1 ? "overlapped" : "sequential",
+                static_cast<unsigned long long>(_upload_wake_stats[i].total_us / _upload_wake_stats[i].count / 1000),
+                static_cast<unsigned>(_upload_wake_stats[i].count));
+        }
+    }
+}
+
+esp_err_t _upload_buffered_readings() {
+    return _send_buffered_readings(start_wifi_connection());
+}
+
+esp_err_t _send_buffered_readings(esp_err_t connected) {
+    esp_err_t ret = ESP_FAIL;
+    bool summary = true; //goes out once, with whichever request of the upload is accepted first
+
+    //the clock is only synced on wakes that have the radio up anyway. a failed sync doesn't hold the upload back
+    if (connected == ESP_OK && node_time_sync_due()) {
+        node_time_sync();
+    }
+
+    if (connected != ESP_OK) {
+        ESP_LOGE(_logger, "Encountered an Error when Starting WIFI. Moving readings to flash for the next upload");
+        _spill_to_flash_queue();
+    } else if (_drain_flash_queue(&summary) != ESP_OK) {
+        //the backlog goes out first so the backend gets readings in order
+        ESP_LOGE(_logger, "Encountered an Error when draining the flash queue. Moving readings to flash for the next upload");
+        _spill_to_flash_queue();
+    } else {
+        size_t count = reading_buffer_peek(_batch, READING_BUFFER_CAPACITY);
+
+        ESP_LOGI(_logger, "Attempting to POST %u buffered moisture readings", static_cast<unsigned>(count));
+        size_t accepted = 0;
+        if (post_moisture_readings(_batch, count, UPLOAD_SUBMIT_MODE, &accepted, &summary) != ESP_OK) {
+            ESP_LOGE(_logger, "Encountered an Error when POSTING moisture readings. Moving %u readings to flash for the next upload",
+                static_cast<unsigned>(count - accepted));
+        } else {
+            ret = ESP_OK;
+        }
+
+        //readings are only removed once the backend has accepted them
+        reading_buffer_discard(accepted);
+        if (ret != ESP_OK) {
+            _spill_to_flash_queue();
+        }
     }
 
-    ESP_LOGI(_logger, "Disconnecting from wifi");
     if (stop_wifi_connection() != ESP_OK) {
         ESP_LOGE(_logger, "Encountered an Error when stoping WIFI");
     }
 
-    ESP_LOGI(_logger, "Entering Deep Sleep");
-    esp_sleep_enable_timer_wakeup(SLEEP_DURATION);
-    esp_deep_sleep_start();
+    //even if a later request failed, the backend already has the summary
+    if (!summary) {
+        WAKE_TIMING_RESET();
+        RAW_CAPTURE_CLEAR();
+    }
+
+    flash_queue_stats_t stats = flash_queue_stats();
+    ESP_LOGI(_logger, "Flash queue: %u/%u queued, %u appended, %u drained, %u dropped, %u sector erases",
+        static_cast<unsigned>(stats.depth), static_cast<unsigned>(stats.capacity), static_cast<unsigned>(stats.appended),
+        static_cast<unsigned>(stats.drained), static_cast<unsigned>(stats.dropped), static_cast<unsigned>(stats.sector_erases));
+
+    return ret;
+}
+
+esp_err_t _drain_flash_queue(bool* summary) {
+    //a flush directive from the backend lifts the limit until the queue is empty. it can arrive with any
+    //response of the drain so it's checked on every batch
+    for (size_t i = 0; i < FLASH_DRAIN_MAX_BATCHES || directives_flush_pending(); ++i) {
+        size_t count = flash_queue_peek(_batch, FLASH_DRAIN_BATCH);
+        if (count == 0) {
+            directives_flush_done();
+            return ESP_OK;
+        }
+
+        ESP_LOGI(_logger, "Attempting to POST %u readings from the flash queue", static_cast<unsigned>(count));
+        size_t accepted = 0;
+        esp_err_t res = post_moisture_readings(_batch, count, UPLOAD_SUBMIT_MODE, &accepted, summary);
+
+        //marked as sent before anything else so an accepted reading is only sent again if the node resets first
+        if (accepted > 0 && flash_queue_commit(accepted) != ESP_OK) {
+            return ESP_FAIL;
+        }
+        if (res != ESP_OK) {
+            return res;
+        }
+    }
 
+    //the rest of the backlog waits for the next upload, the rtc buffer still goes out now
+    ESP_LOGW(_logger, "WARNING! %u readings still queued in flash", static_cast<unsigned>(flash_queue_depth()));
+    return ESP_OK;
 }
 
+void _spill_to_flash_queue() {
+    size_t count = reading_buffer_peek(_batch, READING_BUFFER_CAPACITY);
+
+    //only called when an upload failed. as an error it also gets the event log dumped at the end of the wake
+    EVENT_LOG_E(EVT_UPLOAD_FAILED, static_cast<int32_t>(count));
+    if (count == 0) {
+        return;
+    }
+
+    //readings the flash couldn't take stay in the rtc buffer. the ones it did take leave it even on an error
+    //so they aren't sent twice
+    size_t stored = 0;
+    if (flash_queue_append(_batch, count, &stored) != ESP_OK) {
+        ESP_LOGE(_logger, "Encountered an Error when moving readings to flash. Keeping %u in rtc memory", static_cast<unsigned>(count - stored));
+    }
+    reading_buffer_discard(stored);
+}
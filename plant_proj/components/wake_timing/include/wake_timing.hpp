@@ -0,0 +1,98 @@
+#ifndef WAKE_TIMING_HPP
+#define WAKE_TIMING_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Per phase timing of the wake cycle. a monotonic timestamp is taken at each phase boundary and, when the
+ * node goes back to sleep, the time spent in every phase is added to min/max/mean totals and a coarse
+ * histogram kept in rtc memory. the summary is attached to uploads so latency can be compared across nodes
+ *
+ * the marks go through the WAKE_TIMING_* macros so building with WAKE_TIMING_ENABLED=0 removes the calls,
+ * the rtc state and the payload field entirely
+ */
+
+#ifndef WAKE_TIMING_ENABLED
+#define WAKE_TIMING_ENABLED 1
+#endif
+
+//phase boundaries in the order they happen. a phase's duration is measured from the previous boundary that
+//was reached, wakes that skip the upload go straight from WAKE_PHASE_SAMPLED to WAKE_PHASE_SLEEP
+typedef enum {
+    WAKE_PHASE_BOOT, //task started, measured from reset
+    WAKE_PHASE_SENSOR_INIT, //adc configured
+    WAKE_PHASE_SAMPLED, //every plant sampled and filtered
+    WAKE_PHASE_WIFI_STARTED, //radio started, association begins
+    WAKE_PHASE_GOT_IP, //associated and ip assigned
+    WAKE_PHASE_REQUEST_SENT, //first request's headers sent
+    WAKE_PHASE_RESPONSE, //first response's headers received
+    WAKE_PHASE_SLEEP, //about to enter deep sleep
+    WAKE_PHASE_COUNT
+} wake_phase_t;
+
+//histogram buckets grow by 4x: <1ms, <4ms, <16ms, <64ms, <256ms, <1s, <4s, >=4s
+#define WAKE_TIMING_BUCKETS 8
+
+typedef struct {
+    uint32_t count; //number of wakes that reached this phase
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t total_us; //mean is total_us / count
+    uint16_t histogram[WAKE_TIMING_BUCKETS]; //saturates at UINT16_MAX
+} wake_phase_stats_t;
+
+#if WAKE_TIMING_ENABLED
+
+extern const char* const WAKE_PHASE_NAMES[WAKE_PHASE_COUNT]; //short names used in logs and as keys in the summary
+
+#define WAKE_TIMING_BEGIN() wake_timing_begin()
+#define WAKE_TIMING_MARK(phase) wake_timing_mark(phase)
+#define WAKE_TIMING_END() wake_timing_end()
+#define WAKE_TIMING_RESET() wake_timing_reset()
+#define WAKE_TIMING_STATS() wake_timing_stats()
+
+/**
+ * clears the previous wake's marks and marks WAKE_PHASE_BOOT. called first thing in the wake cycle
+ */
+void wake_timing_begin();
+
+/**
+ * records the time a phase boundary was reached. only the first mark of a phase per wake is kept, so
+ * phases that repeat (ie several requests) measure the first occurrence
+ * @param phase the boundary that was reached
+ */
+void wake_timing_mark(wake_phase_t phase);
+
+/**
+ * marks WAKE_PHASE_SLEEP and adds the duration of every phase reached this wake to the rtc totals
+ */
+void wake_timing_end();
+
+/**
+ * clears the rtc totals. called once a summary was uploaded
+ */
+void wake_timing_reset();
+
+/**
+ * @return returns the totals of every phase, indexed by wake_phase_t
+ */
+const wake_phase_stats_t* wake_timing_stats();
+
+/**
+ * @param duration_us time spent in a phase
+ * @return returns the histogram bucket the duration falls in
+ */
+size_t _wake_timing_bucket(uint32_t duration_us);
+
+#else
+
+#define WAKE_TIMING_BEGIN() ((void)0)
+#define WAKE_TIMING_MARK(phase) ((void)0)
+#define WAKE_TIMING_END() ((void)0)
+#define WAKE_TIMING_RESET() ((void)0)
+#define WAKE_TIMING_STATS() (static_cast<const wake_phase_stats_t*>(NULL))
+
+#endif
+
+#endif
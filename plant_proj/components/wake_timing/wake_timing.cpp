@@ -0,0 +1,91 @@
+#include <esp_attr.h>
+#include <string.h>
+#include "sleep_hal.hpp"
+#include "wake_timing.hpp"
+#include "event_log.hpp"
+
+#if WAKE_TIMING_ENABLED
+
+//short names used in the logs and as keys in the uploaded summary
+const char* const WAKE_PHASE_NAMES[WAKE_PHASE_COUNT] = {
+    "boot", "sensor_init", "sampling", "wifi_start", "got_ip", "request", "response", "sleep"
+};
+
+//timestamps of the current wake, 0 if the boundary wasn't reached. boot is measured from reset so its
+//timestamp is never 0
+static int64_t _marks[WAKE_PHASE_COUNT];
+
+//totals since the last upload
+RTC_DATA_ATTR static wake_phase_stats_t _stats[WAKE_PHASE_COUNT];
+
+void wake_timing_begin() {
+    memset(_marks, 0, sizeof(_marks));
+    wake_timing_mark(WAKE_PHASE_BOOT);
+}
+
+void wake_timing_mark(wake_phase_t phase) {
+    if (_marks[phase] == 0) {
+        int64_t now = sleep_hal_time_us();
+        _marks[phase] = now > 0 ? now : 1;
+    }
+}
+
+void wake_timing_end() {
+    wake_timing_mark(WAKE_PHASE_SLEEP);
+
+    int64_t prev = 0;
+    for (size_t i = 0; i < WAKE_PHASE_COUNT; ++i) {
+        if (_marks[i] == 0) {
+            continue;
+        }
+
+        int64_t elapsed = _marks[i] - prev;
+        prev = _marks[i];
+        uint32_t duration = 0;
+        if (elapsed > static_cast<int64_t>(UINT32_MAX)) {
+            duration = UINT32_MAX;
+        } else if (elapsed > 0) {
+            duration = static_cast<uint32_t>(elapsed);
+        }
+
+        wake_phase_stats_t& stats = _stats[i];
+        if (stats.count == 0 || duration < stats.min_us) {
+            stats.min_us = duration;
+        }
+        if (duration > stats.max_us) {
+            stats.max_us = duration;
+        }
+        stats.count += 1;
+        stats.total_us += duration;
+
+        uint16_t& bucket = stats.histogram[_wake_timing_bucket(duration)];
+        if (bucket < UINT16_MAX) {
+            bucket += 1;
+        }
+
+        EVENT_LOG_D(EVT_PHASE, static_cast<int32_t>(i), static_cast<int32_t>(duration));
+    }
+}
+
+void wake_timing_reset() {
+    memset(_stats, 0, sizeof(_stats));
+}
+
+const wake_phase_stats_t* wake_timing_stats() {
+    return _stats;
+}
+
+size_t _wake_timing_bucket(uint32_t duration_us) {
+    uint32_t ms = duration_us / 1000;
+    uint32_t limit = 1;
+    size_t bucket = 0;
+
+    while (bucket < WAKE_TIMING_BUCKETS - 1 && ms >= limit) {
+        limit <<= 2;
+        bucket += 1;
+    }
+
+    return bucket;
+}
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef HTTP_TRANSPORT_HPP
+#define HTTP_TRANSPORT_HPP
+
+#include <stddef.h>
+#include <esp_err.h>
+#include "uplink_transport.hpp"
+
+/**
+ * Thin interface over the http client used to reach the backend. the esp implementation keeps one
+ * esp_http_client alive while wifi is up, the linux implementation talks plain http over a posix socket
+ * to a local stand-in server (tools/stand_in_server.py). the uploader reaches it through HTTP_UPLINK
+ */
+
+/**
+ * Performs a POST request to the submit reading route, reusing the open connection if there is one
+ *
+ * @param payload body of the request
+ * @param len length of payload
+ * @param content_type format of the payload. the backend picks its decoder from it
+ * @return returns ESP_OK if the request was performed and the backend responded with a 2xx status
+ */
+esp_err_t http_transport_post(const char* payload, size_t len, const char* content_type);
+
+/**
+ * Closes the connection and frees the client. called when the network goes down
+ */
+void http_transport_release();
+
+/**
+ * @return returns the bytes the calling thread wrote and read, headers included. zero on the esp32
+ */
+uplink_traffic_t http_transport_traffic();
+
+#endif
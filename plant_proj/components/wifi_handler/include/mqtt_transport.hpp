@@ -0,0 +1,60 @@
+#ifndef MQTT_TRANSPORT_HPP
+#define MQTT_TRANSPORT_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_err.h>
+#include "uplink_transport.hpp"
+
+/**
+ * MQTT client used to reach the backend's broker. the node connects as leaf-<node_id> with the clean session
+ * flag cleared, so the broker keeps its session (subscriptions, unacknowledged QoS 1 messages) while it sleeps
+ * and a reconnect doesn't have to set anything up again. every reading is published on its own topic,
+ * <MQTT_TOPIC_PREFIX>/<node_id>/<plant_id>, so the backend can subscribe per plant. the payload is the same
+ * json or binary body the http transport POSTs, a binary one starts with its version byte and a json one with {
+ *
+ * the esp implementation uses esp-mqtt with the broker on the backend's host (the cached address on the fast
+ * path), the linux implementation is a minimal MQTT 3.1.1 client over a posix socket to a local stand-in
+ * broker (tools/stand_in_broker.py)
+ */
+
+extern const uint16_t MQTT_BROKER_PORT;
+extern const char* MQTT_TOPIC_PREFIX;
+extern const int MQTT_QOS; //0 sends and forgets, 1 waits for the broker's PUBACK before a reading counts as sent
+extern const uint16_t MQTT_KEEPALIVE_S;
+
+/**
+ * Publishes a message with MQTT_QOS, connecting first if there's no connection. used by MQTT_UPLINK
+ * @param message payload, node and plant it's published for
+ * @return returns ESP_OK once the message was sent (QoS 0) or acknowledged (QoS 1)
+ */
+esp_err_t mqtt_transport_send(const uplink_message_t& message);
+
+/**
+ * Publishes a message
+ * @param message payload, node and plant it's published for
+ * @param qos 0 or 1
+ * @return returns ESP_OK once the message was sent (QoS 0) or acknowledged (QoS 1)
+ */
+esp_err_t mqtt_transport_publish(const uplink_message_t& message, int qos);
+
+/**
+ * Disconnects from the broker and frees the client. called when the network goes down
+ */
+void mqtt_transport_release();
+
+/**
+ * @return returns the bytes the calling thread wrote and read, packet headers included. zero on the esp32
+ */
+uplink_traffic_t mqtt_transport_traffic();
+
+/**
+ * Writes the topic of a message
+ * @param buff destination, null terminated
+ * @param len size of buff
+ * @param message message to publish
+ * @return returns the length of the topic, or 0 if it doesn't fit
+ */
+size_t _mqtt_topic(char* buff, size_t len, const uplink_message_t& message);
+
+#endif
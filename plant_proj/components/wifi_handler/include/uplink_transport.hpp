@@ -0,0 +1,73 @@
+#ifndef UPLINK_TRANSPORT_HPP
+#define UPLINK_TRANSPORT_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_err.h>
+
+/**
+ * Interface the uploader sends its payloads through, so the protocol the readings travel over can be swapped
+ * without touching the encoding or the retry logic. UPLINK_TRANSPORT picks the implementation:
+ *
+ * - HTTP_UPLINK POSTs every payload to the submit reading route (http_transport.hpp). batches of readings
+ *   go out as one request and the response can carry directives (directives.hpp)
+ * - MQTT_UPLINK publishes every reading as its own message on <MQTT_TOPIC_PREFIX>/<node_id>/<plant_id>
+ *   (mqtt_transport.hpp). the session is persistent so the broker keeps it across deep sleeps
+ *
+ * both keep their connection open until release is called when the network goes down
+ */
+
+//protocol the readings are sent over
+typedef enum {
+    UPLINK_HTTP,
+    UPLINK_MQTT,
+} uplink_kind_t;
+
+//one payload and the ids the transport addresses it with
+typedef struct {
+    const char* payload;
+    size_t len;
+    const char* content_type; //format of the payload, see PAYLOAD_FORMAT
+    uint32_t node_id; //node that sampled the readings
+    uint8_t plant_id; //plant of the readings. only meaningful if the transport is per_reading
+} uplink_message_t;
+
+//bytes the transport wrote and read on its connections, protocol overhead included. tcp/ip headers aren't counted
+typedef struct {
+    uint64_t bytes_sent;
+    uint64_t bytes_received;
+} uplink_traffic_t;
+
+typedef struct {
+    const char* name;
+    bool per_reading; //true if every message has to hold the readings of a single plant
+
+    /**
+     * Sends a message, opening the connection if it isn't open yet
+     * @param message payload to send
+     * @return returns ESP_OK once the backend accepted the message
+     */
+    esp_err_t (*send)(const uplink_message_t& message);
+
+    /**
+     * Closes the connection. called when the network goes down
+     */
+    void (*release)();
+
+    /**
+     * @return returns the traffic of the calling thread since it started, zero on the esp32 where the clients
+     * don't expose their byte counts. used by tools/fleet_sim to compare the transports
+     */
+    uplink_traffic_t (*traffic)();
+} uplink_transport_t;
+
+extern const uplink_kind_t UPLINK_TRANSPORT;
+extern const uplink_transport_t HTTP_UPLINK;
+extern const uplink_transport_t MQTT_UPLINK;
+
+/**
+ * @return returns the transport selected by UPLINK_TRANSPORT
+ */
+const uplink_transport_t& uplink_transport();
+
+#endif
@@ -1,47 +1,68 @@
 #ifndef WIFI_HANDLER_HPP
 #define WIFI_HANDLER_HPP
 
-#include <freertos/FreeRTOS.h>
-#include <esp_event.h> //gives us esp_event_base_t type
-#include <freertos/event_groups.h> //gives EventGroupHandle_t type
-#include <esp_bit_defs.h>
-#include <string>
-#include <esp_http_client.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_err.h>
+#include "reading_buffer.hpp"
 
-typedef struct {
-    EventGroupHandle_t wan_event_group;
-    int GOT_IP_BIT;
-} events_data_t;
+/**
+ * Network side of the node: bringing the connection up and down and sending readings to the backend.
+ * on the esp32 the connection is wifi (wifi_handler.cpp), on the linux target it's the host's own network
+ * (linux/wifi_handler_linux.cpp). payloads go through the transport selected by UPLINK_TRANSPORT, see
+ * uplink_transport.hpp
+ */
+
+//how post_moisture_readings sends a group of readings
+typedef enum {
+    SUBMIT_BATCH, //every reading in one request, split only if it doesn't fit in the payload buffer
+    SUBMIT_PER_READING, //one request per reading, back to back over the same connection
+} submit_mode_t;
+
+//encoding of the request bodies
+typedef enum {
+    PAYLOAD_JSON, //see json_encoder.hpp
+    PAYLOAD_BINARY, //packed records, see binary_encoder.hpp
+} payload_format_t;
 
-extern events_data_t wifi_events;
-extern const int HTTP_BUFF_LEN;
-extern const char* SERVER_URL;
 extern const char* SUBMIT_READING_ROUTE;
 extern const int POST_TIMEOUT;
-extern const int WIFI_CONNECTION_TIMEOUT;
+extern const size_t PAYLOAD_BUFFER_LEN;
+extern const payload_format_t PAYLOAD_FORMAT;
+extern const uint32_t WIFI_BACKOFF_MAX_SHIFT; //sleep grows up to 2^WIFI_BACKOFF_MAX_SHIFT times after failed connections
 
 /**
- * Sends a moisture reading to the backend db
- * 
- * @param reading the moisture reading value to be sent
- * @return returns ESP_OK or ESP_FAIL
+ * Sends a group of buffered moisture readings to the backend db. every request goes through the
+ * same long lived client so the tcp connection is reused between requests
+ *
+ * @param records array of readings, oldest first
+ * @param count number of readings in records
+ * @param mode SUBMIT_BATCH sends as few requests as fit in the payload buffer, SUBMIT_PER_READING sends one request per reading.
+ * a per_reading transport always sends one message per reading
+ * @param accepted (optional) set to the number of readings, from the start of records, the backend accepted
+ * @param summary (optional) true while the wake timing and memory summaries and the raw capture still have to go out.
+ * they're attached to the next request and this is cleared once the backend accepted it. NULL sends no summary
+ * @return returns ESP_OK if the backend accepted every reading, ESP_FAIL otherwise
  */
-esp_err_t post_moisture_reading(const double reading);
+esp_err_t post_moisture_readings(const reading_record_t* records, size_t count, submit_mode_t mode, size_t* accepted, bool* summary);
 
 /**
- * Set up function for creating wifi events loop and group. in addition this function sets
- * up the wifi and ip event handlers
+ * Registers http event handler and starts the wifi connection. on timer wakes the fast reconnect cache
+ * is used if it's valid, falling back to a full scan and DHCP if the fast path fails
  * 
- * @return returns an esp_err_t value. if everything went well that value is ESP_OK
+ * @return returns esp_ok if everything was successful
  */
-esp_err_t wan_event_handler_setup();
+esp_err_t start_wifi_connection();
 
 /**
- * Registers http event handler and starts the wifi connection
- * 
- * @return returns esp_ok if everything was successful
+ * Lengthens a sleep after failed connections so a node that can't reach its access point doesn't keep
+ * waking up to fail again. every consecutive failed start_wifi_connection doubles the sleep, up to
+ * WIFI_BACKOFF_MAX_SHIFT times. the failure count is kept in rtc memory and reset by a successful connection
+ *
+ * @param sleep_us sleep the node would do otherwise
+ * @return returns the sleep to do, in microseconds
  */
-esp_err_t start_wifi_connection();
+uint64_t wifi_backoff_sleep_us(uint64_t sleep_us);
 
 /**
  * Stops the wifi connection
@@ -49,57 +70,19 @@ esp_err_t start_wifi_connection();
  */
 esp_err_t stop_wifi_connection();
 
-/** 
-* Handler for Wifi events
-* 
-* @param arg pointer to the event source
-* @param event_base event base associated with the event
-* @param event_id Id of the event
-* @param event_data data associated with the event
-*/
-void wifi_event_handler(
-    void* arg,
-    esp_event_base_t event_base,
-    int32_t event_id,
-    void* event_data //will be NULL
-);
-
-/** 
-* Handler for IP events
-* 
-* @param arg pointer to the event source
-* @param event_base event base associated with the event
-* @param event_id Id of the event
-* @param event_data data associated with the event
-*/
-void ip_event_handler(
-    void* arg,
-    esp_event_base_t event_base,
-    int32_t event_id,
-    void* event_data //will be NULL
-);
-
-/**
-* Handler for http events
-* @param event http event object
-* @return esp_err_t returns ESP_OK on success, ESP_FAIL if an error occured, ESP_ERR_INVALID_RESPONSE if event id in event object is invalid
-* 
-*/
-esp_err_t http_event_handler(esp_http_client_event_t* event);
-
 /**
- * returns the mininum of 2 numbers
- * @param n1 first number
- * @param n2 2nd number
+ * Encodes readings into the payload buffer in PAYLOAD_FORMAT
+ *
+ * @param records array of readings
+ * @param count number of readings in records
+ * @param with_summary true to attach the wake timing and memory summaries and the raw capture (sent once per upload)
+ * @return returns the length of the payload, or 0 if it didn't fit in the buffer
  */
-int _min(int n1, int n2);
+size_t _encode_readings(const reading_record_t* records, size_t count, bool with_summary);
 
 /**
- * Converts the moisture value to a json format
- * 
- * @param value the moisture value
- * @return returns a json string
+ * @return returns the content type of PAYLOAD_FORMAT
  */
-const std::string _to_json(const double value);
+const char* _payload_content_type();
 
-#endif
\ No newline at end of file
+#endif
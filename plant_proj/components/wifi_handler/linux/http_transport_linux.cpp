@@ -0,0 +1,197 @@
+#include <esp_log.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <algorithm>
+#include "http_transport.hpp"
+#include "wifi_handler.hpp"
+#include "wake_timing.hpp"
+#include "directives.hpp"
+
+/**
+ * Minimal http/1.1 client over a posix socket for the linux target. the connection is kept alive between
+ * requests like the esp_http_client one on the device. requests go to a local stand-in server instead of
+ * the configured server url (see tools/stand_in_server.py)
+ */
+
+static const char* LOCAL_SERVER_HOST = "127.0.0.1";
+static const uint16_t LOCAL_SERVER_PORT = 8080;
+static const size_t RESPONSE_BUFF_LEN = 1024;
+
+static const char* _logger = "HTTP Transport (host) *** ";
+//kept alive between requests. thread local so every thread of a host program (ie tools/fleet_sim) acts
+//as a separate node with its own connection
+static thread_local int _sock = -1;
+static thread_local uplink_traffic_t _traffic = {0, 0};
+
+static esp_err_t _open_connection() {
+    _sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (_sock < 0) {
+        ESP_LOGE(_logger, "ERROR! Unable to create socket");
+        return ESP_FAIL;
+    }
+
+    //requests are small, don't let nagle hold them back
+    int one = 1;
+    setsockopt(_sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    struct timeval timeout = {
+        .tv_sec = POST_TIMEOUT / 1000,
+        .tv_usec = (POST_TIMEOUT % 1000) * 1000,
+    };
+    setsockopt(_sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(_sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(LOCAL_SERVER_PORT);
+    inet_pton(AF_INET, LOCAL_SERVER_HOST, &addr.sin_addr);
+
+    if (connect(_sock, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ESP_LOGE(_logger, "ERROR! Unable to connect to %s:%u", LOCAL_SERVER_HOST, LOCAL_SERVER_PORT);
+        http_transport_release();
+        return ESP_FAIL;
+    }
+
+    return ESP_OK;
+}
+
+static bool _send_all(const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(_sock, data, len, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        _traffic.bytes_sent += n;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+//reads one response. returns its status code, or -1 if the connection failed
+static int _read_response(bool* keep_alive) {
+    char buff[RESPONSE_BUFF_LEN];
+    size_t len = 0;
+    char* body = NULL;
+
+    //reads until the end of the headers
+    while (body == NULL) {
+        if (len == sizeof(buff) - 1) {
+            return -1; //headers don't fit
+        }
+
+        ssize_t n = recv(_sock, buff + len, sizeof(buff) - 1 - len, 0);
+        if (n <= 0) {
+            return -1;
+        }
+        _traffic.bytes_received += n;
+        len += n;
+        buff[len] = '\0';
+        body = strstr(buff, "\r\n\r\n");
+    }
+    body += 4;
+
+    int status = -1;
+    if (sscanf(buff, "HTTP/1.%*d %d", &status) != 1) {
+        return -1;
+    }
+
+    //the body is handed to the directives parser as it's read, and read entirely so the next response starts
+    //at the right place
+    size_t content_length = 0;
+    *keep_alive = true;
+    for (char* line = strstr(buff, "\r\n"); line != NULL && line + 2 < body; line = strstr(line + 2, "\r\n")) {
+        if (strncasecmp(line + 2, "Content-Length:", 15) == 0) {
+            content_length = strtoul(line + 2 + 15, NULL, 10);
+        } else if (strncasecmp(line + 2, "Connection: close", 17) == 0) {
+            *keep_alive = false;
+        }
+    }
+
+    DIRECTIVES_BEGIN_RESPONSE();
+    size_t body_read = len - (body - buff);
+    DIRECTIVES_FEED(body, body_read < content_length ? body_read : content_length);
+    while (body_read < content_length) {
+        ssize_t n = recv(_sock, buff, sizeof(buff), 0);
+        if (n <= 0) {
+            return -1;
+        }
+        _traffic.bytes_received += n;
+        DIRECTIVES_FEED(buff, std::min(static_cast<size_t>(n), content_length - body_read));
+        body_read += n;
+    }
+    DIRECTIVES_END_RESPONSE(status >= 200 && status < 300);
+
+    return status;
+}
+
+esp_err_t http_transport_post(const char* payload, size_t len, const char* content_type) {
+    char header[256];
+    int header_len = snprintf(header, sizeof(header),
+        "POST %s HTTP/1.1\r\n"
+        "Host: %s:%u\r\n"
+        "Content-Type: %s\r\n"
+        "Content-Length: %u\r\n"
+        "Connection: keep-alive\r\n"
+        "\r\n",
+        SUBMIT_READING_ROUTE, LOCAL_SERVER_HOST, LOCAL_SERVER_PORT, content_type, static_cast<unsigned>(len));
+
+    //a kept alive connection may have been closed by the server while idle, in that case the request
+    //is retried once on a fresh connection
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        bool reused = (_sock >= 0);
+        if (!reused && _open_connection() != ESP_OK) {
+            return ESP_FAIL;
+        }
+
+        bool keep_alive = false;
+        int status = -1;
+        if (_send_all(header, header_len) && _send_all(payload, len)) {
+            WAKE_TIMING_MARK(WAKE_PHASE_REQUEST_SENT);
+            status = _read_response(&keep_alive);
+        }
+
+        if (status < 0) {
+            http_transport_release();
+            if (reused) {
+                continue;
+            }
+            ESP_LOGE(_logger, "ERROR! Unable to POST moisture reading");
+            return ESP_FAIL;
+        }
+
+        WAKE_TIMING_MARK(WAKE_PHASE_RESPONSE);
+        if (!keep_alive) {
+            http_transport_release();
+        }
+
+        if (status >= 200 && status < 300) {
+            ESP_LOGI(_logger, "Successfully POST moisture reading!");
+            return ESP_OK;
+        }
+
+        ESP_LOGE(_logger, "ERROR! Backend rejected moisture reading. HTTP Status=%d", status);
+        return ESP_FAIL;
+    }
+
+    return ESP_FAIL;
+}
+
+void http_transport_release() {
+    if (_sock >= 0) {
+        close(_sock);
+        _sock = -1;
+    }
+}
+
+uplink_traffic_t http_transport_traffic() {
+    return _traffic;
+}
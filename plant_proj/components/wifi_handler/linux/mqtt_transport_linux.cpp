@@ -0,0 +1,243 @@
+#include <esp_log.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "mqtt_transport.hpp"
+#include "wifi_handler.hpp"
+#include "wake_timing.hpp"
+
+/**
+ * Minimal MQTT 3.1.1 client over a posix socket for the linux target. it only does what a node needs:
+ * CONNECT without the clean session flag, PUBLISH with QoS 0 or 1 and DISCONNECT. messages go to a local
+ * stand-in broker instead of the backend's host (see tools/stand_in_broker.py)
+ */
+
+static const char* LOCAL_BROKER_HOST = "127.0.0.1";
+static const size_t PACKET_BUFF_LEN = 256; //bigger packets from the broker are read and dropped
+static const size_t TOPIC_LEN = 48;
+
+//control packet types, the high nibble of the first byte
+static const uint8_t MQTT_CONNECT = 0x10;
+static const uint8_t MQTT_CONNACK = 0x20;
+static const uint8_t MQTT_PUBLISH = 0x30;
+static const uint8_t MQTT_PUBACK = 0x40;
+static const uint8_t MQTT_DISCONNECT = 0xE0;
+
+static const char* _logger = "MQTT Transport (host) *** ";
+//thread local like the http transport's socket, every thread of a host program is its own node
+static thread_local int _sock = -1;
+static thread_local uint32_t _client_node = 0; //node the connection was opened for
+static thread_local uint16_t _packet_id = 0;
+static thread_local uplink_traffic_t _traffic = {0, 0};
+
+static bool _send_all(const uint8_t* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(_sock, data, len, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        _traffic.bytes_sent += n;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool _recv_all(uint8_t* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = recv(_sock, data, len, 0);
+        if (n <= 0) {
+            return false;
+        }
+        _traffic.bytes_received += n;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+//writes the fixed header of a packet. returns its length, at most 5 bytes
+static size_t _fixed_header(uint8_t* buff, uint8_t type, size_t remaining) {
+    size_t len = 0;
+    buff[len++] = type;
+    do {
+        uint8_t digit = remaining % 128;
+        remaining /= 128;
+        buff[len++] = remaining > 0 ? (digit | 0x80) : digit;
+    } while (remaining > 0);
+    return len;
+}
+
+//reads one packet. the body is truncated to the buffer, the rest is dropped. returns false if the connection failed
+static bool _read_packet(uint8_t* type, uint8_t* body, size_t* body_len) {
+    if (!_recv_all(type, 1)) {
+        return false;
+    }
+
+    size_t remaining = 0;
+    for (int shift = 0; ; shift += 7) {
+        uint8_t digit = 0;
+        if (shift > 21 || !_recv_all(&digit, 1)) {
+            return false;
+        }
+        remaining |= static_cast<size_t>(digit & 0x7F) << shift;
+        if ((digit & 0x80) == 0) {
+            break;
+        }
+    }
+
+    *body_len = remaining < PACKET_BUFF_LEN ? remaining : PACKET_BUFF_LEN;
+    if (!_recv_all(body, *body_len)) {
+        return false;
+    }
+    for (size_t dropped = *body_len; dropped < remaining; ++dropped) {
+        uint8_t skip;
+        if (!_recv_all(&skip, 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static esp_err_t _connect(uint32_t node_id) {
+    _sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (_sock < 0) {
+        ESP_LOGE(_logger, "ERROR! Unable to create socket");
+        return ESP_FAIL;
+    }
+
+    int one = 1;
+    setsockopt(_sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    struct timeval timeout = {
+        .tv_sec = POST_TIMEOUT / 1000,
+        .tv_usec = (POST_TIMEOUT % 1000) * 1000,
+    };
+    setsockopt(_sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(_sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(MQTT_BROKER_PORT);
+    inet_pton(AF_INET, LOCAL_BROKER_HOST, &addr.sin_addr);
+
+    if (connect(_sock, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ESP_LOGE(_logger, "ERROR! Unable to connect to %s:%u", LOCAL_BROKER_HOST, MQTT_BROKER_PORT);
+        mqtt_transport_release();
+        return ESP_FAIL;
+    }
+
+    char client_id[24];
+    size_t id_len = snprintf(client_id, sizeof(client_id), "leaf-%u", static_cast<unsigned>(node_id));
+
+    //variable header: protocol name, level 4 (3.1.1), flags without clean session, keep alive
+    uint8_t packet[5 + 10 + 2 + sizeof(client_id)];
+    size_t len = _fixed_header(packet, MQTT_CONNECT, 10 + 2 + id_len);
+    const uint8_t variable_header[] = {0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04, 0x00,
+        static_cast<uint8_t>(MQTT_KEEPALIVE_S >> 8), static_cast<uint8_t>(MQTT_KEEPALIVE_S & 0xFF)};
+    memcpy(packet + len, variable_header, sizeof(variable_header));
+    len += sizeof(variable_header);
+    packet[len++] = static_cast<uint8_t>(id_len >> 8);
+    packet[len++] = static_cast<uint8_t>(id_len & 0xFF);
+    memcpy(packet + len, client_id, id_len);
+    len += id_len;
+
+    uint8_t type = 0;
+    uint8_t body[PACKET_BUFF_LEN];
+    size_t body_len = 0;
+    if (!_send_all(packet, len) || !_read_packet(&type, body, &body_len)
+        || (type & 0xF0) != MQTT_CONNACK || body_len < 2 || body[1] != 0) {
+        ESP_LOGE(_logger, "ERROR! Broker refused the connection");
+        mqtt_transport_release();
+        return ESP_FAIL;
+    }
+
+    //the broker kept the session of the previous wake if the session present flag is set
+    ESP_LOGI(_logger, "Connected as %s, session present: %u", client_id, body[0] & 0x01);
+    _client_node = node_id;
+    return ESP_OK;
+}
+
+esp_err_t mqtt_transport_publish(const uplink_message_t& message, int qos) {
+    if (_sock >= 0 && _client_node != message.node_id) {
+        mqtt_transport_release();
+    }
+    if (_sock < 0 && _connect(message.node_id) != ESP_OK) {
+        return ESP_FAIL;
+    }
+
+    char topic[TOPIC_LEN];
+    size_t topic_len = _mqtt_topic(topic, sizeof(topic), message);
+    if (topic_len == 0) {
+        ESP_LOGE(_logger, "ERROR! Topic doesn't fit");
+        return ESP_FAIL;
+    }
+
+    //the payload is sent straight from the caller's buffer after the headers
+    uint8_t header[5 + 2 + TOPIC_LEN + 2];
+    size_t remaining = 2 + topic_len + (qos > 0 ? 2 : 0) + message.len;
+    size_t len = _fixed_header(header, MQTT_PUBLISH | (qos > 0 ? 0x02 : 0x00), remaining);
+    header[len++] = static_cast<uint8_t>(topic_len >> 8);
+    header[len++] = static_cast<uint8_t>(topic_len & 0xFF);
+    memcpy(header + len, topic, topic_len);
+    len += topic_len;
+
+    uint16_t packet_id = 0;
+    if (qos > 0) {
+        _packet_id = (_packet_id == UINT16_MAX) ? 1 : _packet_id + 1; //0 isn't a valid packet id
+        packet_id = _packet_id;
+        header[len++] = static_cast<uint8_t>(packet_id >> 8);
+        header[len++] = static_cast<uint8_t>(packet_id & 0xFF);
+    }
+
+    if (!_send_all(header, len) || !_send_all(reinterpret_cast<const uint8_t*>(message.payload), message.len)) {
+        ESP_LOGE(_logger, "ERROR! Unable to publish moisture reading");
+        mqtt_transport_release();
+        return ESP_FAIL;
+    }
+    WAKE_TIMING_MARK(WAKE_PHASE_REQUEST_SENT);
+
+    //QoS 0 has no acknowledgement, the reading counts as sent once it's written
+    while (qos > 0) {
+        uint8_t type = 0;
+        uint8_t body[PACKET_BUFF_LEN];
+        size_t body_len = 0;
+        if (!_read_packet(&type, body, &body_len)) {
+            ESP_LOGE(_logger, "ERROR! No PUBACK for moisture reading");
+            mqtt_transport_release();
+            return ESP_FAIL;
+        }
+        if ((type & 0xF0) == MQTT_PUBACK && body_len >= 2 && ((body[0] << 8) | body[1]) == packet_id) {
+            break;
+        }
+        //anything else (ie a PINGRESP) isn't for this message
+    }
+
+    WAKE_TIMING_MARK(WAKE_PHASE_RESPONSE);
+    ESP_LOGI(_logger, "Successfully published moisture reading!");
+    return ESP_OK;
+}
+
+void mqtt_transport_release() {
+    if (_sock < 0) {
+        return;
+    }
+
+    //a clean disconnect so the broker doesn't treat the session as lost. the session itself is kept
+    uint8_t packet[2];
+    size_t len = _fixed_header(packet, MQTT_DISCONNECT, 0);
+    _send_all(packet, len);
+
+    close(_sock);
+    _sock = -1;
+}
+
+uplink_traffic_t mqtt_transport_traffic() {
+    return _traffic;
+}
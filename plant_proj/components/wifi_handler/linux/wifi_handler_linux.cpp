@@ -0,0 +1,30 @@
+#include <esp_log.h>
+#include "wifi_handler.hpp"
+#include "uplink_transport.hpp"
+#include "wake_timing.hpp"
+
+/**
+ * linux target stand-in for the wifi connection. the host's network is always up so there's
+ * nothing to connect, only the transport's connection has to be dropped when the node "disconnects"
+ */
+
+static const char* _logger = "Wifi Handler (host) *** ";
+const uint32_t WIFI_BACKOFF_MAX_SHIFT = 3;
+
+esp_err_t start_wifi_connection() {
+    ESP_LOGI(_logger, "Host network is always up, nothing to connect");
+    WAKE_TIMING_MARK(WAKE_PHASE_WIFI_STARTED);
+    WAKE_TIMING_MARK(WAKE_PHASE_GOT_IP);
+    return ESP_OK;
+}
+
+uint64_t wifi_backoff_sleep_us(uint64_t sleep_us) {
+    //connecting can't fail so there's never anything to back off from
+    return sleep_us;
+}
+
+esp_err_t stop_wifi_connection() {
+    uplink_transport().release();
+    ESP_LOGI(_logger, "Released host connection");
+    return ESP_OK;
+}
@@ -0,0 +1,165 @@
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <esp_log.h>
+#include <mqtt_client.h>
+#include <stdio.h>
+
+#include "mqtt_transport.hpp"
+#include "wifi_handler.hpp"
+#include "wifi_handler_esp.hpp"
+#include "wifi_cache.hpp"
+#include "wake_timing.hpp"
+#include "event_log.hpp"
+
+static const char* _logger = "MQTT Transport *** ";
+static const size_t TOPIC_LEN = 48;
+static const size_t BROKER_URI_LEN = sizeof("mqtt://") + SERVER_HOST_LEN + sizeof(":65535");
+static const EventBits_t MQTT_CONNECTED_BIT = BIT0;
+static const EventBits_t MQTT_DISCONNECTED_BIT = BIT1;
+static const EventBits_t MQTT_PUBLISHED_BIT = BIT2;
+
+static esp_mqtt_client_handle_t _mqtt_client = NULL; //created on the first publish after connecting to wifi
+static EventGroupHandle_t _mqtt_events = NULL;
+static StaticEventGroup_t _mqtt_events_buffer;
+static char _broker_uri[BROKER_URI_LEN];
+static char _client_id[24];
+static volatile int _acked_msg_id = -1; //msg id of the last PUBACK, set by the event handler
+
+static void _mqtt_event_handler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data) {
+    esp_mqtt_event_handle_t event = static_cast<esp_mqtt_event_handle_t>(event_data);
+
+    switch (static_cast<esp_mqtt_event_id_t>(event_id)) {
+        case MQTT_EVENT_CONNECTED:
+            EVENT_LOG_D(EVT_MQTT_CONNECTED, event->session_present);
+            xEventGroupClearBits(_mqtt_events, MQTT_DISCONNECTED_BIT);
+            xEventGroupSetBits(_mqtt_events, MQTT_CONNECTED_BIT);
+            break;
+        case MQTT_EVENT_DISCONNECTED:
+            EVENT_LOG_D(EVT_MQTT_DISCONNECTED);
+            xEventGroupClearBits(_mqtt_events, MQTT_CONNECTED_BIT);
+            xEventGroupSetBits(_mqtt_events, MQTT_DISCONNECTED_BIT);
+            break;
+        case MQTT_EVENT_PUBLISHED:
+            _acked_msg_id = event->msg_id;
+            xEventGroupSetBits(_mqtt_events, MQTT_PUBLISHED_BIT);
+            break;
+        case MQTT_EVENT_ERROR:
+            EVENT_LOG_W(EVT_MQTT_ERROR);
+            ESP_LOGE(_logger, "ERROR! MQTT client error");
+            break;
+        default:
+            break;
+    }
+}
+
+static esp_mqtt_client_handle_t _get_mqtt_client(uint32_t node_id) {
+    if (_mqtt_client != NULL) {
+        return _mqtt_client;
+    }
+
+    if (_mqtt_events == NULL) {
+        _mqtt_events = xEventGroupCreateStatic(&_mqtt_events_buffer);
+    }
+    xEventGroupClearBits(_mqtt_events, MQTT_CONNECTED_BIT | MQTT_DISCONNECTED_BIT | MQTT_PUBLISHED_BIT);
+
+    //the broker runs on the backend's host. on the fast path its cached address saves the dns lookup
+    char host[SERVER_HOST_LEN];
+    _server_host(host, sizeof(host));
+    if (wifi_timing.fast_path && wifi_cache_get().server_ip[0] != '\0') {
+        snprintf(host, sizeof(host), "%s", wifi_cache_get().server_ip);
+    }
+    snprintf(_broker_uri, sizeof(_broker_uri), "mqtt://%s:%u", host, static_cast<unsigned>(MQTT_BROKER_PORT));
+    snprintf(_client_id, sizeof(_client_id), "leaf-%u", static_cast<unsigned>(node_id));
+
+    esp_mqtt_client_config_t config = {};
+    config.broker.address.uri = _broker_uri;
+    config.credentials.client_id = _client_id;
+    config.session.disable_clean_session = true; //the broker keeps the session while the node sleeps
+    config.session.keepalive = MQTT_KEEPALIVE_S;
+    config.network.timeout_ms = POST_TIMEOUT;
+    config.network.disable_auto_reconnect = true; //a lost connection fails the publish, the readings stay buffered
+
+    _mqtt_client = esp_mqtt_client_init(&config);
+    if (_mqtt_client == NULL) {
+        ESP_LOGE(_logger, "ERROR! Unable to create MQTT client");
+        return NULL;
+    }
+
+    esp_mqtt_client_register_event(_mqtt_client, MQTT_EVENT_ANY, _mqtt_event_handler, NULL);
+    if (esp_mqtt_client_start(_mqtt_client) != ESP_OK) {
+        ESP_LOGE(_logger, "ERROR! Unable to start MQTT client");
+        mqtt_transport_release();
+        return NULL;
+    }
+
+    EventBits_t bits = xEventGroupWaitBits(_mqtt_events, MQTT_CONNECTED_BIT | MQTT_DISCONNECTED_BIT,
+        pdFALSE, pdFALSE, pdMS_TO_TICKS(POST_TIMEOUT));
+    if ((bits & MQTT_CONNECTED_BIT) == 0) {
+        ESP_LOGE(_logger, "ERROR! Unable to connect to broker %s", _broker_uri);
+
+        //the cached backend address might be stale, the next wake resolves it again
+        if (wifi_timing.fast_path) {
+            wifi_cache_invalidate();
+        }
+        mqtt_transport_release();
+        return NULL;
+    }
+
+    return _mqtt_client;
+}
+
+esp_err_t mqtt_transport_publish(const uplink_message_t& message, int qos) {
+    esp_mqtt_client_handle_t client = _get_mqtt_client(message.node_id);
+    if (client == NULL) {
+        return ESP_FAIL;
+    }
+
+    char topic[TOPIC_LEN];
+    if (_mqtt_topic(topic, sizeof(topic), message) == 0) {
+        ESP_LOGE(_logger, "ERROR! Topic doesn't fit");
+        return ESP_FAIL;
+    }
+
+    //publish writes the message to the socket before it returns, QoS 1 then waits for the PUBACK
+    xEventGroupClearBits(_mqtt_events, MQTT_PUBLISHED_BIT);
+    int msg_id = esp_mqtt_client_publish(client, topic, message.payload, static_cast<int>(message.len), qos, 0);
+    if (msg_id < 0) {
+        ESP_LOGE(_logger, "ERROR! Unable to publish moisture reading");
+        return ESP_FAIL;
+    }
+    WAKE_TIMING_MARK(WAKE_PHASE_REQUEST_SENT);
+
+    while (qos > 0) {
+        EventBits_t bits = xEventGroupWaitBits(_mqtt_events, MQTT_PUBLISHED_BIT | MQTT_DISCONNECTED_BIT,
+            pdTRUE, pdFALSE, pdMS_TO_TICKS(POST_TIMEOUT));
+        if ((bits & MQTT_PUBLISHED_BIT) != 0 && _acked_msg_id == msg_id) {
+            break;
+        }
+        if ((bits & MQTT_PUBLISHED_BIT) == 0) {
+            ESP_LOGE(_logger, "ERROR! No PUBACK for moisture reading");
+            mqtt_transport_release();
+            return ESP_FAIL;
+        }
+    }
+
+    WAKE_TIMING_MARK(WAKE_PHASE_RESPONSE);
+    ESP_LOGI(_logger, "Successfully published moisture reading!");
+    return ESP_OK;
+}
+
+void mqtt_transport_release() {
+    if (_mqtt_client == NULL) {
+        return;
+    }
+
+    //stop sends a DISCONNECT, the broker keeps the session for the next wake
+    esp_mqtt_client_stop(_mqtt_client);
+    esp_mqtt_client_destroy(_mqtt_client);
+    _mqtt_client = NULL;
+}
+
+uplink_traffic_t mqtt_transport_traffic() {
+    //esp-mqtt doesn't count what goes over its connection
+    uplink_traffic_t traffic = {0, 0};
+    return traffic;
+}
@@ -0,0 +1,98 @@
+#ifndef WIFI_CACHE_HPP
+#define WIFI_CACHE_HPP
+
+#include <stdint.h>
+#include <esp_netif.h>
+
+/**
+ * Fast reconnect cache kept in RTC slow memory. After a successful full connection we remember the access
+ * point, the DHCP lease and the backend's address so timer wakes can do a directed connect with a static ip
+ * and skip scanning, DHCP and DNS entirely
+ *
+ * https://docs.espressif.com/projects/esp-idf/en/stable/esp32/api-guides/wifi.html#wi-fi-fast-scan
+ */
+
+typedef struct {
+    uint32_t magic; //set to WIFI_CACHE_MAGIC when the cache holds a valid connection
+    uint8_t bssid[6]; //mac address of the access point
+    uint8_t channel; //channel the access point is on
+    esp_netif_ip_info_t ip_info; //ip, netmask and gateway assigned by DHCP
+    esp_ip4_addr_t dns; //main dns server
+    char server_ip[IP4ADDR_STRLEN_MAX]; //resolved backend address, empty if it hasn't been resolved
+    uint32_t config_generation; //leaf config the connection was made with, see leaf_config_generation
+} wifi_cache_t;
+
+//time it took to reach each connection milestone, measured from the start of start_wifi_connection
+typedef struct {
+    bool fast_path; //true if the connection used the cache
+    int64_t start_us; //when start_wifi_connection was called
+    int64_t got_ip_us; //time to ip
+    int64_t first_byte_us; //time to the first byte of the http response
+} wifi_timing_t;
+
+//running totals per connection path, used to report the mean gain of the fast path
+typedef struct {
+    uint32_t count;
+    int64_t total_ip_us;
+    int64_t total_first_byte_us;
+} wifi_path_stats_t;
+
+extern wifi_timing_t wifi_timing; //timing of the current wake
+
+/**
+ * @return returns true if the cache holds a complete connection that can be reused
+ */
+bool wifi_cache_is_valid();
+
+/**
+ * @return returns the cached connection. only meaningful if wifi_cache_is_valid returns true
+ */
+const wifi_cache_t& wifi_cache_get();
+
+/**
+ * saves the access point we associated with. called from the STA_CONNECTED event
+ * @param bssid mac address of the access point
+ * @param channel channel of the access point
+ */
+void wifi_cache_save_ap(const uint8_t* bssid, uint8_t channel);
+
+/**
+ * saves the DHCP lease and dns server once an ip was assigned. marks the cache as valid
+ * @param ip_info ip, netmask and gateway
+ * @param dns main dns server
+ */
+void wifi_cache_save_ip(const esp_netif_ip_info_t& ip_info, const esp_ip4_addr_t& dns);
+
+/**
+ * saves the resolved address of the backend
+ * @param server_ip dotted ip string
+ */
+void wifi_cache_save_server_ip(const char* server_ip);
+
+/**
+ * clears the cache so the next connection goes through the full scan, DHCP and DNS path
+ */
+void wifi_cache_invalidate();
+
+/**
+ * marks the start of a connection attempt and resets the milestones of the current wake
+ * @param fast_path true if the attempt uses the cache
+ */
+void wifi_timing_start(bool fast_path);
+
+/**
+ * records when an ip was obtained
+ */
+void wifi_timing_got_ip();
+
+/**
+ * records when the first byte of the http response arrived. only the first call per wake is recorded
+ */
+void wifi_timing_first_byte();
+
+/**
+ * adds the current wake's milestones to the per path totals and logs them next to the mean of both paths
+ */
+void wifi_timing_report();
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef WIFI_HANDLER_ESP_HPP
+#define WIFI_HANDLER_ESP_HPP
+
+#include <freertos/FreeRTOS.h>
+#include <esp_event.h> //gives us esp_event_base_t type
+#include <freertos/event_groups.h> //gives EventGroupHandle_t type
+#include <esp_bit_defs.h>
+#include <esp_http_client.h>
+#include "leaf_config.hpp"
+
+/**
+ * internals of the esp32 wifi and http client implementation
+ */
+
+//states of a connection attempt. the event handlers report what happened and _connect_to_ap moves between states
+typedef enum {
+    WIFI_STATE_STOPPED, //driver isn't started
+    WIFI_STATE_CONNECTING, //waiting to associate and get an ip
+    WIFI_STATE_BACKOFF, //disconnected, waiting before the next attempt
+    WIFI_STATE_CONNECTED, //got an ip
+    WIFI_STATE_FAILED, //gave up. wrong credentials, no access point, out of attempts or out of time
+} wifi_state_t;
+
+typedef struct {
+    EventGroupHandle_t wan_event_group;
+    int GOT_IP_BIT;
+    int DISCONNECTED_BIT;
+    wifi_state_t state;
+    uint8_t disconnect_reason; //wifi_err_reason_t of the last STA_DISCONNECTED event
+} events_data_t;
+
+#define SERVER_HOST_LEN sizeof(leaf_settings.server_url) //the host is part of the server url so it always fits
+#define POST_URL_LEN (sizeof(leaf_settings.server_url) + 32) //server url plus the route, and the cached ip being longer than the host
+
+extern events_data_t wifi_events;
+extern const int WIFI_CONNECTION_TIMEOUT; //ms. per attempt
+extern const int FAST_CONNECTION_TIMEOUT;
+extern const uint32_t WIFI_MAX_RETRIES; //reconnect attempts after the first one on the full path
+extern const uint32_t WIFI_RETRY_BASE_DELAY_MS; //wait before the first reconnect, doubled every attempt
+extern const int64_t WIFI_AWAKE_BUDGET_US; //time after start_wifi_connection is called after which connecting is given up
+
+/**
+ * Set up function for creating wifi events loop and group. in addition this function sets
+ * up the wifi and ip event handlers. only does the work on the first call
+ * 
+ * @return returns an esp_err_t value. if everything went well that value is ESP_OK
+ */
+esp_err_t wan_event_handler_setup();
+
+/**
+ * Brings up the driver and connects, see start_wifi_connection
+ * @return returns ESP_OK once connected
+ */
+esp_err_t _start_wifi_connection();
+
+/**
+ * Associates with the access point and waits for an ip address. disconnects are retried with an exponential
+ * backoff unless the reason says retrying won't help, and the whole attempt stops WIFI_AWAKE_BUDGET_US after
+ * start_wifi_connection was called
+ *
+ * @param use_cache if true does a directed connect with the cached bssid, channel and static ip. it isn't retried,
+ * the caller falls back to the full path instead
+ * @return returns ESP_OK once an ip was obtained, ESP_FAIL on error or once it gave up
+ */
+esp_err_t _connect_to_ap(bool use_cache);
+
+/**
+ * @param reason wifi_err_reason_t of a disconnect
+ * @return returns true if reconnecting can't succeed until something changes (credentials, access point)
+ */
+bool _is_fatal_disconnect(uint8_t reason);
+
+/**
+ * Builds the submit reading url and the http client config
+ *
+ * @param use_cached_ip if true the host in the server url is replaced with the cached backend address
+ */
+void _set_post_url(bool use_cached_ip);
+
+/**
+ * Copies the host part of the server url
+ * @param host buffer the host is written to, null terminated
+ * @param len size of host, SERVER_HOST_LEN fits any host
+ * @return returns the length of the host, 0 if there is none or it doesn't fit
+ */
+size_t _server_host(char* host, size_t len);
+
+/**
+ * Resolves the backend host and saves its address in the fast reconnect cache
+ */
+void _resolve_server_ip();
+
+/** 
+* Handler for Wifi events
+* 
+* @param arg pointer to the event source
+* @param event_base event base associated with the event
+* @param event_id Id of the event
+* @param event_data data associated with the event
+*/
+void wifi_event_handler(
+    void* arg,
+    esp_event_base_t event_base,
+    int32_t event_id,
+    void* event_data
+);
+
+/** 
+* Handler for IP events
+* 
+* @param arg pointer to the event source
+* @param event_base event base associated with the event
+* @param event_id Id of the event
+* @param event_data data associated with the event
+*/
+void ip_event_handler(
+    void* arg,
+    esp_event_base_t event_base,
+    int32_t event_id,
+    void* event_data
+);
+
+/**
+* Handler for http events
+* @param event http event object
+* @return esp_err_t returns ESP_OK on success, ESP_FAIL if an error occured, ESP_ERR_INVALID_RESPONSE if event id in event object is invalid
+* 
+*/
+esp_err_t http_event_handler(esp_http_client_event_t* event);
+
+/**
+ * Returns the long lived http client, creating it on first use
+ *
+ * @return returns the client handle or NULL if it couldn't be created
+ */
+esp_http_client_handle_t _get_http_client();
+
+#endif
@@ -0,0 +1,47 @@
+#include <stdio.h>
+#include "uplink_transport.hpp"
+#include "http_transport.hpp"
+#include "mqtt_transport.hpp"
+
+const uplink_kind_t UPLINK_TRANSPORT = UPLINK_HTTP; //UPLINK_MQTT once the backend runs a broker
+const uint16_t MQTT_BROKER_PORT = 1883;
+const char* MQTT_TOPIC_PREFIX = "leaf";
+const int MQTT_QOS = 1; //with QoS 0 a reading the broker never got still counts as sent and leaves the buffer
+const uint16_t MQTT_KEEPALIVE_S = 60; //a node is connected for a few seconds per wake, it only has to outlive that
+
+static esp_err_t _http_uplink_send(const uplink_message_t& message) {
+    return http_transport_post(message.payload, message.len, message.content_type);
+}
+
+const uplink_transport_t HTTP_UPLINK = {
+    .name = "http",
+    .per_reading = false,
+    .send = _http_uplink_send,
+    .release = http_transport_release,
+    .traffic = http_transport_traffic,
+};
+
+const uplink_transport_t MQTT_UPLINK = {
+    .name = "mqtt",
+    .per_reading = true,
+    .send = mqtt_transport_send,
+    .release = mqtt_transport_release,
+    .traffic = mqtt_transport_traffic,
+};
+
+const uplink_transport_t& uplink_transport() {
+    return UPLINK_TRANSPORT == UPLINK_MQTT ? MQTT_UPLINK : HTTP_UPLINK;
+}
+
+esp_err_t mqtt_transport_send(const uplink_message_t& message) {
+    return mqtt_transport_publish(message, MQTT_QOS);
+}
+
+size_t _mqtt_topic(char* buff, size_t len, const uplink_message_t& message) {
+    int n = snprintf(buff, len, "%s/%u/%u", MQTT_TOPIC_PREFIX,
+        static_cast<unsigned>(message.node_id), static_cast<unsigned>(message.plant_id));
+    if (n < 0 || static_cast<size_t>(n) >= len) {
+        return 0;
+    }
+    return static_cast<size_t>(n);
+}
@@ -0,0 +1,116 @@
+#include <esp_log.h>
+#include "wifi_handler.hpp"
+#include "uplink_transport.hpp"
+#include "leaf_config.hpp"
+#include "json_encoder.hpp"
+#include "binary_encoder.hpp"
+#include "wake_timing.hpp"
+#include "mem_stats.hpp"
+#include "raw_capture.hpp"
+#include "event_log.hpp"
+
+static const char* _logger = "Uploader *** ";
+const char* SUBMIT_READING_ROUTE = "/submit-reading";
+const int POST_TIMEOUT = 10000; //ms
+const size_t PAYLOAD_BUFFER_LEN = 4096; //each reading is at most ~90 bytes of json, bigger batches are split
+const payload_format_t PAYLOAD_FORMAT = PAYLOAD_JSON; //PAYLOAD_BINARY cuts airtime ~6x once the backend decodes it
+
+static char _payload_buffer[PAYLOAD_BUFFER_LEN]; //request bodies are encoded here. static so they don't need the heap or the task's stack
+
+esp_err_t post_moisture_readings(const reading_record_t* records, size_t count, submit_mode_t mode, size_t* accepted, bool* summary) {
+    if (accepted != NULL) {
+        *accepted = 0;
+    }
+
+    if (records == NULL || count == 0) {
+        ESP_LOGW(_logger, "WARNING! No readings to POST");
+        return ESP_OK;
+    }
+
+    //every request goes out back to back over the kept alive connection. stops at the first failure
+    //so the readings that were accepted are always a prefix of records
+    EVENT_LOG_I(EVT_POST, static_cast<int32_t>(count), mode);
+
+    //a transport that addresses every plant separately (mqtt topics) can't take batches
+    const uplink_transport_t& transport = uplink_transport();
+    if (transport.per_reading) {
+        mode = SUBMIT_PER_READING;
+    }
+
+    size_t sent = 0;
+    while (sent < count) {
+        //a batch that doesn't fit in the payload buffer is split in half until it does
+        //the timing and memory summaries and the raw capture ride along with one request of the upload only so
+        //the backend doesn't count them twice, the caller keeps track of it across calls
+        size_t chunk = (mode == SUBMIT_BATCH) ? count - sent : 1;
+        bool with_summary = (summary != NULL && *summary);
+        size_t len = _encode_readings(records + sent, chunk, with_summary);
+        while (len == 0 && chunk > 1) {
+            chunk /= 2;
+            len = _encode_readings(records + sent, chunk, with_summary);
+        }
+
+        const uplink_message_t message = {
+            .payload = _payload_buffer,
+            .len = len,
+            .content_type = _payload_content_type(),
+            .node_id = leaf_info.node_id,
+            .plant_id = records[sent].plant_id,
+        };
+        if (len == 0 || transport.send(message) != ESP_OK) {
+            ESP_LOGE(_logger, "ERROR! Stopped after %u of %u readings", static_cast<unsigned>(sent), static_cast<unsigned>(count));
+            return ESP_FAIL;
+        }
+
+        sent += chunk;
+        if (with_summary) {
+            *summary = false;
+        }
+        if (accepted != NULL) {
+            *accepted = sent;
+        }
+    }
+
+    return ESP_OK;
+}
+
+size_t _encode_readings(const reading_record_t* records, size_t count, bool with_summary) {
+    size_t len = 0;
+    const wake_phase_stats_t* timing = with_summary ? WAKE_TIMING_STATS() : NULL;
+    const mem_stats_t* mem = with_summary ? mem_stats_get() : NULL;
+    const raw_capture_t* raw = with_summary ? RAW_CAPTURE_GET() : NULL;
+
+    if (PAYLOAD_FORMAT == PAYLOAD_BINARY) {
+        len = encode_readings_binary(
+            reinterpret_cast<uint8_t*>(_payload_buffer), sizeof(_payload_buffer),
+            leaf_info.node_id, leaf_info.plant_count,
+            records, count,
+            timing, mem, raw
+        );
+        if (len == 0) {
+            ESP_LOGW(_logger, "WARNING! %u moisture readings don't fit in one binary payload", static_cast<unsigned>(count));
+        }
+        return len;
+    }
+
+    const char* plant_names[MAX_PLANTS];
+    for (size_t i = 0; i < leaf_info.plant_count; ++i) {
+        plant_names[i] = reinterpret_cast<const char*>(leaf_info.plants[i].plant_name);
+    }
+
+    len = encode_readings_json(
+        _payload_buffer, sizeof(_payload_buffer),
+        plant_names, leaf_info.plant_count, sizeof(leaf_info.plants[0].plant_name),
+        records, count,
+        timing, mem, raw
+    );
+    if (len == 0) {
+        ESP_LOGW(_logger, "WARNING! %u moisture readings don't fit in the payload buffer", static_cast<unsigned>(count));
+    }
+
+    return len;
+}
+
+const char* _payload_content_type() {
+    return PAYLOAD_FORMAT == PAYLOAD_BINARY ? BINARY_CONTENT_TYPE : "application/json";
+}
@@ -0,0 +1,95 @@
+#include <esp_log.h>
+#include <esp_attr.h>
+#include <esp_timer.h>
+#include <cstring>
+#include "wifi_cache.hpp"
+#include "leaf_config.hpp"
+
+static const char* _logger = "Wifi Cache *** ";
+static const uint32_t WIFI_CACHE_MAGIC = 0x57434348; //"WCCH"
+
+//both live in rtc slow memory so they survive deep sleep
+RTC_DATA_ATTR static wifi_cache_t _cache;
+RTC_DATA_ATTR static wifi_path_stats_t _path_stats[2]; //index 0 is the full path, 1 is the fast path
+
+wifi_timing_t wifi_timing;
+
+bool wifi_cache_is_valid() {
+    //a new config can point to a different access point or server
+    return _cache.magic == WIFI_CACHE_MAGIC && _cache.config_generation == leaf_config_generation();
+}
+
+const wifi_cache_t& wifi_cache_get() {
+    return _cache;
+}
+
+void wifi_cache_save_ap(const uint8_t* bssid, uint8_t channel) {
+    memcpy(_cache.bssid, bssid, sizeof(_cache.bssid));
+    _cache.channel = channel;
+}
+
+void wifi_cache_save_ip(const esp_netif_ip_info_t& ip_info, const esp_ip4_addr_t& dns) {
+    _cache.ip_info = ip_info;
+    _cache.dns = dns;
+
+    //the access point is always saved before an ip is assigned so at this point the cache is complete
+    _cache.config_generation = leaf_config_generation();
+    _cache.magic = WIFI_CACHE_MAGIC;
+}
+
+void wifi_cache_save_server_ip(const char* server_ip) {
+    strncpy(_cache.server_ip, server_ip, sizeof(_cache.server_ip) - 1);
+    _cache.server_ip[sizeof(_cache.server_ip) - 1] = '\0';
+}
+
+void wifi_cache_invalidate() {
+    ESP_LOGW(_logger, "Invalidating fast reconnect cache");
+    memset(&_cache, 0, sizeof(_cache));
+}
+
+void wifi_timing_start(bool fast_path) {
+    wifi_timing = {
+        .fast_path = fast_path,
+        .start_us = esp_timer_get_time(),
+        .got_ip_us = 0,
+        .first_byte_us = 0,
+    };
+}
+
+void wifi_timing_got_ip() {
+    wifi_timing.got_ip_us = esp_timer_get_time() - wifi_timing.start_us;
+}
+
+void wifi_timing_first_byte() {
+    if (wifi_timing.first_byte_us == 0) {
+        wifi_timing.first_byte_us = esp_timer_get_time() - wifi_timing.start_us;
+    }
+}
+
+void wifi_timing_report() {
+    //only complete connections are added to the totals
+    if (wifi_timing.got_ip_us == 0 || wifi_timing.first_byte_us == 0) {
+        return;
+    }
+
+    wifi_path_stats_t& stats = _path_stats[wifi_timing.fast_path ? 1 : 0];
+    stats.count += 1;
+    stats.total_ip_us += wifi_timing.got_ip_us;
+    stats.total_first_byte_us += wifi_timing.first_byte_us;
+
+    ESP_LOGI(_logger, "%s path: time to ip %lld ms, time to first byte %lld ms",
+        wifi_timing.fast_path ? "Fast" : "Full",
+        static_cast<long long>(wifi_timing.got_ip_us / 1000),
+        static_cast<long long>(wifi_timing.first_byte_us / 1000));
+
+    for (int i = 0; i < 2; ++i) {
+        if (_path_stats[i].count == 0) {
+            continue;
+        }
+        ESP_LOGI(_logger, "%s path mean over %u connections: time to ip %lld ms, time to first byte %lld ms",
+            i == 1 ? "Fast" : "Full",
+            static_cast<unsigned>(_path_stats[i].count),
+            static_cast<long long>(_path_stats[i].total_ip_us / _path_stats[i].count / 1000),
+            static_cast<long long>(_path_stats[i].total_first_byte_us / _path_stats[i].count / 1000));
+    }
+}
@@ -1,27 +1,56 @@
 #include <freertos/FreeRTOS.h>
+#include <freertos/task.h> //vTaskDelay
 #include <esp_event.h>
 #include <esp_log.h>
 #include <esp_bit_defs.h>
 #include <esp_netif.h> //for networking
 #include <esp_wifi.h>
+#include <esp_attr.h>
+#include <lwip/netdb.h> //getaddrinfo
+#include <lwip/sockets.h> //inet_aton and inet_ntoa_r
+#include <string.h>
+#include <stdio.h>
 // #include <esp_http_client.h>
 // #include <string>
 
 #include "wifi_handler.hpp"
+#include "wifi_handler_esp.hpp"
+#include "http_transport.hpp"
+#include "uplink_transport.hpp"
 #include "leaf_config.hpp"
+#include "wifi_cache.hpp"
+#include "sleep_hal.hpp"
+#include "wake_timing.hpp"
+#include "event_log.hpp"
+#include "directives.hpp"
 
 static const char* _WIFI_EVENTS_LOGGER = "Wifi Handler *** ";
-const int HTTP_BUFF_LEN = 100;
-const char* SERVER_URL = "http://";
-const char* SUBMIT_READING_ROUTE = "/submit-reading";
-const int POST_TIMEOUT = 10000; //ms
 const int WIFI_CONNECTION_TIMEOUT = 5000;
+const int FAST_CONNECTION_TIMEOUT = 1500; //ms. a directed connect with a static ip takes a few hundred ms
+const uint32_t WIFI_MAX_RETRIES = 4; //with the base delay the retries wait 0.25 + 0.5 + 1 + 2s
+const uint32_t WIFI_RETRY_BASE_DELAY_MS = 250;
+const int64_t WIFI_AWAKE_BUDGET_US = 15 * 1000 * 1000;
+const uint32_t WIFI_BACKOFF_MAX_SHIFT = 3; //at most 8x the sleep, ~1 min at the default 8s interval
 
-static std::string target_post_url;
+static char target_post_url[POST_URL_LEN];
 esp_http_client_config_t http_client_config;
+static esp_http_client_handle_t _http_client = NULL; //long lived client, reused by every request while wifi is up
 events_data_t wifi_events;
 
+//consecutive wakes that couldn't connect. lives in rtc memory so it survives deep sleep
+RTC_DATA_ATTR static uint32_t _connect_failures = 0;
+
+//end of WIFI_AWAKE_BUDGET_US for the connection being made. set by each start_wifi_connection, continuous mode
+//reconnects long after boot
+static int64_t _awake_deadline_us = 0;
+
 esp_err_t wan_event_handler_setup() {
+    //the event loop, group and handlers stay around between connections
+    static bool ready = false;
+    if (ready) {
+        return ESP_OK;
+    }
+
     ESP_LOGI(_WIFI_EVENTS_LOGGER, "Initializing WAN events handler SetUp");
     ESP_LOGI(_WIFI_EVENTS_LOGGER, "Creating wifi event loop");
 
@@ -57,8 +86,12 @@ esp_err_t wan_event_handler_setup() {
     //where as event loops are used to invoke an handler (block of code) when an event occurs
 
     //creating an events group
-    wifi_events.wan_event_group = xEventGroupCreate(); //returns a pointer to a set of bits. Each bit acts as flag for some type of info
+    //the group lives in static memory, it's never deleted so there's no reason to take it from the heap
+    static StaticEventGroup_t wan_event_group_buffer;
+    wifi_events.wan_event_group = xEventGroupCreateStatic(&wan_event_group_buffer); //returns a pointer to a set of bits. Each bit acts as flag for some type of info
     wifi_events.GOT_IP_BIT = BIT0; //the lsb of events flags(bits) will correspond to whether or not we got an ip address
+    wifi_events.DISCONNECTED_BIT = BIT1; //set on every disconnect, the reason is in wifi_events.disconnect_reason
+    wifi_events.state = WIFI_STATE_STOPPED;
 
     if (wifi_events.wan_event_group == NULL) {
         ESP_LOGE(_WIFI_EVENTS_LOGGER, "Error! Failed to create Event Group");
@@ -94,20 +127,36 @@ esp_err_t wan_event_handler_setup() {
         return ESP_FAIL;
     }
 
+    ready = true;
     return ESP_OK;
 }
 
 esp_err_t start_wifi_connection() {
-    target_post_url = (std::string(SERVER_URL) + SUBMIT_READING_ROUTE);
+    esp_err_t res = _start_wifi_connection();
 
-    //initializing http client and 
-    //registering http handler
-    http_client_config = {
-        .url = target_post_url.c_str(),
-        .method = HTTP_METHOD_POST,
-        .timeout_ms = POST_TIMEOUT,
-        .event_handler = http_event_handler
-    };
+    //feeds the sleep backoff, see wifi_backoff_sleep_us
+    if (res == ESP_OK) {
+        _connect_failures = 0;
+    } else {
+        _connect_failures += 1;
+        EVENT_LOG_E(EVT_WIFI_FAILED, _connect_failures);
+    }
+
+    return res;
+}
+
+uint64_t wifi_backoff_sleep_us(uint64_t sleep_us) {
+    uint32_t shift = (_connect_failures < WIFI_BACKOFF_MAX_SHIFT) ? _connect_failures : WIFI_BACKOFF_MAX_SHIFT;
+    return sleep_us << shift;
+}
+
+esp_err_t _start_wifi_connection() {
+    //timer wakes with a valid cache skip the scan, DHCP and DNS lookup
+    bool fast_path = sleep_hal_woke_from_timer() && wifi_cache_is_valid();
+    wifi_timing_start(fast_path);
+    _awake_deadline_us = sleep_hal_time_us() + WIFI_AWAKE_BUDGET_US; //the fast path and its fallback share it
+
+    _set_post_url(fast_path);
 
     //event handlers setup
     if (wan_event_handler_setup() != ESP_OK) {
@@ -121,6 +170,17 @@ esp_err_t start_wifi_connection() {
         return ESP_FAIL;
     }
 
+    //creates the default wifi station interface. this is what "WIFI_STA_DEF" refers to
+    if (esp_netif_get_handle_from_ifkey("WIFI_STA_DEF") == NULL && esp_netif_create_default_wifi_sta() == NULL) {
+        ESP_LOGE(_WIFI_EVENTS_LOGGER, "Critical Error! Failed to create wifi station interface");
+        return ESP_FAIL;
+    }
+
+    //the driver keeps its calibration data in NVS. timer wakes that use the cached config haven't initialized it yet
+    if (leaf_config_nvs_init() != ESP_OK) {
+        ESP_LOGW(_WIFI_EVENTS_LOGGER, "WARNING! NVS unavailable, wifi will run a full calibration");
+    }
+
     //initializes wifi config
     wifi_init_config_t wifi_config_def = WIFI_INIT_CONFIG_DEFAULT();
     if (esp_wifi_init(&wifi_config_def) != ESP_OK) {
@@ -147,6 +207,36 @@ esp_err_t start_wifi_connection() {
         return ESP_FAIL;
     }
 
+    if (fast_path) {
+        ESP_LOGI(_WIFI_EVENTS_LOGGER, "Timer wake with a valid cache, attempting fast reconnect");
+        if (_connect_to_ap(true) == ESP_OK) {
+            ESP_LOGI(_WIFI_EVENTS_LOGGER, "Successfully connected to wifi using the fast path");
+            return ESP_OK;
+        }
+
+        //the access point, lease or channel changed. fall back to the full path and rebuild the cache
+        ESP_LOGW(_WIFI_EVENTS_LOGGER, "Fast reconnect failed, falling back to a full connection");
+        wifi_cache_invalidate();
+        esp_wifi_stop();
+
+        wifi_timing_start(false);
+        _set_post_url(false);
+    }
+
+    if (_connect_to_ap(false) != ESP_OK) {
+        esp_wifi_stop();
+        return ESP_FAIL;
+    }
+
+    _resolve_server_ip();
+
+    ESP_LOGI(_WIFI_EVENTS_LOGGER, "Successfully connected to wifi");
+    return ESP_OK;
+}
+
+esp_err_t _connect_to_ap(bool use_cache) {
+    const wifi_cache_t& cache = wifi_cache_get();
+
     //wifi configuration
     //loads wifi name and password into the config object
     wifi_config_t wifi_config_custom;
@@ -154,46 +244,236 @@ esp_err_t start_wifi_connection() {
     memcpy(wifi_config_custom.sta.ssid, wifi_credentials.wifi_ssid, sizeof(wifi_credentials.wifi_ssid));
     memcpy(wifi_config_custom.sta.password, wifi_credentials.wifi_password, sizeof(wifi_credentials.wifi_password));
 
-    if (esp_wifi_set_config(WIFI_IF_STA, &wifi_config_custom) != ESP_OK) {
-        ESP_LOGE(_WIFI_EVENTS_LOGGER, "Critical Error! Failed to set wifi configuration");
-        return ESP_FAIL;
+    if (use_cache) {
+        //directed connect. the driver only probes the cached channel for the cached access point
+        wifi_config_custom.sta.scan_method = WIFI_FAST_SCAN;
+        wifi_config_custom.sta.bssid_set = true;
+        memcpy(wifi_config_custom.sta.bssid, cache.bssid, sizeof(cache.bssid));
+        wifi_config_custom.sta.channel = cache.channel;
     }
 
-    //finally starts wifi connection
-    if (esp_wifi_start() != ESP_OK) {
-        ESP_LOGE(_WIFI_EVENTS_LOGGER, "Critical Error! Failed to start wifi");
+    if (esp_wifi_set_config(WIFI_IF_STA, &wifi_config_custom) != ESP_OK) {
+        ESP_LOGE(_WIFI_EVENTS_LOGGER, "Critical Error! Failed to set wifi configuration");
         return ESP_FAIL;
     }
 
-    //DHCP client setup
     esp_netif_t* sta_netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
     if (sta_netif == NULL) {
         ESP_LOGE(_WIFI_EVENTS_LOGGER, "Critical Error! Failed to get wifi station interface");
         return ESP_FAIL;
     }
-    if (esp_netif_dhcpc_start(sta_netif) != ESP_OK) {
-        ESP_LOGE(_WIFI_EVENTS_LOGGER, "Critical Error! Failed to enable DHCP Client");
-        return ESP_FAIL;
+
+    if (use_cache) {
+        //static ip. the GOT_IP event is raised as soon as we associate instead of after a DHCP exchange
+        esp_err_t res = esp_netif_dhcpc_stop(sta_netif);
+        if (res != ESP_OK && res != ESP_ERR_ESP_NETIF_DHCP_ALREADY_STOPPED) {
+            ESP_LOGE(_WIFI_EVENTS_LOGGER, "Error! Failed to stop DHCP Client");
+            return ESP_FAIL;
+        }
+
+        if (esp_netif_set_ip_info(sta_netif, &cache.ip_info) != ESP_OK) {
+            ESP_LOGE(_WIFI_EVENTS_LOGGER, "Error! Failed to set cached ip address");
+            return ESP_FAIL;
+        }
+
+        esp_netif_dns_info_t dns_info;
+        memset(&dns_info, 0, sizeof(dns_info));
+        dns_info.ip.type = IPADDR_TYPE_V4;
+        dns_info.ip.u_addr.ip4 = cache.dns;
+        esp_netif_set_dns_info(sta_netif, ESP_NETIF_DNS_MAIN, &dns_info);
+    } else {
+        //DHCP client setup. the client is enabled by default so already started isn't an error
+        esp_err_t res = esp_netif_dhcpc_start(sta_netif);
+        if (res != ESP_OK && res != ESP_ERR_ESP_NETIF_DHCP_ALREADY_STARTED) {
+            ESP_LOGE(_WIFI_EVENTS_LOGGER, "Critical Error! Failed to enable DHCP Client");
+            return ESP_FAIL;
+        }
     }
 
-    //waits until the router gives us an ip address
-    //once ip is received the ip handler will be called and it will set the ip bit in the event group
-    EventBits_t bits = xEventGroupWaitBits(
-        wifi_events.wan_event_group,
-        wifi_events.GOT_IP_BIT,
-        pdFALSE, //this parameter is set to true if we want to set the bit(s) back to 0 after it was set to 1
-        pdFALSE, //this is set to true if we're waiting on multiple bits and we want to wait until they're all set to 1
-        pdMS_TO_TICKS(WIFI_CONNECTION_TIMEOUT) // how long we wait for before returning
-    );
+    xEventGroupClearBits(wifi_events.wan_event_group, wifi_events.GOT_IP_BIT | wifi_events.DISCONNECTED_BIT);
+    wifi_events.state = WIFI_STATE_CONNECTING;
 
-    //checks if we returned due to a timeout or the bit was set
-    if ((bits & wifi_events.GOT_IP_BIT) == 0) {
-        ESP_LOGE(_WIFI_EVENTS_LOGGER, "Critical Error! Timedout while waiting to obtain an IP address");
+    //starts wifi connection. the STA_START event handler calls esp_wifi_connect
+    if (esp_wifi_start() != ESP_OK) {
+        ESP_LOGE(_WIFI_EVENTS_LOGGER, "Critical Error! Failed to start wifi");
+        wifi_events.state = WIFI_STATE_STOPPED;
         return ESP_FAIL;
     }
+    WAKE_TIMING_MARK(WAKE_PHASE_WIFI_STARTED);
 
-    ESP_LOGI(_WIFI_EVENTS_LOGGER, "Successfully connected to wifi");
-    return ESP_OK;
+    /*
+    State machine:
+    CONNECTING -> CONNECTED once the ip handler sets GOT_IP_BIT
+    CONNECTING -> BACKOFF on a disconnect (or an attempt timing out) that's worth retrying
+    BACKOFF -> CONNECTING after WIFI_RETRY_BASE_DELAY_MS * 2^attempt
+    CONNECTING -> FAILED on wrong credentials / no access point, when out of attempts, or when the next
+    attempt wouldn't finish within WIFI_AWAKE_BUDGET_US of the start of the connection
+    */
+
+    const uint32_t max_retries = use_cache ? 0 : WIFI_MAX_RETRIES;
+    const int attempt_timeout_ms = use_cache ? FAST_CONNECTION_TIMEOUT : WIFI_CONNECTION_TIMEOUT;
+    uint32_t attempt = 0;
+    int64_t attempt_deadline_us = sleep_hal_time_us() + attempt_timeout_ms * 1000LL;
+
+    while (true) {
+        int64_t deadline_us = (attempt_deadline_us < _awake_deadline_us) ? attempt_deadline_us : _awake_deadline_us;
+        int64_t wait_us = deadline_us - sleep_hal_time_us();
+        EventBits_t bits = 0;
+        if (wait_us > 0) {
+            //waits until the router gives us an ip address or the connection drops
+            bits = xEventGroupWaitBits(
+                wifi_events.wan_event_group,
+                wifi_events.GOT_IP_BIT | wifi_events.DISCONNECTED_BIT,
+                pdFALSE, //this parameter is set to true if we want to set the bit(s) back to 0 after it was set to 1
+                pdFALSE, //this is set to true if we're waiting on multiple bits and we want to wait until they're all set to 1
+                pdMS_TO_TICKS(wait_us / 1000) // how long we wait for before returning
+            );
+        }
+
+        if (bits & wifi_events.GOT_IP_BIT) {
+            wifi_events.state = WIFI_STATE_CONNECTED;
+            return ESP_OK;
+        }
+
+        if (bits & wifi_events.DISCONNECTED_BIT) {
+            xEventGroupClearBits(wifi_events.wan_event_group, wifi_events.DISCONNECTED_BIT);
+
+            if (_is_fatal_disconnect(wifi_events.disconnect_reason)) {
+                ESP_LOGE(_WIFI_EVENTS_LOGGER, "Critical Error! Unable to connect, reason %u. Not retrying", wifi_events.disconnect_reason);
+                break;
+            }
+        } else if (sleep_hal_time_us() >= _awake_deadline_us) {
+            ESP_LOGE(_WIFI_EVENTS_LOGGER, "Critical Error! Out of awake time while waiting to obtain an IP address");
+            break;
+        } else {
+            ESP_LOGW(_WIFI_EVENTS_LOGGER, "WARNING! Timedout while waiting to obtain an IP address");
+        }
+
+        if (attempt >= max_retries) {
+            ESP_LOGE(_WIFI_EVENTS_LOGGER, "Critical Error! Unable to connect after %u attempts", static_cast<unsigned>(attempt + 1));
+            break;
+        }
+
+        uint32_t delay_ms = WIFI_RETRY_BASE_DELAY_MS << attempt;
+        attempt += 1;
+
+        //a retry that can't finish before the budget runs out only burns power
+        if (sleep_hal_time_us() + delay_ms * 1000LL >= _awake_deadline_us) {
+            ESP_LOGE(_WIFI_EVENTS_LOGGER, "Critical Error! Not enough awake time left to retry");
+            break;
+        }
+
+        ESP_LOGW(_WIFI_EVENTS_LOGGER, "Retrying in %u ms (attempt %u of %u)",
+            static_cast<unsigned>(delay_ms), static_cast<unsigned>(attempt + 1), static_cast<unsigned>(max_retries + 1));
+        wifi_events.state = WIFI_STATE_BACKOFF;
+
+        //a timed out attempt can still be associated or mid handshake. its disconnect event is dropped below
+        esp_wifi_disconnect();
+        vTaskDelay(pdMS_TO_TICKS(delay_ms));
+
+        xEventGroupClearBits(wifi_events.wan_event_group, wifi_events.DISCONNECTED_BIT);
+        wifi_events.state = WIFI_STATE_CONNECTING;
+        attempt_deadline_us = sleep_hal_time_us() + attempt_timeout_ms * 1000LL;
+        if (esp_wifi_connect() != ESP_OK) {
+            ESP_LOGE(_WIFI_EVENTS_LOGGER, "Critical Error! Failed to reconnect");
+            break;
+        }
+    }
+
+    wifi_events.state = WIFI_STATE_FAILED;
+    return ESP_FAIL;
+}
+
+bool _is_fatal_disconnect(uint8_t reason) {
+    switch (reason) {
+        case WIFI_REASON_NO_AP_FOUND: //nothing with our ssid in range (or on the cached channel)
+        case WIFI_REASON_AUTH_FAIL: //wrong password
+        case WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT: //usually a wrong password too
+        case WIFI_REASON_HANDSHAKE_TIMEOUT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void _set_post_url(bool use_cached_ip) {
+    const char* server_url = leaf_settings.server_url;
+    char host[SERVER_HOST_LEN];
+    size_t host_len = _server_host(host, sizeof(host));
+
+    int len = 0;
+    if (use_cached_ip && host_len > 0 && wifi_cache_get().server_ip[0] != '\0') {
+        //swaps the host name for the cached address so the http client doesn't do a dns lookup
+        size_t host_start = strstr(server_url, host) - server_url;
+        len = snprintf(target_post_url, sizeof(target_post_url), "%.*s%s%s%s", static_cast<int>(host_start), server_url,
+            wifi_cache_get().server_ip, server_url + host_start + host_len, SUBMIT_READING_ROUTE);
+    } else {
+        len = snprintf(target_post_url, sizeof(target_post_url), "%s%s", server_url, SUBMIT_READING_ROUTE);
+    }
+    if (len < 0 || static_cast<size_t>(len) >= sizeof(target_post_url)) {
+        ESP_LOGE(_WIFI_EVENTS_LOGGER, "ERROR! Submit reading url is too long, it was cut to %s", target_post_url);
+    }
+
+    //the client holds on to the old url so it's recreated on the next request
+    http_transport_release();
+
+    //initializing http client and 
+    //registering http handler
+    http_client_config = {
+        .url = target_post_url,
+        .method = HTTP_METHOD_POST,
+        .timeout_ms = POST_TIMEOUT,
+        .event_handler = http_event_handler,
+        .keep_alive_enable = true, //tcp keep alive so an idle connection is noticed before the next request
+    };
+}
+
+size_t _server_host(char* host, size_t len) {
+    //the server url looks like scheme://host[:port][/path]
+    const char* server_url = leaf_settings.server_url;
+    const char* scheme_end = strstr(server_url, "://");
+    const char* host_start = (scheme_end == NULL) ? server_url : scheme_end + 3;
+    size_t host_len = strcspn(host_start, ":/");
+
+    if (host_len >= len) {
+        host_len = 0;
+    }
+    memcpy(host, host_start, host_len);
+    host[host_len] = '\0';
+    return host_len;
+}
+
+void _resolve_server_ip() {
+    char host[SERVER_HOST_LEN];
+    if (_server_host(host, sizeof(host)) == 0) {
+        ESP_LOGW(_WIFI_EVENTS_LOGGER, "WARNING! Server url has no host, not caching the backend address");
+        return;
+    }
+
+    //host is already an ip address, nothing to look up
+    struct in_addr addr;
+    if (inet_aton(host, &addr)) {
+        wifi_cache_save_server_ip(host);
+        return;
+    }
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo* res = NULL;
+    if (getaddrinfo(host, NULL, &hints, &res) != 0 || res == NULL) {
+        ESP_LOGW(_WIFI_EVENTS_LOGGER, "WARNING! Unable to resolve %s, not caching the backend address", host);
+        return;
+    }
+
+    char server_ip[IP4ADDR_STRLEN_MAX];
+    inet_ntoa_r(reinterpret_cast<struct sockaddr_in*>(res->ai_addr)->sin_addr, server_ip, sizeof(server_ip));
+    freeaddrinfo(res);
+
+    ESP_LOGI(_WIFI_EVENTS_LOGGER, "Resolved %s to %s", host, server_ip);
+    wifi_cache_save_server_ip(server_ip);
 }
 
 esp_err_t stop_wifi_connection() {
@@ -201,6 +481,14 @@ esp_err_t stop_wifi_connection() {
 
     esp_err_t ret_val = ESP_OK;
 
+    wifi_timing_report();
+
+    //the connection can't outlive the wifi
+    uplink_transport().release();
+
+    //the disconnect raised by stopping isn't a dropped connection
+    wifi_events.state = WIFI_STATE_STOPPED;
+
     ret_val = esp_wifi_stop();
     if (ret_val != ESP_OK) {
         ESP_LOGE(_WIFI_EVENTS_LOGGER, "Error when stopping wifi. wifi wasn't initialized by esp_wifi_init");
@@ -216,57 +504,117 @@ esp_err_t stop_wifi_connection() {
     return ret_val;
 }
 
-esp_err_t post_moisture_reading(const double reading) {
-
-    // convert reading to json
-    const std::string payload = _to_json(reading);
+esp_err_t http_transport_post(const char* payload, size_t len, const char* content_type) {
     bool err = false;
 
     /*
     Procedure:
-    1. make a http client config (already did in start_wifi func)
-    2. initialize an http client object using the http client config. returns a ptr
-    3. set the http header, method, and the post field
-    4. perform the Post request
-    5. free the http client
+    1. get the long lived http client. it's created on the first request after connecting to wifi
+    2. set the content type and post field
+    3. perform the Post request. the tcp connection is reused if the backend kept it alive. the response
+       body is handed to the directives parser as it arrives
+    4. on a transport error close the connection so the next request opens a fresh one
     */
 
-    esp_http_client_handle_t client = esp_http_client_init(&http_client_config);
+    esp_http_client_handle_t client = _get_http_client();
     if (client == NULL) {
-        ESP_LOGE(_WIFI_EVENTS_LOGGER, "ERROR! Unable to create HTTP Client");
-        err = true;
-    }
-
-    // set http header
-    if (esp_http_client_set_header(client, "content-type", "application/json") == ESP_OK) {
-        ESP_LOGE(_WIFI_EVENTS_LOGGER, "ERROR! Unable to set HTTP header");
-        err = true;
+        return ESP_FAIL;
     }
 
-    // set method to POST
-    if (esp_http_client_set_method(client, HTTP_METHOD_POST) != ESP_OK) {
-        ESP_LOGE(_WIFI_EVENTS_LOGGER, "ERROR! Unable to set HTTP_METHOD to POST");
-        err = true;
+    if (esp_http_client_set_header(client, "content-type", content_type) != ESP_OK) {
+        ESP_LOGE(_WIFI_EVENTS_LOGGER, "ERROR! Unable to set HTTP content type");
+        return ESP_FAIL;
     }
 
     //set post field
-    if (esp_http_client_set_post_field(client, payload.c_str(), payload.length()) != ESP_OK) {
+    if (esp_http_client_set_post_field(client, payload, len) != ESP_OK) {
         ESP_LOGE(_WIFI_EVENTS_LOGGER, "ERROR! Unable set HTTP Post field");
-        err = true;
+        return ESP_FAIL;
     }
 
-    //performs the request and frees resources
+    //performs the request. a request only counts as successful if the backend accepted it,
+    //otherwise the caller keeps its readings for the next attempt
+    //the response body is parsed for directives while it's read, see directives.hpp
+    DIRECTIVES_BEGIN_RESPONSE();
     esp_err_t res = esp_http_client_perform(client);
-    if (res == ESP_OK) {
+    int status = esp_http_client_get_status_code(client);
+    DIRECTIVES_END_RESPONSE(res == ESP_OK && status >= 200 && status < 300);
+    if (res == ESP_OK && status >= 200 && status < 300) {
         ESP_LOGI(_WIFI_EVENTS_LOGGER, "Successfully POST moisture reading!");
+    } else if (res == ESP_OK) {
+        ESP_LOGE(_WIFI_EVENTS_LOGGER, "ERROR! Backend rejected moisture reading. HTTP Status=%d", status);
+        err = true;
     } else {
         ESP_LOGE(_WIFI_EVENTS_LOGGER, "ERROR! Unable to POST moisture reading. Error Code=%s", esp_err_to_name(res));
+        err = true;
+
+        esp_http_client_close(client);
 
+        //the cached backend address might be stale, the next wake resolves it again
+        if (wifi_timing.fast_path) {
+            wifi_cache_invalidate();
+        }
     }
 
     return err ? ESP_FAIL: ESP_OK;
 }
 
+esp_http_client_handle_t _get_http_client() {
+    if (_http_client != NULL) {
+        return _http_client;
+    }
+
+    /*
+    Procedure:
+    1. initialize an http client object using the http client config (made in _set_post_url). returns a ptr
+    2. set the http headers and method. these stay set for every request made with the client. the content
+       type is set per request
+    */
+
+    _http_client = esp_http_client_init(&http_client_config);
+    if (_http_client == NULL) {
+        ESP_LOGE(_WIFI_EVENTS_LOGGER, "ERROR! Unable to create HTTP Client");
+        return NULL;
+    }
+
+    bool err = false;
+
+    //the url holds the cached ip on the fast path, the backend still needs the real host name
+    char host[SERVER_HOST_LEN];
+    if (wifi_timing.fast_path && _server_host(host, sizeof(host)) > 0 && esp_http_client_set_header(_http_client, "Host", host) != ESP_OK) {
+        ESP_LOGE(_WIFI_EVENTS_LOGGER, "ERROR! Unable to set HTTP Host header");
+        err = true;
+    }
+
+    // set method to POST
+    if (esp_http_client_set_method(_http_client, HTTP_METHOD_POST) != ESP_OK) {
+        ESP_LOGE(_WIFI_EVENTS_LOGGER, "ERROR! Unable to set HTTP_METHOD to POST");
+        err = true;
+    }
+
+    if (err) {
+        http_transport_release();
+    }
+
+    return _http_client;
+}
+
+void http_transport_release() {
+    if (_http_client == NULL) {
+        return;
+    }
+
+    //closes the kept alive connection and frees the resources allocated by esp_http_client_init
+    esp_http_client_cleanup(_http_client);
+    _http_client = NULL;
+}
+
+uplink_traffic_t http_transport_traffic() {
+    //esp_http_client doesn't count what goes over its connection
+    uplink_traffic_t traffic = {0, 0};
+    return traffic;
+}
+
 //**************implementation of event handlers
 
 //board will be listening to events through wifi so we use Wifi_event_sta (sta stands for station)
@@ -274,19 +622,39 @@ void wifi_event_handler(
     void* arg,
     esp_event_base_t event_base,
     int32_t event_id,
-    void* event_data //will be NULL
+    void* event_data //points to the event's struct, ie wifi_event_sta_connected_t for STA_CONNECTED
 ) {
     switch (event_id) {
         case WIFI_EVENT_STA_START:
-            ESP_LOGI(_WIFI_EVENTS_LOGGER, "Connecting to WIFI....");
+            EVENT_LOG_I(EVT_WIFI_CONNECTING);
             esp_wifi_connect();
             break;
+        case WIFI_EVENT_STA_STOP:
+            wifi_events.state = WIFI_STATE_STOPPED;
+            break;
         case WIFI_EVENT_STA_DISCONNECTED:
-            ESP_LOGW(_WIFI_EVENTS_LOGGER, "ESP32 has been disconnected from Wifi");
+        {
+            //retries are decided by _connect_to_ap, the handler only reports why
+            wifi_event_sta_disconnected_t* disconnected = static_cast<wifi_event_sta_disconnected_t*>(event_data);
+            wifi_events.disconnect_reason = disconnected->reason;
+            EVENT_LOG_W(EVT_WIFI_DISCONNECTED, disconnected->reason);
+
+            if (wifi_events.state == WIFI_STATE_CONNECTED) {
+                //nothing retries once connected, the next request fails and its readings are queued
+                wifi_events.state = WIFI_STATE_FAILED;
+                xEventGroupClearBits(wifi_events.wan_event_group, wifi_events.GOT_IP_BIT);
+            }
+            xEventGroupSetBits(wifi_events.wan_event_group, wifi_events.DISCONNECTED_BIT);
             break;
+        }
         case WIFI_EVENT_STA_CONNECTED:
-            ESP_LOGI(_WIFI_EVENTS_LOGGER, "Connected to WIFI");
+        {
+            //remembers the access point for the next fast reconnect
+            wifi_event_sta_connected_t* connected = static_cast<wifi_event_sta_connected_t*>(event_data);
+            EVENT_LOG_I(EVT_WIFI_CONNECTED, connected->channel);
+            wifi_cache_save_ap(connected->bssid, connected->channel);
             break;
+        }
         default:
             ESP_LOGE(_WIFI_EVENTS_LOGGER, "Unknown Event Id: %d", static_cast<int>(event_id));
             break;
@@ -300,25 +668,29 @@ void ip_event_handler(
     void* arg,
     esp_event_base_t event_base,
     int32_t event_id,
-    void* event_data //will be NULL
+    void* event_data //ip_event_got_ip_t for GOT_IP
 ) {
     switch (event_id) {
         case IP_EVENT_STA_GOT_IP:
-            //get's ip address that we've been assigned
-            esp_netif_ip_info_t ip_info;
-            esp_netif_get_ip_info(
-                //the handler function returns an object/handler that stores all info related to networking
-                esp_netif_get_handle_from_ifkey("WiFi_STA_DEF"), //gets the handlre for the wifi station
-                &ip_info //saves info from handler
-            );
-            char ip_addr[IP4ADDR_STRLEN_MAX];
-            esp_ip4addr_ntoa(&ip_info.ip, ip_addr, IP4ADDR_STRLEN_MAX); //copies Ip adrress into the ip_addr var
-            ESP_LOGI(_WIFI_EVENTS_LOGGER, "Received the ip adrress-%s", ip_addr);
+        {
+            wifi_timing_got_ip();
+            WAKE_TIMING_MARK(WAKE_PHASE_GOT_IP);
+
+            //get's ip address that we've been assigned. recorded in network byte order, the decoder prints it as hex
+            ip_event_got_ip_t* got_ip = static_cast<ip_event_got_ip_t*>(event_data);
+            EVENT_LOG_I(EVT_GOT_IP, static_cast<int32_t>(got_ip->ip_info.ip.addr));
+
+            //saves the lease and dns server for the next fast reconnect
+            esp_netif_dns_info_t dns_info;
+            memset(&dns_info, 0, sizeof(dns_info));
+            esp_netif_get_dns_info(got_ip->esp_netif, ESP_NETIF_DNS_MAIN, &dns_info);
+            wifi_cache_save_ip(got_ip->ip_info, dns_info.ip.u_addr.ip4);
 
             //sets the bit corresponding to ip data in the event group
             //allows other components that are subscribed to the event group to know that we've received an ip addr
             xEventGroupSetBits(wifi_events.wan_event_group, wifi_events.GOT_IP_BIT);
             break;
+        }
         default:
             ESP_LOGI(
                 _WIFI_EVENTS_LOGGER,
@@ -329,82 +701,35 @@ void ip_event_handler(
 }
 
 esp_err_t http_event_handler(esp_http_client_event_t* event) {
-    //buffer that stores the received data. declared static because we want the buffer to 
-    //last during the duration of the whole program
-    static char* output_buffer = NULL;
-    static int buff_data_len = 0; //len of data in the buffer, this is different from the buffer size
-
+    //runs several times per request so it only records events, nothing is formatted or copied
     switch (event->event_id) {
         case HTTP_EVENT_ERROR:
-            ESP_LOGE(_WIFI_EVENTS_LOGGER, "http_events_handler: HTTP_EVENT_ERROR");
+            EVENT_LOG_W(EVT_HTTP_ERROR);
             break;
         case HTTP_EVENT_ON_CONNECTED:
-            ESP_LOGI(_WIFI_EVENTS_LOGGER, "http_events_handler: HTTP_EVENT_ON_CONNECTED");
+            EVENT_LOG_D(EVT_HTTP_CONNECTED);
             break;
         case HTTP_EVENT_HEADER_SENT:
-            ESP_LOGI(_WIFI_EVENTS_LOGGER, "http_events_handler: HTTP_EVENT_HEADERS_SENT"); //sending http header for event
+            //the body is written right after the headers in the same perform call
+            WAKE_TIMING_MARK(WAKE_PHASE_REQUEST_SENT);
+            EVENT_LOG_D(EVT_HTTP_HEADER_SENT);
             break;
         case HTTP_EVENT_ON_HEADER: //received http header for an event
-            ESP_LOGI(
-                _WIFI_EVENTS_LOGGER,
-                "http_events_handler: HTTP_EVENT_ON_HEADER, recevied http header. key=%s, value=%s", event->header_key, event->header_value);
+            wifi_timing_first_byte();
+            WAKE_TIMING_MARK(WAKE_PHASE_RESPONSE);
+            EVENT_LOG_D(EVT_HTTP_HEADER);
             break;
         case HTTP_EVENT_ON_FINISH:
-            ESP_LOGI(_WIFI_EVENTS_LOGGER, "http_events_handler: HTTP_EVENT_ON_FINISH");
-            //clearing the buffer
-            buff_data_len = 0;
-            if (output_buffer != NULL) {
-                free(output_buffer);
-                output_buffer = NULL;
-            }
+            EVENT_LOG_D(EVT_HTTP_FINISH);
             break;
         case HTTP_EVENT_DISCONNECTED:
-            ESP_LOGI(_WIFI_EVENTS_LOGGER, "http_events_handler: HTTP_EVENT_DISCONNECTED");
-            buff_data_len = 0;
-            if (output_buffer != NULL) {
-                free(output_buffer);
-                output_buffer = NULL;
-            }
+            EVENT_LOG_D(EVT_HTTP_DISCONNECTED);
             break;
         case HTTP_EVENT_ON_DATA:
-        {
-            ESP_LOGI(_WIFI_EVENTS_LOGGER, "http_events_handler: HTTP_EVENT_ON_DATA, data_len: %d", event->data_len);
-
-            if (output_buffer == NULL) {
-                output_buffer = (char*) malloc(sizeof(char) * HTTP_BUFF_LEN);
-                if (output_buffer == NULL){
-                    //means we weren't able to allocate memory for the buffer
-                    ESP_LOGE(_WIFI_EVENTS_LOGGER, "Error! Unable to allocate memory for http buffer");
-                    return ESP_FAIL;
-                }
-                memset(output_buffer, 0, HTTP_BUFF_LEN);
-            }
-
-            //copies data into the buffer
-
-            int rem_space = HTTP_BUFF_LEN - buff_data_len; //space left in our buffer
-            int copy_len = _min(event->data_len, rem_space); //returns the smaller value
-            if (copy_len > 0) {
-                //output_buff+buff_data_len (ptr arithmetic) gets the index of the last valid character in the buff. then we copy the data
-                //from the http event to the remainin space
-                memcpy(output_buffer+buff_data_len, event->data, copy_len);
-                buff_data_len += copy_len;
-            }
-
-            //allows us to print what's curr in the buffer
-            char* curr_buff = (char*)malloc(buff_data_len+1);
-            if (curr_buff != NULL){
-                memcpy(curr_buff, output_buffer, buff_data_len);
-                curr_buff[buff_data_len] = '\0'; //null char termination
-                ESP_LOGI(_WIFI_EVENTS_LOGGER, "http_events_handler: HTTP_EVENT_ON_DATA, buff_len: %d , buff_data: %s", buff_data_len, curr_buff);
-
-                free(curr_buff);
-                curr_buff = NULL;
-            }
+            EVENT_LOG_D(EVT_HTTP_DATA, event->data_len);
+            DIRECTIVES_FEED(static_cast<const char*>(event->data), event->data_len);
             break;
-        }
         case HTTP_EVENT_REDIRECT:
-            ESP_LOGI(_WIFI_EVENTS_LOGGER, "http_events_handler: HTTP_EVENT_REDIRECT");
             break;
         default:
             ESP_LOGE(_WIFI_EVENTS_LOGGER, "https_events_handler: Unknown event id: %d", event->event_id);
@@ -413,21 +738,3 @@ esp_err_t http_event_handler(esp_http_client_event_t* event) {
 
     return ESP_OK;
 }
-
-const std::string _to_json(const double value) {
-    const std::string plant_name = std::string(reinterpret_cast<const char*>(leaf_info.plant_name));
-
-    /*
-    {
-        "plant name": "<plant's name>",
-        "moisture val" "<moisture val"
-    }
-    */
-    const std::string json_str = "{\"plant name\":\"" + plant_name + "\", \"moisture\" :\"" + std::to_string(value) + "}";
-
-    return json_str;
-}
-
-int _min(int n1, int n2) {
-    return (n1 < n2) ? n1: n2;
-}
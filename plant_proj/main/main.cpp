@@ -1,26 +1,26 @@
 #include <freertos/FreeRTOS.h>
 #include "esp_mac.h"
 #include <esp_mac.h>
-#include "nvs_flash.h"
 #include <esp_log.h> // logger
 #include <esp_heap_caps.h> // used to get the size of the heap (where we allocate memory). this is flash mem on the esp32
 #include "moisture_tracker.hpp"
+#include "continuous_mode.hpp"
 #include "leaf_config.hpp"
+#include "sleep_hal.hpp"
 
 static const char* _main_logger = "MAIN";
 
+//logging goes out over the uart and adds up to a good part of a timer wake. set to ESP_LOG_INFO to see every
+//wake's logs. the boot to sleep comparison is in the event log either way
+static const esp_log_level_t TIMER_WAKE_LOG_LEVEL = ESP_LOG_WARN;
+
 esp_err_t setup() {
     esp_err_t ret = ESP_OK;
-    esp_err_t mem_check = nvs_flash_init();
-    if (mem_check != ESP_OK) {
-        ESP_LOGE(_main_logger, "Error! Encountered a problem when initializing NVS");
-    } else {
-        ESP_LOGI(_main_logger, "Successfully initialized NVS");
-    }
 
     size_t mem_size = esp_get_free_heap_size();
     ESP_LOGI(_main_logger, "Memory Avaliable for use: %u bytes", mem_size);
 
+    //NVS is initialized by leaf_config, and only when the config isn't cached in rtc memory
     initialize_leaf_config();
 
     return ret;
@@ -28,19 +28,30 @@ esp_err_t setup() {
 
 extern "C" void app_main(void)
 {
+    //timer wakes take the minimal path. the config comes from the rtc cache, the adc, wifi and flash queue are only
+    //brought up if the wake needs them, and the wake cycle runs on this task instead of a new one
+    if (sleep_hal_woke_from_timer()) {
+        esp_log_level_set("*", TIMER_WAKE_LOG_LEVEL);
+        initialize_leaf_config();
+        moisture_tracker_run();
+        return;
+    }
+
     ESP_LOGI("MAIN", "Initializing the Main Function");
 
     if (setup() != ESP_OK){
         ESP_LOGE(_main_logger, "Encountered an error in setup function");
     }
 
-    xTaskCreate(
-        moisture_tracker, // task/function to call
-        "moisture_tracker", //the name used to refer to our task
-        4096, // allocated 4kb of memory for this task to use
-        NULL, // task parameters
-        5, //priority. 
-        NULL //task handler
-    );
-    
-}
\ No newline at end of file
+    //mains powered nodes never sleep, the sampler and uplink tasks take over from the wake cycle
+    if (CONTINUOUS_MODE) {
+        if (continuous_mode_start() != ESP_OK) {
+            ESP_LOGE(_main_logger, "Encountered an error starting continuous mode");
+        }
+        return;
+    }
+
+    if (moisture_tracker_start() != ESP_OK) {
+        ESP_LOGE(_main_logger, "Encountered an error starting the moisture tracker");
+    }
+}
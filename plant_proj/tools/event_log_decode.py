@@ -0,0 +1,96 @@
+# Decoder for the dumps of the deferred binary event log (see components/event_log).
+# Reads a console capture, turns every "ELOG:<hex>" line back into text using the formats in event_log_events.hpp
+# and passes every other line through unchanged, so it can sit at the end of a pipe:
+#
+# usage: python3 event_log_decode.py [capture file] [--events path/to/event_log_events.hpp]
+#   ./build/plant_proj.elf | python3 tools/event_log_decode.py
+#   idf.py monitor | python3 tools/event_log_decode.py
+
+import os
+import re
+import struct
+import sys
+
+DEFAULT_EVENTS_PATH = os.path.join(os.path.dirname(__file__), '..', 'components', 'event_log', 'include', 'event_log_events.hpp')
+
+# must match event_log_entry_t
+_ENTRY = struct.Struct('<IHBB2i')
+LEVEL_NAMES = {1: 'E', 2: 'W', 3: 'I', 4: 'D'}
+
+_EVENT_RE = re.compile(r'X\((\w+),\s*"((?:[^"\\]|\\.)*)"\)')
+_FORMAT_RE = re.compile(r'%(0?\d*)([dux])')
+
+
+def load_events(path):
+    """Returns the (name, format) of every event, indexed by event id"""
+    with open(path) as f:
+        text = f.read()
+
+    # only the list itself, the comment above it shows the syntax
+    return _EVENT_RE.findall(text[text.index('#define EVENT_LOG_EVENTS(X)'):])
+
+
+def format_event(fmt, args):
+    """Fills a format with the entry's args. the formats are printf style, %u and %x print the arg as unsigned"""
+    args = iter(args)
+
+    def fill(match):
+        width, conv = match.groups()
+        value = next(args, 0)
+        if conv in 'ux':
+            value &= 0xFFFFFFFF
+        return ('%' + width + conv.replace('u', 'd')) % value
+
+    return _FORMAT_RE.sub(fill, fmt)
+
+
+def decode_entry(hex_data, events):
+    """Decodes one ELOG line's hex into text"""
+    time_us, wake, event_id, level, arg0, arg1 = _ENTRY.unpack(bytes.fromhex(hex_data))
+    if event_id < len(events):
+        name, fmt = events[event_id]
+        text = format_event(fmt, (arg0, arg1))
+    else:
+        name, text = 'EVT_%d' % event_id, 'unknown event, args %d %d' % (arg0, arg1)
+
+    return 'wake %5u %10.3f ms %s %-22s %s' % (wake, time_us / 1000.0, LEVEL_NAMES.get(level, '?'), name, text)
+
+
+def decode_stream(lines, events, out):
+    for line in lines:
+        marker = line.find('ELOG')
+        if marker < 0:
+            out.write(line)
+            continue
+
+        record = line[marker:].strip()
+        if record.startswith('ELOG:'):
+            try:
+                out.write(decode_entry(record[5:], events) + '\n')
+            except (ValueError, struct.error):
+                out.write('malformed entry: %s\n' % record)
+        elif record.startswith('ELOG-BEGIN'):
+            parts = record.split()
+            lost = int(parts[2]) if len(parts) > 2 else 0
+            out.write('---- event log, %s entries%s ----\n' % (parts[1] if len(parts) > 1 else '?',
+                      ', %d older ones were overwritten' % lost if lost else ''))
+        elif record.startswith('ELOG-END'):
+            out.write('---- end of event log ----\n')
+        else:
+            out.write(line)
+
+
+if __name__ == '__main__':
+    argv = sys.argv[1:]
+    events_path = DEFAULT_EVENTS_PATH
+    if '--events' in argv:
+        i = argv.index('--events')
+        events_path = argv[i + 1]
+        del argv[i:i + 2]
+
+    events = load_events(events_path)
+    if argv:
+        with open(argv[0], errors='replace') as f:
+            decode_stream(f, events, sys.stdout)
+    else:
+        decode_stream(sys.stdin, events, sys.stdout)
@@ -0,0 +1,398 @@
+#include <esp_log.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+#include "uplink_transport.hpp"
+#include "mqtt_transport.hpp"
+#include "json_encoder.hpp"
+#include "binary_encoder.hpp"
+#include "reading_buffer.hpp"
+#include "leaf_config.hpp"
+#include "wifi_handler.hpp"
+
+/**
+ * Fleet load simulator. runs FLEET_NODES virtual nodes on a pool of FLEET_WORKERS threads against the local
+ * stand-in server (tools/stand_in_server.py) or broker (tools/stand_in_broker.py). every node has its own wake
+ * interval, jitter, plants and drying curve. it buffers its readings and every FLEET_UPLOAD_EVERY wakes sends
+ * them through the firmware's payload encoders and uplink transport, then drops the connection like a node
+ * going back to sleep. the report compares the transports by bytes on air per reading and round trip latency
+ *
+ * settings are read from environment variables (see _load_settings). time is compressed so the wake interval
+ * is in milliseconds
+ */
+
+typedef struct {
+    int nodes; //FLEET_NODES
+    int workers; //FLEET_WORKERS
+    int duration_s; //FLEET_DURATION_S
+    int interval_ms; //FLEET_INTERVAL_MS, mean wake interval of a node
+    int jitter_pct; //FLEET_JITTER_PCT, spread of the nodes' intervals and of every single wake
+    int upload_every; //FLEET_UPLOAD_EVERY, wakes between uploads
+    payload_format_t format; //FLEET_FORMAT, "json" or "binary"
+    uplink_kind_t transport; //FLEET_TRANSPORT, "http" or "mqtt"
+    int qos; //FLEET_QOS, 0 or 1 for mqtt
+} sim_settings_t;
+
+typedef struct {
+    uint32_t id;
+    uint32_t rng; //xorshift state
+    uint8_t plant_count;
+    char plant_names[MAX_PLANTS][16];
+    const char* plant_name_ptrs[MAX_PLANTS];
+    double moisture_mv[MAX_PLANTS];
+    double drying_mv[MAX_PLANTS]; //how fast each plant dries, in mV per wake when wet
+    uint32_t wake_count;
+    int64_t interval_us;
+    int64_t next_wake_us; //relative to the start of the simulation
+    reading_record_t records[READING_BUFFER_CAPACITY]; //oldest first
+    size_t record_count;
+} sim_node_t;
+
+typedef struct {
+    std::vector<sim_node_t*> nodes;
+    std::vector<uint32_t> latencies_us; //of the requests that succeeded
+    std::vector<uint32_t> upload_latencies_us; //of the uploads that succeeded, all their requests together
+    uint32_t requests;
+    uint32_t failures;
+    uint32_t encode_failures;
+    uint32_t readings_sent;
+    uint64_t bytes_sent; //payloads only
+    uplink_traffic_t traffic; //everything the transport put on the connection
+    int64_t max_lag_us; //worst delay between a wake's scheduled time and when it ran
+    pthread_t thread;
+} sim_worker_t;
+
+static const char* _logger = "Fleet Sim *** ";
+static const double WET_MV = 1300.0; //probe output in saturated soil
+static const double DRY_MV = 2800.0; //probe output in dry soil
+
+static sim_settings_t _settings;
+static int64_t _start_us; //host clock when the simulation started
+
+static int64_t _now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int _env_int(const char* name, int fallback) {
+    const char* value = getenv(name);
+    if (value == NULL || *value == '\0') {
+        return fallback;
+    }
+
+    int parsed = atoi(value);
+    return parsed >= 0 ? parsed : fallback;
+}
+
+static void _load_settings() {
+    _settings.nodes = std::max(1, _env_int("FLEET_NODES", 200));
+    _settings.workers = std::max(1, _env_int("FLEET_WORKERS", 16));
+    _settings.duration_s = std::max(1, _env_int("FLEET_DURATION_S", 30));
+    _settings.interval_ms = std::max(1, _env_int("FLEET_INTERVAL_MS", 1000));
+    _settings.jitter_pct = std::min(90, _env_int("FLEET_JITTER_PCT", 20));
+    _settings.upload_every = std::max(1, _env_int("FLEET_UPLOAD_EVERY", 8));
+
+    const char* format = getenv("FLEET_FORMAT");
+    _settings.format = (format != NULL && strcmp(format, "binary") == 0) ? PAYLOAD_BINARY : PAYLOAD_JSON;
+
+    const char* transport = getenv("FLEET_TRANSPORT");
+    _settings.transport = (transport != NULL && strcmp(transport, "mqtt") == 0) ? UPLINK_MQTT : UPLINK_HTTP;
+    _settings.qos = std::min(1, _env_int("FLEET_QOS", MQTT_QOS));
+}
+
+static uint32_t _next_rand(sim_node_t& node) {
+    node.rng ^= node.rng << 13;
+    node.rng ^= node.rng >> 17;
+    node.rng ^= node.rng << 5;
+    return node.rng;
+}
+
+//uniform in [-1, 1]
+static double _rand_unit(sim_node_t& node) {
+    return (_next_rand(node) % 20001) / 10000.0 - 1.0;
+}
+
+static void _init_node(sim_node_t& node, uint32_t id) {
+    node.id = id;
+    node.rng = id * 2654435761u + 1; //never 0, xorshift would get stuck
+    node.plant_count = 1 + _next_rand(node) % 4;
+
+    for (size_t i = 0; i < node.plant_count; ++i) {
+        snprintf(node.plant_names[i], sizeof(node.plant_names[i]), "n%u-p%u", static_cast<unsigned>(id), static_cast<unsigned>(i));
+        node.plant_name_ptrs[i] = node.plant_names[i];
+        node.moisture_mv[i] = WET_MV + (DRY_MV - WET_MV) * (_rand_unit(node) + 1.0) / 2.0;
+        node.drying_mv[i] = 5.0 + 20.0 * (_rand_unit(node) + 1.0);
+    }
+
+    double jitter = _settings.jitter_pct / 100.0;
+    node.interval_us = static_cast<int64_t>(_settings.interval_ms * 1000.0 * (1.0 + jitter * _rand_unit(node)));
+    node.next_wake_us = static_cast<int64_t>(node.interval_us * (_rand_unit(node) + 1.0) / 2.0); //spreads the first wakes
+    node.wake_count = 0;
+    node.record_count = 0;
+}
+
+//soil dries fast while wet and slower as it approaches DRY_MV, until it's watered
+static int32_t _sample_plant(sim_node_t& node, size_t plant) {
+    double& mv = node.moisture_mv[plant];
+
+    mv += node.drying_mv[plant] * (DRY_MV - mv) / (DRY_MV - WET_MV);
+    if (mv > DRY_MV - 150.0 && _next_rand(node) % 20 == 0) {
+        mv = WET_MV + 100.0 * (_rand_unit(node) + 1.0);
+    }
+
+    //nodes report percent, a straight line between the two ends is close enough for load tests
+    double noisy = mv + 5.0 * _rand_unit(node);
+    double percent = 100.0 * (DRY_MV - noisy) / (DRY_MV - WET_MV);
+    return static_cast<int32_t>(percent * MOISTURE_SCALE);
+}
+
+static void _buffer_reading(sim_node_t& node, const reading_record_t& record) {
+    //same policy as the rtc buffer: the oldest reading is dropped when it's full
+    if (node.record_count == READING_BUFFER_CAPACITY) {
+        std::copy(node.records + 1, node.records + READING_BUFFER_CAPACITY, node.records);
+        node.record_count -= 1;
+    }
+    node.records[node.record_count++] = record;
+}
+
+static size_t _encode(const sim_node_t& node, const reading_record_t* records, size_t count, char* payload, size_t cap) {
+    if (_settings.format == PAYLOAD_BINARY) {
+        return encode_readings_binary(
+            reinterpret_cast<uint8_t*>(payload), cap,
+            node.id, node.plant_count,
+            records, count, NULL, NULL, NULL
+        );
+    }
+    return encode_readings_json(
+        payload, cap,
+        node.plant_name_ptrs, node.plant_count, sizeof(node.plant_names[0]),
+        records, count, NULL, NULL, NULL
+    );
+}
+
+static esp_err_t _send(sim_worker_t& worker, const uplink_message_t& message) {
+    int64_t start = _now_us();
+    esp_err_t res = (_settings.transport == UPLINK_MQTT)
+        ? mqtt_transport_publish(message, _settings.qos)
+        : HTTP_UPLINK.send(message);
+    int64_t latency = _now_us() - start;
+
+    worker.requests += 1;
+    worker.bytes_sent += message.len;
+    if (res != ESP_OK) {
+        worker.failures += 1;
+        return res;
+    }
+    worker.latencies_us.push_back(static_cast<uint32_t>(latency));
+    return ESP_OK;
+}
+
+static void _upload(sim_worker_t& worker, sim_node_t& node, char* payload, size_t cap) {
+    const uplink_transport_t& transport = (_settings.transport == UPLINK_MQTT) ? MQTT_UPLINK : HTTP_UPLINK;
+    uplink_message_t message = {
+        .payload = payload,
+        .len = 0,
+        .content_type = _settings.format == PAYLOAD_BINARY ? BINARY_CONTENT_TYPE : "application/json",
+        .node_id = node.id,
+        .plant_id = 0,
+    };
+
+    //http sends the whole buffer in one request, mqtt publishes every reading on its plant's topic
+    //like the firmware's uploader. stops at the first failure, the rest is kept for the next upload
+    int64_t start = _now_us();
+    size_t batch = transport.per_reading ? 1 : node.record_count;
+    size_t sent = 0;
+    while (sent < node.record_count) {
+        message.len = _encode(node, node.records + sent, batch, payload, cap);
+        message.plant_id = node.records[sent].plant_id;
+        if (message.len == 0) {
+            worker.encode_failures += 1;
+            sent = node.record_count; //dropped
+            break;
+        }
+        if (_send(worker, message) != ESP_OK) {
+            break;
+        }
+        sent += batch;
+        worker.readings_sent += batch;
+    }
+    int64_t latency = _now_us() - start;
+
+    //the node goes back to sleep after every upload so the next one opens a new connection
+    transport.release();
+
+    if (sent == node.record_count) {
+        worker.upload_latencies_us.push_back(static_cast<uint32_t>(latency));
+    }
+    std::copy(node.records + sent, node.records + node.record_count, node.records);
+    node.record_count -= sent;
+}
+
+static void _run_wake(sim_worker_t& worker, sim_node_t& node, char* payload, size_t cap) {
+    node.wake_count += 1;
+
+    for (size_t i = 0; i < node.plant_count; ++i) {
+        reading_record_t record = {
+            .wake_id = node.wake_count,
+            .moisture = _sample_plant(node, i),
+            .timestamp = 0, //virtual nodes never sync their clock, the backend stamps the readings
+            .time_error_s = 0,
+            .plant_id = static_cast<uint8_t>(i),
+        };
+        _buffer_reading(node, record);
+    }
+
+    if (node.wake_count % _settings.upload_every == 0) {
+        _upload(worker, node, payload, cap);
+    }
+
+    double jitter = _settings.jitter_pct / 200.0;
+    node.next_wake_us += static_cast<int64_t>(node.interval_us * (1.0 + jitter * _rand_unit(node)));
+}
+
+static void* _worker_main(void* arg) {
+    sim_worker_t& worker = *static_cast<sim_worker_t*>(arg);
+    std::vector<char> payload(PAYLOAD_BUFFER_LEN);
+    int64_t end_us = static_cast<int64_t>(_settings.duration_s) * 1000000;
+
+    while (true) {
+        //the node that's due next. a worker only serves a handful of nodes so a scan is enough
+        sim_node_t* next = NULL;
+        for (sim_node_t* node : worker.nodes) {
+            if (next == NULL || node->next_wake_us < next->next_wake_us) {
+                next = node;
+            }
+        }
+        if (next == NULL || next->next_wake_us >= end_us) {
+            break;
+        }
+
+        int64_t due = _start_us + next->next_wake_us;
+        int64_t now = _now_us();
+        if (due > now) {
+            struct timespec ts = {
+                .tv_sec = static_cast<time_t>(due / 1000000),
+                .tv_nsec = static_cast<long>((due % 1000000) * 1000),
+            };
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        } else {
+            worker.max_lag_us = std::max(worker.max_lag_us, now - due);
+        }
+
+        _run_wake(worker, *next, payload.data(), payload.size());
+    }
+
+    //the transports count per thread
+    worker.traffic = (_settings.transport == UPLINK_MQTT) ? MQTT_UPLINK.traffic() : HTTP_UPLINK.traffic();
+    return NULL;
+}
+
+static uint32_t _percentile(const std::vector<uint32_t>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    return sorted[static_cast<size_t>(p * (sorted.size() - 1))];
+}
+
+static void _report(const std::vector<sim_worker_t>& workers, int64_t elapsed_us) {
+    std::vector<uint32_t> latencies;
+    std::vector<uint32_t> upload_latencies;
+    uint32_t requests = 0;
+    uint32_t failures = 0;
+    uint32_t encode_failures = 0;
+    uint32_t readings_sent = 0;
+    uint64_t bytes_sent = 0;
+    uint64_t air_sent = 0;
+    uint64_t air_received = 0;
+    int64_t max_lag_us = 0;
+
+    for (const sim_worker_t& worker : workers) {
+        latencies.insert(latencies.end(), worker.latencies_us.begin(), worker.latencies_us.end());
+        upload_latencies.insert(upload_latencies.end(), worker.upload_latencies_us.begin(), worker.upload_latencies_us.end());
+        requests += worker.requests;
+        failures += worker.failures;
+        encode_failures += worker.encode_failures;
+        readings_sent += worker.readings_sent;
+        bytes_sent += worker.bytes_sent;
+        air_sent += worker.traffic.bytes_sent;
+        air_received += worker.traffic.bytes_received;
+        max_lag_us = std::max(max_lag_us, worker.max_lag_us);
+    }
+    std::sort(latencies.begin(), latencies.end());
+    std::sort(upload_latencies.begin(), upload_latencies.end());
+
+    double elapsed_s = elapsed_us / 1000000.0;
+    if (_settings.transport == UPLINK_MQTT) {
+        ESP_LOGI(_logger, "%d nodes, %d workers, %.1f s, %s payloads over mqtt QoS %d", _settings.nodes, _settings.workers,
+            elapsed_s, _settings.format == PAYLOAD_BINARY ? "binary" : "json", _settings.qos);
+    } else {
+        ESP_LOGI(_logger, "%d nodes, %d workers, %.1f s, %s payloads over http", _settings.nodes, _settings.workers,
+            elapsed_s, _settings.format == PAYLOAD_BINARY ? "binary" : "json");
+    }
+    ESP_LOGI(_logger, "requests: %u (%.1f req/s), failed: %u (%.2f%%), unencodable batches: %u",
+        static_cast<unsigned>(requests), requests / elapsed_s,
+        static_cast<unsigned>(failures), requests == 0 ? 0.0 : 100.0 * failures / requests,
+        static_cast<unsigned>(encode_failures));
+    ESP_LOGI(_logger, "request latency ms: p50 %.2f, p90 %.2f, p99 %.2f, max %.2f",
+        _percentile(latencies, 0.50) / 1000.0, _percentile(latencies, 0.90) / 1000.0,
+        _percentile(latencies, 0.99) / 1000.0, _percentile(latencies, 1.0) / 1000.0);
+    ESP_LOGI(_logger, "upload latency ms: p50 %.2f, p90 %.2f, p99 %.2f, max %.2f",
+        _percentile(upload_latencies, 0.50) / 1000.0, _percentile(upload_latencies, 0.90) / 1000.0,
+        _percentile(upload_latencies, 0.99) / 1000.0, _percentile(upload_latencies, 1.0) / 1000.0);
+    ESP_LOGI(_logger, "payload bytes: %llu total, %.1f per request",
+        static_cast<unsigned long long>(bytes_sent), requests == 0 ? 0.0 : static_cast<double>(bytes_sent) / requests);
+
+    //connection setup and teardown included, tcp/ip headers not
+    double per_reading = readings_sent == 0 ? 0.0 : 1.0 / readings_sent;
+    ESP_LOGI(_logger, "bytes on air per reading: %.1f sent, %.1f received (%u readings)",
+        air_sent * per_reading, air_received * per_reading, static_cast<unsigned>(readings_sent));
+
+    //a worker that can't keep up with its nodes' schedules caps the request rate below what the server could take
+    if (max_lag_us > static_cast<int64_t>(_settings.interval_ms) * 1000) {
+        ESP_LOGW(_logger, "WARNING! Workers fell up to %.1f ms behind schedule, results are limited by FLEET_WORKERS",
+            max_lag_us / 1000.0);
+    }
+}
+
+extern "C" void app_main(void) {
+    _load_settings();
+
+    //the firmware logs every request, only the report is wanted here
+    esp_log_level_set("*", ESP_LOG_WARN);
+    esp_log_level_set(_logger, ESP_LOG_INFO);
+
+    std::vector<sim_node_t> nodes(_settings.nodes);
+    std::vector<sim_worker_t> workers(_settings.workers);
+    for (int i = 0; i < _settings.nodes; ++i) {
+        _init_node(nodes[i], static_cast<uint32_t>(i + 1));
+        workers[i % _settings.workers].nodes.push_back(&nodes[i]);
+    }
+
+    ESP_LOGI(_logger, "Running %d nodes on %d workers for %d s", _settings.nodes, _settings.workers, _settings.duration_s);
+
+    //the workers are plain pthreads next to the freertos simulator. they block every signal so the
+    //simulator's tick signal is never delivered to them
+    sigset_t all_signals;
+    sigset_t previous;
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_BLOCK, &all_signals, &previous);
+
+    _start_us = _now_us();
+    for (sim_worker_t& worker : workers) {
+        pthread_create(&worker.thread, NULL, _worker_main, &worker);
+    }
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    for (sim_worker_t& worker : workers) {
+        pthread_join(worker.thread, NULL);
+    }
+
+    _report(workers, _now_us() - _start_us);
+    exit(0);
+}
@@ -0,0 +1,56 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <atomic>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "bench.hpp"
+
+volatile int64_t bench_sink = 0;
+
+static std::atomic<uint64_t> _allocations(0);
+
+//every other operator new and delete goes through these
+void* operator new(size_t size) {
+    _allocations += 1;
+    void* p = malloc(size > 0 ? size : 1);
+    if (p == NULL) {
+        abort(); //esp-idf builds without exceptions
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t size) noexcept {
+    free(p);
+}
+
+uint64_t bench_allocations() {
+    return _allocations;
+}
+
+uint64_t bench_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+uint64_t bench_time_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void bench_report(const bench_result_t& result) {
+    printf("BENCH %s: %llu ns/op", result.name, static_cast<unsigned long long>(result.ns_per_op));
+    if (result.cycles_per_op > 0) {
+        printf(" %llu cycles/op", static_cast<unsigned long long>(result.cycles_per_op));
+    }
+    printf(" %.1f allocs/op\n", static_cast<double>(result.allocations) / result.iterations);
+}
@@ -0,0 +1,78 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Microbenchmark helpers. an operation is run for a fixed number of iterations and timed with the host's
+ * monotonic clock and, on x86, the time stamp counter. the host is much faster than the esp32 so the figures
+ * are for comparing implementations with each other, not for the node's timing budget. heap allocations
+ * through operator new are counted too, bench.cpp replaces the global one
+ */
+
+typedef struct {
+    const char* name;
+    size_t iterations;
+    uint64_t ns_per_op;
+    uint64_t cycles_per_op; //0 where the host has no cycle counter
+    uint64_t allocations; //operator new calls during all iterations
+} bench_result_t;
+
+//results are written here so the compiler can't drop the benchmarked calls
+extern volatile int64_t bench_sink;
+
+/**
+ * @return returns the host's cycle counter, 0 where there is none
+ */
+uint64_t bench_cycles();
+
+/**
+ * @return returns the host's monotonic clock in nanoseconds
+ */
+uint64_t bench_time_ns();
+
+/**
+ * @return returns the number of operator new calls since the program started, from any thread
+ */
+uint64_t bench_allocations();
+
+/**
+ * Prints a result as one line, "BENCH <name>: <ns>/op <cycles>/op <allocations>/op"
+ * @param result the result
+ */
+void bench_report(const bench_result_t& result);
+
+/**
+ * Times an operation. it runs once before the timing starts so caches and lazy state are warm
+ * @param name name printed with the result
+ * @param iterations number of timed runs
+ * @param op the operation, called with the iteration's index
+ * @return returns the mean cost of one run, it's also printed
+ */
+template <typename Op>
+bench_result_t bench_run(const char* name, size_t iterations, Op op) {
+    op(0);
+
+    uint64_t start_allocations = bench_allocations();
+    uint64_t start_ns = bench_time_ns();
+    uint64_t start_cycles = bench_cycles();
+    for (size_t i = 0; i < iterations; ++i) {
+        op(i);
+    }
+    uint64_t cycles = bench_cycles() - start_cycles;
+    uint64_t ns = bench_time_ns() - start_ns;
+    uint64_t allocations = bench_allocations() - start_allocations;
+
+    bench_result_t result = {
+        .name = name,
+        .iterations = iterations,
+        .ns_per_op = ns / iterations,
+        .cycles_per_op = cycles / iterations,
+        .allocations = allocations,
+    };
+    bench_report(result);
+    return result;
+}
+
+#endif
@@ -0,0 +1,28 @@
+#include <esp_log.h>
+#include <stdlib.h>
+#include "unity.h"
+
+/**
+ * Host unit tests and microbenchmarks of the firmware. the test cases are registered by the test_*.cpp files
+ * with unity's TEST_CASE, tests tagged [bench] print their timings (see bench.hpp)
+ *
+ * HOST_TESTS_TAG runs only the tests with that tag (ie "[bench]" or "[filter]"), HOST_TESTS_TAG="![bench]"
+ * everything but them. the exit code is the number of failed tests
+ */
+
+extern "C" void app_main(void) {
+    //the firmware logs every wake, only the test results are wanted here
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    const char* tag = getenv("HOST_TESTS_TAG");
+
+    UNITY_BEGIN();
+    if (tag == NULL || tag[0] == '\0') {
+        unity_run_all_tests();
+    } else if (tag[0] == '!') {
+        unity_run_tests_by_tag(tag + 1, true);
+    } else {
+        unity_run_tests_by_tag(tag, false);
+    }
+    exit(UNITY_END());
+}
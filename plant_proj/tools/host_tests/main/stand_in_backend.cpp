@@ -0,0 +1,154 @@
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include "stand_in_backend.hpp"
+
+static const uint16_t BACKEND_PORT = 8080; //where http_transport_linux.cpp sends its requests
+static const size_t HEADER_LEN = 2048;
+
+static int _listen_sock = -1;
+static std::atomic<int> _status(200);
+static std::atomic<uint32_t> _requests(0);
+static std::mutex _body_lock; //the backend thread writes the body, the tests read it
+static char _body[STAND_IN_BODY_LEN];
+static size_t _body_len = 0;
+
+//reads until the end of the headers. returns false once the client closed the connection
+static bool _read_headers(int sock, char* buff, size_t cap, size_t* len, size_t* header_end) {
+    *len = 0;
+    while (true) {
+        if (*len == cap - 1) {
+            return false;
+        }
+        ssize_t n = recv(sock, buff + *len, cap - 1 - *len, 0);
+        if (n <= 0) {
+            return false;
+        }
+        *len += n;
+        buff[*len] = '\0';
+
+        char* end = strstr(buff, "\r\n\r\n");
+        if (end != NULL) {
+            *header_end = end + 4 - buff;
+            return true;
+        }
+    }
+}
+
+static void _serve_connection(int sock) {
+    char buff[HEADER_LEN];
+    size_t len = 0;
+    size_t header_end = 0;
+
+    //the transport keeps the connection alive between requests
+    while (_read_headers(sock, buff, sizeof(buff), &len, &header_end)) {
+        size_t content_length = 0;
+        for (char* line = strstr(buff, "\r\n"); line != NULL && line < buff + header_end; line = strstr(line + 2, "\r\n")) {
+            if (strncasecmp(line + 2, "Content-Length:", 15) == 0) {
+                content_length = strtoul(line + 2 + 15, NULL, 10);
+            }
+        }
+
+        //the body started arriving with the headers
+        std::lock_guard<std::mutex> guard(_body_lock);
+        size_t received = len - header_end;
+        _body_len = std::min(received, sizeof(_body) - 1);
+        memcpy(_body, buff + header_end, _body_len);
+        while (received < content_length) {
+            char chunk[512];
+            ssize_t n = recv(sock, chunk, std::min(sizeof(chunk), content_length - received), 0);
+            if (n <= 0) {
+                return;
+            }
+            size_t keep = std::min(static_cast<size_t>(n), sizeof(_body) - 1 - _body_len);
+            memcpy(_body + _body_len, chunk, keep);
+            _body_len += keep;
+            received += n;
+        }
+        _body[_body_len] = '\0';
+
+        char response[128];
+        int response_len = snprintf(response, sizeof(response),
+            "HTTP/1.1 %d Stand-in\r\nContent-Length: 0\r\nConnection: keep-alive\r\n\r\n", _status.load());
+        _requests += 1;
+        if (send(sock, response, response_len, MSG_NOSIGNAL) != response_len) {
+            return;
+        }
+    }
+}
+
+static void* _backend_main(void* arg) {
+    while (true) {
+        int sock = accept(_listen_sock, NULL, NULL);
+        if (sock < 0) {
+            continue;
+        }
+        _serve_connection(sock);
+        close(sock);
+    }
+    return NULL;
+}
+
+bool stand_in_backend_start() {
+    if (_listen_sock >= 0) {
+        return true;
+    }
+
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) {
+        return false;
+    }
+    int one = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(BACKEND_PORT);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    if (bind(sock, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 || listen(sock, 4) != 0) {
+        printf("Unable to listen on 127.0.0.1:%u, is tools/stand_in_server.py running?\n", BACKEND_PORT);
+        close(sock);
+        return false;
+    }
+    _listen_sock = sock;
+
+    //a plain pthread next to the freertos simulator. it blocks every signal so the simulator's tick signal
+    //is never delivered to it
+    sigset_t all_signals;
+    sigset_t previous;
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_BLOCK, &all_signals, &previous);
+    pthread_t thread;
+    pthread_create(&thread, NULL, _backend_main, NULL);
+    pthread_detach(thread);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    return true;
+}
+
+void stand_in_backend_set_status(int status) {
+    _status = status;
+}
+
+uint32_t stand_in_backend_requests() {
+    return _requests;
+}
+
+size_t stand_in_backend_last_body(char* out, size_t len) {
+    std::lock_guard<std::mutex> guard(_body_lock);
+    size_t n = std::min(_body_len, len - 1);
+    memcpy(out, _body, n);
+    out[n] = '\0';
+    return n;
+}
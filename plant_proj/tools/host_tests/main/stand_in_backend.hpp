@@ -0,0 +1,40 @@
+#ifndef STAND_IN_BACKEND_HPP
+#define STAND_IN_BACKEND_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * In process stand-in for the backend, so the wake cycle tests can upload without tools/stand_in_server.py.
+ * it listens where the linux http transport sends its requests (127.0.0.1:8080), reads one request at a time
+ * and answers every one with the configured status and an empty body. nothing else may use the port while the
+ * tests run
+ */
+
+#define STAND_IN_BODY_LEN 8192 //longer bodies are cut, the request is still read entirely
+
+/**
+ * Starts listening on the first call, later calls do nothing
+ * @return returns false if the port couldn't be bound
+ */
+bool stand_in_backend_start();
+
+/**
+ * @param status http status every following request is answered with
+ */
+void stand_in_backend_set_status(int status);
+
+/**
+ * @return returns the number of requests received since the backend started
+ */
+uint32_t stand_in_backend_requests();
+
+/**
+ * Copies the body of the latest request
+ * @param out buffer the body is copied into, null terminated
+ * @param len size of out
+ * @return returns the length of the body, 0 if there was no request yet
+ */
+size_t stand_in_backend_last_body(char* out, size_t len);
+
+#endif
@@ -0,0 +1,124 @@
+#include "unity.h"
+#include "adaptive_sampling.hpp"
+#include "leaf_config.hpp"
+#include "moisture_sensor.hpp"
+#include "bench.hpp"
+
+static const uint64_t MINUTE_US = 60000000;
+
+//the trend estimates live in rtc memory and carry over from earlier tests (and the wake cycle tests), so every
+//test first reports the values once and then holds the plants still until the trend has decayed
+static void _settle(const int32_t* values, size_t count) {
+    leaf_settings.sleep_interval_s = MIN_SLEEP_DURATION / 1000000;
+
+    //a step away and back is reported both ways
+    int32_t away[MAX_PLANTS];
+    for (size_t i = 0; i < count; ++i) {
+        away[i] = values[i] + 2 * MOISTURE_DEADBAND;
+    }
+    adaptive_sampling_update(away, count);
+
+    for (int i = 0; i < 40; ++i) {
+        adaptive_sampling_mark_uploaded();
+        adaptive_sampling_slept(MINUTE_US);
+        adaptive_sampling_update(values, count);
+    }
+}
+
+TEST_CASE("readings within the deadband aren't reported", "[adaptive_sampling]")
+{
+    int32_t values[2] = {5000, 3000};
+    _settle(values, 2);
+
+    values[0] = 5000 + MOISTURE_DEADBAND - 1;
+    values[1] = 3000 - (MOISTURE_DEADBAND - 1);
+    TEST_ASSERT_FALSE(adaptive_sampling_update(values, 2).report);
+
+    //the change is measured against the last reported value, not the previous wake
+    values[1] = 3000 - MOISTURE_DEADBAND;
+    TEST_ASSERT_TRUE(adaptive_sampling_update(values, 2).report);
+    TEST_ASSERT_FALSE(adaptive_sampling_update(values, 2).report);
+}
+
+TEST_CASE("a plant without a reading is left out", "[adaptive_sampling]")
+{
+    int32_t values[2] = {5000, 3000};
+    _settle(values, 2);
+
+    //neither a change worth reporting nor a jump in the trend
+    int32_t missing[2] = {5000, MOISTURE_NO_READING};
+    sample_decision_t decision = adaptive_sampling_update(missing, 2);
+    TEST_ASSERT_FALSE(decision.report);
+    TEST_ASSERT_EQUAL_UINT64(MAX_SLEEP_DURATION, decision.next_sleep_us);
+    TEST_ASSERT_FALSE(adaptive_sampling_update(values, 2).report);
+}
+
+TEST_CASE("a heartbeat is forced after HEARTBEAT_WAKES wakes without an upload", "[adaptive_sampling]")
+{
+    int32_t values[1] = {4000};
+    _settle(values, 1);
+
+    adaptive_sampling_mark_uploaded();
+    for (uint32_t i = 1; i < HEARTBEAT_WAKES; ++i) {
+        sample_decision_t decision = adaptive_sampling_update(values, 1);
+        TEST_ASSERT_FALSE(decision.heartbeat);
+        TEST_ASSERT_FALSE(decision.report);
+    }
+
+    TEST_ASSERT_TRUE(adaptive_sampling_heartbeat_due());
+    sample_decision_t decision = adaptive_sampling_update(values, 1);
+    TEST_ASSERT_TRUE(decision.heartbeat);
+    TEST_ASSERT_TRUE(decision.report);
+}
+
+TEST_CASE("sleep follows the fastest changing plant within the configured bounds", "[adaptive_sampling]")
+{
+    int32_t values[2] = {5000, 5000};
+    _settle(values, 2);
+
+    //stable soil sleeps as long as allowed
+    TEST_ASSERT_EQUAL_UINT64(MAX_SLEEP_DURATION, adaptive_sampling_update(values, 2).next_sleep_us);
+
+    //10 percent in a minute on one plant
+    adaptive_sampling_slept(MINUTE_US);
+    values[1] += 1000;
+    sample_decision_t decision = adaptive_sampling_update(values, 2);
+    TEST_ASSERT_LESS_THAN_UINT64(MAX_SLEEP_DURATION / 4, decision.next_sleep_us);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT64(MIN_SLEEP_DURATION, decision.next_sleep_us);
+
+    //a longer configured interval (ie from a directive) raises the floor of this wake's sleep
+    leaf_settings.sleep_interval_s = 600;
+    TEST_ASSERT_EQUAL_UINT64(600 * 1000000ULL, adaptive_sampling_reclamp(decision.next_sleep_us));
+    leaf_settings.sleep_interval_s = MIN_SLEEP_DURATION / 1000000;
+}
+
+TEST_CASE("the trend is measured over the interval that was actually slept", "[adaptive_sampling]")
+{
+    int32_t values[1] = {5000};
+
+    //the same change after a minute and after a backed off 8 minutes
+    _settle(values, 1);
+    adaptive_sampling_slept(MINUTE_US);
+    values[0] += 1000;
+    uint64_t after_minute = adaptive_sampling_update(values, 1).next_sleep_us;
+
+    _settle(values, 1);
+    adaptive_sampling_slept(8 * MINUTE_US);
+    values[0] += 1000;
+    uint64_t after_backoff = adaptive_sampling_update(values, 1).next_sleep_us;
+
+    //an 8x slower trend sleeps about 8x longer
+    TEST_ASSERT_GREATER_THAN_UINT64(after_minute * 6, after_backoff);
+}
+
+TEST_CASE("adaptive sampling microbenchmark", "[adaptive_sampling][bench]")
+{
+    int32_t values[MAX_PLANTS] = {5000, 5100, 5200, 5300, 5400, 5500, 5600, 5700};
+    _settle(values, MAX_PLANTS);
+
+    bench_run("adaptive sampling update, 8 plants", 1000000, [&](size_t i) {
+        values[i % MAX_PLANTS] += (i & 1) ? 7 : -7;
+        bench_sink = adaptive_sampling_update(values, MAX_PLANTS).next_sleep_us;
+    });
+    adaptive_sampling_mark_uploaded();
+}
@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "moisture_calibration.hpp"
+#include "bench.hpp"
+
+//the probe in moisture_calibration.cpp, which keeps it private. the first test checks the copy still matches
+static constexpr probe_calibration_t CAPACITIVE_V1_2 = {
+    .points = {
+        {1300, 10000},
+        {1500, 8500},
+        {1800, 6000},
+        {2200, 3000},
+        {2550, 1000},
+        {2800, 0},
+    },
+    .point_count = 6,
+    .mv_per_c = 0,
+};
+static constexpr calibration_lut_t CAPACITIVE_V1_2_LUT = calibration_build_lut(CAPACITIVE_V1_2);
+
+//a probe whose output rises with temperature. its points are on table entries so the line has no corners between them
+static constexpr probe_calibration_t TWO_POINT_WARM = {
+    .points = {
+        {1200, 10000},
+        {2592, 0},
+    },
+    .point_count = 2,
+    .mv_per_c = 3,
+};
+static constexpr calibration_lut_t TWO_POINT_WARM_LUT = calibration_build_lut(TWO_POINT_WARM);
+
+static const int32_t MAX_MV = 3400; //above the esp32's input range
+static const int32_t MAX_ERROR = 30; //hundredths of a percent, see CALIBRATION_STEP_SHIFT
+
+/**
+ * Compares the table lookup with the exact curve at every mV
+ * @return returns the largest error in hundredths of a percent
+ */
+static int32_t _max_error(const probe_calibration_t& probe, const calibration_lut_t& lut, int32_t temp_c) {
+    int32_t offset_mv = probe.mv_per_c * (temp_c - CALIBRATION_REFERENCE_TEMP_C);
+    int32_t worst = 0;
+    for (int32_t mv = 0; mv <= MAX_MV; ++mv) {
+        int32_t expected = calibration_curve(probe, mv);
+        int32_t actual = calibration_mv_to_percent(lut, (mv + offset_mv) * CALIBRATION_PERCENT_SCALE, CALIBRATION_PERCENT_SCALE, temp_c);
+        int32_t error = (actual > expected) ? actual - expected : expected - actual;
+        if (error > worst) {
+            worst = error;
+        }
+        TEST_ASSERT_INT32_WITHIN(MAX_ERROR, expected, actual);
+    }
+    return worst;
+}
+
+TEST_CASE("channel tables are built from the capacitive probe's points", "[calibration]")
+{
+    for (size_t i = 0; i < CALIBRATION_CHANNELS; ++i) {
+        TEST_ASSERT_EQUAL_MEMORY(&CAPACITIVE_V1_2_LUT, CHANNEL_CALIBRATIONS[i], sizeof(calibration_lut_t));
+    }
+}
+
+TEST_CASE("table lookup follows the curve over the whole mV range", "[calibration]")
+{
+    int32_t worst = _max_error(CAPACITIVE_V1_2, CAPACITIVE_V1_2_LUT, CALIBRATION_REFERENCE_TEMP_C);
+    printf("CALIBRATION capacitive v1.2, 0 to %d mV: max error %d.%02d percent\n",
+        static_cast<int>(MAX_MV), static_cast<int>(worst / 100), static_cast<int>(worst % 100));
+
+    worst = _max_error(TWO_POINT_WARM, TWO_POINT_WARM_LUT, CALIBRATION_REFERENCE_TEMP_C);
+    TEST_ASSERT_LESS_OR_EQUAL_INT32(2, worst); //a straight line only has rounding error
+}
+
+TEST_CASE("table lookup takes the temperature out of the probe output", "[calibration]")
+{
+    _max_error(TWO_POINT_WARM, TWO_POINT_WARM_LUT, 35);
+    _max_error(TWO_POINT_WARM, TWO_POINT_WARM_LUT, 0);
+
+    //without the correction a probe 15 C above the reference reads 45 mV drier
+    int32_t uncorrected = calibration_mv_to_percent(TWO_POINT_WARM_LUT, 1896 + 45, 1, CALIBRATION_REFERENCE_TEMP_C);
+    int32_t corrected = calibration_mv_to_percent(TWO_POINT_WARM_LUT, 1896 + 45, 1, CALIBRATION_REFERENCE_TEMP_C + 15);
+    TEST_ASSERT_EQUAL_INT32(50, corrected);
+    TEST_ASSERT_LESS_THAN_INT32(50, uncorrected);
+}
+
+TEST_CASE("table lookup clamps below and above the table", "[calibration]")
+{
+    TEST_ASSERT_EQUAL_INT32(100, calibration_mv_to_percent(CAPACITIVE_V1_2_LUT, 0, 1, CALIBRATION_REFERENCE_TEMP_C));
+    TEST_ASSERT_EQUAL_INT32(100, calibration_mv_to_percent(CAPACITIVE_V1_2_LUT, -50, 1, CALIBRATION_REFERENCE_TEMP_C));
+    TEST_ASSERT_EQUAL_INT32(0, calibration_mv_to_percent(CAPACITIVE_V1_2_LUT, 3300, 1, CALIBRATION_REFERENCE_TEMP_C));
+    TEST_ASSERT_EQUAL_INT32(0, calibration_mv_to_percent(CAPACITIVE_V1_2_LUT, 100000, 1, CALIBRATION_REFERENCE_TEMP_C));
+}
+
+TEST_CASE("bench calibration lookup", "[calibration][bench]")
+{
+    bench_run("calibration_mv_to_percent", 1000000, [](size_t i) {
+        bench_sink = calibration_mv_to_percent(CAPACITIVE_V1_2_LUT, static_cast<int32_t>(i % MAX_MV) * 100, 100, CALIBRATION_REFERENCE_TEMP_C);
+    });
+}
@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <algorithm>
+#include <string>
+#include "unity.h"
+#include "leaf_config.hpp"
+#include "moisture_sensor.hpp"
+#include "directives.hpp"
+
+/**
+ * Feeds response bodies to the directives parser in chunks of every size the transports hand it, down to a
+ * character at a time, and checks what each one leaves in leaf_settings
+ */
+
+static const size_t CHUNK_SIZES[] = {1, 2, 3, 100};
+static const uint16_t START_SAMPLES = 16;
+static const uint32_t START_SLEEP_S = 300;
+
+typedef struct {
+    const char* name;
+    std::string body;
+    bool accepted;
+    uint32_t sleep_s; //what leaf_settings should hold after the response
+    uint16_t samples;
+    bool flush;
+} directive_case_t;
+
+static void _respond(const directive_case_t& test, size_t chunk) {
+    leaf_settings.sample_size = START_SAMPLES;
+    leaf_settings.sleep_interval_s = START_SLEEP_S;
+    directives_flush_done();
+
+    directives_begin_response();
+    for (size_t i = 0; i < test.body.size(); i += chunk) {
+        directives_feed(test.body.data() + i, std::min(chunk, test.body.size() - i));
+    }
+    directives_end_response(test.accepted);
+}
+
+TEST_CASE("directives parse the same whatever the body is split into", "[directives]")
+{
+    //deeper than the nesting counter goes, the body is dropped
+    std::string deep = "{\"x\": " + std::string(256, '[') + std::string(256, ']') + ", \"sleep_s\": 60}";
+
+    const directive_case_t cases[] = {
+        {"all three", "{\"sleep_s\": 60, \"samples\": 32, \"flush\": true}", true, 60, 32, true},
+        {"whitespace and trailing text", " \r\n{ \"samples\" :\t8 }\nthanks", true, START_SLEEP_S, 8, false},
+        {"nested values are skipped",
+            "{\"meta\": {\"a\": [1, {\"b\": \"}]\\\"{\"}], \"sleep_s\": 9}, \"list\": [[], {}], \"sleep_s\": 120}",
+            true, 120, START_SAMPLES, false},
+        {"escapes in strings and keys",
+            "{\"note\": \"say \\\"hi\\\" \\\\\", \"sleep\\u005fs\": 30, \"samp\\\"les\": 4, \"samples\": 24}",
+            true, START_SLEEP_S, 24, false},
+        {"keys and literals past the token buffer",
+            "{\"sleep_s_and_then_some_more\": 30, \"sleep_s\": 0000000000000000090, \"samples\": 12, \"flush\": true}",
+            true, START_SLEEP_S, 12, true},
+        {"values out of range or overflowing",
+            "{\"sleep_s\": 7, \"samples\": 99999999999, \"flush\": 1}", true, START_SLEEP_S, START_SAMPLES, false},
+        {"an invalid value leaves the others", "{\"sleep_s\": 86401, \"samples\": 100, \"flush\": false}",
+            true, START_SLEEP_S, 100, false},
+        {"nested too deep", deep, true, START_SLEEP_S, START_SAMPLES, false},
+        {"truncated", "{\"sleep_s\": 60, \"samples\": 32", true, START_SLEEP_S, START_SAMPLES, false},
+        {"truncated in a literal", "{\"sleep_s\": 60", true, START_SLEEP_S, START_SAMPLES, false},
+        {"not an object", "ok", true, START_SLEEP_S, START_SAMPLES, false},
+        {"missing colon", "{\"sleep_s\" 60}", true, START_SLEEP_S, START_SAMPLES, false},
+        {"empty", "", true, START_SLEEP_S, START_SAMPLES, false},
+        {"rejected request", "{\"sleep_s\": 60, \"samples\": 32, \"flush\": true}", false,
+            START_SLEEP_S, START_SAMPLES, false},
+    };
+
+    leaf_settings_t saved = leaf_settings;
+    for (const directive_case_t& test : cases) {
+        for (size_t chunk : CHUNK_SIZES) {
+            char message[96];
+            snprintf(message, sizeof(message), "%s, %u byte chunks", test.name, static_cast<unsigned>(chunk));
+            _respond(test, chunk);
+            TEST_ASSERT_EQUAL_UINT32_MESSAGE(test.sleep_s, leaf_settings.sleep_interval_s, message);
+            TEST_ASSERT_EQUAL_UINT16_MESSAGE(test.samples, leaf_settings.sample_size, message);
+            TEST_ASSERT_EQUAL_MESSAGE(test.flush, directives_flush_pending(), message);
+        }
+    }
+
+    directives_flush_done();
+    leaf_settings = saved;
+}
+
+TEST_CASE("samples are limited to what a capture of every plant converts in time", "[directives]")
+{
+    leaf_settings_t saved = leaf_settings;
+    uint8_t plant_count = leaf_info.plant_count;
+
+    for (uint8_t plants : {1, 2, MAX_PLANTS}) {
+        leaf_info.plant_count = plants;
+        uint32_t max_n = static_cast<uint32_t>(moisture_sensor_max_samples(plants));
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(MAX_SAMPLE_SIZE, max_n);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(ADC_MAX_FRAME_MS, max_n * ADC_OVERSAMPLE_FACTOR * plants * 1000 / ADC_SAMPLE_FREQ_HZ);
+
+        directive_case_t at_limit = {"at the limit", "{\"samples\": " + std::to_string(max_n) + "}", true,
+            START_SLEEP_S, static_cast<uint16_t>(max_n), false};
+        _respond(at_limit, 1);
+        TEST_ASSERT_EQUAL_UINT16(max_n, leaf_settings.sample_size);
+
+        directive_case_t past_limit = {"past the limit", "{\"samples\": " + std::to_string(max_n + 1) + "}", true,
+            START_SLEEP_S, START_SAMPLES, false};
+        _respond(past_limit, 1);
+        TEST_ASSERT_EQUAL_UINT16(START_SAMPLES, leaf_settings.sample_size);
+    }
+
+    leaf_info.plant_count = plant_count;
+    leaf_settings = saved;
+}
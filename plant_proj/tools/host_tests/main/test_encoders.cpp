@@ -0,0 +1,195 @@
+#include <string.h>
+#include "unity.h"
+#include "json_encoder.hpp"
+#include "binary_encoder.hpp"
+#include "bench.hpp"
+
+static const char* const PLANT_NAMES[] = {"fern", "basil"};
+static const size_t NAME_LEN = 16;
+
+static uint32_t _read_u32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static uint16_t _read_u16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+TEST_CASE("json batch has every reading and leaves ts out of untimed ones", "[encoder]")
+{
+    const reading_record_t records[] = {
+        {.wake_id = 7, .moisture = 4256, .timestamp = 1700000000, .time_error_s = 3, .plant_id = 0},
+        {.wake_id = 8, .moisture = -5, .timestamp = 0, .time_error_s = 0, .plant_id = 1},
+    };
+    char buf[256];
+
+    size_t len = encode_readings_json(buf, sizeof(buf), PLANT_NAMES, 2, NAME_LEN, records, 2, NULL, NULL, NULL);
+    TEST_ASSERT_EQUAL_STRING(
+        "{\"readings\":["
+        "{\"plant name\":\"fern\",\"wake\":7,\"moisture\":42.56,\"ts\":1700000000,\"ts_err\":3},"
+        "{\"plant name\":\"basil\",\"wake\":8,\"moisture\":-0.05}"
+        "]}", buf);
+    TEST_ASSERT_EQUAL(strlen(buf), len);
+}
+
+TEST_CASE("json escapes plant names and skips unknown plants", "[encoder]")
+{
+    const char* const names[] = {"a\"b\\c\n"};
+    const reading_record_t records[] = {
+        {.wake_id = 1, .moisture = 100, .timestamp = 0, .time_error_s = 0, .plant_id = 0},
+        {.wake_id = 1, .moisture = 100, .timestamp = 0, .time_error_s = 0, .plant_id = 5},
+    };
+    char buf[128];
+
+    encode_readings_json(buf, sizeof(buf), names, 1, NAME_LEN, records, 2, NULL, NULL, NULL);
+    TEST_ASSERT_EQUAL_STRING("{\"readings\":[{\"plant name\":\"a\\\"b\\\\c\\u000a\",\"wake\":1,\"moisture\":1.00}]}", buf);
+}
+
+TEST_CASE("json reports a payload that doesn't fit instead of truncating it", "[encoder]")
+{
+    const reading_record_t record = {.wake_id = 1, .moisture = 100, .timestamp = 0, .time_error_s = 0, .plant_id = 0};
+    char buf[256];
+
+    size_t len = encode_readings_json(buf, sizeof(buf), PLANT_NAMES, 2, NAME_LEN, &record, 1, NULL, NULL, NULL);
+    TEST_ASSERT_GREATER_THAN(0, len);
+
+    //one byte is kept for the null terminator so a buffer of exactly len bytes is too small
+    TEST_ASSERT_EQUAL(0, encode_readings_json(buf, len, PLANT_NAMES, 2, NAME_LEN, &record, 1, NULL, NULL, NULL));
+    TEST_ASSERT_EQUAL(len, encode_readings_json(buf, len + 1, PLANT_NAMES, 2, NAME_LEN, &record, 1, NULL, NULL, NULL));
+}
+
+TEST_CASE("json fixed point and base64 helpers", "[encoder]")
+{
+    char buf[64];
+    json_writer_t w = json_writer_init(buf, sizeof(buf));
+    json_write_fixed_point(w, 5, 100);
+    json_write_literal(w, " ");
+    json_write_fixed_point(w, INT32_MIN, 100);
+    json_write_literal(w, " ");
+    json_write_uint(w, UINT32_MAX);
+    json_write_literal(w, " ");
+    json_write_base64(w, reinterpret_cast<const uint8_t*>("leaf"), 4);
+    json_writer_finish(w);
+    TEST_ASSERT_EQUAL_STRING("0.05 -21474836.48 4294967295 bGVhZg==", buf);
+}
+
+TEST_CASE("binary header and records", "[encoder]")
+{
+    const reading_record_t records[] = {
+        {.wake_id = 100, .moisture = 4256, .timestamp = 0, .time_error_s = 0, .plant_id = 1},
+        {.wake_id = 103, .moisture = -7, .timestamp = 1700000000, .time_error_s = 300, .plant_id = 0},
+        {.wake_id = 104, .moisture = 1, .timestamp = 1700000008, .time_error_s = 2, .plant_id = 9}, //unknown plant
+    };
+    uint8_t buf[64];
+
+    size_t len = encode_readings_binary(buf, sizeof(buf), 0xA1B2C3D4, 2, records, 3, NULL, NULL, NULL);
+    TEST_ASSERT_EQUAL(15 + 2 * 10, len);
+
+    TEST_ASSERT_EQUAL_UINT8(BINARY_FORMAT_VERSION, buf[0]);
+    TEST_ASSERT_EQUAL_UINT8(0, buf[1]);
+    TEST_ASSERT_EQUAL_UINT32(0xA1B2C3D4, _read_u32(buf + 2));
+    TEST_ASSERT_EQUAL_UINT32(100, _read_u32(buf + 6));
+    TEST_ASSERT_EQUAL_UINT32(1700000000, _read_u32(buf + 10)); //first record that has a timestamp
+    TEST_ASSERT_EQUAL_UINT8(2, buf[14]);
+
+    const uint8_t* record = buf + 15;
+    TEST_ASSERT_EQUAL_UINT8(1, record[0]);
+    TEST_ASSERT_EQUAL_UINT16(0, _read_u16(record + 1));
+    TEST_ASSERT_EQUAL_INT32(4256, static_cast<int32_t>(_read_u32(record + 3)));
+    TEST_ASSERT_EQUAL_UINT16(BINARY_NO_TIME, _read_u16(record + 7));
+
+    record += 10;
+    TEST_ASSERT_EQUAL_UINT8(0, record[0]);
+    TEST_ASSERT_EQUAL_UINT16(3, _read_u16(record + 1));
+    TEST_ASSERT_EQUAL_INT32(-7, static_cast<int32_t>(_read_u32(record + 3)));
+    TEST_ASSERT_EQUAL_UINT16(0, _read_u16(record + 7));
+    TEST_ASSERT_EQUAL_UINT8(UINT8_MAX, record[9]); //the error bound saturates
+}
+
+TEST_CASE("binary rejects batches it can't represent", "[encoder]")
+{
+    reading_record_t records[BINARY_MAX_RECORDS + 1];
+    for (size_t i = 0; i < BINARY_MAX_RECORDS + 1; ++i) {
+        records[i] = {.wake_id = static_cast<uint32_t>(i), .moisture = 0, .timestamp = 0, .time_error_s = 0, .plant_id = 0};
+    }
+    static uint8_t buf[4096];
+
+    TEST_ASSERT_GREATER_THAN(0, encode_readings_binary(buf, sizeof(buf), 1, 1, records, BINARY_MAX_RECORDS, NULL, NULL, NULL));
+    TEST_ASSERT_EQUAL(0, encode_readings_binary(buf, sizeof(buf), 1, 1, records, BINARY_MAX_RECORDS + 1, NULL, NULL, NULL));
+
+    //wake span past a u16
+    records[1].wake_id = UINT16_MAX + 1;
+    TEST_ASSERT_EQUAL(0, encode_readings_binary(buf, sizeof(buf), 1, 1, records, 2, NULL, NULL, NULL));
+
+    //a timestamp before the base time, the clock was moved back by a sync
+    records[1].wake_id = 1;
+    records[0].timestamp = 1700000000;
+    records[1].timestamp = 1699999999;
+    TEST_ASSERT_EQUAL(0, encode_readings_binary(buf, sizeof(buf), 1, 1, records, 2, NULL, NULL, NULL));
+
+    //too small a buffer
+    TEST_ASSERT_EQUAL(0, encode_readings_binary(buf, 15 + 10 - 1, 1, 1, records, 1, NULL, NULL, NULL));
+}
+
+TEST_CASE("memory trailer leaves out unrecorded tasks", "[encoder]")
+{
+    const reading_record_t records[] = {
+        {.wake_id = 5, .moisture = 100, .timestamp = 0, .time_error_s = 0, .plant_id = 0},
+    };
+    mem_stats_t mem = {};
+    mem.heap_free = 150000;
+    mem.heap_min_free = 120000;
+    mem.heap_largest_block = 90000;
+    mem.tasks[MEM_TASK_MAIN] = {.stack_size = 4096, .stack_min_free = 1200};
+    mem.tasks[MEM_TASK_UPLINK] = {.stack_size = 70000, .stack_min_free = 66000}; //past a u16
+    char json[256];
+    uint8_t buf[64];
+
+    size_t len = encode_readings_json(json, sizeof(json), PLANT_NAMES, 2, NAME_LEN, records, 1, NULL, &mem, NULL);
+    TEST_ASSERT_EQUAL_STRING(
+        "{\"readings\":[{\"plant name\":\"fern\",\"wake\":5,\"moisture\":1.00}],"
+        "\"mem\":{\"heap\":[150000,120000,90000],\"main\":[4096,1200],\"uplink\":[70000,66000]}}", json);
+    TEST_ASSERT_EQUAL(strlen(json), len);
+
+    //without the trailer the flag is clear and the payload ends after the records
+    TEST_ASSERT_EQUAL(15 + 10, encode_readings_binary(buf, sizeof(buf), 1, 2, records, 1, NULL, NULL, NULL));
+    TEST_ASSERT_EQUAL_UINT8(0, buf[1]);
+
+    len = encode_readings_binary(buf, sizeof(buf), 1, 2, records, 1, NULL, &mem, NULL);
+    TEST_ASSERT_EQUAL(15 + 10 + 13 + 2 * 4, len);
+    TEST_ASSERT_EQUAL_UINT8(BINARY_FLAG_MEMORY, buf[1]);
+
+    const uint8_t* trailer = buf + 15 + 10;
+    TEST_ASSERT_EQUAL_UINT32(150000, _read_u32(trailer));
+    TEST_ASSERT_EQUAL_UINT32(120000, _read_u32(trailer + 4));
+    TEST_ASSERT_EQUAL_UINT32(90000, _read_u32(trailer + 8));
+    TEST_ASSERT_EQUAL_UINT8((1 << MEM_TASK_MAIN) | (1 << MEM_TASK_UPLINK), trailer[12]);
+    TEST_ASSERT_EQUAL_UINT16(4096, _read_u16(trailer + 13));
+    TEST_ASSERT_EQUAL_UINT16(1200, _read_u16(trailer + 15));
+    TEST_ASSERT_EQUAL_UINT16(UINT16_MAX, _read_u16(trailer + 17)); //stack figures saturate
+    TEST_ASSERT_EQUAL_UINT16(UINT16_MAX, _read_u16(trailer + 19));
+}
+
+TEST_CASE("encoder microbenchmark", "[encoder][bench]")
+{
+    //a full upload of 16 wakes of two plants
+    reading_record_t records[32];
+    for (size_t i = 0; i < 32; ++i) {
+        records[i] = {
+            .wake_id = static_cast<uint32_t>(1000 + i / 2),
+            .moisture = static_cast<int32_t>(4000 + i * 37),
+            .timestamp = static_cast<uint32_t>(1700000000 + (i / 2) * 480),
+            .time_error_s = 2,
+            .plant_id = static_cast<uint8_t>(i % 2),
+        };
+    }
+    static char json[4096];
+    static uint8_t binary[1024];
+
+    bench_run("json encode, 32 readings", 20000, [&](size_t) {
+        bench_sink = encode_readings_json(json, sizeof(json), PLANT_NAMES, 2, NAME_LEN, records, 32, NULL, NULL, NULL);
+    });
+    bench_run("binary encode, 32 readings", 20000, [&](size_t) {
+        bench_sink = encode_readings_binary(binary, sizeof(binary), 1, 2, records, 32, NULL, NULL, NULL);
+    });
+}
@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "unity.h"
+#include "event_log.hpp"
+
+/**
+ * Records more events than the ring holds and checks the dump. with HOST_TESTS_PAYLOADS=<dir> the dump is written
+ * to <dir>/event_log.txt and what went in to <dir>/event_log.events.json for tools/test_event_log_decode.py
+ */
+
+#define EVENT_LOG_NAME(name, format) #name,
+#define EVENT_LOG_FORMAT(name, format) format,
+static const char* const EVENT_NAMES[] = {EVENT_LOG_EVENTS(EVENT_LOG_NAME)};
+static const char* const EVENT_FORMATS[] = {EVENT_LOG_EVENTS(EVENT_LOG_FORMAT)};
+#undef EVENT_LOG_NAME
+#undef EVENT_LOG_FORMAT
+
+static const uint32_t WRITES = EVENT_LOG_CAPACITY + 6;
+
+typedef struct {
+    uint8_t id;
+    uint8_t level;
+    int32_t args[2];
+} written_event_t;
+
+static written_event_t _event(uint32_t i) {
+    written_event_t event = {
+        .id = static_cast<uint8_t>(i % EVT_COUNT),
+        .level = static_cast<uint8_t>((i % 3 == 0) ? EVENT_LOG_LEVEL_WARN : EVENT_LOG_LEVEL_INFO),
+        .args = {static_cast<int32_t>(i) * 1000 - 20000, -static_cast<int32_t>(i)}, //negative args, printed by %u and %x too
+    };
+    return event;
+}
+
+/**
+ * Runs event_log_dump with stdout going to a temporary file
+ * @return returns what was dumped
+ */
+static std::string _capture_dump() {
+    FILE* capture = tmpfile();
+    TEST_ASSERT_NOT_NULL(capture);
+
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    dup2(fileno(capture), STDOUT_FILENO);
+    event_log_dump();
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+
+    std::string out;
+    char buf[256];
+    rewind(capture);
+    for (size_t n; (n = fread(buf, 1, sizeof(buf), capture)) > 0;) {
+        out.append(buf, n);
+    }
+    fclose(capture);
+    return out;
+}
+
+static void _write_expected(FILE* file, uint32_t lost) {
+    fprintf(file, "{\"lost\":%u,\"entries\":[", static_cast<unsigned>(lost));
+    for (uint32_t i = lost; i < WRITES; ++i) {
+        written_event_t event = _event(i);
+        char text[128];
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+        snprintf(text, sizeof(text), EVENT_FORMATS[event.id], event.args[0], event.args[1]);
+#pragma GCC diagnostic pop
+        fprintf(file, "%s{\"name\":\"%s\",\"level\":%u,\"text\":\"%s\"}", (i == lost) ? "" : ",",
+            EVENT_NAMES[event.id], event.level, text);
+    }
+    fprintf(file, "]}\n");
+}
+
+TEST_CASE("event log dump keeps the newest entries of an overwritten ring", "[event_log]")
+{
+    _capture_dump(); //whatever the earlier tests recorded
+    event_log_begin_wake();
+    for (uint32_t i = 0; i < WRITES; ++i) {
+        written_event_t event = _event(i);
+        event_log_write(event.level, static_cast<event_id_t>(event.id), event.args[0], event.args[1]);
+    }
+    TEST_ASSERT_EQUAL(EVENT_LOG_CAPACITY, event_log_pending());
+
+    std::string dump = _capture_dump();
+    TEST_ASSERT_EQUAL(0, event_log_pending());
+
+    //one ELOG:<hex> line per entry between the begin and end markers
+    std::vector<std::string> lines;
+    for (size_t start = 0, end; (end = dump.find('\n', start)) != std::string::npos; start = end + 1) {
+        lines.push_back(dump.substr(start, end - start));
+    }
+    TEST_ASSERT_EQUAL(EVENT_LOG_CAPACITY + 2, lines.size());
+    char begin[32];
+    snprintf(begin, sizeof(begin), "ELOG-BEGIN %u %u", static_cast<unsigned>(EVENT_LOG_CAPACITY),
+        static_cast<unsigned>(WRITES - EVENT_LOG_CAPACITY));
+    TEST_ASSERT_EQUAL_STRING(begin, lines.front().c_str());
+    TEST_ASSERT_EQUAL_STRING("ELOG-END", lines.back().c_str());
+
+    for (size_t i = 0; i < EVENT_LOG_CAPACITY; ++i) {
+        const std::string& line = lines[i + 1];
+        TEST_ASSERT_EQUAL(5 + 2 * sizeof(event_log_entry_t), line.size());
+        TEST_ASSERT_EQUAL(0, line.compare(0, 5, "ELOG:"));
+
+        event_log_entry_t entry;
+        uint8_t* bytes = reinterpret_cast<uint8_t*>(&entry);
+        for (size_t b = 0; b < sizeof(entry); ++b) {
+            bytes[b] = static_cast<uint8_t>(strtoul(line.substr(5 + 2 * b, 2).c_str(), NULL, 16));
+        }
+        written_event_t event = _event(static_cast<uint32_t>(WRITES - EVENT_LOG_CAPACITY + i));
+        TEST_ASSERT_EQUAL_UINT8(event.id, entry.id);
+        TEST_ASSERT_EQUAL_UINT8(event.level, entry.level);
+        TEST_ASSERT_EQUAL_INT32(event.args[0], entry.args[0]);
+        TEST_ASSERT_EQUAL_INT32(event.args[1], entry.args[1]);
+    }
+
+    const char* dir = getenv("HOST_TESTS_PAYLOADS");
+    if (dir == NULL) {
+        return;
+    }
+    std::string path = std::string(dir) + "/event_log.txt";
+    FILE* file = fopen(path.c_str(), "w");
+    TEST_ASSERT_NOT_NULL_MESSAGE(file, path.c_str());
+    fwrite(dump.data(), 1, dump.size(), file);
+    fclose(file);
+
+    path = std::string(dir) + "/event_log.events.json";
+    file = fopen(path.c_str(), "w");
+    TEST_ASSERT_NOT_NULL_MESSAGE(file, path.c_str());
+    _write_expected(file, WRITES - EVENT_LOG_CAPACITY);
+    fclose(file);
+}
@@ -0,0 +1,232 @@
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "unity.h"
+#include "moisture_filter.hpp"
+#include "bench.hpp"
+
+/**
+ * Replays ADC traces through every filter and reports how far each one lands from the true level and what it
+ * costs per capture. a trace is a run of captures, the samples of one plant on consecutive wakes
+ *
+ * the built in traces are synthetic with a known level per capture: noise alone, noise with the probe's full
+ * scale spikes, and noise with bursts of wifi tx coupling. recorded traces are replayed too if HOST_TESTS_TRACES
+ * names a directory of them, in the format tools/stand_in_server.py --raw-dir records (one capture per line).
+ * their level isn't known so the median of the whole trace stands in for it, which only works for probes that
+ * sat in still soil while recording
+ */
+
+static const int CAPTURES = 64;
+static const int CAPTURE_SAMPLES = 64;
+static const int LEVEL = 1800;
+
+static const moisture_filter_t ALL_FILTERS[] = {FILTER_MEAN, FILTER_MEDIAN, FILTER_TRIMMED_MEAN, FILTER_MAD_MEAN};
+static const char* const FILTER_NAMES[] = {"mean", "median", "trimmed mean", "mad mean"};
+
+typedef struct {
+    std::string name;
+    std::vector<std::vector<int>> captures;
+    std::vector<int32_t> truth; //level of every capture, scaled by FILTER_SCALE
+} trace_t;
+
+typedef struct {
+    double mean_error; //in adc steps
+    double max_error;
+} replay_result_t;
+
+static uint32_t _rng = 0x2545F491;
+
+static uint32_t _next_random() {
+    _rng ^= _rng << 13;
+    _rng ^= _rng >> 17;
+    _rng ^= _rng << 5;
+    return _rng;
+}
+
+//sum of four uniforms, close enough to gaussian noise with a standard deviation of about 5 steps
+static int _noise() {
+    int sum = 0;
+    for (int i = 0; i < 4; ++i) {
+        sum += static_cast<int>(_next_random() % 9) - 4;
+    }
+    return sum;
+}
+
+//every capture sits at LEVEL, disturb adds the trace's outliers to it
+template <typename Disturb>
+static trace_t _synthetic_trace(const char* name, Disturb disturb) {
+    trace_t trace = {name, {}, {}};
+    for (int c = 0; c < CAPTURES; ++c) {
+        std::vector<int> capture(CAPTURE_SAMPLES);
+        for (int i = 0; i < CAPTURE_SAMPLES; ++i) {
+            capture[i] = LEVEL + _noise();
+        }
+        disturb(capture);
+        trace.captures.push_back(capture);
+        trace.truth.push_back(LEVEL * FILTER_SCALE);
+    }
+    return trace;
+}
+
+static trace_t _noise_trace() {
+    return _synthetic_trace("noise", [](std::vector<int>&) {});
+}
+
+static trace_t _spike_trace() {
+    //the capacitive probes' occasional full scale reading, about one sample in 16
+    return _synthetic_trace("spikes", [](std::vector<int>& capture) {
+        for (int& sample : capture) {
+            if (_next_random() % 16 == 0) {
+                sample = 4095;
+            }
+        }
+    });
+}
+
+static trace_t _burst_trace() {
+    //sampling while wifi associates, a tx burst couples into a run of 8 samples
+    return _synthetic_trace("tx bursts", [](std::vector<int>& capture) {
+        size_t start = _next_random() % (capture.size() - 8);
+        for (size_t i = start; i < start + 8; ++i) {
+            capture[i] += 250;
+        }
+    });
+}
+
+static bool _read_trace(const std::string& path, trace_t& trace) {
+    FILE* file = fopen(path.c_str(), "r");
+    if (file == NULL) {
+        return false;
+    }
+
+    std::vector<int> all;
+    char line[8192];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        std::vector<int> capture;
+        char* end = line;
+        for (char* p = line; ; p = end) {
+            long sample = strtol(p, &end, 10);
+            if (end == p) {
+                break;
+            }
+            capture.push_back(static_cast<int>(sample));
+        }
+        if (!capture.empty()) {
+            all.insert(all.end(), capture.begin(), capture.end());
+            trace.captures.push_back(capture);
+        }
+    }
+    fclose(file);
+
+    if (all.empty()) {
+        return false;
+    }
+    std::nth_element(all.begin(), all.begin() + all.size() / 2, all.end());
+    trace.truth.assign(trace.captures.size(), all[all.size() / 2] * FILTER_SCALE);
+    return true;
+}
+
+static std::vector<trace_t> _recorded_traces() {
+    std::vector<trace_t> traces;
+    const char* dir_path = getenv("HOST_TESTS_TRACES");
+    DIR* dir = (dir_path != NULL) ? opendir(dir_path) : NULL;
+    if (dir == NULL) {
+        return traces;
+    }
+
+    for (struct dirent* entry = readdir(dir); entry != NULL; entry = readdir(dir)) {
+        if (strstr(entry->d_name, ".txt") == NULL) {
+            continue;
+        }
+        trace_t trace = {entry->d_name, {}, {}};
+        if (_read_trace(std::string(dir_path) + "/" + entry->d_name, trace)) {
+            traces.push_back(trace);
+        }
+    }
+    closedir(dir);
+    return traces;
+}
+
+static replay_result_t _replay(const trace_t& trace, size_t filter) {
+    static int scratch[4096];
+    replay_result_t result = {0, 0};
+
+    double total = 0;
+    for (size_t c = 0; c < trace.captures.size(); ++c) {
+        const std::vector<int>& capture = trace.captures[c];
+        size_t n = std::min(capture.size(), sizeof(scratch) / sizeof(scratch[0]));
+        int32_t value = filter_samples(ALL_FILTERS[filter], capture.data(), n, scratch);
+
+        double error = static_cast<double>(value - trace.truth[c]) / FILTER_SCALE;
+        error = (error < 0) ? -error : error;
+        total += error;
+        result.max_error = std::max(result.max_error, error);
+    }
+    result.mean_error = total / trace.captures.size();
+
+    //the whole trace once per timed iteration, the cost is reported per capture
+    std::string name = "filter replay " + trace.name + ", " + FILTER_NAMES[filter];
+    bench_result_t cost = bench_run(name.c_str(), 200, [&](size_t) {
+        for (const std::vector<int>& capture : trace.captures) {
+            bench_sink = filter_samples(ALL_FILTERS[filter], capture.data(), std::min(capture.size(), sizeof(scratch) / sizeof(scratch[0])), scratch);
+        }
+    });
+    printf("REPLAY %s, %s: error mean %.2f max %.2f steps, %llu ns %llu cycles per capture\n",
+        trace.name.c_str(), FILTER_NAMES[filter], result.mean_error, result.max_error,
+        static_cast<unsigned long long>(cost.ns_per_op / trace.captures.size()),
+        static_cast<unsigned long long>(cost.cycles_per_op / trace.captures.size()));
+
+    return result;
+}
+
+TEST_CASE("every filter finds the level under plain noise", "[filter][replay]")
+{
+    trace_t trace = _noise_trace();
+    for (size_t f = 0; f < 4; ++f) {
+        replay_result_t result = _replay(trace, f);
+        TEST_ASSERT_TRUE(result.mean_error < 1.5);
+        TEST_ASSERT_TRUE(result.max_error < 5);
+    }
+}
+
+TEST_CASE("robust filters reject the probe's spikes, the mean doesn't", "[filter][replay]")
+{
+    trace_t trace = _spike_trace();
+    TEST_ASSERT_TRUE(_replay(trace, 0).mean_error > 50);
+    for (size_t f = 1; f < 4; ++f) {
+        replay_result_t result = _replay(trace, f);
+        TEST_ASSERT_TRUE(result.mean_error < 2);
+        TEST_ASSERT_TRUE(result.max_error < 6);
+    }
+}
+
+TEST_CASE("robust filters reject tx bursts, the mean doesn't", "[filter][replay]")
+{
+    trace_t trace = _burst_trace();
+    TEST_ASSERT_TRUE(_replay(trace, 0).mean_error > 20);
+    for (size_t f = 1; f < 4; ++f) {
+        replay_result_t result = _replay(trace, f);
+        TEST_ASSERT_TRUE(result.mean_error < 2);
+        TEST_ASSERT_TRUE(result.max_error < 6);
+    }
+}
+
+TEST_CASE("recorded traces replay through every filter", "[filter][replay]")
+{
+    std::vector<trace_t> traces = _recorded_traces();
+    if (traces.empty()) {
+        TEST_MESSAGE("no recorded traces, set HOST_TESTS_TRACES to a directory recorded by stand_in_server.py --raw-dir");
+        return;
+    }
+
+    //there's no known level to hold them to, the results are only reported
+    for (const trace_t& trace : traces) {
+        for (size_t f = 0; f < 4; ++f) {
+            _replay(trace, f);
+        }
+    }
+}
@@ -0,0 +1,100 @@
+#include "unity.h"
+#include "moisture_filter.hpp"
+#include "bench.hpp"
+
+static const moisture_filter_t ALL_FILTERS[] = {FILTER_MEAN, FILTER_MEDIAN, FILTER_TRIMMED_MEAN, FILTER_MAD_MEAN};
+
+TEST_CASE("every filter returns a constant signal unchanged", "[filter]")
+{
+    int samples[33];
+    int scratch[33];
+    for (size_t i = 0; i < 33; ++i) {
+        samples[i] = 2048;
+    }
+
+    for (moisture_filter_t filter : ALL_FILTERS) {
+        TEST_ASSERT_EQUAL_INT32(2048 * FILTER_SCALE, filter_samples(filter, samples, 33, scratch));
+    }
+}
+
+TEST_CASE("every filter returns 0 for no samples", "[filter]")
+{
+    int scratch[1];
+    for (moisture_filter_t filter : ALL_FILTERS) {
+        TEST_ASSERT_EQUAL_INT32(0, filter_samples(filter, NULL, 0, scratch));
+    }
+}
+
+TEST_CASE("mean keeps the fraction of an adc step", "[filter]")
+{
+    int samples[] = {100, 101, 101, 101};
+    int scratch[4];
+    //100.75 * 16 = 1612
+    TEST_ASSERT_EQUAL_INT32(1612, filter_samples(FILTER_MEAN, samples, 4, scratch));
+}
+
+TEST_CASE("median of an even number of samples averages the middle two", "[filter]")
+{
+    int odd[] = {9, 1, 5};
+    int even[] = {9, 1, 5, 6};
+    int scratch[4];
+    TEST_ASSERT_EQUAL_INT32(5 * FILTER_SCALE, filter_samples(FILTER_MEDIAN, odd, 3, scratch));
+    TEST_ASSERT_EQUAL_INT32(11 * FILTER_SCALE / 2, filter_samples(FILTER_MEDIAN, even, 4, scratch));
+}
+
+TEST_CASE("robust filters ignore a full scale spike", "[filter]")
+{
+    int samples[] = {1000, 1002, 998, 1001, 4095, 999, 1000, 1003, 997, 1000};
+    int scratch[10];
+
+    //the mean is pulled up by ~310 steps, the robust filters stay within one step
+    TEST_ASSERT_GREATER_THAN_INT32(1300 * FILTER_SCALE, filter_samples(FILTER_MEAN, samples, 10, scratch));
+    TEST_ASSERT_INT32_WITHIN(FILTER_SCALE, 1000 * FILTER_SCALE, filter_samples(FILTER_MEDIAN, samples, 10, scratch));
+    TEST_ASSERT_INT32_WITHIN(FILTER_SCALE, 1000 * FILTER_SCALE, filter_samples(FILTER_TRIMMED_MEAN, samples, 10, scratch));
+    TEST_ASSERT_INT32_WITHIN(FILTER_SCALE, 1000 * FILTER_SCALE, filter_samples(FILTER_MAD_MEAN, samples, 10, scratch));
+}
+
+TEST_CASE("filters don't reorder the samples", "[filter]")
+{
+    int samples[] = {5, 3, 9, 1, 7};
+    int scratch[5];
+    for (moisture_filter_t filter : ALL_FILTERS) {
+        filter_samples(filter, samples, 5, scratch);
+        TEST_ASSERT_EQUAL_INT(5, samples[0]);
+        TEST_ASSERT_EQUAL_INT(7, samples[4]);
+    }
+}
+
+TEST_CASE("iir filter takes its first value as is and then moves by 1/2^IIR_SHIFT", "[filter]")
+{
+    filter_iir_reset(0);
+    TEST_ASSERT_EQUAL_INT32(1000, filter_iir_smooth(0, 1000));
+    TEST_ASSERT_EQUAL_INT32(1000 + (1 << 10 >> IIR_SHIFT), filter_iir_smooth(0, 1000 + (1 << 10)));
+
+    //steps down round like steps up
+    filter_iir_reset(1);
+    filter_iir_smooth(1, 1000);
+    TEST_ASSERT_EQUAL_INT32(1000 - (1 << 10 >> IIR_SHIFT), filter_iir_smooth(1, 1000 - (1 << 10)));
+
+    //out of range slots pass the value through
+    TEST_ASSERT_EQUAL_INT32(1234, filter_iir_smooth(FILTER_IIR_SLOTS, 1234));
+}
+
+TEST_CASE("filter microbenchmark", "[filter][bench]")
+{
+    //a wake's burst for one plant, noise plus the odd spike
+    int samples[64];
+    int scratch[64];
+    uint32_t rng = 0x12345678;
+    for (size_t i = 0; i < 64; ++i) {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        samples[i] = (i % 17 == 0) ? 4095 : 1800 + static_cast<int>(rng % 25) - 12;
+    }
+
+    bench_run("filter mean, 64 samples", 100000, [&](size_t) { bench_sink = filter_samples(FILTER_MEAN, samples, 64, scratch); });
+    bench_run("filter median, 64 samples", 100000, [&](size_t) { bench_sink = filter_samples(FILTER_MEDIAN, samples, 64, scratch); });
+    bench_run("filter trimmed mean, 64 samples", 100000, [&](size_t) { bench_sink = filter_samples(FILTER_TRIMMED_MEAN, samples, 64, scratch); });
+    bench_run("filter mad mean, 64 samples", 100000, [&](size_t) { bench_sink = filter_samples(FILTER_MAD_MEAN, samples, 64, scratch); });
+}
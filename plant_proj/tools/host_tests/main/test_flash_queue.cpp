@@ -0,0 +1,137 @@
+#include <esp_partition.h>
+#include "unity.h"
+#include "flash_queue.hpp"
+
+/**
+ * Runs the flash queue around its ring several times under both capacity policies, on the linux target's
+ * emulation of the "readings" partition. readings are numbered by wake_id so every drain can check nothing
+ * was lost out of order or sent twice
+ */
+
+static const uint32_t SECTOR_SIZE = 4096;
+
+static reading_record_t _reading(uint32_t n) {
+    reading_record_t record = {
+        .wake_id = n,
+        .moisture = static_cast<int32_t>(n * 7),
+        .timestamp = 1700000000 + n,
+        .time_error_s = static_cast<uint16_t>(n % 300),
+        .plant_id = static_cast<uint8_t>(n % 3),
+    };
+    return record;
+}
+
+//every slot of the partition, the sector being written included
+static uint32_t _total_slots() {
+    const esp_partition_t* partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, FLASH_QUEUE_PARTITION);
+    TEST_ASSERT_NOT_NULL(partition);
+    uint32_t sectors = partition->size / SECTOR_SIZE;
+    return flash_queue_stats().capacity / (sectors - 1) * sectors;
+}
+
+/**
+ * Sends up to max readings, checking they're numbered from first on
+ * @return returns the number of readings sent
+ */
+static uint32_t _drain(uint32_t first, uint32_t max) {
+    static reading_record_t batch[64];
+    uint32_t sent = 0;
+
+    while (sent < max) {
+        size_t count = flash_queue_peek(batch, (max - sent < 64) ? max - sent : 64);
+        if (count == 0) {
+            break;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            reading_record_t expected = _reading(first + sent + i);
+            TEST_ASSERT_EQUAL_UINT32(expected.wake_id, batch[i].wake_id);
+            TEST_ASSERT_EQUAL_INT32(expected.moisture, batch[i].moisture);
+            TEST_ASSERT_EQUAL_UINT32(expected.timestamp, batch[i].timestamp);
+            TEST_ASSERT_EQUAL_UINT16(expected.time_error_s, batch[i].time_error_s);
+            TEST_ASSERT_EQUAL_UINT8(expected.plant_id, batch[i].plant_id);
+        }
+        TEST_ASSERT_EQUAL(ESP_OK, flash_queue_commit(count));
+        sent += count;
+    }
+
+    return sent;
+}
+
+//sends whatever earlier tests left behind
+static void _empty_queue() {
+    static reading_record_t batch[64];
+    for (size_t count; (count = flash_queue_peek(batch, 64)) > 0;) {
+        TEST_ASSERT_EQUAL(ESP_OK, flash_queue_commit(count));
+    }
+    TEST_ASSERT_EQUAL(0, flash_queue_depth());
+}
+
+TEST_CASE("flash queue dropping the oldest sector keeps the newest readings in order", "[flash_queue]")
+{
+    _empty_queue();
+    uint32_t slots = _total_slots();
+    flash_queue_stats_t before = flash_queue_stats();
+
+    //three times around the ring in batches that straddle sector boundaries
+    uint32_t written = 0;
+    while (written < 3 * slots) {
+        reading_record_t batch[37];
+        for (size_t i = 0; i < 37; ++i) {
+            batch[i] = _reading(written + i);
+        }
+        size_t stored = 0;
+        TEST_ASSERT_EQUAL(ESP_OK, _append(batch, 37, &stored, FLASH_QUEUE_DROP_OLDEST));
+        TEST_ASSERT_EQUAL(37, stored);
+        written += 37;
+
+        flash_queue_stats_t stats = flash_queue_stats();
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(slots, stats.depth);
+        TEST_ASSERT_EQUAL_UINT32(written, stats.appended - before.appended);
+        TEST_ASSERT_EQUAL_UINT32(written, stats.depth + stats.dropped - before.dropped);
+    }
+
+    //at least the capacity survives, and a cold boot finds the same queue
+    flash_queue_stats_t stats = flash_queue_stats();
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(stats.capacity, stats.depth);
+    TEST_ASSERT_EQUAL(ESP_OK, _scan_partition());
+    TEST_ASSERT_EQUAL_UINT32(stats.depth, flash_queue_depth());
+
+    TEST_ASSERT_EQUAL_UINT32(stats.depth, _drain(written - stats.depth, UINT32_MAX));
+    TEST_ASSERT_EQUAL(0, flash_queue_depth());
+}
+
+TEST_CASE("flash queue dropping new readings keeps the oldest ones until they're sent", "[flash_queue]")
+{
+    _empty_queue();
+    uint32_t slots = _total_slots();
+
+    //each round fills the queue, is turned away, then sends part of it to make room for the next
+    uint32_t written = 0;
+    uint32_t sent = 0;
+    for (int round = 0; round < 4; ++round) {
+        uint32_t dropped = flash_queue_stats().dropped;
+
+        esp_err_t res = ESP_OK;
+        size_t stored = 0;
+        while (res == ESP_OK) {
+            reading_record_t batch[37];
+            for (size_t i = 0; i < 37; ++i) {
+                batch[i] = _reading(written + i);
+            }
+            res = _append(batch, 37, &stored, FLASH_QUEUE_DROP_NEWEST);
+            written += stored;
+            TEST_ASSERT_LESS_OR_EQUAL_UINT32(slots, flash_queue_depth());
+        }
+        TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, res);
+        TEST_ASSERT_EQUAL_UINT32(37 - stored, flash_queue_stats().dropped - dropped);
+        TEST_ASSERT_GREATER_OR_EQUAL_UINT32(flash_queue_stats().capacity, flash_queue_depth());
+        TEST_ASSERT_EQUAL_UINT32(written - sent, flash_queue_depth());
+
+        //the readings that got in are the oldest ones, nothing was overwritten
+        sent += _drain(sent, (round % 2 == 0) ? slots / 3 : slots / 2);
+        TEST_ASSERT_EQUAL_UINT32(written - sent, flash_queue_depth());
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(written - sent, _drain(sent, UINT32_MAX));
+    TEST_ASSERT_EQUAL(0, flash_queue_depth());
+}
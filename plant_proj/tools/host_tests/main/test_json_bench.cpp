@@ -0,0 +1,81 @@
+#include <string.h>
+#include <string>
+#include "unity.h"
+#include "json_encoder.hpp"
+#include "bench.hpp"
+
+/**
+ * The heap free json encoder against the std::string one it replaced. _to_json_reference is the old
+ * _to_json(records, count) of wifi_handler.cpp with the plant name passed in instead of read from leaf_info.
+ * the old payload had one plant and no timestamps, so the readings here are one plant's and untimed
+ */
+
+static const char* const PLANT_NAMES[] = {"fern"};
+static const size_t NAME_LEN = 16;
+
+static std::string _to_json_reference(const char* plant_name_ptr, const reading_record_t* records, size_t count) {
+    const std::string plant_name = std::string(plant_name_ptr);
+
+    std::string json_str = "{\"plant name\":\"" + plant_name + "\",\"readings\":[";
+    for (size_t i = 0; i < count; ++i) {
+        if (i > 0) {
+            json_str += ",";
+        }
+
+        const double moisture = static_cast<double>(records[i].moisture) / MOISTURE_SCALE;
+        json_str += "{\"wake\":" + std::to_string(records[i].wake_id) + ",\"moisture\":" + std::to_string(moisture) + "}";
+    }
+    json_str += "]}";
+
+    return json_str;
+}
+
+static void _compare(size_t count) {
+    static reading_record_t records[READING_BUFFER_CAPACITY];
+    for (size_t i = 0; i < count; ++i) {
+        records[i] = {
+            .wake_id = static_cast<uint32_t>(12000 + i),
+            .moisture = static_cast<int32_t>(4256 - 13 * i),
+            .timestamp = 0,
+            .time_error_s = 0,
+            .plant_id = 0,
+        };
+    }
+    static char buf[8192];
+
+    char name[64];
+    snprintf(name, sizeof(name), "json encoder, %u readings", static_cast<unsigned>(count));
+    bench_result_t encoder = bench_run(name, 20000, [&](size_t) {
+        bench_sink = encode_readings_json(buf, sizeof(buf), PLANT_NAMES, 1, NAME_LEN, records, count, NULL, NULL, NULL);
+    });
+    size_t encoder_bytes = encode_readings_json(buf, sizeof(buf), PLANT_NAMES, 1, NAME_LEN, records, count, NULL, NULL, NULL);
+
+    snprintf(name, sizeof(name), "old _to_json, %u readings", static_cast<unsigned>(count));
+    bench_result_t reference = bench_run(name, 20000, [&](size_t) {
+        bench_sink = _to_json_reference(PLANT_NAMES[0], records, count).size();
+    });
+    size_t reference_bytes = _to_json_reference(PLANT_NAMES[0], records, count).size();
+
+    printf("JSON %u readings: encoder %u bytes, old _to_json %u bytes\n", static_cast<unsigned>(count),
+        static_cast<unsigned>(encoder_bytes), static_cast<unsigned>(reference_bytes));
+
+    //the point of the encoder: no heap at all, where the old one allocated for every piece of the payload
+    TEST_ASSERT_EQUAL(0, encoder.allocations);
+    TEST_ASSERT_GREATER_THAN(count * reference.iterations, reference.allocations);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT64(reference.ns_per_op, encoder.ns_per_op);
+}
+
+TEST_CASE("json encoder against the old _to_json, 1 reading", "[encoder][bench]")
+{
+    _compare(1);
+}
+
+TEST_CASE("json encoder against the old _to_json, 8 readings", "[encoder][bench]")
+{
+    _compare(8);
+}
+
+TEST_CASE("json encoder against the old _to_json, a full buffer", "[encoder][bench]")
+{
+    _compare(READING_BUFFER_CAPACITY);
+}
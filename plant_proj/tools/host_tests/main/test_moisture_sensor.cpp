@@ -0,0 +1,39 @@
+#include "unity.h"
+#include "moisture_sensor.hpp"
+#include "reading_buffer.hpp"
+
+/**
+ * Continuous captures on the fake adc, which like the driver hands over nothing when the frame takes longer
+ * than the timeout to convert
+ */
+
+static const uint8_t CHANNELS[] = {0, 3};
+
+TEST_CASE("continuous capture waits for a frame longer than the margin", "[moisture_sensor]")
+{
+    //4000 conversions take 200 ms at 20 kHz, twice the margin
+    const int n = 250;
+    TEST_ASSERT_GREATER_THAN_UINT32(static_cast<uint32_t>(n) * ADC_OVERSAMPLE_FACTOR * 2 * 1000 / ADC_SAMPLE_FREQ_HZ,
+        _frame_timeout_ms(n * ADC_OVERSAMPLE_FACTOR * 2));
+
+    moisture_sensor_init(n, CHANNELS, 2);
+    int32_t values[2];
+    get_moisture_values(MOISTURE_SCALE, values);
+
+    for (size_t slot = 0; slot < 2; ++slot) {
+        size_t count = 0;
+        moisture_sensor_samples(slot, &count);
+        TEST_ASSERT_EQUAL(n, count);
+        TEST_ASSERT_NOT_EQUAL(MOISTURE_NO_READING, values[slot]);
+        TEST_ASSERT_LESS_THAN_INT32(100 * MOISTURE_SCALE, values[slot]); //the fake's probes aren't soaked
+    }
+}
+
+TEST_CASE("a channel without samples isn't a reading", "[moisture_sensor]")
+{
+    moisture_sensor_init(0, CHANNELS, 2);
+    int32_t values[2];
+    get_moisture_values(MOISTURE_SCALE, values);
+    TEST_ASSERT_EQUAL_INT32(MOISTURE_NO_READING, values[0]);
+    TEST_ASSERT_EQUAL_INT32(MOISTURE_NO_READING, values[1]);
+}
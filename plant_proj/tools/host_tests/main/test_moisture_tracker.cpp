@@ -0,0 +1,102 @@
+#include <string.h>
+#include "unity.h"
+#include "moisture_tracker.hpp"
+#include "adaptive_sampling.hpp"
+#include "reading_buffer.hpp"
+#include "flash_queue.hpp"
+#include "leaf_config.hpp"
+#include "stand_in_backend.hpp"
+#include "bench.hpp"
+
+/**
+ * Whole wake cycles on the fake adc, uploading to the in process stand-in backend. the fake's probes barely
+ * move so after the first wake readings are only reported on heartbeats, which makes the upload wakes
+ * predictable: one at most every HEARTBEAT_WAKES wakes
+ */
+
+static void _configure_node() {
+    leaf_info.node_id = 1;
+    leaf_info.plant_count = 2;
+    strcpy(reinterpret_cast<char*>(leaf_info.plants[0].plant_name), "fern");
+    leaf_info.plants[0].adc_channel = 0;
+    strcpy(reinterpret_cast<char*>(leaf_info.plants[1].plant_name), "basil");
+    leaf_info.plants[1].adc_channel = 3;
+    strcpy(leaf_settings.server_url, "http://127.0.0.1:8080");
+    leaf_settings.sample_size = 16;
+    leaf_settings.sleep_interval_s = MIN_SLEEP_DURATION / 1000000;
+
+    TEST_ASSERT_TRUE_MESSAGE(stand_in_backend_start(), "stand-in backend couldn't listen on 127.0.0.1:8080");
+}
+
+//runs wakes until one sends a request, checking every wake's sleep
+static bool _wake_until_upload() {
+    uint32_t requests = stand_in_backend_requests();
+    for (uint32_t i = 0; i < HEARTBEAT_WAKES + 1; ++i) {
+        uint64_t sleep_us = moisture_tracker_wake();
+        TEST_ASSERT_GREATER_OR_EQUAL_UINT64(MIN_SLEEP_DURATION, sleep_us);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT64(MAX_SLEEP_DURATION, sleep_us);
+
+        if (stand_in_backend_requests() != requests) {
+            return true;
+        }
+    }
+    return false;
+}
+
+TEST_CASE("wake cycle uploads every buffered reading once an upload is due", "[moisture_tracker]")
+{
+    _configure_node();
+    stand_in_backend_set_status(200);
+
+    TEST_ASSERT_TRUE(_wake_until_upload());
+    TEST_ASSERT_EQUAL(0, reading_buffer_count());
+
+    static char body[STAND_IN_BODY_LEN];
+    stand_in_backend_last_body(body, sizeof(body));
+    TEST_ASSERT_EQUAL(0, strncmp(body, "{\"readings\":[", 13));
+    TEST_ASSERT_NOT_NULL(strstr(body, "\"plant name\":\"fern\""));
+    TEST_ASSERT_NOT_NULL(strstr(body, "\"plant name\":\"basil\""));
+    TEST_ASSERT_NOT_NULL(strstr(body, "\"timing\":{"));
+}
+
+TEST_CASE("wakes that aren't due for an upload leave the radio off", "[moisture_tracker]")
+{
+    _configure_node();
+    stand_in_backend_set_status(200);
+    TEST_ASSERT_TRUE(_wake_until_upload());
+
+    uint32_t requests = stand_in_backend_requests();
+    moisture_tracker_wake();
+    TEST_ASSERT_EQUAL_UINT32(requests, stand_in_backend_requests());
+}
+
+TEST_CASE("failed uploads are queued in flash and sent first by the next upload", "[moisture_tracker]")
+{
+    _configure_node();
+    stand_in_backend_set_status(503);
+    TEST_ASSERT_TRUE(_wake_until_upload());
+    TEST_ASSERT_EQUAL(0, reading_buffer_count());
+    TEST_ASSERT_GREATER_THAN_UINT32(0, flash_queue_depth());
+
+    //the failed upload didn't reset the heartbeat, so the next wake tries again
+    stand_in_backend_set_status(200);
+    uint32_t requests = stand_in_backend_requests();
+    TEST_ASSERT_TRUE(_wake_until_upload());
+    TEST_ASSERT_EQUAL_UINT32(0, flash_queue_depth());
+    TEST_ASSERT_EQUAL(0, reading_buffer_count());
+    TEST_ASSERT_EQUAL_UINT32(requests + 2, stand_in_backend_requests()); //the backlog, then this wake's readings
+
+    //the timing summary went out with the backlog, not again with this wake's readings
+    static char body[STAND_IN_BODY_LEN];
+    stand_in_backend_last_body(body, sizeof(body));
+    TEST_ASSERT_NULL(strstr(body, "\"timing\""));
+}
+
+TEST_CASE("wake cycle microbenchmark", "[moisture_tracker][bench]")
+{
+    _configure_node();
+    stand_in_backend_set_status(200);
+
+    //mostly wakes that sample and go back to sleep, with a heartbeat upload every HEARTBEAT_WAKES
+    bench_run("wake cycle, 2 plants x 16 samples", 10 * HEARTBEAT_WAKES, [](size_t) { bench_sink = moisture_tracker_wake(); });
+}
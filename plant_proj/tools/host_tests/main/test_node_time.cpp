@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include "unity.h"
+#include "node_time.hpp"
+#include "adaptive_sampling.hpp"
+
+/**
+ * Runs node_time's clock math against a simulated rtc clock that runs fast, through the syncs node_time asks for
+ */
+
+static const int64_t START_US = 1700000000LL * 1000000; //true time of the first wake
+static const int64_t CLOCK_FAST_PPM = 800; //the esp32's 150 kHz rtc clock is off by up to a few hundred ppm
+static const int64_t SYNC_JITTER_US = 10000; //sntp over wifi, well inside the sync error node_time assumes
+
+typedef struct {
+    int64_t true_us;
+    int64_t clock_us; //system clock of the node
+    uint32_t rng;
+} sim_clock_t;
+
+static uint32_t _next_random(sim_clock_t& sim) {
+    sim.rng ^= sim.rng << 13;
+    sim.rng ^= sim.rng >> 17;
+    sim.rng ^= sim.rng << 5;
+    return sim.rng;
+}
+
+static void _sleep(sim_clock_t& sim, int64_t sleep_us) {
+    sim.true_us += sleep_us;
+    sim.clock_us += sleep_us + sleep_us / 1000000 * CLOCK_FAST_PPM;
+}
+
+/**
+ * Sets the clock to the true time, give or take the sync's error, and records the step like node_time_sync
+ */
+static void _sync(sim_clock_t& sim, time_state_t& state) {
+    int64_t jitter_us = static_cast<int64_t>(_next_random(sim) % (2 * SYNC_JITTER_US + 1)) - SYNC_JITTER_US;
+    int64_t synced_us = sim.true_us + jitter_us;
+    int64_t step_us = synced_us - sim.clock_us;
+    sim.clock_us = synced_us;
+    _record_sync(state, sim.clock_us, step_us);
+}
+
+TEST_CASE("node time has no timestamp before the first sync", "[time]")
+{
+    time_state_t state = {};
+    node_timestamp_t stamp = _timestamp_at(state, START_US);
+    TEST_ASSERT_EQUAL_UINT32(0, stamp.epoch_s);
+    TEST_ASSERT_EQUAL_UINT16(UINT16_MAX, stamp.error_s);
+    TEST_ASSERT_TRUE(_sync_due(state, START_US));
+}
+
+TEST_CASE("node time syncs every couple of days even at the longest sleep", "[time]")
+{
+    TEST_ASSERT_LESS_OR_EQUAL_UINT64(2 * 24 * 3600 * 1000000ULL, TIME_SYNC_EVERY_WAKES * MAX_SLEEP_DURATION);
+
+    //right after a sync the error bound is small, only the wake count asks for the next one
+    time_state_t state = {};
+    sim_clock_t sim = {.true_us = START_US, .clock_us = START_US, .rng = 0x9E3779B9};
+    _sync(sim, state);
+    state.wakes_since_sync = TIME_SYNC_EVERY_WAKES - 1;
+    TEST_ASSERT_FALSE(_sync_due(state, sim.clock_us));
+    state.wakes_since_sync += 1;
+    TEST_ASSERT_TRUE(_sync_due(state, sim.clock_us));
+}
+
+TEST_CASE("node time only measures the drift over long intervals", "[time]")
+{
+    time_state_t state = {};
+    sim_clock_t sim = {.true_us = START_US, .clock_us = START_US + 3000000, .rng = 0x12345678};
+    _sync(sim, state);
+    TEST_ASSERT_FALSE(state.drift_known);
+
+    //5 minutes, the 10 ms sync error would be 33 ppm of it
+    _sleep(sim, 300000000);
+    _sync(sim, state);
+    TEST_ASSERT_FALSE(state.drift_known);
+    TEST_ASSERT_EQUAL_INT64(0, state.drift_ppb);
+
+    _sleep(sim, 3600000000LL);
+    _sync(sim, state);
+    TEST_ASSERT_TRUE(state.drift_known);
+    TEST_ASSERT_INT32_WITHIN(10000, CLOCK_FAST_PPM * 1000, state.drift_ppb);
+}
+
+TEST_CASE("node time stays within its error bound with a clock 800 ppm fast", "[time]")
+{
+    const uint32_t WAKES = 5000;
+    time_state_t state = {};
+    sim_clock_t sim = {.true_us = START_US, .clock_us = START_US - 5000000, .rng = 0x9E3779B9};
+    uint32_t syncs = 0;
+    int64_t worst_us = 0;
+
+    for (uint32_t wake = 0; wake < WAKES; ++wake) {
+        if (state.magic == TIME_STATE_MAGIC) {
+            state.wakes_since_sync += 1; //node_time_begin_wake
+        }
+
+        //stamps are taken while sampling, before the upload that may sync
+        node_timestamp_t stamp = _timestamp_at(state, sim.clock_us);
+        if (state.magic == TIME_STATE_MAGIC) {
+            int64_t error_us = _corrected_time_us(state, sim.clock_us) - sim.true_us;
+            error_us = (error_us < 0) ? -error_us : error_us;
+            worst_us = (error_us > worst_us) ? error_us : worst_us;
+            TEST_ASSERT_LESS_OR_EQUAL_INT64(_error_bound_us(state, sim.clock_us), error_us);
+
+            int64_t stamp_error_s = static_cast<int64_t>(stamp.epoch_s) - sim.true_us / 1000000;
+            stamp_error_s = (stamp_error_s < 0) ? -stamp_error_s : stamp_error_s;
+            TEST_ASSERT_LESS_OR_EQUAL_INT64(stamp.error_s, stamp_error_s);
+        }
+
+        if (_sync_due(state, sim.clock_us)) {
+            _sync(sim, state);
+            syncs += 1;
+        }
+
+        uint64_t span_us = MAX_SLEEP_DURATION - MIN_SLEEP_DURATION;
+        _sleep(sim, static_cast<int64_t>(MIN_SLEEP_DURATION + _next_random(sim) % span_us));
+    }
+
+    printf("TIME %u wakes, clock %d ppm fast: %u syncs, drift estimate %d ppb, worst error %d ms\n",
+        static_cast<unsigned>(WAKES), static_cast<int>(CLOCK_FAST_PPM), static_cast<unsigned>(syncs),
+        static_cast<int>(state.drift_ppb), static_cast<int>(worst_us / 1000));
+
+    TEST_ASSERT_TRUE(state.drift_known);
+    TEST_ASSERT_INT32_WITHIN(10000, CLOCK_FAST_PPM * 1000, state.drift_ppb);
+    //uncorrected, the error bound would run out every couple of wakes
+    TEST_ASSERT_LESS_THAN_UINT32(WAKES / 20, syncs);
+}
@@ -0,0 +1,102 @@
+#include "unity.h"
+#include "reading_buffer.hpp"
+#include "bench.hpp"
+
+static reading_record_t _record(uint32_t wake_id, uint8_t plant_id = 0) {
+    reading_record_t record = {
+        .wake_id = wake_id,
+        .moisture = static_cast<int32_t>(wake_id * 10),
+        .timestamp = 0,
+        .time_error_s = 0,
+        .plant_id = plant_id,
+    };
+    return record;
+}
+
+//the buffer lives in rtc memory, a global, so every test starts by emptying it
+static void _empty_buffer() {
+    reading_buffer_discard(reading_buffer_count());
+}
+
+TEST_CASE("reading buffer keeps readings oldest first until they're discarded", "[reading_buffer]")
+{
+    _empty_buffer();
+    for (uint32_t i = 1; i <= 5; ++i) {
+        reading_buffer_push(_record(i));
+    }
+    TEST_ASSERT_EQUAL(5, reading_buffer_count());
+
+    reading_record_t out[8];
+    TEST_ASSERT_EQUAL(3, reading_buffer_peek(out, 3));
+    TEST_ASSERT_EQUAL_UINT32(1, out[0].wake_id);
+    TEST_ASSERT_EQUAL_UINT32(3, out[2].wake_id);
+    TEST_ASSERT_EQUAL(5, reading_buffer_count()); //peeking doesn't remove
+
+    reading_buffer_discard(2);
+    TEST_ASSERT_EQUAL(3, reading_buffer_peek(out, 8));
+    TEST_ASSERT_EQUAL_UINT32(3, out[0].wake_id);
+    TEST_ASSERT_EQUAL_INT32(50, out[2].moisture);
+
+    //discarding more than is stored empties the buffer
+    reading_buffer_discard(10);
+    TEST_ASSERT_EQUAL(0, reading_buffer_count());
+}
+
+TEST_CASE("full reading buffer drops the oldest reading", "[reading_buffer]")
+{
+    _empty_buffer();
+    for (uint32_t i = 0; i < READING_BUFFER_CAPACITY + 3; ++i) {
+        reading_buffer_push(_record(i));
+    }
+    TEST_ASSERT_EQUAL(READING_BUFFER_CAPACITY, reading_buffer_count());
+
+    static reading_record_t out[READING_BUFFER_CAPACITY];
+    TEST_ASSERT_EQUAL(READING_BUFFER_CAPACITY, reading_buffer_peek(out, READING_BUFFER_CAPACITY));
+    TEST_ASSERT_EQUAL_UINT32(3, out[0].wake_id);
+    TEST_ASSERT_EQUAL_UINT32(READING_BUFFER_CAPACITY + 2, out[READING_BUFFER_CAPACITY - 1].wake_id);
+    _empty_buffer();
+}
+
+TEST_CASE("reading buffer flushes on fill level or age", "[reading_buffer]")
+{
+    _empty_buffer();
+    TEST_ASSERT_FALSE(reading_buffer_flush_due(100, 1, 1)); //nothing to send
+
+    reading_buffer_push(_record(100));
+    reading_buffer_push(_record(101));
+    TEST_ASSERT_FALSE(reading_buffer_flush_due(101, 3, 15));
+    TEST_ASSERT_TRUE(reading_buffer_flush_due(101, 2, 15));
+    TEST_ASSERT_TRUE(reading_buffer_should_flush(101, 2, 15));
+
+    //the oldest reading is 15 wakes old
+    TEST_ASSERT_FALSE(reading_buffer_flush_due(114, 8, 15));
+    TEST_ASSERT_TRUE(reading_buffer_flush_due(115, 8, 15));
+    TEST_ASSERT_TRUE(reading_buffer_should_flush(115, 8, 15));
+    _empty_buffer();
+}
+
+TEST_CASE("reading buffer age survives the wake counter wrapping", "[reading_buffer]")
+{
+    _empty_buffer();
+    reading_buffer_push(_record(UINT32_MAX - 1));
+    TEST_ASSERT_EQUAL_UINT32(3, _oldest_age(1));
+    TEST_ASSERT_FALSE(reading_buffer_flush_due(1, 8, 4));
+    TEST_ASSERT_TRUE(reading_buffer_flush_due(2, 8, 4));
+    _empty_buffer();
+}
+
+TEST_CASE("reading buffer microbenchmark", "[reading_buffer][bench]")
+{
+    _empty_buffer();
+    bench_run("reading buffer push + discard", 1000000, [](size_t i) {
+        reading_buffer_push(_record(static_cast<uint32_t>(i)));
+        reading_buffer_discard(1);
+    });
+
+    for (uint32_t i = 0; i < READING_BUFFER_CAPACITY; ++i) {
+        reading_buffer_push(_record(i));
+    }
+    static reading_record_t out[READING_BUFFER_CAPACITY];
+    bench_run("reading buffer peek, full", 100000, [](size_t) { bench_sink = reading_buffer_peek(out, READING_BUFFER_CAPACITY); });
+    _empty_buffer();
+}
@@ -0,0 +1,120 @@
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include "unity.h"
+#include "reading_ring.hpp"
+
+/**
+ * Stress test of the spsc ring between two threads, the sampler and uplink tasks of the continuous mode. build with
+ * HOST_TESTS_TSAN=1 to have thread sanitizer check the ordering of the indexes and the entries' copies
+ */
+
+static const uint32_t STRESS_PUSHES = 2000000;
+static const size_t CONSUMER_BATCH = 32;
+
+typedef struct {
+    uint32_t overflows; //pushes the ring turned away, retried by the producer
+} producer_result_t;
+
+/**
+ * Every field is derived from the reading's sequence number so the consumer can tell a torn copy
+ */
+static ring_reading_t _reading(uint32_t seq) {
+    ring_reading_t reading = {
+        .record = {
+            .wake_id = seq,
+            .moisture = static_cast<int32_t>(seq * 7),
+            .timestamp = ~seq,
+            .time_error_s = static_cast<uint16_t>(seq),
+            .plant_id = static_cast<uint8_t>(seq % 8),
+        },
+        .sampled_us = static_cast<int64_t>(seq) * 3,
+    };
+    return reading;
+}
+
+static void* _producer_main(void* arg) {
+    producer_result_t* result = static_cast<producer_result_t*>(arg);
+    for (uint32_t seq = 0; seq < STRESS_PUSHES; ++seq) {
+        ring_reading_t reading = _reading(seq);
+        while (!reading_ring_push(reading)) {
+            result->overflows += 1;
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+TEST_CASE("ring hands every reading over in order between two threads", "[ring]")
+{
+    reading_ring_discard(reading_ring_count());
+    reading_ring_stats_t before = reading_ring_stats();
+
+    //a plain pthread next to the freertos simulator, it blocks every signal like the stand-in backend's
+    producer_result_t result = {.overflows = 0};
+    sigset_t all_signals;
+    sigset_t previous;
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_BLOCK, &all_signals, &previous);
+    pthread_t producer;
+    TEST_ASSERT_EQUAL(0, pthread_create(&producer, NULL, _producer_main, &result));
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    //the consumer discards a varying part of what it peeked, like an upload that was only partly accepted
+    static ring_reading_t batch[CONSUMER_BATCH];
+    uint32_t expected = 0;
+    uint32_t mismatches = 0;
+    while (expected < STRESS_PUSHES) {
+        size_t n = reading_ring_peek(batch, CONSUMER_BATCH);
+        for (size_t i = 0; i < n; ++i) {
+            ring_reading_t want = _reading(expected + static_cast<uint32_t>(i));
+            if (batch[i].record.wake_id != want.record.wake_id || batch[i].record.moisture != want.record.moisture
+                || batch[i].record.timestamp != want.record.timestamp || batch[i].record.plant_id != want.record.plant_id
+                || batch[i].sampled_us != want.sampled_us) {
+                mismatches += 1;
+            }
+        }
+        size_t accepted = (n == 0) ? 0 : n - (expected % n) % 3;
+        reading_ring_discard(accepted);
+        expected += static_cast<uint32_t>(accepted);
+        if (n == 0) {
+            sched_yield();
+        }
+    }
+    pthread_join(producer, NULL);
+
+    reading_ring_stats_t after = reading_ring_stats();
+    printf("RING %u pushes: %u overflows, max depth %u\n", static_cast<unsigned>(STRESS_PUSHES),
+        static_cast<unsigned>(result.overflows), static_cast<unsigned>(after.max_depth));
+
+    TEST_ASSERT_EQUAL_UINT32(0, mismatches);
+    TEST_ASSERT_EQUAL_UINT32(STRESS_PUSHES, after.pushed - before.pushed);
+    TEST_ASSERT_EQUAL_UINT32(result.overflows, after.overflows - before.overflows);
+    TEST_ASSERT_EQUAL(0, after.depth);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(READING_RING_CAPACITY, after.max_depth);
+}
+
+TEST_CASE("full ring drops the new reading and keeps the old ones", "[ring]")
+{
+    reading_ring_discard(reading_ring_count());
+    reading_ring_stats_t before = reading_ring_stats();
+
+    for (uint32_t seq = 0; seq < READING_RING_CAPACITY; ++seq) {
+        TEST_ASSERT_TRUE(reading_ring_push(_reading(seq)));
+    }
+    TEST_ASSERT_FALSE(reading_ring_push(_reading(READING_RING_CAPACITY)));
+    TEST_ASSERT_EQUAL(READING_RING_CAPACITY, reading_ring_count());
+
+    ring_reading_t oldest;
+    TEST_ASSERT_EQUAL(1, reading_ring_peek(&oldest, 1));
+    TEST_ASSERT_EQUAL_UINT32(0, oldest.record.wake_id);
+
+    //discarding more than is waiting only empties the ring
+    reading_ring_discard(READING_RING_CAPACITY + 10);
+    TEST_ASSERT_EQUAL(0, reading_ring_count());
+
+    reading_ring_stats_t after = reading_ring_stats();
+    TEST_ASSERT_EQUAL_UINT32(1, after.overflows - before.overflows);
+    TEST_ASSERT_EQUAL_UINT32(READING_RING_CAPACITY, after.max_depth);
+}
@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "unity.h"
+#include "json_encoder.hpp"
+#include "binary_encoder.hpp"
+#include "moisture_sensor.hpp"
+#include "raw_capture.hpp"
+
+/**
+ * Payloads of every variant of both formats for tools/test_wire_format.py, which decodes them with wire_format.py
+ * and compares them with what went in. with HOST_TESTS_PAYLOADS=<dir> each variant is written to <dir> as
+ * <variant>.json, <variant>.bin and <variant>.expected.json, the encoders' input. built with RAW_CAPTURE_ENABLED=1 the
+ * captures raw_capture.cpp takes of the sensor's samples and of its full rate frame are written too
+ */
+
+static const char* const PLANT_NAMES[] = {"fern", "basil"};
+static const size_t NAME_LEN = 16;
+static const uint32_t NODE_ID = 0xC0FFEE01;
+
+static const reading_record_t RECORDS[] = {
+    {.wake_id = 100, .moisture = 4256, .timestamp = 1700000000, .time_error_s = 3, .plant_id = 0},
+    {.wake_id = 100, .moisture = -5, .timestamp = 0, .time_error_s = 0, .plant_id = 1},
+    {.wake_id = 101, .moisture = 4300, .timestamp = 1700000060, .time_error_s = 200, .plant_id = 0},
+    {.wake_id = 103, .moisture = 10000, .timestamp = 1700000200, .time_error_s = 7, .plant_id = 1},
+};
+static const size_t RECORD_COUNT = sizeof(RECORDS) / sizeof(RECORDS[0]);
+
+//raw capture channels, plant id and samples
+static const int RAW_FERN[] = {1800, 1803, 1797, 4095, 1801, 0, 1802};
+static const int RAW_BASIL[] = {2100, 2099, 2100};
+
+typedef struct {
+    const char* name;
+    bool timing;
+    bool mem;
+    bool raw;
+} variant_t;
+
+static const variant_t VARIANTS[] = {
+    {"batch", false, false, false},
+    {"timing", true, false, false},
+    {"mem", false, true, false},
+    {"raw", false, false, true},
+    {"all", true, true, true},
+};
+
+typedef std::vector<std::vector<int>> raw_samples_t; //samples of every plant that went into a capture
+
+static wake_phase_stats_t _timing[WAKE_PHASE_COUNT];
+static mem_stats_t _mem;
+static raw_capture_t _raw;
+static raw_samples_t _raw_samples;
+
+/**
+ * Appends a channel to the capture the way raw_capture.cpp lays it out: delta + zig-zag varints
+ */
+static void _raw_put_channel(raw_capture_t& raw, uint8_t plant_id, const int* samples, uint16_t count) {
+    raw.data[raw.len++] = plant_id;
+    raw.data[raw.len++] = static_cast<uint8_t>(count);
+    raw.data[raw.len++] = static_cast<uint8_t>(count >> 8);
+
+    int prev = 0;
+    for (uint16_t i = 0; i < count; ++i) {
+        int32_t delta = samples[i] - prev;
+        prev = samples[i];
+        uint32_t value = (static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31);
+        while (value >= 0x80) {
+            raw.data[raw.len++] = static_cast<uint8_t>(value | 0x80);
+            value >>= 7;
+        }
+        raw.data[raw.len++] = static_cast<uint8_t>(value);
+    }
+}
+
+static void _build_summaries() {
+    memset(_timing, 0, sizeof(_timing));
+    for (size_t i = 0; i < WAKE_PHASE_COUNT; ++i) {
+        if (i == WAKE_PHASE_WIFI_STARTED) {
+            continue; //a phase no wake reached is left out
+        }
+        wake_phase_stats_t& stats = _timing[i];
+        stats.count = 10 + i;
+        stats.min_us = 500 * (i + 1);
+        stats.max_us = 90000 * (i + 1);
+        stats.total_us = static_cast<uint64_t>(stats.count) * 7000 * (i + 1) + i; //mean is rounded down
+        for (size_t b = 0; b < WAKE_TIMING_BUCKETS; ++b) {
+            stats.histogram[b] = static_cast<uint16_t>((i + b) % 4);
+        }
+        stats.histogram[WAKE_TIMING_BUCKETS - 1] = UINT16_MAX;
+    }
+
+    memset(&_mem, 0, sizeof(_mem));
+    _mem.heap_free = 150000;
+    _mem.heap_min_free = 120000;
+    _mem.heap_largest_block = 90000;
+    _mem.tasks[MEM_TASK_MAIN] = {.stack_size = 4096, .stack_min_free = 1200};
+    _mem.tasks[MEM_TASK_SAMPLING] = {.stack_size = 3072, .stack_min_free = 800};
+    _mem.tasks[MEM_TASK_UPLINK] = {.stack_size = 6144, .stack_min_free = 2000};
+
+    memset(&_raw, 0, sizeof(_raw));
+    _raw.mode = RAW_CAPTURE_SAMPLES;
+    _raw_put_channel(_raw, 0, RAW_FERN, sizeof(RAW_FERN) / sizeof(RAW_FERN[0]));
+    _raw_put_channel(_raw, 1, RAW_BASIL, sizeof(RAW_BASIL) / sizeof(RAW_BASIL[0]));
+    _raw_samples = {
+        std::vector<int>(RAW_FERN, RAW_FERN + sizeof(RAW_FERN) / sizeof(RAW_FERN[0])),
+        std::vector<int>(RAW_BASIL, RAW_BASIL + sizeof(RAW_BASIL) / sizeof(RAW_BASIL[0])),
+    };
+}
+
+/**
+ * Writes the encoders' input as json, test_wire_format.py works out the decoded payload from it
+ * @param raw_samples samples of every plant behind the raw capture
+ * @param truncated true if only the start of each plant's samples fit in the capture
+ */
+static void _write_expected(FILE* file, const variant_t& variant, const raw_capture_t* raw,
+    const raw_samples_t& raw_samples, bool truncated) {
+    fprintf(file, "{\"node\":%u,\"plants\":[\"%s\",\"%s\"],\"records\":[",
+        static_cast<unsigned>(NODE_ID), PLANT_NAMES[0], PLANT_NAMES[1]);
+    for (size_t i = 0; i < RECORD_COUNT; ++i) {
+        const reading_record_t& r = RECORDS[i];
+        fprintf(file, "%s{\"plant_id\":%u,\"wake\":%u,\"moisture\":%d,\"ts\":%u,\"ts_err\":%u}", (i == 0) ? "" : ",",
+            r.plant_id, static_cast<unsigned>(r.wake_id), static_cast<int>(r.moisture),
+            static_cast<unsigned>(r.timestamp), r.time_error_s);
+    }
+    fprintf(file, "]");
+
+    if (variant.timing) {
+        fprintf(file, ",\"timing\":[");
+        for (size_t i = 0; i < WAKE_PHASE_COUNT; ++i) {
+            const wake_phase_stats_t& stats = _timing[i];
+            fprintf(file, "%s{\"count\":%u,\"min_us\":%u,\"max_us\":%u,\"total_us\":%llu,\"histogram\":[", (i == 0) ? "" : ",",
+                static_cast<unsigned>(stats.count), static_cast<unsigned>(stats.min_us), static_cast<unsigned>(stats.max_us),
+                static_cast<unsigned long long>(stats.total_us));
+            for (size_t b = 0; b < WAKE_TIMING_BUCKETS; ++b) {
+                fprintf(file, "%s%u", (b == 0) ? "" : ",", stats.histogram[b]);
+            }
+            fprintf(file, "]}");
+        }
+        fprintf(file, "]");
+    }
+
+    if (variant.mem) {
+        fprintf(file, ",\"mem\":{\"heap\":[%u,%u,%u],\"tasks\":[",
+            static_cast<unsigned>(_mem.heap_free), static_cast<unsigned>(_mem.heap_min_free),
+            static_cast<unsigned>(_mem.heap_largest_block));
+        for (size_t i = 0; i < MEM_TASK_COUNT; ++i) {
+            fprintf(file, "%s[%u,%u]", (i == 0) ? "" : ",",
+                static_cast<unsigned>(_mem.tasks[i].stack_size), static_cast<unsigned>(_mem.tasks[i].stack_min_free));
+        }
+        fprintf(file, "]}");
+    }
+
+    if (raw != NULL) {
+        fprintf(file, ",\"raw\":{\"mode\":%u,\"truncated\":%s,\"plants\":{", raw->mode, truncated ? "true" : "false");
+        for (size_t plant = 0; plant < raw_samples.size(); ++plant) {
+            fprintf(file, "%s\"%u\":[", (plant == 0) ? "" : ",", static_cast<unsigned>(plant));
+            for (size_t i = 0; i < raw_samples[plant].size(); ++i) {
+                fprintf(file, "%s%d", (i == 0) ? "" : ",", raw_samples[plant][i]);
+            }
+            fprintf(file, "]");
+        }
+        fprintf(file, "}}");
+    }
+
+    fprintf(file, "}\n");
+}
+
+static void _dump(const char* dir, const char* name, const char* ext, const void* data, size_t len) {
+    std::string path = std::string(dir) + "/" + name + ext;
+    FILE* file = fopen(path.c_str(), "wb");
+    TEST_ASSERT_NOT_NULL_MESSAGE(file, path.c_str());
+    TEST_ASSERT_EQUAL(len, fwrite(data, 1, len, file));
+    fclose(file);
+}
+
+/**
+ * Encodes a variant in both formats and writes it to dir, if there is one
+ * @param raw capture to attach, NULL for variants without one
+ */
+static void _encode_variant(const char* dir, const variant_t& variant, const raw_capture_t* raw,
+    const raw_samples_t& raw_samples, bool truncated) {
+    const wake_phase_stats_t* timing = variant.timing ? _timing : NULL;
+    const mem_stats_t* mem = variant.mem ? &_mem : NULL;
+
+    static char json[4096];
+    size_t json_len = encode_readings_json(json, sizeof(json), PLANT_NAMES, 2, NAME_LEN,
+        RECORDS, RECORD_COUNT, timing, mem, raw);
+    TEST_ASSERT_NOT_EQUAL_MESSAGE(0, json_len, variant.name);
+
+    static uint8_t binary[2048];
+    size_t binary_len = encode_readings_binary(binary, sizeof(binary), NODE_ID, 2,
+        RECORDS, RECORD_COUNT, timing, mem, raw);
+    TEST_ASSERT_NOT_EQUAL_MESSAGE(0, binary_len, variant.name);
+
+    if (dir == NULL) {
+        return;
+    }
+    _dump(dir, variant.name, ".json", json, json_len);
+    _dump(dir, variant.name, ".bin", binary, binary_len);
+
+    std::string path = std::string(dir) + "/" + variant.name + ".expected.json";
+    FILE* file = fopen(path.c_str(), "w");
+    TEST_ASSERT_NOT_NULL_MESSAGE(file, path.c_str());
+    _write_expected(file, variant, raw, raw_samples, truncated);
+    fclose(file);
+}
+
+TEST_CASE("every payload variant encodes in both formats", "[encoder][wire]")
+{
+    _build_summaries();
+    const char* dir = getenv("HOST_TESTS_PAYLOADS");
+
+    for (const variant_t& variant : VARIANTS) {
+        _encode_variant(dir, variant, variant.raw ? &_raw : NULL, _raw_samples, false);
+    }
+}
+
+#if RAW_CAPTURE_ENABLED
+TEST_CASE("raw captures of the sensor encode in both formats", "[encoder][wire]")
+{
+    //64 samples of 8 conversions per plant. the averaged samples fit in each plant's half of the capture, the
+    //512 conversions behind them don't
+    const uint8_t channels[] = {0, 3};
+    moisture_sensor_init(64, channels, 2);
+    int32_t values[2];
+    get_moisture_values(MOISTURE_SCALE, values);
+    _build_summaries();
+    const char* dir = getenv("HOST_TESTS_PAYLOADS");
+
+    raw_samples_t samples(2);
+    for (size_t slot = 0; slot < 2; ++slot) {
+        size_t count = 0;
+        const int* slot_samples = moisture_sensor_samples(slot, &count);
+        samples[slot].assign(slot_samples, slot_samples + count);
+    }
+    _raw_capture_take(RAW_CAPTURE_SAMPLES);
+    const raw_capture_t* raw = raw_capture_get();
+    TEST_ASSERT_NOT_NULL(raw);
+    TEST_ASSERT_EQUAL_UINT8(RAW_CAPTURE_SAMPLES, raw->mode);
+    _encode_variant(dir, {"capture_samples", true, true, true}, raw, samples, false);
+
+    raw_samples_t conversions(2);
+    size_t frame_len = 0;
+    const adc_hal_sample_t* frame = moisture_sensor_frame(&frame_len);
+    TEST_ASSERT_NOT_NULL(frame);
+    for (size_t i = 0; i < frame_len; ++i) {
+        for (size_t slot = 0; slot < 2; ++slot) {
+            if (frame[i].channel == moisture_sensor_channel(slot)) {
+                conversions[slot].push_back(frame[i].raw);
+            }
+        }
+    }
+    _raw_capture_take(RAW_CAPTURE_FULL_RATE);
+    raw = raw_capture_get();
+    TEST_ASSERT_NOT_NULL(raw);
+    TEST_ASSERT_EQUAL_UINT8(RAW_CAPTURE_FULL_RATE, raw->mode);
+    TEST_ASSERT_GREATER_THAN(RAW_CAPTURE_LEN - 8, raw->len); //both plants filled their share
+    _encode_variant(dir, {"capture_full_rate", true, true, true}, raw, conversions, true);
+
+    raw_capture_clear();
+}
+#endif
@@ -0,0 +1,161 @@
+# Compares encodings of raw ADC captures (see components/moisture_sensor/include/raw_capture.hpp) by size.
+# Reads the traces recorded by stand_in_server.py --raw-dir, one capture per line, or generates captures shaped
+# like the linux target's fake ADC (components/hal/linux/adc_hal_fake.cpp) with --synthetic.
+#
+# usage: python3 raw_capture_bench.py TRACE...
+#        python3 raw_capture_bench.py --synthetic [captures] [samples per capture]
+#
+# encodings:
+#   raw16          every sample as a u16, what the capture would cost uncompressed
+#   packed12       two samples in three bytes
+#   delta varint   zig-zag varint of the difference to the previous sample, what the firmware sends
+#   dod varint     zig-zag varint of the delta of deltas
+#   delta bits     the deltas bit packed in gorilla style buckets ('0', '10' + 7 bits, '110' + 9, '1110' + 12, '1111' + 16)
+#   dod bits       the same buckets over the delta of deltas, gorilla's timestamp scheme
+#   zlib raw16     raw16 through zlib at level 9, for reference, too heavy for the node
+
+import os
+import struct
+import sys
+import zlib
+
+from wire_format import decode_raw_samples
+
+# (prefix bits, prefix, value bits), the last bucket takes any 16 bit value
+_BUCKETS = [(1, 0b0, 0), (2, 0b10, 7), (3, 0b110, 9), (4, 0b1110, 12), (4, 0b1111, 16)]
+
+
+def zigzag(value):
+    return (value << 1) ^ (value >> 31)  # python's >> keeps the sign, like the firmware's on an int32_t
+
+
+def varint(value):
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value == 0:
+            out.append(byte)
+            return out
+        out.append(byte | 0x80)
+
+
+def deltas(samples):
+    prev = 0
+    out = []
+    for sample in samples:
+        out.append(sample - prev)
+        prev = sample
+    return out
+
+
+def encode_raw16(samples):
+    return struct.pack(f'<{len(samples)}H', *samples)
+
+
+def encode_packed12(samples):
+    out = bytearray()
+    for i in range(0, len(samples), 2):
+        a = samples[i]
+        b = samples[i + 1] if i + 1 < len(samples) else 0
+        out += bytes([a & 0xFF, (a >> 8) | ((b & 0x0F) << 4), b >> 4])
+    return out
+
+
+def encode_varints(values):
+    out = bytearray()
+    for value in values:
+        out += varint(zigzag(value))
+    return out
+
+
+def encode_bits(values):
+    bits = 0
+    for value in values:
+        for prefix_bits, _prefix, value_bits in _BUCKETS:
+            if value_bits == 0 and value == 0:
+                bits += prefix_bits
+                break
+            if value_bits > 0 and zigzag(value) < (1 << value_bits):
+                bits += prefix_bits + value_bits
+                break
+        else:
+            raise ValueError(f'{value} doesn\'t fit in 16 bits')
+    return bytes((bits + 7) // 8)  # only the size matters here
+
+
+ENCODINGS = [
+    ('raw16', encode_raw16),
+    ('packed12', encode_packed12),
+    ('delta varint', lambda s: encode_varints(deltas(s))),
+    ('dod varint', lambda s: encode_varints(deltas(deltas(s)))),
+    ('delta bits', lambda s: encode_bits(deltas(s))),
+    ('dod bits', lambda s: encode_bits(deltas(deltas(s)))),
+    ('zlib raw16', lambda s: zlib.compress(encode_raw16(s), 9)),
+]
+
+
+def check_firmware_encoding(samples):
+    """The delta varint column has to be what the node sends, decoded back by wire_format.py"""
+    data = struct.pack('<BH', 0, len(samples)) + encode_varints(deltas(samples))
+    if decode_raw_samples(data) != {0: samples}:
+        raise AssertionError('delta varint encoding doesn\'t round trip through wire_format.py')
+
+
+def synthetic_captures(captures, samples, channel=0):
+    """Captures shaped like adc_hal_fake.cpp: a level per channel, slow drift, uniform noise and periodic spikes"""
+    rng = 0x12345678
+    index = 0
+    out = []
+    for _ in range(captures):
+        capture = []
+        for _ in range(samples):
+            index += 1
+            rng ^= (rng << 13) & 0xFFFFFFFF
+            rng ^= rng >> 17
+            rng ^= (rng << 5) & 0xFFFFFFFF
+            if index % 97 == 0:
+                capture.append(4095)
+                continue
+            drift = (index // 1000) % 200 - 100
+            noise = rng % 25 - 12
+            capture.append(max(0, min(4095, 1800 + channel * 150 + drift + noise)))
+        out.append(capture)
+    return out
+
+
+def read_trace(path):
+    with open(path) as trace:
+        return [[int(sample) for sample in line.split()] for line in trace if line.strip()]
+
+
+def report(name, captures):
+    total_samples = sum(len(capture) for capture in captures)
+    if total_samples == 0:
+        print(f'{name}: no samples')
+        return
+
+    for capture in captures:
+        check_firmware_encoding(capture)
+
+    sizes = {label: sum(len(encode(capture)) for capture in captures) for label, encode in ENCODINGS}
+    print(f'{name}: {len(captures)} captures, {total_samples} samples')
+    print(f'  {"encoding":<14}{"bytes":>10}{"bytes/sample":>14}{"vs raw16":>10}')
+    for label, _encode in ENCODINGS:
+        size = sizes[label]
+        print(f'  {label:<14}{size:>10}{size / total_samples:>14.3f}{sizes["raw16"] / size:>9.2f}x')
+
+
+if __name__ == '__main__':
+    args = sys.argv[1:]
+    if not args:
+        print('usage: python3 raw_capture_bench.py TRACE... | --synthetic [captures] [samples per capture]')
+        sys.exit(1)
+
+    if args[0] == '--synthetic':
+        captures = int(args[1]) if len(args) > 1 else 16
+        samples = int(args[2]) if len(args) > 2 else 64
+        report(f'synthetic ({captures} x {samples})', synthetic_captures(captures, samples))
+    else:
+        for path in args:
+            report(os.path.basename(path), read_trace(path))
@@ -0,0 +1,129 @@
+# Stand-in for the backend's MQTT broker used by the linux host build of the firmware.
+# Accepts MQTT 3.1.1 connections, decodes every published reading (see wire_format.py) and prints it with its topic.
+# Only what the nodes use is implemented: CONNECT, PUBLISH with QoS 0 or 1, PINGREQ and DISCONNECT. sessions
+# are remembered by client id so a node that connects without the clean session flag gets session present back,
+# there are no subscribers.
+#
+# usage: python3 stand_in_broker.py [port] [--quiet]
+#   --quiet only counts messages instead of printing them, for load tests (see fleet_sim)
+
+import socketserver
+import struct
+import sys
+import threading
+
+from wire_format import BINARY_CONTENT_TYPE, JSON_CONTENT_TYPE, decode_payload
+
+CONNECT = 1
+CONNACK = 2
+PUBLISH = 3
+PUBACK = 4
+PINGREQ = 12
+PINGRESP = 13
+DISCONNECT = 14
+
+
+class StandInBroker(socketserver.ThreadingTCPServer):
+    daemon_threads = True
+    allow_reuse_address = True
+    quiet = False
+    received = 0
+    lock = threading.Lock()
+    sessions = set()  # client ids that connected without the clean session flag
+
+
+class BrokerHandler(socketserver.StreamRequestHandler):
+
+    def handle(self):
+        client_id = None
+        while True:
+            packet = self._read_packet()
+            if packet is None:
+                return
+            kind, flags, body = packet
+
+            if kind == CONNECT:
+                client_id = self._connect(body)
+            elif client_id is None:
+                return  # the first packet has to be CONNECT
+            elif kind == PUBLISH:
+                self._publish(flags, body)
+            elif kind == PINGREQ:
+                self.wfile.write(bytes([PINGRESP << 4, 0]))
+            elif kind == DISCONNECT:
+                return
+            else:
+                print(f'{client_id}: unsupported packet type {kind}, closing', flush=True)
+                return
+
+    def _read_packet(self):
+        first = self.rfile.read(1)
+        if not first:
+            return None
+
+        remaining = 0
+        for shift in range(0, 28, 7):
+            digit = self.rfile.read(1)
+            if not digit:
+                return None
+            remaining |= (digit[0] & 0x7F) << shift
+            if digit[0] & 0x80 == 0:
+                break
+
+        body = self.rfile.read(remaining)
+        if len(body) != remaining:
+            return None
+        return first[0] >> 4, first[0] & 0x0F, body
+
+    def _connect(self, body):
+        name_len, = struct.unpack_from('>H', body, 0)
+        level, flags, _keepalive, id_len = struct.unpack_from('>BBHH', body, 2 + name_len)
+        client_id = body[8 + name_len:8 + name_len + id_len].decode()
+        clean_session = bool(flags & 0x02)
+
+        with StandInBroker.lock:
+            present = not clean_session and client_id in StandInBroker.sessions
+            if clean_session:
+                StandInBroker.sessions.discard(client_id)
+            else:
+                StandInBroker.sessions.add(client_id)
+
+        return_code = 0 if level == 4 else 1  # 1: unacceptable protocol version
+        self.wfile.write(bytes([CONNACK << 4, 2, int(present), return_code]))
+        return client_id
+
+    def _publish(self, flags, body):
+        qos = (flags >> 1) & 0x03
+        topic_len, = struct.unpack_from('>H', body, 0)
+        topic = body[2:2 + topic_len].decode()
+        offset = 2 + topic_len
+        if qos > 0:
+            packet_id, = struct.unpack_from('>H', body, offset)
+            offset += 2
+        payload = body[offset:]
+
+        # mqtt has no content type, a json payload is an object and a binary one starts with its version byte
+        content_type = JSON_CONTENT_TYPE if payload.startswith(b'{') else BINARY_CONTENT_TYPE
+        try:
+            decoded = decode_payload(content_type, payload)
+        except ValueError as err:
+            decoded = f'undecodable: {err}'
+
+        if StandInBroker.quiet:
+            with StandInBroker.lock:
+                StandInBroker.received += 1
+                if StandInBroker.received % 1000 == 0:
+                    print(f'{StandInBroker.received} messages received', flush=True)
+        else:
+            print(f'{topic} {len(payload)} bytes: {decoded}', flush=True)
+
+        if qos > 0:
+            self.wfile.write(bytes([PUBACK << 4, 2]) + struct.pack('>H', packet_id))
+
+
+if __name__ == '__main__':
+    args = [arg for arg in sys.argv[1:] if arg != '--quiet']
+    StandInBroker.quiet = '--quiet' in sys.argv[1:]
+    port = int(args[0]) if args else 1883
+    print(f'stand-in broker listening on 127.0.0.1:{port}', flush=True)
+    StandInBroker(('127.0.0.1', port), BrokerHandler).serve_forever()
@@ -0,0 +1,90 @@
+# Stand-in for the backend used by the linux host build of the firmware.
+# Accepts POSTs on /submit-reading, decodes the body according to its content type (see wire_format.py),
+# prints it and keeps the connection alive like the real server.
+#
+# usage: python3 stand_in_server.py [port] [--quiet] [--directives JSON] [--raw-dir DIR]
+#   --quiet only counts requests instead of printing them, for load tests (see fleet_sim)
+#   --directives answers every request with JSON instead of "ok", ie '{"sleep_s": 60, "flush": true}'
+#   (see components/directives)
+#   --raw-dir appends the samples of every raw capture to DIR/<mode>_plant<id>.txt, one capture per line, for
+#   tools/raw_capture_bench.py (see components/moisture_sensor/include/raw_capture.hpp)
+
+import os
+import sys
+import threading
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+from wire_format import decode_payload
+
+SUBMIT_READING_ROUTE = '/submit-reading'
+
+
+class StandInHandler(BaseHTTPRequestHandler):
+    protocol_version = 'HTTP/1.1'  # keep-alive between requests
+    quiet = False
+    response = b'ok'
+    received = 0
+    received_lock = threading.Lock()
+    raw_dir = None
+
+    def do_POST(self):
+        length = int(self.headers.get('Content-Length', 0))
+        body = self.rfile.read(length)
+
+        if self.path != SUBMIT_READING_ROUTE:
+            self._respond(404, b'not found')
+            return
+
+        try:
+            payload = decode_payload(self.headers.get('Content-Type'), body)
+        except ValueError as err:
+            self._respond(400, str(err).encode())
+            return
+
+        if StandInHandler.raw_dir is not None and payload['raw'] is not None:
+            _record_raw(payload['raw'])
+
+        if StandInHandler.quiet:
+            with StandInHandler.received_lock:
+                StandInHandler.received += 1
+                if StandInHandler.received % 1000 == 0:
+                    print(f'{StandInHandler.received} requests received', flush=True)
+        else:
+            print(f'{len(body)} bytes: {payload}', flush=True)
+        self._respond(200, StandInHandler.response)
+
+    def log_message(self, format, *args):
+        if not StandInHandler.quiet:
+            super().log_message(format, *args)
+
+    def _respond(self, status, body):
+        self.send_response(status)
+        self.send_header('Content-Type', 'application/json' if body.startswith(b'{') else 'text/plain')
+        self.send_header('Content-Length', str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+
+def _record_raw(raw):
+    with StandInHandler.received_lock:
+        for plant_id, samples in raw['plants'].items():
+            path = os.path.join(StandInHandler.raw_dir, f"{raw['mode']}_plant{plant_id}.txt")
+            with open(path, 'a') as trace:
+                trace.write(' '.join(str(sample) for sample in samples) + '\n')
+
+
+if __name__ == '__main__':
+    args = [arg for arg in sys.argv[1:] if arg != '--quiet']
+    StandInHandler.quiet = '--quiet' in sys.argv[1:]
+    if '--directives' in args:
+        i = args.index('--directives')
+        StandInHandler.response = args[i + 1].encode()
+        del args[i:i + 2]
+    if '--raw-dir' in args:
+        i = args.index('--raw-dir')
+        StandInHandler.raw_dir = args[i + 1]
+        os.makedirs(StandInHandler.raw_dir, exist_ok=True)
+        del args[i:i + 2]
+    port = int(args[0]) if args else 8080
+    print(f'stand-in server listening on 127.0.0.1:{port}', flush=True)
+    ThreadingHTTPServer(('127.0.0.1', port), StandInHandler).serve_forever()
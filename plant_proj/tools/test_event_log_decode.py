@@ -0,0 +1,52 @@
+# Decodes an event log dump recorded by event_log.cpp on the host. the host tests write the dump of a ring that
+# overflowed along with the events that went in, see tools/host_tests/main/test_event_log.cpp
+#
+# usage: HOST_TESTS_PAYLOADS=<dir> ./build/host_tests.elf    (in tools/host_tests)
+#        HOST_TESTS_PAYLOADS=<dir> python3 test_event_log_decode.py
+
+import io
+import json
+import os
+import re
+import unittest
+
+from event_log_decode import DEFAULT_EVENTS_PATH, LEVEL_NAMES, decode_stream, load_events
+
+_LINE_RE = re.compile(r'wake +(\d+) +[\d.]+ ms (\w) (\w+) +(.*)$')
+
+
+class EventLogDecode(unittest.TestCase):
+    def setUp(self):
+        self.dir = os.environ.get('HOST_TESTS_PAYLOADS')
+        if not self.dir:
+            self.skipTest('HOST_TESTS_PAYLOADS is not set, run the host tests with it first')
+
+        with open(os.path.join(self.dir, 'event_log.events.json')) as file:
+            self.expected = json.load(file)
+        with open(os.path.join(self.dir, 'event_log.txt')) as file:
+            out = io.StringIO()
+            decode_stream(file, load_events(DEFAULT_EVENTS_PATH), out)
+            self.lines = out.getvalue().splitlines()
+
+    def test_markers(self):
+        entries = len(self.expected['entries'])
+        self.assertEqual('---- event log, %d entries, %d older ones were overwritten ----'
+                         % (entries, self.expected['lost']), self.lines[0])
+        self.assertEqual('---- end of event log ----', self.lines[-1])
+        self.assertEqual(entries + 2, len(self.lines))
+
+    def test_entries(self):
+        wakes = set()
+        for line, entry in zip(self.lines[1:-1], self.expected['entries']):
+            match = _LINE_RE.match(line)
+            self.assertIsNotNone(match, line)
+            wake, level, name, text = match.groups()
+            wakes.add(wake)
+            self.assertEqual(LEVEL_NAMES[entry['level']], level)
+            self.assertEqual(entry['name'], name)
+            self.assertEqual(entry['text'], text.rstrip())
+        self.assertEqual(1, len(wakes))  # recorded in one wake
+
+
+if __name__ == '__main__':
+    unittest.main()
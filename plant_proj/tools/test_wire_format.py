@@ -0,0 +1,115 @@
+# Round trip of the firmware's payload encoders through wire_format.py. the host tests write a json and a binary
+# payload of every variant (multiple records and plants, an untimed reading, the timing, memory and raw capture
+# trailers, and the captures raw_capture.cpp takes in both modes) along with the encoders' input, see
+# tools/host_tests/main/test_wire_format.cpp. both payloads have to decode to what went in
+#
+# usage: HOST_TESTS_PAYLOADS=<dir> ./build/host_tests.elf    (in tools/host_tests)
+#        HOST_TESTS_PAYLOADS=<dir> python3 test_wire_format.py
+
+import glob
+import json
+import os
+import unittest
+
+from wire_format import (BINARY_CONTENT_TYPE, JSON_CONTENT_TYPE, MEM_TASK_NAMES, MOISTURE_SCALE, RAW_CAPTURE_MODES,
+                         WAKE_PHASE_NAMES, decode_payload)
+
+VARIANTS = ['batch', 'timing', 'mem', 'raw', 'all']  # always written, the captures only with RAW_CAPTURE_ENABLED=1
+
+
+def expected_payload(encoded, binary):
+    """What wire_format.py should decode the encoders' input to. binary payloads name plants through plant_names"""
+    readings = []
+    for r in encoded['records']:
+        timed = r['ts'] != 0
+        readings.append({
+            'plant': encoded['plants'][r['plant_id']],
+            'wake': r['wake'],
+            'moisture': r['moisture'] / MOISTURE_SCALE,
+            'ts': r['ts'] if timed else None,
+            'ts_err': (min(r['ts_err'], 255) if binary else r['ts_err']) if timed else None,
+        })
+
+    timing = {}
+    for name, stats in zip(WAKE_PHASE_NAMES, encoded.get('timing', [])):
+        if stats['count'] == 0:
+            continue
+        timing[name] = {'count': stats['count'], 'min_us': stats['min_us'],
+                        'mean_us': stats['total_us'] // stats['count'], 'max_us': stats['max_us'],
+                        'histogram': stats['histogram']}
+
+    mem = None
+    if 'mem' in encoded:
+        saturate = (lambda value: min(value, 0xFFFF)) if binary else (lambda value: value)
+        heap_free, heap_min_free, largest_block = encoded['mem']['heap']
+        mem = {'heap_free': heap_free, 'heap_min_free': heap_min_free, 'heap_largest_block': largest_block,
+               'stacks': {name: {'size': saturate(size), 'min_free': saturate(min_free)}
+                          for name, (size, min_free) in zip(MEM_TASK_NAMES, encoded['mem']['tasks']) if size != 0}}
+
+    raw = None
+    if 'raw' in encoded:
+        raw = {'mode': RAW_CAPTURE_MODES[encoded['raw']['mode']],
+               'plants': {int(plant_id): samples for plant_id, samples in encoded['raw']['plants'].items()}}
+
+    return {'node': encoded['node'] if binary else None, 'readings': readings, 'timing': timing, 'mem': mem, 'raw': raw}
+
+
+class WireFormatRoundTrip(unittest.TestCase):
+    def setUp(self):
+        self.dir = os.environ.get('HOST_TESTS_PAYLOADS')
+        if not self.dir:
+            self.skipTest('HOST_TESTS_PAYLOADS is not set, run the host tests with it first')
+
+        suffix = '.expected.json'
+        self.variants = sorted(os.path.basename(path)[:-len(suffix)]
+                               for path in glob.glob(os.path.join(self.dir, '*' + suffix)))
+        missing = set(VARIANTS) - set(self.variants)
+        if missing:
+            self.fail(f'no payloads of {sorted(missing)} in {self.dir}')
+
+    def _read(self, variant, ext):
+        with open(os.path.join(self.dir, variant + ext), 'rb') as file:
+            return file.read()
+
+    def _decode(self, variant):
+        """Returns the encoders' input and the payload decoded from each format"""
+        encoded = json.loads(self._read(variant, '.expected.json'))
+        plant_names = {(encoded['node'], i): name for i, name in enumerate(encoded['plants'])}
+        from_json = decode_payload(JSON_CONTENT_TYPE, self._read(variant, '.json'))
+        from_binary = decode_payload(BINARY_CONTENT_TYPE, self._read(variant, '.bin'), plant_names)
+        return encoded, from_json, from_binary
+
+    def _assert_round_trip(self, encoded, decoded, binary):
+        expected = expected_payload(encoded, binary)
+        if encoded.get('raw', {}).get('truncated'):
+            # each plant gets a share of the capture, the samples past it are left out
+            self.assertEqual(expected['raw']['mode'], decoded['raw']['mode'])
+            self.assertEqual(expected['raw']['plants'].keys(), decoded['raw']['plants'].keys())
+            for plant_id, samples in decoded['raw']['plants'].items():
+                full = expected['raw']['plants'][plant_id]
+                self.assertTrue(0 < len(samples) < len(full))
+                self.assertEqual(full[:len(samples)], samples)
+            expected['raw'] = decoded['raw']
+        self.assertEqual(expected, decoded)
+
+    def test_json(self):
+        for variant in self.variants:
+            with self.subTest(variant=variant):
+                encoded, from_json, _ = self._decode(variant)
+                self._assert_round_trip(encoded, from_json, binary=False)
+
+    def test_binary(self):
+        for variant in self.variants:
+            with self.subTest(variant=variant):
+                encoded, _, from_binary = self._decode(variant)
+                self._assert_round_trip(encoded, from_binary, binary=True)
+
+    def test_formats_agree(self):
+        for variant in self.variants:
+            with self.subTest(variant=variant):
+                encoded, from_json, from_binary = self._decode(variant)
+                self.assertEqual(dict(from_json, node=encoded['node']), from_binary)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,225 @@
+# Reference decoder for the payloads sent by the nodes.
+# The format is picked from the request's content type:
+#   application/json             see components/payload_encoder/include/json_encoder.hpp
+#   application/x-leaf-readings  packed records, see components/payload_encoder/include/binary_encoder.hpp
+#
+# Both decode to the same shape so the backend doesn't care which one a node sends:
+#   {"node": <id or None>, "readings": [{"plant": <name or id>, "wake": <id>, "moisture": <percent>,
+#                                        "ts": <unix time or None>, "ts_err": <s or None>}], "timing": {...},
+#    "mem": {"heap_free": <bytes>, "heap_min_free": <bytes>, "heap_largest_block": <bytes>,
+#            "stacks": {<task>: {"size": <bytes>, "min_free": <bytes>}}} or None,
+#    "raw": {"mode": <samples or full_rate>, "plants": {<plant id>: [<sample>, ...]}} or None}
+# ts is None for readings sampled before the node had the time, the backend falls back to its own clock for those
+
+import base64
+import json
+import struct
+
+JSON_CONTENT_TYPE = 'application/json'
+BINARY_CONTENT_TYPE = 'application/x-leaf-readings'
+
+BINARY_FORMAT_VERSION = 2
+BINARY_FLAG_TIMING = 0x01
+BINARY_FLAG_MEMORY = 0x02
+BINARY_FLAG_RAW = 0x04
+BINARY_NO_TIME = 0xFFFF
+MOISTURE_SCALE = 100
+
+# must match wake_phase_t and WAKE_PHASE_NAMES in components/wake_timing
+WAKE_PHASE_NAMES = ['boot', 'sensor_init', 'sampling', 'wifi_start', 'got_ip', 'request', 'response', 'sleep']
+WAKE_TIMING_BUCKETS = 8
+
+# must match mem_task_t and MEM_TASK_NAMES in components/mem_stats
+MEM_TASK_NAMES = ['main', 'tracker', 'sampling', 'sampler', 'uplink']
+
+# must match raw_capture_mode_t in components/moisture_sensor/include/raw_capture.hpp
+RAW_CAPTURE_MODES = ['none', 'samples', 'full_rate']
+
+_HEADER = struct.Struct('<BBIIIB')
+_RECORD = struct.Struct('<BHiHB')
+# version 1, before timestamps
+_HEADER_V1 = struct.Struct('<BBIIB')
+_RECORD_V1 = struct.Struct('<BHi')
+_PHASE = struct.Struct('<IIII%dH' % WAKE_TIMING_BUCKETS)
+_HEAP = struct.Struct('<IIIB')
+_STACK = struct.Struct('<HH')
+_RAW = struct.Struct('<BH')
+_RAW_CHANNEL = struct.Struct('<BH')
+
+
+def decode_payload(content_type, body, plant_names=None):
+    """Decodes a request body. plant_names optionally maps (node id, plant id) to a plant name for binary payloads"""
+    media_type = (content_type or '').split(';')[0].strip().lower()
+
+    if media_type == BINARY_CONTENT_TYPE:
+        return decode_binary(body, plant_names)
+    if media_type == JSON_CONTENT_TYPE:
+        return decode_json(body)
+
+    raise ValueError(f'unsupported content type: {content_type}')
+
+
+def decode_json(body):
+    payload = json.loads(body)
+
+    # single reading, sent by firmware from before readings were batched: {"plant name": ..., "moisture": ...}
+    if 'readings' not in payload:
+        payload = {'readings': [dict(payload, wake=0)]}
+
+    timing = {}
+    for phase, values in payload.get('timing', {}).items():
+        timing[phase] = _timing_entry(values[:4], values[4:])
+
+    mem = None
+    if 'mem' in payload:
+        stacks = {task: values for task, values in payload['mem'].items() if task != 'heap'}
+        mem = _mem_entry(payload['mem']['heap'], stacks)
+
+    raw = None
+    if 'raw' in payload:
+        raw = _raw_entry(payload['raw']['mode'], base64.b64decode(payload['raw']['data']))
+
+    return {
+        'node': None,
+        'readings': [
+            {'plant': r['plant name'], 'wake': r['wake'], 'moisture': r['moisture'],
+             'ts': r.get('ts'), 'ts_err': r.get('ts_err')}
+            for r in payload['readings']
+        ],
+        'timing': timing,
+        'mem': mem,
+        'raw': raw,
+    }
+
+
+def decode_binary(body, plant_names=None):
+    if len(body) < 1:
+        raise ValueError('payload shorter than the header')
+
+    version = body[0]
+    if version == BINARY_FORMAT_VERSION:
+        header, record = _HEADER, _RECORD
+    elif version == 1:
+        header, record = _HEADER_V1, _RECORD_V1
+    else:
+        raise ValueError(f'unsupported binary format version: {version}')
+
+    if len(body) < header.size:
+        raise ValueError('payload shorter than the header')
+
+    if version == 1:
+        version, flags, node_id, base_wake, count = header.unpack_from(body, 0)
+        base_time = 0
+    else:
+        version, flags, node_id, base_wake, base_time, count = header.unpack_from(body, 0)
+
+    offset = header.size
+    if len(body) < offset + count * record.size:
+        raise ValueError('payload shorter than its records')
+
+    readings = []
+    for _ in range(count):
+        values = record.unpack_from(body, offset)
+        offset += record.size
+        plant_id, wake_delta, moisture = values[:3]
+        time_delta, time_error = values[3:] if version != 1 else (BINARY_NO_TIME, None)
+
+        plant = plant_id
+        if plant_names is not None:
+            plant = plant_names.get((node_id, plant_id), plant_id)
+
+        timed = time_delta != BINARY_NO_TIME
+        readings.append({
+            'plant': plant,
+            'wake': base_wake + wake_delta,
+            'moisture': moisture / MOISTURE_SCALE,
+            'ts': base_time + time_delta if timed else None,
+            'ts_err': time_error if timed else None,
+        })
+
+    timing = {}
+    if flags & BINARY_FLAG_TIMING:
+        mask = body[offset]
+        offset += 1
+        for i, name in enumerate(WAKE_PHASE_NAMES):
+            if mask & (1 << i):
+                values = _PHASE.unpack_from(body, offset)
+                offset += _PHASE.size
+                timing[name] = _timing_entry(values[:4], values[4:])
+
+    mem = None
+    if flags & BINARY_FLAG_MEMORY:
+        heap_free, heap_min_free, largest_block, mask = _HEAP.unpack_from(body, offset)
+        offset += _HEAP.size
+        stacks = {}
+        for i, name in enumerate(MEM_TASK_NAMES):
+            if mask & (1 << i):
+                stacks[name] = _STACK.unpack_from(body, offset)
+                offset += _STACK.size
+        mem = _mem_entry((heap_free, heap_min_free, largest_block), stacks)
+
+    raw = None
+    if flags & BINARY_FLAG_RAW:
+        mode, raw_len = _RAW.unpack_from(body, offset)
+        offset += _RAW.size
+        if len(body) < offset + raw_len:
+            raise ValueError('payload shorter than its raw capture')
+        raw = _raw_entry(mode, body[offset:offset + raw_len])
+        offset += raw_len
+
+    if offset != len(body):
+        raise ValueError('trailing bytes after the payload')
+
+    return {'node': node_id, 'readings': readings, 'timing': timing, 'mem': mem, 'raw': raw}
+
+
+def decode_raw_samples(data):
+    """Decodes the compressed samples of a raw capture into {plant id: [samples]}, see raw_capture.hpp"""
+    plants = {}
+    offset = 0
+    while offset < len(data):
+        if len(data) < offset + _RAW_CHANNEL.size:
+            raise ValueError('raw capture shorter than its channel header')
+        plant_id, count = _RAW_CHANNEL.unpack_from(data, offset)
+        offset += _RAW_CHANNEL.size
+
+        samples = []
+        sample = 0
+        for _ in range(count):
+            value, offset = _read_varint(data, offset)
+            sample += (value >> 1) ^ -(value & 1)  # zig-zag back to a signed delta
+            samples.append(sample)
+        plants[plant_id] = samples
+    return plants
+
+
+def _read_varint(data, offset):
+    value = 0
+    shift = 0
+    while True:
+        if offset >= len(data):
+            raise ValueError('raw capture ends inside a varint')
+        byte = data[offset]
+        offset += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if byte & 0x80 == 0:
+            return value, offset
+
+
+def _timing_entry(stats, histogram):
+    count, min_us, mean_us, max_us = stats
+    return {'count': count, 'min_us': min_us, 'mean_us': mean_us, 'max_us': max_us, 'histogram': list(histogram)}
+
+
+def _mem_entry(heap, stacks):
+    heap_free, heap_min_free, largest_block = heap
+    return {
+        'heap_free': heap_free, 'heap_min_free': heap_min_free, 'heap_largest_block': largest_block,
+        'stacks': {task: {'size': size, 'min_free': min_free} for task, (size, min_free) in stacks.items()},
+    }
+
+
+def _raw_entry(mode, data):
+    name = RAW_CAPTURE_MODES[mode] if mode < len(RAW_CAPTURE_MODES) else mode
+    return {'mode': name, 'plants': decode_raw_samples(data)}